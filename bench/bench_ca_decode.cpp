@@ -0,0 +1,153 @@
+#include <benchmark/benchmark.h>
+#include <db_access.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "epics/ca/ca_pv.h"
+
+// Decoding of CA replies and conversion of the decoded value to the node's
+// port type. Both run on the CA callback thread for every get and monitor.
+
+using namespace bchtree::epics;
+using bchtree::epics::ca::CAPV;
+
+namespace {
+
+// A DBR_TIME_* buffer as CA hands it to the callback
+template <typename Dbr>
+Dbr MakeDbr() {
+    Dbr dbr;
+    std::memset(&dbr, 0, sizeof(dbr));
+    return dbr;
+}
+
+template <typename Dbr>
+void DecodeScalar(benchmark::State& state, chtype type, const Dbr& dbr) {
+    for (auto _ : state) {
+        PVData data = CAPV::DecodePV(type, 1, &dbr, false);
+        benchmark::DoNotOptimize(data);
+    }
+}
+
+void BM_DecodeTimeString(benchmark::State& state) {
+    auto dbr = MakeDbr<dbr_time_string>();
+    std::strncpy(dbr.value, "SR:STATE:RUNNING", sizeof(dbr.value) - 1);
+    DecodeScalar(state, DBR_TIME_STRING, dbr);
+}
+
+void BM_DecodeTimeShort(benchmark::State& state) {
+    auto dbr = MakeDbr<dbr_time_short>();
+    dbr.value = 42;
+    DecodeScalar(state, DBR_TIME_SHORT, dbr);
+}
+
+void BM_DecodeTimeFloat(benchmark::State& state) {
+    auto dbr = MakeDbr<dbr_time_float>();
+    dbr.value = 1.5f;
+    DecodeScalar(state, DBR_TIME_FLOAT, dbr);
+}
+
+void BM_DecodeTimeEnum(benchmark::State& state) {
+    auto dbr = MakeDbr<dbr_time_enum>();
+    dbr.value = 3;
+    DecodeScalar(state, DBR_TIME_ENUM, dbr);
+}
+
+void BM_DecodeTimeLong(benchmark::State& state) {
+    auto dbr = MakeDbr<dbr_time_long>();
+    dbr.value = 123456;
+    DecodeScalar(state, DBR_TIME_LONG, dbr);
+}
+
+void BM_DecodeTimeDouble(benchmark::State& state) {
+    auto dbr = MakeDbr<dbr_time_double>();
+    dbr.value = 3.14;
+    DecodeScalar(state, DBR_TIME_DOUBLE, dbr);
+}
+
+// Waveform reply of range(0) doubles
+void BM_DecodeTimeDoubleArray(benchmark::State& state) {
+    const auto count = static_cast<long>(state.range(0));
+    // dbr_time_double holds the first element, the rest follows it
+    std::vector<char> buffer(sizeof(dbr_time_double) +
+                             sizeof(dbr_double_t) * (count - 1));
+    for (auto _ : state) {
+        PVData data =
+            CAPV::DecodePV(DBR_TIME_DOUBLE, count, buffer.data(), true);
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetBytesProcessed(state.iterations() * count *
+                            static_cast<int64_t>(sizeof(dbr_double_t)));
+}
+
+PVData ScalarData(PVScalarValue value) {
+    PVData data;
+    data.value = std::move(value);
+    data.count = 1;
+    return data;
+}
+
+template <typename T>
+void Extract(benchmark::State& state, const PVData& data) {
+    for (auto _ : state) {
+        T value = CAPV::extract_as<T>(data);
+        benchmark::DoNotOptimize(value);
+    }
+}
+
+void BM_ExtractDoubleAsDouble(benchmark::State& state) {
+    Extract<double>(state, ScalarData(PVScalarValue{2.5}));
+}
+
+void BM_ExtractLongAsDouble(benchmark::State& state) {
+    Extract<double>(state, ScalarData(PVScalarValue{int32_t{7}}));
+}
+
+void BM_ExtractDoubleAsInt(benchmark::State& state) {
+    Extract<int32_t>(state, ScalarData(PVScalarValue{2.5}));
+}
+
+void BM_ExtractStringAsString(benchmark::State& state) {
+    Extract<std::string>(
+        state, ScalarData(PVScalarValue{std::string("SR:STATE:RUNNING")}));
+}
+
+PVData ArrayData(PVArrayValue value, size_t count) {
+    PVData data;
+    data.value = std::move(value);
+    data.count = count;
+    return data;
+}
+
+// Same element type: the buffer is shared
+void BM_ExtractArraySameType(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    PVArray<double> arr = std::make_shared<std::vector<double>>(count, 1.0);
+    Extract<PVArray<double>>(state, ArrayData(PVArrayValue{arr}, count));
+}
+
+// Different element type: a new buffer is filled
+void BM_ExtractArrayConverted(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    PVArray<int32_t> arr = std::make_shared<std::vector<int32_t>>(count, 1);
+    Extract<PVArray<double>>(state, ArrayData(PVArrayValue{arr}, count));
+}
+
+}  // namespace
+
+BENCHMARK(BM_DecodeTimeString);
+BENCHMARK(BM_DecodeTimeShort);
+BENCHMARK(BM_DecodeTimeFloat);
+BENCHMARK(BM_DecodeTimeEnum);
+BENCHMARK(BM_DecodeTimeLong);
+BENCHMARK(BM_DecodeTimeDouble);
+BENCHMARK(BM_DecodeTimeDoubleArray)->Arg(16)->Arg(1024)->Arg(65536);
+
+BENCHMARK(BM_ExtractDoubleAsDouble);
+BENCHMARK(BM_ExtractLongAsDouble);
+BENCHMARK(BM_ExtractDoubleAsInt);
+BENCHMARK(BM_ExtractStringAsString);
+BENCHMARK(BM_ExtractArraySameType)->Arg(1024)->Arg(65536);
+BENCHMARK(BM_ExtractArrayConverted)->Arg(1024)->Arg(65536);
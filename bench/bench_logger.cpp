@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "logger.h"
+
+// Cost of a log call on the tick thread. Every mode writes to a file only;
+// the async modes hand the message to the background thread.
+
+using namespace bchtree;
+
+namespace {
+
+enum Mode { kSync = 0, kAsyncBlock = 1, kAsyncDrop = 2 };
+
+void BM_LoggerDebugLine(benchmark::State& state) {
+    const auto mode = static_cast<Mode>(state.range(0));
+    const auto path =
+        (std::filesystem::temp_directory_path() / "bch_tree_bench.log")
+            .string();
+
+    size_t dropped = 0;
+    {
+        Logger logger;
+        logger.setLevel("debug");
+        logger.setConsole(false);
+        logger.setFile(path);
+        if (mode != kSync) {
+            AsyncLogOptions options;
+            options.overflow = mode == kAsyncDrop ? LogOverflow::DropOldest
+                                                  : LogOverflow::Block;
+            logger.setAsync(options);
+        }
+
+        // Same shape as a RunnerLogger status change line
+        const std::string msg =
+            " [1700000000.123]: CAGetDouble              RUNNING -> SUCCESS";
+        for (auto _ : state) {
+            logger.debug(msg);
+        }
+        dropped = logger.droppedMessages();
+    }
+    state.counters["dropped"] = static_cast<double>(dropped);
+    std::remove(path.c_str());
+}
+
+// Debug line below the runtime level: the old string API builds the message
+// before the level is checked, the fmt API does not
+void BM_LoggerDisabledDebug(benchmark::State& state) {
+    const bool use_fmt = state.range(0) != 0;
+    Logger logger;
+    logger.setLevel("info");
+    logger.setConsole(false);
+
+    const std::string name = "CAGetDouble";
+    const double since_epoch = 1700000000.123;
+    for (auto _ : state) {
+        if (use_fmt) {
+            logger.debug(FMT_STRING(" [{:.3f}]: {} {} -> {}"), since_epoch,
+                         name, "RUNNING", "SUCCESS");
+        } else {
+            logger.debug(" [" + std::to_string(since_epoch) + "]: " + name +
+                         " RUNNING -> SUCCESS");
+        }
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_LoggerDisabledDebug)->ArgName("fmt")->Arg(0)->Arg(1);
+
+BENCHMARK(BM_LoggerDebugLine)
+    ->ArgName("mode")
+    ->Arg(kSync)
+    ->Arg(kAsyncBlock)
+    ->Arg(kAsyncDrop);
@@ -0,0 +1,183 @@
+#include <behaviortree_cpp/bt_factory.h>
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "actions/cacalc_node.h"
+#include "actions/caget_node.h"
+#include "actions/caput_node.h"
+#include "epics/loopback/loopback_transport.h"
+#include "epics/pv_manager.h"
+
+// Trees of thousands of nodes against the in-process loopback transport:
+// the cost of the runner, the nodes and the PV layer without an IOC or
+// network in the way.
+
+using namespace bchtree;
+using epics::loopback::LoopbackOptions;
+using epics::loopback::LoopbackTransport;
+
+namespace {
+
+// Same loop as BTRunner::TickUntilDone
+BT::NodeStatus RunOnce(BT::Tree& tree) {
+    BT::NodeStatus status = tree.tickOnce();
+    while (status == BT::NodeStatus::RUNNING) {
+        tree.sleep(std::chrono::milliseconds(100));
+        status = tree.tickOnce();
+    }
+    return status;
+}
+
+// range(0) nodes under one Parallel, each on its own PV
+std::string ParallelXml(const std::string& node, const std::string& attrs,
+                        int64_t count) {
+    std::string xml =
+        R"(<root BTCPP_format="4"><BehaviorTree ID="Main"><Parallel>)";
+    for (int64_t i = 0; i < count; ++i) {
+        xml += "<" + node + " pv=\"LB:PV" + std::to_string(i) + "\" " +
+               attrs + "/>";
+    }
+    return xml + "</Parallel></BehaviorTree></root>";
+}
+
+void RunParallelTree(benchmark::State& state, const std::string& node,
+                     const std::string& attrs,
+                     LoopbackOptions options = {}) {
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    auto pv_manager = std::make_shared<epics::PVManager>(transport);
+    auto deadlines = std::make_shared<DeadlineRegistry>();
+
+    BT::BehaviorTreeFactory factory;
+    factory.registerNodeType<CAGetNode<double>>("CAGetDouble", pv_manager,
+                                                deadlines);
+    factory.registerNodeType<CAPutNode<double>>("CAPutDouble", pv_manager,
+                                                deadlines);
+
+    auto tree =
+        factory.createTreeFromText(ParallelXml(node, attrs, state.range(0)));
+
+    // First execution connects the channels
+    if (RunOnce(tree) != BT::NodeStatus::SUCCESS) {
+        state.SkipWithError("tree failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (RunOnce(tree) != BT::NodeStatus::SUCCESS) {
+            state.SkipWithError("tree failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_LoopbackTreeGet(benchmark::State& state) {
+    RunParallelTree(state, "CAGetDouble",
+                    R"(use_monitor="false" result="{value}")");
+}
+
+void BM_LoopbackTreeMonitorGet(benchmark::State& state) {
+    // Values keep changing while the tree reads the monitor cache
+    LoopbackOptions options;
+    options.update_rate_hz = 100;
+    RunParallelTree(state, "CAGetDouble",
+                    R"(use_monitor="true" result="{value}")", options);
+}
+
+void BM_LoopbackTreePut(benchmark::State& state) {
+    RunParallelTree(state, "CAPutDouble", R"(value="1.5")");
+}
+
+// One CACalc over range(0) PVs whose values keep changing: the expression
+// reads every monitor cache on each tick
+void BM_LoopbackCalc(benchmark::State& state) {
+    LoopbackOptions options;
+    options.update_rate_hz = 100;
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    auto pv_manager = std::make_shared<epics::PVManager>(transport);
+
+    BT::BehaviorTreeFactory factory;
+    factory.registerNodeType<CACalcNode>("CACalc", pv_manager);
+
+    std::string expr = "0";
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        expr += " + LB:PV" + std::to_string(i);
+    }
+    auto tree = factory.createTreeFromText(
+        R"(<root BTCPP_format="4"><BehaviorTree ID="Main"><CACalc expr=")" +
+        expr + R"( &gt;= 0" result="{ok}"/></BehaviorTree></root>)");
+
+    // First execution connects the channels
+    if (RunOnce(tree) != BT::NodeStatus::SUCCESS) {
+        state.SkipWithError("tree failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (RunOnce(tree) != BT::NodeStatus::SUCCESS) {
+            state.SkipWithError("tree failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// One get through the worker thread and back
+void BM_LoopbackGetRoundTrip(benchmark::State& state) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    epics::PVManager manager(transport);
+    auto pv = manager.Get("LB:PV");
+    if (!manager.ConnectAll({pv}, std::chrono::seconds(1)).empty()) {
+        state.SkipWithError("loopback PV did not connect");
+        return;
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    for (auto _ : state) {
+        done = false;
+        pv->GetCB(
+            [&](epics::PVData) {
+                std::lock_guard<std::mutex> lock(mtx);
+                done = true;
+                cv.notify_one();
+            },
+            std::chrono::seconds(1));
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return done; });
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_LoopbackTreeGet)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_LoopbackTreeMonitorGet)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_LoopbackTreePut)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_LoopbackCalc)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK(BM_LoopbackGetRoundTrip)->UseRealTime();
@@ -0,0 +1,151 @@
+#include <behaviortree_cpp/bt_factory.h>
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "actions/caget_node.h"
+#include "actions/caput_node.h"
+#include "bt_runner.h"
+#include "epics/ca/ca_transport.h"
+#include "softioc_runner.h"
+
+// Tick-thread costs: the status line of RunnerLogger, and one complete
+// execution of CAGetNode/CAPutNode against a softIoc on localhost,
+// including the CA round trip.
+
+using namespace bchtree;
+
+namespace {
+
+// softIoc shared by every node benchmark, started on first use
+class LocalIoc {
+   public:
+    LocalIoc() {
+        setenv("EPICS_CA_AUTO_ADDR_LIST", "NO", 1);
+        setenv("EPICS_CA_ADDR_LIST", "127.0.0.1", 1);
+        ctx_->EnsureAttached();
+        runner_.Start(R"DB(
+            record(ao, "BENCH:AO") {
+                field(VAL,  "0")
+                field(PINI, "YES")
+            }
+        )DB");
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+    }
+    ~LocalIoc() { runner_.KillIfRunning(); }
+
+    std::shared_ptr<epics::ca::CAContextManager> ctx() const { return ctx_; }
+
+   private:
+    SoftIocRunner runner_;
+    std::shared_ptr<epics::ca::CAContextManager> ctx_{
+        std::make_shared<epics::ca::CAContextManager>()};
+};
+
+LocalIoc& SharedIoc() {
+    static LocalIoc ioc;
+    return ioc;
+}
+
+// Same loop as BTRunner::TickUntilDone
+BT::NodeStatus RunOnce(BT::Tree& tree) {
+    BT::NodeStatus status = tree.tickOnce();
+    while (status == BT::NodeStatus::RUNNING) {
+        tree.sleep(std::chrono::milliseconds(100));
+        status = tree.tickOnce();
+    }
+    return status;
+}
+
+void RunNodeTree(benchmark::State& state, const std::string& node_xml) {
+    auto transport =
+        std::make_shared<epics::ca::CATransport>(SharedIoc().ctx());
+    auto pv_manager = std::make_shared<epics::PVManager>(transport);
+    auto deadlines = std::make_shared<DeadlineRegistry>();
+
+    BT::BehaviorTreeFactory factory;
+    factory.registerNodeType<CAGetNode<double>>("CAGetDouble", pv_manager,
+                                                deadlines);
+    factory.registerNodeType<CAPutNode<double>>("CAPutDouble", pv_manager,
+                                                deadlines);
+
+    auto tree = factory.createTreeFromText(
+        R"(<root BTCPP_format="4"><BehaviorTree ID="Main">)" + node_xml +
+        "</BehaviorTree></root>");
+
+    // First execution connects the channel
+    if (RunOnce(tree) != BT::NodeStatus::SUCCESS) {
+        state.SkipWithError("node failed, is softIoc in PATH?");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (RunOnce(tree) != BT::NodeStatus::SUCCESS) {
+            state.SkipWithError("node failed");
+            break;
+        }
+    }
+}
+
+void BM_CAGetNodeTick(benchmark::State& state) {
+    RunNodeTree(state, R"(<CAGetDouble pv="BENCH:AO" use_monitor="false"
+                                       result="{value}"/>)");
+}
+
+void BM_CAGetNodeMonitorTick(benchmark::State& state) {
+    RunNodeTree(state, R"(<CAGetDouble pv="BENCH:AO" use_monitor="true"
+                                       result="{value}"/>)");
+}
+
+void BM_CAPutNodeTick(benchmark::State& state) {
+    RunNodeTree(state, R"(<CAPutDouble pv="BENCH:AO" value="1.5"/>)");
+}
+
+// RunnerLogger::callback for one status change; range(0) selects whether
+// debug is enabled (line written to a file) or filtered out
+void BM_RunnerLoggerCallback(benchmark::State& state) {
+    const bool enabled = state.range(0) != 0;
+    const auto path =
+        (std::filesystem::temp_directory_path() / "bch_tree_bench_rl.log")
+            .string();
+
+    {
+        auto logger = std::make_shared<Logger>();
+        logger->setLevel(enabled ? "debug" : "info");
+        logger->setConsole(false);
+        logger->setFile(path);
+
+        BT::BehaviorTreeFactory factory;
+        auto tree = factory.createTreeFromText(
+            R"(<root BTCPP_format="4"><BehaviorTree ID="Main">
+                 <AlwaysSuccess name="CAGetDouble"/>
+               </BehaviorTree></root>)");
+
+        RunnerLogger runner_logger(tree, logger);
+        BT::StatusChangeLogger& status_logger = runner_logger;
+        const BT::TreeNode& node = *tree.rootNode();
+        const auto timestamp = std::chrono::high_resolution_clock::now()
+                                   .time_since_epoch();
+
+        for (auto _ : state) {
+            status_logger.callback(timestamp, node, BT::NodeStatus::RUNNING,
+                                   BT::NodeStatus::SUCCESS);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+}  // namespace
+
+BENCHMARK(BM_CAGetNodeTick)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_CAGetNodeMonitorTick)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK(BM_CAPutNodeTick)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_RunnerLoggerCallback)->ArgName("debug")->Arg(0)->Arg(1);
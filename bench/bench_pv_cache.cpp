@@ -0,0 +1,184 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epics/pv_cache.h"
+
+// Contention benchmark for the monitor cache: writer threads play the CA
+// callback threads and update every PV at kUpdateRateHz, while the benchmark
+// thread plays the tick thread and reads the PVs round-robin.
+
+using namespace bchtree::epics;
+
+namespace {
+
+constexpr int kWriterThreads = 4;
+constexpr auto kUpdatePeriod = std::chrono::milliseconds(1);  // 1 kHz
+
+// Previous CAPV scheme: the value is assigned and copied under a mutex
+class MutexCache {
+   public:
+    void Publish(PVData data) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        data_ = std::move(data);
+        ++version_;
+    }
+    PVData Read() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return data_;
+    }
+
+   private:
+    mutable std::mutex mtx_;
+    PVData data_;
+    uint64_t version_{0};
+};
+
+// Value kinds selected by the second benchmark argument
+enum ValueKind { kDouble = 0, kString = 1 };
+
+PVData MakeValue(ValueKind kind, double value) {
+    PVData data;
+    if (kind == kString) {
+        // Longer than the SSO buffer, like most DBR_STRING values
+        data.value = PVScalarValue{"SR:STATE:" + std::to_string(value) +
+                                   ":RUNNING:NOMINAL"};
+    } else {
+        data.value = PVScalarValue{value};
+    }
+    data.count = 1;
+    return data;
+}
+
+size_t Consume(const PVData& data) {
+    const auto& v = std::get<PVScalarValue>(data.value);
+    if (const auto* s = std::get_if<PVString>(&v)) return s->size();
+    return static_cast<size_t>(std::get<double>(v));
+}
+
+size_t ReadValue(const PVCache& cache) {
+    auto snapshot = cache.Load();
+    return snapshot ? Consume(snapshot->data) : 0;
+}
+
+size_t ReadValue(const MutexCache& cache) { return Consume(cache.Read()); }
+
+// What CAPV::GetAs<double>() does: seqlock first, snapshot for strings
+struct NumericRead {
+    PVCache cache;
+    void Publish(PVData data) { cache.Publish(std::move(data)); }
+};
+
+size_t ReadValue(const NumericRead& r) {
+    if (auto v = r.cache.LoadNumeric()) {
+        return static_cast<size_t>(std::get<double>(*v));
+    }
+    return ReadValue(r.cache);
+}
+
+// Updates caches[i] for every i at kUpdatePeriod until destroyed
+template <typename Cache>
+class UpdateLoad {
+   public:
+    UpdateLoad(std::vector<Cache>& caches, ValueKind kind) : kind_(kind) {
+        const size_t slice = (caches.size() + kWriterThreads - 1) /
+                             kWriterThreads;
+        for (int w = 0; w < kWriterThreads; ++w) {
+            const size_t begin = std::min(caches.size(), w * slice);
+            const size_t end = std::min(caches.size(), begin + slice);
+            writers_.emplace_back([this, &caches, begin, end] {
+                Run(caches, begin, end);
+            });
+        }
+    }
+
+    ~UpdateLoad() {
+        stop_ = true;
+        for (auto& t : writers_) t.join();
+    }
+
+    uint64_t Published() const { return published_; }
+    double PublishNs() const {
+        return published_ ? static_cast<double>(publish_ns_) / published_
+                          : 0.0;
+    }
+
+   private:
+    void Run(std::vector<Cache>& caches, size_t begin, size_t end) {
+        using Clock = std::chrono::steady_clock;
+        auto next = Clock::now();
+        double value = 0.0;
+        while (!stop_) {
+            const auto t0 = Clock::now();
+            for (size_t i = begin; i < end; ++i) {
+                caches[i].Publish(MakeValue(kind_, value));
+            }
+            const auto t1 = Clock::now();
+            publish_ns_ +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                    .count();
+            published_ += end - begin;
+            value += 1.0;
+
+            next += kUpdatePeriod;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    const ValueKind kind_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> publish_ns_{0};
+    std::vector<std::thread> writers_;
+};
+
+template <typename Cache>
+void ReadUnderUpdates(benchmark::State& state) {
+    const auto kind = static_cast<ValueKind>(state.range(1));
+    std::vector<Cache> caches(static_cast<size_t>(state.range(0)));
+    for (auto& cache : caches) cache.Publish(MakeValue(kind, 0.0));
+    UpdateLoad<Cache> load(caches, kind);
+
+    size_t i = 0;
+    size_t sum = 0;
+    for (auto _ : state) {
+        sum += ReadValue(caches[i]);
+        if (++i == caches.size()) i = 0;
+    }
+    benchmark::DoNotOptimize(sum);
+
+    state.counters["updates"] = benchmark::Counter(
+        static_cast<double>(load.Published()), benchmark::Counter::kIsRate);
+    state.counters["publish_ns"] = load.PublishNs();
+}
+
+}  // namespace
+
+static void BM_PVCache_ReadUnderUpdates(benchmark::State& state) {
+    ReadUnderUpdates<PVCache>(state);
+}
+BENCHMARK(BM_PVCache_ReadUnderUpdates)
+    ->ArgsProduct({{100, 1000, 5000}, {kDouble, kString}})
+    ->ArgNames({"pvs", "string"})
+    ->UseRealTime();
+
+static void BM_PVCache_NumericReadUnderUpdates(benchmark::State& state) {
+    ReadUnderUpdates<NumericRead>(state);
+}
+BENCHMARK(BM_PVCache_NumericReadUnderUpdates)
+    ->ArgsProduct({{100, 1000, 5000}, {kDouble, kString}})
+    ->ArgNames({"pvs", "string"})
+    ->UseRealTime();
+
+static void BM_MutexCache_ReadUnderUpdates(benchmark::State& state) {
+    ReadUnderUpdates<MutexCache>(state);
+}
+BENCHMARK(BM_MutexCache_ReadUnderUpdates)
+    ->ArgsProduct({{100, 1000, 5000}, {kDouble, kString}})
+    ->ArgNames({"pvs", "string"})
+    ->UseRealTime();
@@ -0,0 +1,172 @@
+#include <benchmark/benchmark.h>
+#include <db_access.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "callback_guard.h"
+#include "epics/ca/ca_pv.h"
+#include "epics/pv_cache.h"
+
+// Heap allocations on the monitor path: decoding the CA event, publishing it
+// to the cache and copying the value out, as GetAs<PVData>() does. The
+// allocs/op counter should be 0 for scalars and strings, 1 for arrays (the
+// element buffer).
+//
+// And on the request path, a get or put issued as the nodes do and completed
+// at once by a backend without a network: 0 once the PV has a request
+// context in its pool.
+
+namespace {
+// Per thread, so that counting does not contend between benchmark threads
+thread_local uint64_t t_allocations = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+    ++t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace bchtree::epics;
+using bchtree::epics::ca::CAPV;
+
+namespace {
+
+void ReportAllocations(benchmark::State& state, uint64_t allocations) {
+    state.counters["allocs/op"] = benchmark::Counter(
+        static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// One monitor event: decode and publish, then read the value back
+void MonitorUpdate(benchmark::State& state, chtype type, long count,
+                   const void* dbr, bool is_array) {
+    PVCache cache;
+    cache.Publish(CAPV::DecodePV(type, count, dbr, is_array));
+
+    const uint64_t before = t_allocations;
+    for (auto _ : state) {
+        cache.Publish(CAPV::DecodePV(type, count, dbr, is_array));
+        benchmark::DoNotOptimize(cache.Load()->version);
+    }
+    ReportAllocations(state, t_allocations - before);
+}
+
+void BM_MonitorUpdateString(benchmark::State& state) {
+    dbr_time_string dbr;
+    std::memset(&dbr, 0, sizeof(dbr));
+    // Longer than the small string buffer of std::string
+    std::strncpy(dbr.value, "SR:STATE:RUNNING:NOMINAL", sizeof(dbr.value) - 1);
+    MonitorUpdate(state, DBR_TIME_STRING, 1, &dbr, false);
+}
+
+void BM_MonitorUpdateDouble(benchmark::State& state) {
+    dbr_time_double dbr;
+    std::memset(&dbr, 0, sizeof(dbr));
+    dbr.value = 3.14;
+    MonitorUpdate(state, DBR_TIME_DOUBLE, 1, &dbr, false);
+}
+
+void BM_MonitorUpdateDoubleArray(benchmark::State& state) {
+    const auto count = static_cast<long>(state.range(0));
+    std::vector<char> buffer(sizeof(dbr_time_double) +
+                             sizeof(dbr_double_t) * (count - 1));
+    MonitorUpdate(state, DBR_TIME_DOUBLE, count, buffer.data(), true);
+}
+
+// GetAs<PVData>() returns a copy of the cached value
+void BM_CopyPVDataString(benchmark::State& state) {
+    PVCache cache;
+    PVData data;
+    data.value = PVScalarValue{"SR:STATE:RUNNING:NOMINAL"};
+    data.count = 1;
+    cache.Publish(std::move(data));
+
+    const uint64_t before = t_allocations;
+    for (auto _ : state) {
+        PVData copy = cache.Load()->data;
+        benchmark::DoNotOptimize(copy);
+    }
+    ReportAllocations(state, t_allocations - before);
+}
+
+// Completes every request inside DoGetCB/DoPutCB, as if the reply came back
+// immediately
+class ImmediatePV : public PV {
+   public:
+    void SetMaxElements(size_t) override {}
+    void SetFlightRecorder(std::shared_ptr<bchtree::FlightRecorder>) override {
+    }
+    void AddConnCB(ConnCallback) override {}
+    void Connect() override {}
+    std::string GetPVname() const override { return "BENCH:PV"; }
+    bool IsConnected() const override { return true; }
+
+   protected:
+    bool DoGetCB(GetRequest* req, std::chrono::milliseconds, bool) override {
+        CompleteGet(req, reply_);
+        return true;
+    }
+    bool DoPutCB(const PVScalarValue&, PutRequest* req, bool) override {
+        CompletePut(req, true);
+        return true;
+    }
+
+   private:
+    const PVData reply_ = [] {
+        PVData data;
+        data.value = PVScalarValue{3.14};
+        data.count = 1;
+        return data;
+    }();
+};
+
+// range(0) != 0 times the requests into PVMetrics
+void BM_GetRequest(benchmark::State& state) {
+    ImmediatePV pv;
+    if (state.range(0)) pv.SetMetrics(std::make_shared<bchtree::PVMetrics>());
+    bchtree::CallbackGuard callbacks;
+    double sink = 0;
+    // As CAGetNode keeps it
+    const GetCallbackAs<double> cb =
+        callbacks.Wrap([&sink](double value) { sink = value; });
+    pv.GetCBAs<double>(cb, std::chrono::seconds(1));
+
+    const uint64_t before = t_allocations;
+    for (auto _ : state) {
+        pv.GetCBAs<double>(cb, std::chrono::seconds(1));
+    }
+    ReportAllocations(state, t_allocations - before);
+    benchmark::DoNotOptimize(sink);
+}
+
+void BM_PutRequest(benchmark::State& state) {
+    ImmediatePV pv;
+    if (state.range(0)) pv.SetMetrics(std::make_shared<bchtree::PVMetrics>());
+    bchtree::CallbackGuard callbacks;
+    bool sink = false;
+    const PutCallback cb =
+        callbacks.Wrap([&sink](bool success) { sink = success; });
+    const PVScalarValue value{1.0};
+    pv.PutCB(value, cb);
+
+    const uint64_t before = t_allocations;
+    for (auto _ : state) {
+        pv.PutCB(value, cb);
+    }
+    ReportAllocations(state, t_allocations - before);
+    benchmark::DoNotOptimize(sink);
+}
+
+}  // namespace
+
+BENCHMARK(BM_MonitorUpdateString);
+BENCHMARK(BM_MonitorUpdateDouble);
+BENCHMARK(BM_MonitorUpdateDoubleArray)->Arg(16)->Arg(1024);
+BENCHMARK(BM_CopyPVDataString);
+BENCHMARK(BM_GetRequest)->Arg(0)->Arg(1);
+BENCHMARK(BM_PutRequest)->Arg(0)->Arg(1);
@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "epics/ca/ca_pv.h"
+#include "epics/ca/ca_transport.h"
+#include "epics/pv_manager.h"
+#include "epics/request_pool.h"
+
+// PV lookups as done by the nodes in onStart(). The registry is filled
+// once; the benchmark threads only look up existing names. Channels are
+// never connected, so no IOC is needed.
+
+using namespace bchtree::epics;
+using namespace bchtree::epics::ca;
+
+namespace {
+
+constexpr size_t kRegistryPVs = 50000;
+
+struct Registry {
+    Registry()
+        : manager(std::make_shared<CATransport>(
+              std::make_shared<CAContextManager>())) {
+        for (size_t i = 0; i < kRegistryPVs; ++i) {
+            names.push_back("BENCH:PV" + std::to_string(i));
+        }
+        pvs = manager.GetMany(names);
+        for (const auto& name : names) {
+            handles.push_back(manager.Intern(name));
+        }
+    }
+
+    PVManager manager;
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<PV>> pvs;  // keeps the entries alive
+    std::vector<PVHandle> handles;
+};
+
+Registry& SharedRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+// Each thread walks the names from a different offset
+size_t StartIndex(const benchmark::State& state) {
+    return static_cast<size_t>(state.thread_index()) * 7919 % kRegistryPVs;
+}
+
+void BM_PVManagerGet(benchmark::State& state) {
+    auto& registry = SharedRegistry();
+    size_t i = StartIndex(state);
+    for (auto _ : state) {
+        auto pv = registry.manager.Get(registry.names[i]);
+        benchmark::DoNotOptimize(pv);
+        if (++i == kRegistryPVs) i = 0;
+    }
+}
+
+void BM_PVManagerGetHandle(benchmark::State& state) {
+    auto& registry = SharedRegistry();
+    size_t i = StartIndex(state);
+    for (auto _ : state) {
+        auto pv = registry.manager.Get(registry.handles[i]);
+        benchmark::DoNotOptimize(pv);
+        if (++i == kRegistryPVs) i = 0;
+    }
+}
+
+// range(0) names per call, reported per PV
+void BM_PVManagerGetMany(benchmark::State& state) {
+    auto& registry = SharedRegistry();
+    const auto batch = static_cast<size_t>(state.range(0));
+    const size_t first = StartIndex(state) % (kRegistryPVs - batch);
+    const std::vector<std::string> names(
+        registry.names.begin() + static_cast<std::ptrdiff_t>(first),
+        registry.names.begin() + static_cast<std::ptrdiff_t>(first + batch));
+
+    for (auto _ : state) {
+        auto pvs = registry.manager.GetMany(names);
+        benchmark::DoNotOptimize(pvs);
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(batch));
+}
+
+// Per-request context of PV::GetCB: taken from the pool when the get is
+// issued and returned by the completion
+void BM_GetRequestContext(benchmark::State& state) {
+    struct Request {
+        GetCallback cb;
+        ErrorCallback err_cb;
+        uint64_t serial = 0;
+        Request* next = nullptr;
+    };
+    RequestPool<Request> pool;
+    double sink = 0;
+    for (auto _ : state) {
+        Request* req = pool.Acquire();
+        req->cb = [&sink](PVData) { sink = 1.0; };
+        req->err_cb = [&sink](int) { sink = 0; };
+        benchmark::DoNotOptimize(req);
+
+        GetCallback cb = pool.Release(req, [](Request& r) {
+            r.err_cb = nullptr;
+            return std::move(r.cb);
+        });
+        cb(PVData{});
+    }
+    benchmark::DoNotOptimize(sink);
+}
+
+}  // namespace
+
+BENCHMARK(BM_PVManagerGet)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PVManagerGetHandle)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PVManagerGetMany)->Arg(100)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_GetRequestContext);
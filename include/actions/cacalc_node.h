@@ -0,0 +1,79 @@
+#pragma once
+#include <behaviortree_cpp/behavior_tree.h>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/pv.h"
+#include "epics/pv_expression.h"
+#include "epics/pv_manager.h"
+
+namespace bchtree {
+
+// Evaluate [expr] (see PVExpression) over the monitor values of the PVs it
+// names and write the result to [result]. A literal [expr] is compiled when
+// the tree is created, so syntax errors fail the load; the PVs are bound on
+// the first tick and read from their caches without a request to the IOC.
+//
+// Returns SUCCESS once every PV is connected with a numeric value or, with
+// [until], once the result is true; the expression is evaluated again on
+// each monitor update while waiting. Returns FAILURE after [timeout] ms.
+class CACalcNode : public BT::StatefulActionNode, public CallbackOwner {
+   public:
+    static constexpr int kDefaultTimeoutMs = 5000;
+
+    explicit CACalcNode(const std::string& name, const BT::NodeConfig& cfg,
+                        std::shared_ptr<epics::PVManager> pv_manager,
+                        std::shared_ptr<DeadlineRegistry> deadlines = nullptr);
+
+    // Ports definition for BehaviorTree.CPP
+    static BT::PortsList providedPorts();
+
+    // Lifecycle
+    BT::NodeStatus onStart() override;
+    BT::NodeStatus onRunning() override;
+    void onHalted() override;
+
+    CACalcNode(const CACalcNode&) = delete;
+    CACalcNode& operator=(const CACalcNode&) = delete;
+
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
+   private:
+    void compile(const std::string& text);
+    void bindPVs();
+    void unbindPVs();
+    // nullopt until every PV is connected and has a value
+    std::optional<double> evaluate();
+
+    void armDeadline();
+    void disarmDeadline();
+
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+
+    std::optional<epics::PVExpression> expr_;
+    // One per name of expr_, empty until bound
+    std::vector<std::shared_ptr<epics::PV>> pvs_;
+    // The monitor callback of each of pvs_
+    std::vector<epics::MonitorCallbackId> monitor_ids_;
+    std::vector<double> values_;
+    std::atomic<bool> waiting_{false};
+
+    // Inputs
+    bool until_{false};
+    int timeout_ms_{kDefaultTimeoutMs};
+
+    std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
+};
+
+}  // namespace bchtree
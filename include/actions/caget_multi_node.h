@@ -0,0 +1,97 @@
+#pragma once
+#include <behaviortree_cpp/behavior_tree.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/pv.h"
+#include "epics/pv_manager.h"
+#include "epics/types.h"
+
+namespace bchtree {
+
+// Read many PVs at once: every get is queued first and sent with a single
+// flush. [pvs] accepts a list and brace patterns (see ExpandPVNames).
+// Returns SUCCESS when all PVs were read. Otherwise returns FAILURE and
+// lists the PVs that failed in [failed]; values read so far are still
+// written to [result].
+class CAGetMultiNode : public BT::StatefulActionNode, public CallbackOwner {
+   public:
+    static constexpr int kDefaultTimeoutMs = 1000;
+
+    explicit CAGetMultiNode(
+        const std::string& name, const BT::NodeConfig& cfg,
+        std::shared_ptr<epics::PVManager> pv_manager,
+        std::shared_ptr<DeadlineRegistry> deadlines = nullptr);
+
+    // Ports definition for BehaviorTree.CPP
+    static BT::PortsList providedPorts();
+
+    // Lifecycle
+    BT::NodeStatus onStart() override;
+    BT::NodeStatus onRunning() override;
+    void onHalted() override;
+
+    CAGetMultiNode(const CAGetMultiNode&) = delete;
+    CAGetMultiNode& operator=(const CAGetMultiNode&) = delete;
+
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
+   private:
+    enum class SlotState { kPending, kRequested, kDone, kFailed };
+
+    struct Slot {
+        std::string name;
+        std::shared_ptr<epics::PV> pv;
+        SlotState state{SlotState::kPending};
+        // The get issued for this execution, touched by the tick thread only
+        epics::RequestHandle request;
+        epics::PVData value;
+    };
+
+    void watchConnection(const std::shared_ptr<epics::PV>& pv);
+    void resolvePVs(const std::string& spec);
+    void issuePendingGets();
+    void handleGetResult(uint64_t generation, size_t index,
+                         epics::PVData value);
+    void handleGetError(uint64_t generation, size_t index);
+    BT::NodeStatus finish();
+
+    // Frees what the callbacks of replies that may never come hold
+    void cancelRequests();
+
+    void armDeadline();
+    void disarmDeadline();
+    bool deadlineExpired() const;
+
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+    // PVs given a connection callback, once each across [pvs] changes
+    std::set<std::weak_ptr<epics::PV>, std::owner_less<>> watched_;
+
+    // Guards slots_, remaining_ and generation_ against CA callbacks
+    std::mutex mtx_;
+    std::vector<Slot> slots_;
+    size_t remaining_{0};
+    uint64_t generation_{0};
+
+    // Inputs
+    std::string spec_;
+    int timeout_ms_{kDefaultTimeoutMs};
+
+    std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+    std::atomic<bool> timed_out_{false};
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
+};
+
+}  // namespace bchtree
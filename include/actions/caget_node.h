@@ -1,24 +1,38 @@
 #pragma once
 #include <behaviortree_cpp/behavior_tree.h>
 
-#include "epics/ca/ca_pv.h"
-#include "epics/ca/ca_pv_manager.h"
+#include <iostream>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/monitor_filter.h"
+#include "epics/pv.h"
+#include "epics/pv_manager.h"
+#include "epics/pv_names.h"
 #include "epics/types.h"
 
 namespace bchtree {
 
 template <typename T>
-class CAGetNode : public BT::StatefulActionNode {
+class CAGetNode : public BT::StatefulActionNode, public CallbackOwner {
    public:
     static constexpr int kDefaultTimeoutMs = 1000;
 
+    // Names in [pv] without a scheme get pv_scheme, e.g. "pva" for the
+    // pvAccess variants
     explicit CAGetNode(const std::string& name, const BT::NodeConfig& cfg,
-                       std::shared_ptr<epics::ca::CAContextManager> ctx,
-                       std::shared_ptr<epics::ca::PVManager> pv_manager)
+                       std::shared_ptr<epics::PVManager> pv_manager,
+                       std::shared_ptr<DeadlineRegistry> deadlines = nullptr,
+                       std::string pv_scheme = "")
         : BT::StatefulActionNode(name, cfg),
-          ctx_(ctx),
-          pv_manager_(pv_manager) {
-        ctx_->EnsureAttached();
+          pv_manager_(pv_manager),
+          deadlines_(deadlines),
+          pv_scheme_(std::move(pv_scheme)) {
+        pv_manager_->Attach();
+        // Wrapped once: each get takes a copy, without allocating
+        get_cb_ = callbacks_.Wrap(
+            [this](T sample) { handleGetResult(std::move(sample)); });
+        err_cb_ = callbacks_.Wrap([this](int) { handleGetError(); });
     }
 
     // Ports definition for BehaviorTree.CPP
@@ -28,6 +42,8 @@ class CAGetNode : public BT::StatefulActionNode {
             InputPort<std::string>("pv"),
             InputPort<int>("timeout"),
             InputPort<bool>("use_monitor"),
+            InputPort<std::string>("monitor",
+                                   "Monitor options, e.g. deadband=0.5"),
             OutputPort<T>("result"),
         };
     }
@@ -35,7 +51,10 @@ class CAGetNode : public BT::StatefulActionNode {
     // Lifecycle
     BT::NodeStatus onStart() override {
         cancelled_ = false;
+        timed_out_ = false;
         done_ = false;
+        failed_ = false;
+        claimed_ = false;
         requested_ = false;
 
         if (!BT::TreeNode::getInput("pv", pv_name_)) {
@@ -44,18 +63,29 @@ class CAGetNode : public BT::StatefulActionNode {
         BT::TreeNode::getInput("timeout", timeout_ms_);
         BT::TreeNode::getInput("use_monitor", use_monitor_);
 
-        promise_ = std::promise<T>();
-        future_ = promise_.get_future();
-
         deadline_ = std::chrono::steady_clock::now() +
                     std::chrono::milliseconds(timeout_ms_);
 
         if (!pv_) {
-            pv_ = pv_manager_->Get(pv_name_);
-            pv_->AddConnCB(
-                [this](bool connected) { handleConnection(connected); });
+            const auto full_name = epics::WithPVScheme(pv_scheme_, pv_name_);
+            setMonitorOptions(full_name);
+            pv_ = pv_manager_->Get(full_name);
+            if constexpr (epics::is_pv_array_v<T>) pv_->ExpectArray();
+            pv_->AddConnCB(callbacks_.Wrap(
+                [this](bool connected) { handleConnection(connected); }));
+            // Only the updates a waiting node needs are queued
+            pv_->AddMonitorCB(callbacks_.WrapMonitor(
+                [this](const epics::PVData&) {
+                    return waiting_monitor_.load();
+                },
+                [this](const epics::PVData&) { handleMonitorUpdate(); }));
         }
 
+        // Armed before anything can complete so that a callback racing with
+        // onStart() still wakes the tree
+        waiting_monitor_ = use_monitor_;
+        armDeadline();
+
         connected_ = pv_->IsConnected();
 
         if (!connected_) {
@@ -65,6 +95,12 @@ class CAGetNode : public BT::StatefulActionNode {
 
         // Use monitor value
         if (use_monitor_) {
+            if (!pv_->HasValue()) {
+                // Wait for the first monitor update
+                return BT::NodeStatus::RUNNING;
+            }
+            waiting_monitor_ = false;
+            disarmDeadline();
             T sample = pv_->GetAs<T>();
             setOutput("result", sample);
             return BT::NodeStatus::SUCCESS;
@@ -72,10 +108,10 @@ class CAGetNode : public BT::StatefulActionNode {
 
         // Issue getCB
         bool status =
-            pv_->GetCBAs<T>([this](T sample) { handleGetResult(sample); },
-                            std::chrono::milliseconds(timeout_ms_));
+            pv_->GetCBAs<T>(get_cb_, std::chrono::milliseconds(timeout_ms_),
+                            err_cb_, true, &request_);
         if (!status) {
-            throw BT::RuntimeError("CAGetNode: failed to call getCB");
+            return requestRefused();
         }
         requested_ = true;
 
@@ -83,37 +119,44 @@ class CAGetNode : public BT::StatefulActionNode {
     }
 
     BT::NodeStatus onRunning() override {
-        if (use_monitor_ && connected_) {
-            T sample = pv_->GetAs<T>();
-            setOutput("result", sample);
-            return BT::NodeStatus::SUCCESS;
-        }
-
-        if (!requested_ && connected_) {
+        if (use_monitor_) {
+            waiting_monitor_ = true;
+            if (connected_ && pv_->HasValue()) {
+                waiting_monitor_ = false;
+                disarmDeadline();
+                T sample = pv_->GetAs<T>();
+                setOutput("result", sample);
+                return BT::NodeStatus::SUCCESS;
+            }
+        } else if (!requested_ && connected_) {
             // Issue get
-            bool status =
-                pv_->GetCBAs<T>([this](T sample) { handleGetResult(sample); },
-                                std::chrono::milliseconds(timeout_ms_));
+            bool status = pv_->GetCBAs<T>(
+                get_cb_, std::chrono::milliseconds(timeout_ms_), err_cb_, true,
+                &request_);
             if (!status) {
-                throw BT::RuntimeError("CAGetNode: failed to call getCB");
+                return requestRefused();
             }
             requested_ = true;
         }
 
         // Check condition
-        if (done_) {
-            try {
-                auto samp = future_.get();
-                setOutput("result", samp);
-                return BT::NodeStatus::SUCCESS;
-            } catch (...) {
-                return BT::NodeStatus::FAILURE;
-            }
+        if (done_.load(std::memory_order_acquire)) {
+            disarmDeadline();
+            setOutput("result", result_);
+            return BT::NodeStatus::SUCCESS;
+        }
+        // Error status from the IOC, or a reply not convertible to T
+        if (failed_.load(std::memory_order_acquire)) {
+            disarmDeadline();
+            return BT::NodeStatus::FAILURE;
         }
 
         // timeout
-        if (std::chrono::steady_clock::now() > deadline_) {
+        if (deadlineExpired()) {
             cancelled_ = true;
+            cancelRequest();
+            waiting_monitor_ = false;
+            disarmDeadline();
             return BT::NodeStatus::FAILURE;
         }
 
@@ -121,41 +164,127 @@ class CAGetNode : public BT::StatefulActionNode {
         return BT::NodeStatus::RUNNING;
     }
 
-    void onHalted() override { cancelled_ = true; }
+    void onHalted() override {
+        cancelled_ = true;
+        cancelRequest();
+        waiting_monitor_ = false;
+        disarmDeadline();
+    }
 
-    // Non-copyable / movable: node owns async state (promise/future) and EPICS
+    // Non-copyable / movable: node owns async state (result_) and EPICS
     CAGetNode(const CAGetNode&) = delete;
     CAGetNode& operator=(const CAGetNode&) = delete;
     CAGetNode(CAGetNode&&) noexcept = default;
     CAGetNode& operator=(CAGetNode&&) noexcept = default;
 
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
    private:
+    // BTRunner registers literal options before it connects the tree; this
+    // covers a [monitor] from the blackboard
+    void setMonitorOptions(const std::string& full_name) {
+        std::string spec;
+        if (!BT::TreeNode::getInput("monitor", spec) || spec.empty()) return;
+        try {
+            pv_manager_->SetMonitorOptions(full_name,
+                                           epics::ParseMonitorOptions(spec));
+        } catch (const std::invalid_argument& e) {
+            throw BT::RuntimeError("CAGetNode: ", e.what());
+        }
+    }
+
+    // A PV with too many cancelled gets awaiting their reply, e.g. from an
+    // IOC that hangs, refuses new ones: that fails this node, not the tree
+    BT::NodeStatus requestRefused() {
+        waiting_monitor_ = false;
+        disarmDeadline();
+        if (!pv_->Saturated()) {
+            throw BT::RuntimeError("CAGetNode: failed to call getCB");
+        }
+        std::cerr << "CAGetNode: " << pv_->GetPVname()
+                  << " refuses gets while " << epics::PV::kMaxCancelledRequests
+                  << " cancelled requests await their reply" << std::endl;
+        return BT::NodeStatus::FAILURE;
+    }
+
     void handleGetResult(T sample) {
-        if (cancelled_) {
+        // The first reply of the execution writes result_
+        if (cancelled_ || claimed_.exchange(true)) {
             return;
         }
 
-        promise_.set_value(sample);
-        done_ = true;
+        result_ = std::move(sample);
+        done_.store(true, std::memory_order_release);
+        emitWakeUpSignal();
+    }
+
+    void handleGetError() {
+        if (cancelled_ || claimed_.exchange(true)) {
+            return;
+        }
+        failed_.store(true, std::memory_order_release);
+        emitWakeUpSignal();
     }
 
-    void handleConnection(bool connected) { connected_ = connected; }
+    void handleConnection(bool connected) {
+        connected_ = connected;
+        emitWakeUpSignal();
+    }
 
-    // EPICS CA PV handle
-    std::shared_ptr<epics::ca::CAPV> pv_;
-    std::shared_ptr<epics::ca::CAContextManager> ctx_;
-    std::shared_ptr<epics::ca::PVManager> pv_manager_;
+    void handleMonitorUpdate() {
+        // Only the node waiting for a monitor value needs another tick
+        if (waiting_monitor_.exchange(false)) {
+            emitWakeUpSignal();
+        }
+    }
+
+    // The registry flags the timeout at the deadline, when the runner
+    // expires it before the tick
+    void armDeadline() {
+        if (!deadlines_) return;
+        deadlines_->Disarm(deadline_id_);
+        deadline_id_ = deadlines_->Arm(
+            deadline_, callbacks_.Wrap([this] { timed_out_ = true; }));
+    }
+
+    void disarmDeadline() {
+        if (!deadlines_) return;
+        deadlines_->Disarm(deadline_id_);
+        deadline_id_ = DeadlineRegistry::kInvalidId;
+    }
+
+    bool deadlineExpired() const {
+        if (deadlines_) return timed_out_;
+        return std::chrono::steady_clock::now() >= deadline_;
+    }
+
+    // Frees what the callbacks of a reply that may never come hold
+    void cancelRequest() {
+        if (pv_ && request_) pv_->CancelRequest(request_);
+        request_ = {};
+    }
+
+    // PV handle
+    std::shared_ptr<epics::PV> pv_;
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+    std::string pv_scheme_;
 
     // Execution flags
     std::atomic<bool> requested_{false};
     std::atomic<bool> done_{false};
+    std::atomic<bool> failed_{false};
     std::atomic<bool> cancelled_{false};
+    std::atomic<bool> timed_out_{false};
     std::atomic<bool> connected_{false};
+    std::atomic<bool> waiting_monitor_{false};
 
-    // Result delivery: promise/future shared to allow repeated polls in
-    // onRunning()
-    std::promise<T> promise_;
-    std::shared_future<T> future_;
+    // Result delivery: written by the get callback before done_ is set,
+    // read in onRunning() after. Reused by every execution.
+    std::atomic<bool> claimed_{false};
+    T result_{};
+    epics::GetCallbackAs<T> get_cb_;
+    epics::ErrorCallback err_cb_;
 
     // Inputs (immutable during a single tick execution)
     std::string pv_name_;
@@ -164,6 +293,17 @@ class CAGetNode : public BT::StatefulActionNode {
 
     // Deadline for the current execution (set in onStart)
     std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+    // The get in flight
+    epics::RequestHandle request_;
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
 };
 
+// Array/waveform get. The result shares the buffer of the monitor cache when
+// the element type matches the native type of the channel.
+template <typename T>
+using CAGetArrayNode = CAGetNode<epics::PVArray<T>>;
+
 }  // namespace bchtree
@@ -0,0 +1,105 @@
+#pragma once
+#include <behaviortree_cpp/behavior_tree.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/pv.h"
+#include "epics/pv_manager.h"
+#include "epics/pv_table.h"
+#include "epics/types.h"
+
+namespace BT {
+// Allow a literal table (see ParsePVPutTable) in the [values] port
+template <>
+inline bchtree::epics::PVPutTable convertFromString(StringView str) {
+    return bchtree::epics::ParsePVPutTable(str);
+}
+}  // namespace BT
+
+namespace bchtree {
+
+// Write many PVs at once: every ca_put_callback is queued first and sent
+// with a single flush. The table comes from [values] or from [file].
+// Returns SUCCESS once every put is acknowledged, and FAILURE on the first
+// error or on timeout. [failed] lists the PVs whose put was not
+// acknowledged as successful.
+class CAPutMultiNode : public BT::StatefulActionNode, public CallbackOwner {
+   public:
+    static constexpr int kDefaultTimeoutMs = 1000;
+
+    explicit CAPutMultiNode(
+        const std::string& name, const BT::NodeConfig& cfg,
+        std::shared_ptr<epics::PVManager> pv_manager,
+        std::shared_ptr<DeadlineRegistry> deadlines = nullptr);
+
+    // Ports definition for BehaviorTree.CPP
+    static BT::PortsList providedPorts();
+
+    // Lifecycle
+    BT::NodeStatus onStart() override;
+    BT::NodeStatus onRunning() override;
+    void onHalted() override;
+
+    CAPutMultiNode(const CAPutMultiNode&) = delete;
+    CAPutMultiNode& operator=(const CAPutMultiNode&) = delete;
+
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
+   private:
+    enum class SlotState { kPending, kRequested, kDone, kFailed };
+
+    struct Slot {
+        std::string name;
+        std::shared_ptr<epics::PV> pv;
+        epics::PVScalarValue value;
+        SlotState state{SlotState::kPending};
+        // The put issued for this execution, touched by the tick thread only
+        epics::RequestHandle request;
+    };
+
+    epics::PVPutTable readTable();
+    void watchConnection(const std::shared_ptr<epics::PV>& pv);
+    void resolvePVs(epics::PVPutTable table);
+    void issuePendingPuts();
+    void handlePutResult(uint64_t generation, size_t index, bool success);
+    BT::NodeStatus finish(BT::NodeStatus status);
+
+    // Frees what the callbacks of replies that may never come hold
+    void cancelRequests();
+
+    void armDeadline();
+    void disarmDeadline();
+    bool deadlineExpired() const;
+
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+    // PVs given a connection callback, once each across [values] changes
+    std::set<std::weak_ptr<epics::PV>, std::owner_less<>> watched_;
+
+    // Guards slots_ states, remaining_, failed_ and generation_ against CA
+    // callbacks
+    std::mutex mtx_;
+    std::vector<Slot> slots_;
+    size_t remaining_{0};
+    bool failed_{false};
+    uint64_t generation_{0};
+
+    int timeout_ms_{kDefaultTimeoutMs};
+
+    std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+    std::atomic<bool> timed_out_{false};
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
+};
+
+}  // namespace bchtree
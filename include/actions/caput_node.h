@@ -1,24 +1,36 @@
 #pragma once
 #include <behaviortree_cpp/behavior_tree.h>
 
-#include "epics/ca/ca_pv.h"
-#include "epics/ca/ca_pv_manager.h"
+#include <iostream>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/pv.h"
+#include "epics/pv_manager.h"
+#include "epics/pv_names.h"
 #include "epics/types.h"
 
 namespace bchtree {
 
 template <typename T>
-class CAPutNode : public BT::StatefulActionNode {
+class CAPutNode : public BT::StatefulActionNode, public CallbackOwner {
    public:
     static constexpr int kDefaultTimeoutMs = 1000;
 
+    // Names in [pv] without a scheme get pv_scheme, e.g. "pva" for the
+    // pvAccess variants
     explicit CAPutNode(const std::string& name, const BT::NodeConfig& cfg,
-                       std::shared_ptr<epics::ca::CAContextManager> ctx,
-                       std::shared_ptr<epics::ca::PVManager> pv_manager)
+                       std::shared_ptr<epics::PVManager> pv_manager,
+                       std::shared_ptr<DeadlineRegistry> deadlines = nullptr,
+                       std::string pv_scheme = "")
         : BT::StatefulActionNode(name, cfg),
-          ctx_(ctx),
-          pv_manager_(pv_manager) {
-        ctx_->EnsureAttached();
+          pv_manager_(pv_manager),
+          deadlines_(deadlines),
+          pv_scheme_(std::move(pv_scheme)) {
+        pv_manager_->Attach();
+        // Wrapped once: each put takes a copy, without allocating
+        put_cb_ = callbacks_.Wrap(
+            [this](bool success) { handlePutResult(success); });
     }
 
     // Ports definition for BehaviorTree.CPP
@@ -35,6 +47,7 @@ class CAPutNode : public BT::StatefulActionNode {
     // Lifecycle
     BT::NodeStatus onStart() override {
         cancelled_ = false;
+        timed_out_ = false;
         done_ = false;
         requested_ = false;
 
@@ -51,11 +64,13 @@ class CAPutNode : public BT::StatefulActionNode {
                     std::chrono::milliseconds(timeout_ms_);
 
         if (!pv_) {
-            pv_ = pv_manager_->Get(pv_name_);
-            pv_->AddConnCB(
-                [this](bool connected) { handleConnection(connected); });
+            pv_ = pv_manager_->Get(epics::WithPVScheme(pv_scheme_, pv_name_));
+            pv_->AddConnCB(callbacks_.Wrap(
+                [this](bool connected) { handleConnection(connected); }));
         }
 
+        armDeadline();
+
         connected_ = pv_->IsConnected();
 
         if (!connected_) {
@@ -66,15 +81,15 @@ class CAPutNode : public BT::StatefulActionNode {
         if (!force_write_) {
             T current_val = pv_->GetAs<T>();
             if (value_ == current_val) {
+                disarmDeadline();
                 return BT::NodeStatus::SUCCESS;
             }
         }
 
         // Issue put
-        bool status = pv_->PutCB(
-            value_, [this](bool success) { handlePutResult(success); });
+        bool status = pv_->PutCB(value_, put_cb_, true, &request_);
         if (!status) {
-            throw BT::RuntimeError("CAPutNode: failed to call PutCB");
+            return requestRefused();
         }
         requested_ = true;
 
@@ -84,22 +99,24 @@ class CAPutNode : public BT::StatefulActionNode {
     BT::NodeStatus onRunning() override {
         if (!requested_ && connected_) {
             // Issue put
-            bool status = pv_->PutCB(
-                value_, [this](bool success) { handlePutResult(success); });
+            bool status = pv_->PutCB(value_, put_cb_, true, &request_);
             if (!status) {
-                throw BT::RuntimeError("CAPutNode: failed to call PutCB");
+                return requestRefused();
             }
             requested_ = true;
         }
 
         // Check condition
         if (done_) {
+            disarmDeadline();
             return BT::NodeStatus::SUCCESS;
         }
 
         // timeout
-        if (std::chrono::steady_clock::now() > deadline_) {
+        if (deadlineExpired()) {
             cancelled_ = true;
+            cancelRequest();
+            disarmDeadline();
             return BT::NodeStatus::FAILURE;
         }
 
@@ -107,34 +124,85 @@ class CAPutNode : public BT::StatefulActionNode {
         return BT::NodeStatus::RUNNING;
     }
 
-    void onHalted() override { cancelled_ = true; }
+    void onHalted() override {
+        cancelled_ = true;
+        cancelRequest();
+        disarmDeadline();
+    }
 
-    // Non-copyable / movable: node owns async state (promise/future) and EPICS
+    // Non-copyable / movable: node owns async state and EPICS
     CAPutNode(const CAPutNode&) = delete;
     CAPutNode& operator=(const CAPutNode&) = delete;
     CAPutNode(CAPutNode&&) noexcept = default;
     CAPutNode& operator=(CAPutNode&&) noexcept = default;
 
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
    private:
+    // A PV with too many cancelled puts awaiting their reply refuses new
+    // ones: that fails this node, not the tree
+    BT::NodeStatus requestRefused() {
+        disarmDeadline();
+        if (!pv_->Saturated()) {
+            throw BT::RuntimeError("CAPutNode: failed to call PutCB");
+        }
+        std::cerr << "CAPutNode: " << pv_->GetPVname()
+                  << " refuses puts while " << epics::PV::kMaxCancelledRequests
+                  << " cancelled requests await their reply" << std::endl;
+        return BT::NodeStatus::FAILURE;
+    }
+
     void handlePutResult(bool success) {
         if (cancelled_) {
             return;
         }
 
         done_ = success;
+        emitWakeUpSignal();
+    }
+
+    void handleConnection(bool connected) {
+        connected_ = connected;
+        emitWakeUpSignal();
+    }
+
+    // The registry flags the timeout at the deadline, when the runner
+    // expires it before the tick
+    void armDeadline() {
+        if (!deadlines_) return;
+        deadlines_->Disarm(deadline_id_);
+        deadline_id_ = deadlines_->Arm(
+            deadline_, callbacks_.Wrap([this] { timed_out_ = true; }));
+    }
+
+    void disarmDeadline() {
+        if (!deadlines_) return;
+        deadlines_->Disarm(deadline_id_);
+        deadline_id_ = DeadlineRegistry::kInvalidId;
     }
 
-    void handleConnection(bool connected) { connected_ = connected; }
+    bool deadlineExpired() const {
+        if (deadlines_) return timed_out_;
+        return std::chrono::steady_clock::now() >= deadline_;
+    }
+
+    // Frees what the callbacks of a reply that may never come hold
+    void cancelRequest() {
+        if (pv_ && request_) pv_->CancelRequest(request_);
+        request_ = {};
+    }
 
-    // EPICS CA PV handle
-    std::shared_ptr<epics::ca::CAPV> pv_;
-    std::shared_ptr<epics::ca::CAContextManager> ctx_;
-    std::shared_ptr<epics::ca::PVManager> pv_manager_;
+    // PV handle
+    std::shared_ptr<epics::PV> pv_;
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+    std::string pv_scheme_;
 
     // Execution flags
     std::atomic<bool> requested_{false};
     std::atomic<bool> done_{false};
     std::atomic<bool> cancelled_{false};
+    std::atomic<bool> timed_out_{false};
     std::atomic<bool> connected_{false};
 
     // Inputs (immutable during a single tick execution)
@@ -143,8 +211,16 @@ class CAPutNode : public BT::StatefulActionNode {
     T value_;
     bool force_write_{false};
 
+    epics::PutCallback put_cb_;
+
     // Deadline for the current execution (set in onStart)
     std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+    // The put in flight
+    epics::RequestHandle request_;
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
 };
 
 }  // namespace bchtree
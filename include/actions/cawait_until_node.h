@@ -0,0 +1,78 @@
+#pragma once
+#include <behaviortree_cpp/behavior_tree.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/pv.h"
+#include "epics/pv_condition.h"
+#include "epics/pv_manager.h"
+
+namespace bchtree {
+
+// Wait until the monitor value of [pv] satisfies [op] [value] (see
+// PVCondition; [tolerance] for within, [mask] for mask). The condition is
+// checked on the tick thread for each monitor update while waiting, so
+// nothing is read from the IOC; updates that come while the node is not
+// waiting don't wake the tree. Returns SUCCESS with the
+// satisfying value in [result], FAILURE after [timeout] ms.
+class CAWaitUntilNode : public BT::StatefulActionNode, public CallbackOwner {
+   public:
+    static constexpr int kDefaultTimeoutMs = 5000;
+
+    explicit CAWaitUntilNode(
+        const std::string& name, const BT::NodeConfig& cfg,
+        std::shared_ptr<epics::PVManager> pv_manager,
+        std::shared_ptr<DeadlineRegistry> deadlines = nullptr);
+
+    // Ports definition for BehaviorTree.CPP
+    static BT::PortsList providedPorts();
+
+    // Lifecycle
+    BT::NodeStatus onStart() override;
+    BT::NodeStatus onRunning() override;
+    void onHalted() override;
+
+    CAWaitUntilNode(const CAWaitUntilNode&) = delete;
+    CAWaitUntilNode& operator=(const CAWaitUntilNode&) = delete;
+
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
+   private:
+    epics::PVCondition readCondition();
+    void resolvePV(const std::string& pv_name);
+    void handleMonitorUpdate(const epics::PV& pv, const epics::PVData& data);
+    void disarm();
+
+    void armDeadline();
+    void disarmDeadline();
+
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+
+    std::shared_ptr<epics::PV> pv_;
+    std::string resolved_name_;  // [pv] that pv_ was resolved for
+    epics::MonitorCallbackId monitor_id_ = 0;
+    // Bumped when [pv] resolves to another PV
+    std::atomic<uint64_t> generation_{0};
+
+    // Guards the condition and the match against the monitor callback
+    std::mutex mtx_;
+    std::optional<epics::PVCondition> condition_;  // set while waiting
+    std::optional<epics::PVData> matched_;
+    // Set with condition_: the monitor updates are queued only meanwhile
+    std::atomic<bool> waiting_{false};
+
+    std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
+};
+
+}  // namespace bchtree
@@ -0,0 +1,93 @@
+#pragma once
+#include <behaviortree_cpp/behavior_tree.h>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "callback_guard.h"
+#include "deadline_registry.h"
+#include "epics/pv.h"
+#include "epics/pv_history.h"
+#include "epics/pv_manager.h"
+
+namespace bchtree {
+
+// Statistic of the monitor updates of [pv] over a sliding window: the last
+// [window_ms] milliseconds or the last [window_count] updates. [stat] is
+// mean (default), min, max, stddev, rate (updates per second) or count.
+//
+// The updates are kept in the history ring of the PV (at least [history]
+// samples), so none are missed between ticks. The node returns RUNNING
+// until the window is complete: window_ms after the ring started, or
+// window_count updates. mean, min, max and stddev also need one update in
+// the window. Returns FAILURE after [timeout] ms.
+class CAWindowStatNode : public BT::StatefulActionNode, public CallbackOwner {
+   public:
+    static constexpr int kDefaultTimeoutMs = 5000;
+    static constexpr int kDefaultHistory = 1024;
+
+    explicit CAWindowStatNode(
+        const std::string& name, const BT::NodeConfig& cfg,
+        std::shared_ptr<epics::PVManager> pv_manager,
+        std::shared_ptr<DeadlineRegistry> deadlines = nullptr);
+
+    // Ports definition for BehaviorTree.CPP
+    static BT::PortsList providedPorts();
+
+    // Lifecycle
+    BT::NodeStatus onStart() override;
+    BT::NodeStatus onRunning() override;
+    void onHalted() override;
+
+    CAWindowStatNode(const CAWindowStatNode&) = delete;
+    CAWindowStatNode& operator=(const CAWindowStatNode&) = delete;
+
+    CallbackGuard& Callbacks() override { return callbacks_; }
+
+   private:
+    enum class Stat { kMean, kMin, kMax, kStddev, kRate, kCount };
+
+    static Stat parseStat(const std::string& name);
+    void readInputs();
+    void setUpWindow();
+    // Feed the samples recorded since the last call into the window
+    void syncWindow(std::chrono::steady_clock::time_point now);
+    std::optional<double> statistic(
+        std::chrono::steady_clock::time_point now) const;
+
+    void armDeadline(std::chrono::steady_clock::time_point at);
+    void disarmDeadline();
+
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+
+    std::shared_ptr<epics::PV> pv_;
+    std::string resolved_name_;  // [pv] that pv_ was resolved for
+    std::shared_ptr<const epics::PVHistory> history_;
+    std::optional<epics::WindowStats> window_;
+    uint64_t next_seq_{0};
+    std::vector<epics::PVSample> buffer_;
+    std::atomic<bool> waiting_{false};
+
+    // Inputs
+    std::string pv_name_;
+    Stat stat_{Stat::kMean};
+    int window_ms_{0};
+    int window_count_{0};
+    int history_size_{kDefaultHistory};
+    int timeout_ms_{kDefaultTimeoutMs};
+    // Inputs the window was built for
+    int built_window_ms_{0};
+    int built_window_count_{0};
+
+    std::chrono::steady_clock::time_point deadline_{};
+    DeadlineRegistry::Id deadline_id_{DeadlineRegistry::kInvalidId};
+
+    // Last member: closed before the state the PV callbacks use is gone
+    CallbackGuard callbacks_;
+};
+
+}  // namespace bchtree
@@ -2,12 +2,21 @@
 #include <behaviortree_cpp/bt_factory.h>
 #include <behaviortree_cpp/loggers/abstract_logger.h>
 
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-#include "epics/ca/ca_context_manager.h"
-#include "epics/ca/ca_pv_manager.h"
+#include "callback_queue.h"
+#include "deadline_registry.h"
+#include "epics/pv_manager.h"
+#include "file_watcher.h"
+#include "flight_recorder.h"
 #include "logger.h"
+#include "metrics.h"
 
 namespace bchtree {
 
@@ -31,30 +40,164 @@ class RunnerLogger : public BT::StatusChangeLogger {
     std::shared_ptr<Logger> logger_;
 };
 
+// Feeds node status transitions to the flight recorder. The nodes are
+// named "<tree name>/<node path>" under ids of the recorder, since node
+// UIDs repeat from one tree to the next.
+class FlightRecorderLogger : public BT::StatusChangeLogger {
+   public:
+    FlightRecorderLogger(const BT::Tree& tree,
+                         std::shared_ptr<FlightRecorder> recorder,
+                         const std::string& tree_name);
+
+    virtual void flush() override {}
+
+   private:
+    virtual void callback(BT::Duration timestamp, const BT::TreeNode& node,
+                          BT::NodeStatus prev_status,
+                          BT::NodeStatus status) override;
+
+    std::shared_ptr<FlightRecorder> recorder_;
+    // Recorder id of each node, by UID
+    std::vector<uint32_t> ids_;
+};
+
+// Feeds tick and RUNNING durations of every node to the metrics registry
+class MetricsLogger : public BT::StatusChangeLogger {
+   public:
+    MetricsLogger(BT::Tree& tree, MetricsRegistry& registry,
+                  const std::string& tree_name);
+
+    virtual void flush() override {}
+
+   private:
+    virtual void callback(BT::Duration timestamp, const BT::TreeNode& node,
+                          BT::NodeStatus prev_status,
+                          BT::NodeStatus status) override;
+
+    struct Entry {
+        std::shared_ptr<NodeMetrics> metrics;
+        BT::Duration running_since{};
+    };
+    std::unordered_map<uint16_t, Entry> nodes_;  // by UID
+};
+
+class TickSlots;
+
+// Time spent in tickOnce() by one tree. tick_time and max_tick_time are
+// wall clock, cpu_time is the CPU time of the ticking thread.
+struct TreeStats {
+    uint64_t ticks = 0;
+    std::chrono::nanoseconds tick_time{0};
+    std::chrono::nanoseconds max_tick_time{0};
+    std::chrono::nanoseconds cpu_time{0};
+};
+
 class BTRunner {
    public:
-    explicit BTRunner(std::shared_ptr<epics::ca::CAContextManager> ctx,
-                      std::shared_ptr<epics::ca::PVManager> pv_manager)
-        : ctx_(std::move(ctx)), pv_manager_(std::move(pv_manager)) {}
+    // Upper bound of a single sleep between ticks. Nodes that neither emit
+    // a wake-up signal nor register a deadline are still ticked this often.
+    static constexpr std::chrono::milliseconds kMaxTickSleep{100};
+    // How long RegisterTreeFromFile waits for the PVs of the tree to connect
+    static constexpr std::chrono::milliseconds kDefaultConnectTimeout{2000};
+
+    explicit BTRunner(std::shared_ptr<epics::PVManager> pv_manager)
+        : pv_manager_(std::move(pv_manager)),
+          deadlines_(std::make_shared<DeadlineRegistry>()),
+          callback_queue_(std::make_shared<CallbackQueue>()) {}
 
+    // Tick the tree until it finishes. May be called again to rerun it with
+    // the PVs still connected.
     bool Run();
     void PrintTree();
     void SetLogger(std::shared_ptr<Logger> logger);
     void UseRunnerLogger();
+    // Record the tree into recorder and dump it to dump_path when the tree
+    // fails. Call before RegisterTreeFromFile.
+    void SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder,
+                           std::string dump_path);
+    // Record node tick and running times. Call before RegisterTreeFromFile.
+    void SetMetrics(std::shared_ptr<MetricsRegistry> metrics);
     void RegisterTreeFromFile(const std::string& treePath);
+    // Rebuild the tree from its file. PVs used by both the old and the new
+    // tree keep their channels; the others are released. Keeps the current
+    // tree and returns false if the file does not load. Not while Run().
+    bool ReloadTree();
+    // Reload the tree at the start of the next Run() after the file changes
+    void WatchTreeFile();
+
+    // Zero skips connecting the PVs at load time
+    void SetConnectTimeout(std::chrono::milliseconds timeout);
+    // PVs of the tree that did not connect within the connect timeout
+    const std::vector<std::string>& MissingPVs() const;
+
+    // Shown in the log lines of the tree
+    void SetName(std::string name);
+    // Take a slot for every tick, see TreeScheduler
+    void SetTickSlots(std::shared_ptr<TickSlots> slots);
+    // Totals over all runs. Safe to call while the tree runs.
+    TreeStats Stats() const;
 
    private:
+    BT::NodeStatus TickUntilDone();
+    BT::NodeStatus TimedTick();
+    std::chrono::steady_clock::duration NextSleep() const;
+    void RegisterNodes();
+    // Register the literal monitor= options of the nodes with the PV
+    // manager, which applies them to live PVs too
+    void ApplyMonitorOptions(const BT::Tree& tree);
+    std::vector<std::string> CollectPVNames(const BT::Tree& tree) const;
+    // pv with the scheme of the node's transport, if it has one
+    std::string NodePVName(const BT::TreeNode& node,
+                           const std::string& pv) const;
+    void ConnectTreePVs();
+    void RouteCallbacks();
+    // Tree label of the node metrics: the name, else the file stem
+    std::string MetricsName() const;
+
     std::shared_ptr<Logger> logger_;
     BT::BehaviorTreeFactory factory_;
     BT::Tree tree_;
     std::shared_ptr<BT::Blackboard> blackboard_;
 
-    std::shared_ptr<epics::ca::CAContextManager> ctx_;
-    std::shared_ptr<epics::ca::PVManager> pv_manager_;
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<DeadlineRegistry> deadlines_;
+    // PV callbacks of the nodes, run by the ticking thread
+    std::shared_ptr<CallbackQueue> callback_queue_;
+
+    // Default scheme of the [pv] port per node ID
+    std::map<std::string, std::string> pv_schemes_;
+
+    std::chrono::milliseconds connect_timeout_{kDefaultConnectTimeout};
+    // Keeps the channels alive until the nodes look them up
+    std::vector<std::shared_ptr<epics::PV>> tree_pvs_;
+    std::vector<std::string> missing_pvs_;
+    // Sorted, to diff them on reload
+    std::vector<std::string> tree_pv_names_;
+
+    std::string tree_path_;
+    bool nodes_registered_{false};
+    std::atomic<bool> reload_pending_{false};
 
     bool initialized_{false};
     bool use_runner_logger_{false};
     std::unique_ptr<RunnerLogger> runner_logger_;
+
+    std::shared_ptr<FlightRecorder> recorder_;
+    std::string flight_dump_path_;
+    std::unique_ptr<FlightRecorderLogger> flight_logger_;
+
+    std::shared_ptr<MetricsRegistry> metrics_;
+    std::unique_ptr<MetricsLogger> metrics_logger_;
+
+    std::string name_;
+    std::shared_ptr<TickSlots> tick_slots_;
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<int64_t> tick_ns_{0};
+    std::atomic<int64_t> max_tick_ns_{0};
+    std::atomic<int64_t> cpu_ns_{0};
+
+    // Last member: stopped before what its callback uses is destroyed
+    std::unique_ptr<FileWatcher> watcher_;
 };
 
 }  // namespace bchtree
@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "callback_queue.h"
+
+namespace bchtree {
+
+// Lets a node hand callbacks to a PV that may outlive it, e.g. a PV kept
+// across a tree reload or shared with another tree. A wrapped callback does
+// nothing once the guard is closed, and closing waits for the callbacks
+// that are running. Declare the guard as the last member of the node so
+// that it is closed before the state the callbacks use is destroyed.
+//
+// Once routed, the wrapped callbacks are queued for the thread that drains
+// the queue, which each push wakes, and never run on the PV callback
+// thread: neither side takes a lock, so a PV thread never waits for node
+// code. Monitor callbacks go through WrapMonitor() so that only the updates
+// a node waits for are queued.
+//
+// Only monitor updates are ever dropped: nodes read the PV state again when
+// they start. One that finds the queue inactive, i.e. no run in progress,
+// is dropped; one that finds it full wakes the draining thread and retries
+// for a while, then is dropped and counted in CallbackQueue::Dropped(). The
+// other callbacks, e.g. the completion of a get, can't be replayed: they go
+// to the overflow of a full queue, and run in place when it is inactive.
+class CallbackGuard {
+   public:
+    // Pushes tried against a full queue before a monitor update is dropped
+    static constexpr int kFullQueueRetries = 100;
+
+    CallbackGuard() = default;
+    ~CallbackGuard() { Close(); }
+
+    CallbackGuard(const CallbackGuard&) = delete;
+    CallbackGuard& operator=(const CallbackGuard&) = delete;
+
+    template <typename F>
+    auto Wrap(F&& f) const {
+        // f by value: small node lambdas keep the wrapper within the inline
+        // buffer of the request callbacks
+        return [state = state_, fn = std::forward<F>(f)](auto&&... args) {
+            Call call(*state);
+            if (!call.open) return;
+            Dispatch<false>(state, fn, std::forward<decltype(args)>(args)...);
+        };
+    }
+
+    // For monitor callbacks: wanted(args...) is asked first, on the PV
+    // thread, and an update it turns down is neither queued nor wakes the
+    // draining thread. Nodes pass their waiting flag, so that the updates
+    // of a PV that nobody waits for cost no tick.
+    template <typename W, typename F>
+    auto WrapMonitor(W&& wanted, F&& f) const {
+        return [state = state_, want = std::forward<W>(wanted),
+                fn = std::forward<F>(f)](auto&&... args) {
+            Call call(*state);
+            if (!call.open || !want(args...)) return;
+            Dispatch<true>(state, fn, std::forward<decltype(args)>(args)...);
+        };
+    }
+
+    // Queue the callbacks to queue from now on; wake is called after each
+    // push to get the draining thread going
+    void Route(std::shared_ptr<CallbackQueue> queue,
+               std::function<void()> wake) {
+        std::atomic_store(&state_->route,
+                          std::shared_ptr<const Routing>(new Routing{
+                              std::move(queue), std::move(wake)}));
+    }
+
+    void Close() {
+        state_->open.store(false);
+        // Wait for the callbacks running in place and the pushes in
+        // progress, which may still call wake
+        while (state_->calls.load() != 0) std::this_thread::yield();
+        // Queued tasks hold the state: don't let the state hold the queue
+        std::atomic_store(&state_->route, std::shared_ptr<const Routing>());
+    }
+
+   private:
+    struct Routing {
+        std::shared_ptr<CallbackQueue> queue;
+        std::function<void()> wake;
+    };
+
+    struct State {
+        std::atomic<bool> open{true};
+        // Wrapped callbacks in progress; nested ones count once each
+        std::atomic<int> calls{0};
+        std::shared_ptr<const Routing> route;
+    };
+
+    // Announces the call before checking open, so that Close() either
+    // sees it or the call sees the guard closed
+    struct Call {
+        explicit Call(State& s) : state(s) {
+            state.calls.fetch_add(1);
+            open = state.open.load();
+        }
+        ~Call() { state.calls.fetch_sub(1); }
+        State& state;
+        bool open;
+    };
+
+    template <bool kDroppable, typename Fn, typename... Args>
+    static void Dispatch(const std::shared_ptr<State>& state, const Fn& fn,
+                         Args&&... args) {
+        const auto route = std::atomic_load(&state->route);
+        // In place when unrouted or on the draining thread itself
+        if (!route || route->queue->OnConsumerThread()) {
+            fn(std::forward<Args>(args)...);
+            return;
+        }
+
+        auto task = [state, fn, args...]() mutable {
+            if (state->open.load()) fn(std::move(args)...);
+        };
+        if constexpr (!kDroppable) {
+            if (route->queue->Post(std::move(task))) {
+                if (route->wake) route->wake();
+            } else {
+                // Inactive: no tick runs node code meanwhile
+                fn(std::forward<Args>(args)...);
+            }
+            return;
+        }
+        for (int i = 0; i < kFullQueueRetries; ++i) {
+            if (route->queue->Push(task)) {
+                if (route->wake) route->wake();
+                return;
+            }
+            if (!route->queue->Active()) return;
+            // Full: get the drain going and give it time to run
+            if (route->wake) route->wake();
+            std::this_thread::yield();
+        }
+        route->queue->CountDropped();
+    }
+
+    std::shared_ptr<State> state_ = std::make_shared<State>();
+};
+
+// Implemented by the nodes that hand callbacks to PVs, so that the runner
+// can route them
+class CallbackOwner {
+   public:
+    virtual ~CallbackOwner() = default;
+    virtual CallbackGuard& Callbacks() = 0;
+};
+
+}  // namespace bchtree
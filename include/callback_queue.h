@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bchtree {
+
+// Bounded multi-producer, single-consumer queue of callbacks. PV callback
+// threads push, the tick thread runs them with Drain(), in push order.
+// Push() is lock-free and does not allocate for tasks up to kTaskSize
+// bytes; it returns false when the queue is full or inactive, and the
+// caller decides whether to retry or drop the task. Post() is for tasks
+// that must not be dropped: it takes a lock and allocates only when the
+// ring is full.
+//
+// Slots follow Dmitry Vyukov's bounded queue: each one carries a sequence
+// number telling producers and the consumer whose turn it is.
+class CallbackQueue {
+   public:
+    static constexpr size_t kDefaultCapacity = 4096;
+    static constexpr size_t kTaskSize = 192;
+
+    // capacity is rounded up to a power of two, at least 2
+    explicit CallbackQueue(size_t capacity = kDefaultCapacity);
+    ~CallbackQueue();
+
+    CallbackQueue(const CallbackQueue&) = delete;
+    CallbackQueue& operator=(const CallbackQueue&) = delete;
+
+    template <typename F>
+    bool Push(F&& task);
+    // Push, or append to an unbounded overflow list when the ring is full.
+    // Drain() runs the overflow after the ring, so an overflowing task may
+    // run after tasks pushed later. Returns false only when inactive.
+    template <typename F>
+    bool Post(F&& task);
+
+    // Run the queued tasks on the calling thread, at most one capacity's
+    // worth of the ring so that busy producers can't hold it, then the
+    // overflow. A task that throws is
+    // removed before the exception propagates. Returns the tasks run.
+    size_t Drain();
+
+    // Inactive while nobody drains, e.g. between two runs of a tree, so
+    // that callbacks don't wait in the queue meanwhile. Starts inactive.
+    void SetActive(bool active);
+    bool Active() const;
+    // True on the thread that last called Drain()
+    bool OnConsumerThread() const;
+    size_t Capacity() const { return mask_ + 1; }
+    // Pushes refused, and posts diverted, because the ring was full
+    uint64_t Overflows() const;
+    // Tasks given up on while the queue stayed full, see CallbackGuard
+    void CountDropped();
+    uint64_t Dropped() const;
+
+   private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        void (*run)(void*) = nullptr;
+        void (*destroy)(void*) = nullptr;
+        alignas(std::max_align_t) unsigned char storage[kTaskSize];
+    };
+
+    template <typename T>
+    static void Emplace(Slot& slot, T&& task);
+    size_t DrainOverflow();
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+
+    alignas(64) std::atomic<size_t> tail_{0};  // producers
+    alignas(64) size_t head_ = 0;               // consumer
+    std::atomic<bool> active_{false};
+    std::atomic<std::thread::id> consumer_{};
+    std::atomic<uint64_t> overflows_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex overflow_mtx_;  // guards overflow_
+    std::vector<std::function<void()>> overflow_;
+    std::atomic<bool> has_overflow_{false};
+};
+
+template <typename T>
+void CallbackQueue::Emplace(Slot& slot, T&& task) {
+    using Task = std::decay_t<T>;
+    if constexpr (sizeof(Task) <= kTaskSize &&
+                  alignof(Task) <= alignof(std::max_align_t)) {
+        new (slot.storage) Task(std::forward<T>(task));
+        slot.run = [](void* p) { (*static_cast<Task*>(p))(); };
+        slot.destroy = [](void* p) { static_cast<Task*>(p)->~Task(); };
+    } else {
+        // Too large to live in the slot
+        using Ptr = Task*;
+        new (slot.storage) Ptr(new Task(std::forward<T>(task)));
+        slot.run = [](void* p) { (**static_cast<Ptr*>(p))(); };
+        slot.destroy = [](void* p) { delete *static_cast<Ptr*>(p); };
+    }
+}
+
+template <typename F>
+bool CallbackQueue::Push(F&& task) {
+    if (!active_.load(std::memory_order_relaxed)) return false;
+
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots_[pos & mask_];
+        const size_t seq = slot->seq.load(std::memory_order_acquire);
+        const auto diff =
+            static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    Emplace(*slot, std::forward<F>(task));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename F>
+bool CallbackQueue::Post(F&& task) {
+    if (Push(task)) return true;
+    if (!Active()) return false;
+
+    std::lock_guard<std::mutex> lock(overflow_mtx_);
+    overflow_.emplace_back(std::forward<F>(task));
+    has_overflow_.store(true, std::memory_order_release);
+    return true;
+}
+
+}  // namespace bchtree
@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "inline_function.h"
+
+namespace bchtree {
+
+// Keeps the deadlines of RUNNING nodes so that the runner can sleep until
+// the earliest one instead of polling the tree, and runs their expiry
+// callbacks when Expire() finds them due.
+//
+// A hierarchical timer wheel: four levels of 64 slots with 1 ms, 64 ms,
+// 4 s and 4.4 min granularity, and an overflow list for what is more than
+// one revolution of the top level (4.7 h) ahead.
+// Arm and Disarm are O(1) and reuse the entries of expired deadlines; a
+// slot is redistributed to the level below when the wheel reaches it.
+// Entries keep their exact deadline, so Earliest() and Expire() are not
+// rounded to the slot granularity.
+class DeadlineRegistry {
+   public:
+    using Clock = std::chrono::steady_clock;
+    using Id = uint64_t;
+    using Callback = InlineFunction<void(), 48>;
+
+    static constexpr Id kInvalidId = 0;
+
+    DeadlineRegistry();
+
+    DeadlineRegistry(const DeadlineRegistry&) = delete;
+    DeadlineRegistry& operator=(const DeadlineRegistry&) = delete;
+
+    // on_expiry runs on the thread calling Expire(), without the lock held
+    Id Arm(Clock::time_point deadline, Callback on_expiry = nullptr);
+    // No-op for an expired or already disarmed id
+    void Disarm(Id id);
+
+    // Remove the deadlines up to now and run their callbacks. Returns the
+    // number of deadlines removed.
+    size_t Expire(Clock::time_point now);
+
+    std::optional<Clock::time_point> Earliest() const;
+    size_t Size() const;
+
+   private:
+    static constexpr size_t kLevels = 4;
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr uint32_t kNil = UINT32_MAX;
+    // Level of the overflow list in Entry::level
+    static constexpr uint8_t kOverflow = kLevels;
+
+    struct Entry {
+        Clock::time_point deadline;
+        Callback on_expiry;
+        uint32_t prev = kNil;
+        uint32_t next = kNil;  // also links the free entries
+        uint32_t generation = 1;
+        uint8_t level = 0;
+        uint32_t* list = nullptr;  // slot or overflow head, nullptr if free
+    };
+
+    uint64_t ToTick(Clock::time_point t) const;
+    void Insert(uint32_t index);
+    void Unlink(uint32_t index);
+    void Free(uint32_t index);
+    // Move the deadlines of the slots that the wheel reaches at tick down
+    void Cascade(uint64_t tick);
+    void Reinsert(uint32_t* list);
+    std::optional<Clock::time_point> EarliestIn(uint32_t head) const;
+
+    mutable std::mutex mtx_;
+    const Clock::time_point origin_;
+    // Ticks (1 ms) since origin_ that Expire() has reached
+    uint64_t now_tick_ = 0;
+
+    std::vector<Entry> entries_;
+    uint32_t free_ = kNil;
+    std::array<std::array<uint32_t, kSlots>, kLevels> slots_;
+    uint32_t overflow_ = kNil;
+    std::array<size_t, kLevels + 1> level_size_{};
+    size_t size_ = 0;
+};
+
+}  // namespace bchtree
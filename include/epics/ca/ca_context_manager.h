@@ -11,6 +11,7 @@ class CAContextManager {
 
     void Init();
     void EnsureAttached();
+    void Flush();
     void Shutdown();
 
    private:
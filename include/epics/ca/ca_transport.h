@@ -0,0 +1,26 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "epics/ca/ca_context_manager.h"
+#include "epics/pv_transport.h"
+
+namespace bchtree::epics::ca {
+
+// PVTransport creating CAPVs on one CA context
+class CATransport : public PVTransport {
+   public:
+    explicit CATransport(std::shared_ptr<CAContextManager> ctx)
+        : ctx_(std::move(ctx)) {}
+
+    std::shared_ptr<PV> CreatePV(const std::string& pv_name) override;
+    void Attach() override;
+    void Flush() override;
+
+    std::shared_ptr<CAContextManager> Context() const { return ctx_; }
+
+   private:
+    std::shared_ptr<CAContextManager> ctx_;
+};
+
+}  // namespace bchtree::epics::ca
@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "epics/pv_transport.h"
+#include "epics/types.h"
+
+namespace bchtree::epics::loopback {
+
+class LoopbackServer;
+
+struct LoopbackOptions {
+    // Delay of connections, get replies and put completions
+    std::chrono::microseconds latency{0};
+    // How often the server changes every numeric scalar by +1 and posts a
+    // monitor update; 0 disables the updates
+    double update_rate_hz = 0;
+    // Unknown names connect with the value 0.0. Without it only the names
+    // added with AddPV() connect.
+    bool create_on_demand = true;
+};
+
+// In-process PV server for benchmarks and stress tests. Values live in this
+// process; connections, replies and monitor updates are delivered by one
+// worker thread in the order they are due, so runs are repeatable and no IOC
+// or network is involved.
+class LoopbackTransport : public PVTransport {
+   public:
+    explicit LoopbackTransport(LoopbackOptions options = {});
+    ~LoopbackTransport() override;
+
+    LoopbackTransport(const LoopbackTransport&) = delete;
+    LoopbackTransport& operator=(const LoopbackTransport&) = delete;
+
+    std::shared_ptr<PV> CreatePV(const std::string& pv_name) override;
+
+    // Server side: define a PV, or change its value and notify the monitors
+    void AddPV(const std::string& pv_name, PVData initial);
+    void SetValue(const std::string& pv_name, PVScalarValue value);
+    // Drop the connections of pv_name, as if its IOC went away. The PVs
+    // connect again on the next AddPV() or SetValue() of the name.
+    void Disconnect(const std::string& pv_name);
+    std::optional<PVData> GetValue(const std::string& pv_name) const;
+
+   private:
+    std::shared_ptr<LoopbackServer> server_;
+};
+
+}  // namespace bchtree::epics::loopback
@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "epics/types.h"
+
+namespace bchtree::epics {
+
+// Event classes of a monitor subscription, same bits as DBE_*
+enum MonitorEvent : uint32_t {
+    kMonitorValue = 1,
+    kMonitorLog = 2,
+    kMonitorAlarm = 4,
+    kMonitorProperty = 8,
+};
+
+struct MonitorOptions {
+    // Events the server sends. Used by Channel Access only.
+    uint32_t events = kMonitorValue | kMonitorAlarm;
+    // Client side: drop numeric scalar updates that change the value by no
+    // more than abs_deadband, or by no more than rel_deadband times the
+    // last delivered value
+    double abs_deadband = 0;
+    double rel_deadband = 0;
+    // Client side: drop updates arriving sooner than 1 / max_rate_hz after
+    // the last delivered one. 0 is unlimited.
+    double max_rate_hz = 0;
+    // Server side channel filter appended to the channel name, e.g.
+    // {"dbnd":{"abs":0.5}}
+    std::string server_filter;
+    // Keep the last history numeric updates for windowed statistics, see
+    // PVHistory. 0 keeps none.
+    size_t history = 0;
+
+    bool operator==(const MonitorOptions& other) const;
+    bool operator!=(const MonitorOptions& other) const {
+        return !(*this == other);
+    }
+};
+
+// Client side part of MonitorOptions. Alarm changes always pass. A dropped
+// update is lost: the cache keeps the last delivered value until another
+// update passes.
+//
+// Not thread-safe; a PV feeds it from its monitor callback thread only.
+class MonitorFilter {
+   public:
+    explicit MonitorFilter(const MonitorOptions& options = {});
+
+    // False if every update passes
+    bool Active() const { return active_; }
+    // Whether data reaches the cache, remembering it if so
+    bool Accept(const PVData& data, std::chrono::steady_clock::time_point now);
+
+   private:
+    void Remember(const PVData& data,
+                  std::chrono::steady_clock::time_point now);
+
+    double abs_deadband_;
+    double rel_deadband_;
+    std::chrono::steady_clock::duration min_interval_{};
+    bool active_;
+
+    bool has_last_ = false;
+    bool last_numeric_ = false;
+    double last_value_ = 0;
+    uint32_t last_severity_ = 0;
+    uint32_t last_status_ = 0;
+    std::chrono::steady_clock::time_point last_time_{};
+};
+
+// Parse options written as space separated key=value pairs:
+//   events=value,log,alarm,property  deadband=0.5  rel_deadband=0.01
+//   max_rate=10  filter={"dbnd":{"abs":0.5}}  history=1000
+// Keys left out keep their defaults. The filter must not contain spaces.
+// Throws std::invalid_argument on unknown keys or malformed values.
+MonitorOptions ParseMonitorOptions(std::string_view spec);
+
+using MonitorConfig = std::vector<std::pair<std::string, MonitorOptions>>;
+
+// Parse one "PV options" entry per line, options as ParseMonitorOptions.
+// Text after '#' is a comment. PV names may use the patterns of
+// ExpandPVNames. Throws std::invalid_argument on malformed entries.
+MonitorConfig ParseMonitorConfig(std::string_view text);
+
+// Same as ParseMonitorConfig for the content of a file.
+// Throws std::runtime_error when the file cannot be read.
+MonitorConfig LoadMonitorConfig(const std::string& path);
+
+}  // namespace bchtree::epics
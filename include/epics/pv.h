@@ -0,0 +1,372 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "epics/monitor_filter.h"
+#include "epics/pv_cache.h"
+#include "epics/pv_history.h"
+#include "epics/request_pool.h"
+#include "epics/types.h"
+#include "flight_recorder.h"
+#include "inline_function.h"
+#include "metrics.h"
+
+namespace bchtree::epics {
+
+// The callbacks of a single request hold their captures in place: large
+// enough for a node callback wrapped by a CallbackGuard, and for GetCBAs
+// holding one of those and an ErrorCallback
+constexpr size_t kRequestCallbackSize = 48;
+
+using GetCallback = InlineFunction<void(PVData), 3 * kRequestCallbackSize>;
+using PutCallback = InlineFunction<void(bool), kRequestCallbackSize>;
+using ConnCallback = std::function<void(bool)>;
+using MonitorCallback = std::function<void(const PVData&)>;
+// Names a monitor callback for PV::RemoveMonitorCB
+using MonitorCallbackId = uint64_t;
+// Backend status code
+using ErrorCallback = InlineFunction<void(int), kRequestCallbackSize>;
+
+// Monitor updates that reached the cache, and those that the filter
+// dropped or that could not be decoded
+struct MonitorCounters {
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+};
+
+// Names an issued get or put for PV::CancelRequest
+struct RequestHandle {
+    void* request = nullptr;
+    uint64_t serial = 0;
+    bool put = false;
+
+    explicit operator bool() const { return serial != 0; }
+};
+
+template <typename T>
+using GetCallbackAs = InlineFunction<void(T), kRequestCallbackSize>;
+
+// One channel of a PV transport. Backends implement the requests; the
+// monitor cache, the monitor callbacks and the type conversions are common.
+//
+// Callbacks run on the backend's callback thread. Requests may be issued
+// from any thread attached with PVTransport::Attach().
+class PV {
+   public:
+    // Cap on the number of array elements requested for gets and monitors.
+    // 0 means the full element count of the channel.
+    static constexpr size_t kUnlimitedElements = 0;
+    // ErrorCallback status when a reply can't be converted to the requested
+    // type
+    static constexpr int kConversionError = -1;
+    // ErrorCallback status of a failed request for backends without status
+    // codes
+    static constexpr int kRequestError = -2;
+    // Cancelled requests still awaiting their reply, e.g. from an IOC that
+    // hangs, beyond which the PV refuses new requests
+    static constexpr size_t kMaxCancelledRequests = 64;
+
+    virtual ~PV() = default;
+
+    virtual void SetMaxElements(size_t max_elements) = 0;
+    // Decode the values as arrays even if the channel has one element, e.g.
+    // a waveform with NELM=1. Backends that can't tell a one element array
+    // from a scalar otherwise go by the element count.
+    void ExpectArray();
+    // Record connection, get, put and monitor events. Set before Connect().
+    virtual void SetFlightRecorder(
+        std::shared_ptr<FlightRecorder> recorder) = 0;
+    virtual void AddConnCB(ConnCallback cb) = 0;
+    // Time the requests and count the connections and monitor updates into
+    // metrics. Set before Connect().
+    void SetMetrics(std::shared_ptr<PVMetrics> metrics);
+    MonitorCallbackId AddMonitorCB(MonitorCallback cb);
+    // Stop calling the callback. A call already in progress, or queued by
+    // a CallbackGuard, may still come.
+    void RemoveMonitorCB(MonitorCallbackId id);
+    // Subscription and filtering of the monitor. On a live PV the client
+    // side filter is replaced at once and a changed event mask subscribes
+    // again. Returns false if the PV keeps its server side filter, which
+    // is part of the channel and can't change once it is created.
+    bool SetMonitorOptions(const MonitorOptions& options);
+    MonitorOptions GetMonitorOptions() const;
+    MonitorCounters MonitorCounts() const;
+
+    // Record the numeric monitor updates in a ring of at least capacity
+    // samples. May be called at any time; a ring that is too small is
+    // replaced by an empty one.
+    void EnableHistory(size_t capacity);
+    // nullptr unless EnableHistory() was called
+    std::shared_ptr<const PVHistory> History() const;
+    virtual void Connect() = 0;
+
+    // Latest monitor value. Lock-free: never waits for the callback thread.
+    template <typename T>
+    T GetAs() const {
+        if constexpr (std::is_arithmetic_v<T>) {
+            // Seqlock fast path, no reference counting
+            if (auto numeric = cache_.LoadNumeric()) {
+                PVData data;
+                data.value = std::move(*numeric);
+                return extract_as<T>(data);
+            }
+        }
+
+        const auto snapshot = cache_.Load();
+        const PVData& data = snapshot ? snapshot->data : kEmptyPVData;
+
+        if constexpr (std::is_same_v<T, PVData>) {
+            // Don't need convert
+            return data;
+        } else {
+            // Convert to sample data
+            return extract_as<T>(data);
+        }
+    }
+
+    // Latest monitor value with its update counter, nullptr before the first
+    // update
+    std::shared_ptr<const PVSnapshot> Snapshot() const;
+    uint64_t UpdateCount() const;
+    bool HasValue() const;
+    // Latest value if it is a numeric scalar, nullopt for strings, arrays
+    // and before the first update. Lock-free like GetAs.
+    std::optional<double> NumericValue() const;
+    // State names of an enum PV by index, read once when it connects;
+    // nullptr for other PVs and until known
+    std::shared_ptr<const std::vector<std::string>> EnumStrings() const;
+
+    // Issue an asynchronous get. Without err_cb a failed get is only counted
+    // in DroppedErrors(). Pass flush=false to queue several requests and send
+    // them with a single PVTransport::Flush(). handle, if given, receives
+    // the handle of the request.
+    bool GetCB(GetCallback cb, std::chrono::milliseconds timeout,
+               ErrorCallback err_cb = nullptr, bool flush = true,
+               RequestHandle* handle = nullptr);
+
+    // GetCB converting the reply to T
+    template <typename T>
+    bool GetCBAs(GetCallbackAs<T> cb, const std::chrono::milliseconds timeout,
+                 ErrorCallback err_cb = nullptr, bool flush = true,
+                 RequestHandle* handle = nullptr) {
+        if constexpr (std::is_same_v<T, PVData>) {
+            return GetCB(std::move(cb), timeout, std::move(err_cb), flush,
+                         handle);
+        } else {
+            return GetCB(
+                [this, cb = std::move(cb), err_cb](PVData data) {
+                    T value;
+                    try {
+                        value = extract_as<T>(data);
+                    } catch (const std::exception&) {
+                        // Never throws on the callback thread
+                        if (err_cb) {
+                            err_cb(kConversionError);
+                        } else {
+                            dropped_errors_.fetch_add(
+                                1, std::memory_order_relaxed);
+                        }
+                        return;
+                    }
+                    cb(std::move(value));
+                },
+                timeout, err_cb, flush, handle);
+        }
+    }
+
+    // Pass flush=false to batch puts, see GetCB
+    bool PutCB(const PVScalarValue& v, PutCallback cb, bool flush = true,
+               RequestHandle* handle = nullptr);
+
+    // Drop the callbacks of a request that has not completed, and what they
+    // hold. Its context returns to the pool when the backend answers, which
+    // then runs no callback. Returns false if the request completed.
+    bool CancelRequest(const RequestHandle& handle);
+    // True while the PV refuses requests, see kMaxCancelledRequests
+    bool Saturated() const;
+
+    virtual std::string GetPVname() const = 0;
+    virtual bool IsConnected() const = 0;
+
+    // Pure conversion helpers, public so that benchmarks can drive them
+    // without a channel
+    template <typename T>
+    static T extract_as(const PVData& d) {
+        if constexpr (is_pv_array_v<T>) {
+            return extract_array_as<typename is_pv_array<T>::element_type>(d);
+        } else {
+            return extract_scalar_as<T>(d);
+        }
+    }
+
+    template <typename T>
+    static T extract_scalar_as(const PVData& d) {
+        // Try exact type first
+        if (const auto* pv = std::get_if<PVScalarValue>(&d.value)) {
+            // std::string is read from the inline PVString below
+            if constexpr (!std::is_same_v<T, std::string>) {
+                if (const auto* exact = std::get_if<T>(pv)) {
+                    return *exact;
+                }
+            }
+            // Numeric scalar cast support (e.g., stored as double -> T=int32_t)
+            if constexpr (std::is_same_v<T, int32_t> ||
+                          std::is_same_v<T, float> ||
+                          std::is_same_v<T, double> ||
+                          std::is_same_v<T, uint16_t>) {
+                return std::visit(
+                    [](const auto& val) -> T {
+                        using S = std::decay_t<decltype(val)>;
+                        if constexpr (std::is_same_v<S, int32_t> ||
+                                      std::is_same_v<S, float> ||
+                                      std::is_same_v<S, double> ||
+                                      std::is_same_v<S, uint16_t>) {
+                            return static_cast<T>(val);
+                        } else {
+                            throw std::runtime_error("unsupported DBR type");
+                        }
+                    },
+                    *pv);
+            }
+            if constexpr (std::is_same_v<T, std::string>) {
+                if (const auto* s = std::get_if<PVString>(pv)) return s->str();
+            }
+        }
+        throw std::runtime_error("unsupported DBR type");
+    }
+
+    template <typename E>
+    static PVArray<E> extract_array_as(const PVData& d) {
+        if (const auto* pa = std::get_if<PVArrayValue>(&d.value)) {
+            // Exact element type: share the buffer without copying
+            if (const auto* exact = std::get_if<PVArray<E>>(pa)) {
+                return *exact;
+            }
+            // Numeric element cast needs a new buffer
+            if constexpr (std::is_arithmetic_v<E>) {
+                return std::visit(
+                    [](const auto& arr) -> PVArray<E> {
+                        using S = typename std::decay_t<
+                            decltype(arr)>::element_type::value_type;
+                        if constexpr (std::is_arithmetic_v<S>) {
+                            auto out = std::make_shared<std::vector<E>>();
+                            if (arr) out->assign(arr->begin(), arr->end());
+                            return out;
+                        } else {
+                            throw std::runtime_error("unsupported DBR type");
+                        }
+                    },
+                    *pa);
+            }
+        }
+        // A scalar channel reads as a one element array
+        if (std::holds_alternative<PVScalarValue>(d.value)) {
+            return std::make_shared<const std::vector<E>>(
+                1, extract_scalar_as<E>(d));
+        }
+        throw std::runtime_error("unsupported DBR type");
+    }
+
+    // Request contexts allocated so far. Stays at the number of requests
+    // once in flight together.
+    size_t RequestContexts() const;
+    // Failed gets, and replies that could not be converted, that had no
+    // ErrorCallback to report to
+    uint64_t DroppedErrors() const;
+
+   protected:
+    // Context of a request, reused from a pool of the PV
+    struct GetRequest {
+        GetCallback cb;
+        ErrorCallback err_cb;
+        std::chrono::steady_clock::time_point start;
+        PV* pv = nullptr;
+        bool cancelled = false;
+        uint64_t serial = 0;
+        GetRequest* next = nullptr;
+    };
+    struct PutRequest {
+        PutCallback cb;
+        std::chrono::steady_clock::time_point start;
+        PV* pv = nullptr;
+        bool cancelled = false;
+        uint64_t serial = 0;
+        PutRequest* next = nullptr;
+    };
+
+    // The requests of the backend, see GetCB and PutCB. On success the
+    // backend completes the request exactly once, with CompleteGet or
+    // FailGet, resp. CompletePut; on failure the request stays with the PV.
+    virtual bool DoGetCB(GetRequest* req, std::chrono::milliseconds timeout,
+                         bool flush) = 0;
+    virtual bool DoPutCB(const PVScalarValue& v, PutRequest* req,
+                         bool flush) = 0;
+
+    // Return the request to the pool, then run its callback
+    void CompleteGet(GetRequest* req, PVData data);
+    // Without err_cb, only counted in DroppedErrors()
+    void FailGet(GetRequest* req, int status);
+    void CompletePut(PutRequest* req, bool success);
+
+    // Store a monitor update and run the monitor callbacks, unless the
+    // monitor filter drops it. Called by the backend from one thread at a
+    // time, without holding its locks.
+    void PublishMonitor(PVData data);
+    // Count a monitor update the backend could not decode
+    void DropMonitor();
+    void SetEnumStrings(std::vector<std::string> strings);
+    // Called by SetMonitorOptions() when events or server_filter change.
+    // Returns false if the backend keeps the previous server_filter.
+    virtual bool MonitorOptionsChanged(const MonitorOptions& previous) {
+        (void)previous;
+        return true;
+    }
+    bool ArrayExpected() const;
+
+    PVCache cache_;
+
+   private:
+    static inline const PVData kEmptyPVData{};
+
+    // Serializes AddMonitorCB and RemoveMonitorCB, guards the ids
+    std::mutex monitor_mtx_;
+    MonitorCallbackId last_monitor_id_ = 0;
+    // Copy-on-write so that PublishMonitor reads it without a lock
+    std::shared_ptr<
+        const std::vector<std::pair<MonitorCallbackId, MonitorCallback>>>
+        monitor_cbs_;
+
+    mutable std::mutex options_mtx_;  // guards monitor_options_
+    MonitorOptions monitor_options_;
+    // Swapped whole by SetMonitorOptions(), fed by the monitor thread;
+    // nullptr when every update passes
+    std::shared_ptr<MonitorFilter> monitor_filter_;
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> expect_array_{false};
+    std::shared_ptr<const std::vector<std::string>> enum_strings_;
+
+    std::shared_ptr<PVMetrics> metrics_;
+
+    // Members of the base class: destroyed after the backend has cancelled
+    // what is in flight
+    RequestPool<GetRequest> get_requests_;
+    RequestPool<PutRequest> put_requests_;
+    std::atomic<size_t> cancelled_in_flight_{0};
+    // Failed gets without an ErrorCallback
+    std::atomic<uint64_t> dropped_errors_{0};
+
+    std::mutex history_mtx_;  // serializes EnableHistory
+    std::shared_ptr<PVHistory> history_;
+};
+
+}  // namespace bchtree::epics
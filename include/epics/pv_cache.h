@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "epics/types.h"
+
+namespace bchtree::epics {
+
+// Immutable value published by a PVCache
+struct PVSnapshot {
+    PVData data;
+    uint64_t version = 0;  // 1 for the first update, then monotonic
+};
+
+// Latest-value cache shared between the CA callback thread (writer) and the
+// tick thread (readers).
+//
+// An update builds a new immutable snapshot and swaps the pointer
+// atomically, so readers never see a torn PVData and neither side waits
+// while a value is copied or decoded. Numeric scalars are additionally kept
+// behind a seqlock: LoadNumeric() is a handful of plain loads, without the
+// reference counting of Load().
+//
+// Snapshots that were replaced are reused by later updates once no reader
+// holds them, so with inline scalars and strings an update does not
+// allocate.
+//
+// Publish() is expected from one thread at a time per cache, which is how CA
+// delivers the events of a subscription.
+class PVCache {
+   public:
+    uint64_t Publish(PVData data);
+
+    // nullptr until the first Publish()
+    std::shared_ptr<const PVSnapshot> Load() const;
+
+    // Latest value if it is a numeric scalar, std::nullopt for strings,
+    // arrays and before the first Publish()
+    std::optional<PVScalarValue> LoadNumeric() const;
+
+    // Number of updates published so far
+    uint64_t Version() const;
+
+   private:
+    static constexpr uint8_t kNotNumeric = 0xff;
+    static constexpr int kMaxSeqRetries = 16;
+    static constexpr size_t kSpareSnapshots = 4;
+
+    std::shared_ptr<PVSnapshot> TakeSpare();
+    void Retire(std::shared_ptr<PVSnapshot> snapshot);
+
+    std::shared_ptr<const PVSnapshot> snapshot_;
+    // Writer side only: the published snapshot and replaced ones
+    std::shared_ptr<PVSnapshot> current_;
+    std::array<std::shared_ptr<PVSnapshot>, kSpareSnapshots> spares_;
+
+    // Seqlock: odd while Publish() is writing, version is seq_ / 2
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> numeric_bits_{0};
+    std::atomic<uint8_t> numeric_index_{kNotNumeric};
+};
+
+}  // namespace bchtree::epics
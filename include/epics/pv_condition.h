@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "epics/types.h"
+
+namespace bchtree::epics {
+
+// Predicate on the scalar value of a PV. Arrays never match.
+//
+//   eq, ne          equal / not equal; numbers compare as numbers, strings
+//                   as strings
+//   lt, le, gt, ge  numeric comparison with the operand
+//   within          |value - operand| <= tolerance
+//   mask            value & mask == operand & mask (integers)
+//   state           text of the value equals the operand, e.g. a string
+//                   PV; an enum matches its state name (see
+//                   PV::EnumStrings) or its index
+class PVCondition {
+   public:
+    enum class Op { kEq, kNe, kLt, kLe, kGt, kGe, kWithin, kMask, kState };
+
+    // Throws std::invalid_argument on unknown names
+    static Op ParseOp(std::string_view name);
+
+    PVCondition(Op op, PVScalarValue operand, double tolerance = 0,
+                uint32_t mask = 0);
+
+    // states: names of the enum states by index, if the PV is an enum
+    bool Matches(const PVData& data,
+                 const std::vector<std::string>* states = nullptr) const;
+
+   private:
+    Op op_;
+    PVScalarValue operand_;
+    double tolerance_;
+    uint32_t mask_;
+};
+
+}  // namespace bchtree::epics
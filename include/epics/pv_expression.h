@@ -0,0 +1,82 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bchtree::epics {
+
+// Arithmetic and logic over the numeric values of PVs, compiled once into
+// a flat program so that evaluating it is a loop over a few instructions.
+//
+//   (A:CUR * 1.2 + B:OFF) > LIM
+//
+// Names are letters, digits and '_', ':' or '.'; any other name, e.g. one
+// with a '-', is written in single quotes: 'LI-01:CUR'. Numbers are C
+// literals (1, 1.5, 2e-3). Operators, from lowest precedence:
+//
+//   c ? a : b
+//   ||  or
+//   &&  and
+//   ==  !=
+//   <  <=  >  >=
+//   +  -
+//   *  /  %
+//   -  !  not   (unary)
+//
+// and the functions abs, sqrt, exp, log, floor, ceil (one argument), min,
+// max and pow (two). Names may contain ':', so leave a space before the ':'
+// of c ? a : b. Comparisons and logic give 1 or 0; a value is true if
+// it is neither 0 nor NaN. All operands are evaluated, there is no short
+// circuit, and constant subexpressions are folded at compile time.
+class PVExpression {
+   public:
+    // Throws std::invalid_argument on syntax errors
+    static PVExpression Compile(std::string_view text);
+
+    // PV names in order of first use; Evaluate() reads values[i] for
+    // Names()[i]
+    const std::vector<std::string>& Names() const { return names_; }
+    const std::string& Text() const { return text_; }
+
+    // NaN for a default constructed expression
+    double Evaluate(const double* values) const;
+    double Evaluate(const std::vector<double>& values) const {
+        return Evaluate(values.data());
+    }
+
+    static bool IsTrue(double value) {
+        return value != 0 && !std::isnan(value);
+    }
+
+   private:
+    friend class PVExpressionParser;
+
+    enum class Op : uint8_t {
+        // Operands
+        kConst, kLoad,
+        // Unary
+        kNeg, kNot, kAbs, kSqrt, kExp, kLog, kFloor, kCeil,
+        // Binary
+        kAdd, kSub, kMul, kDiv, kMod, kMin, kMax, kPow,
+        kLt, kLe, kGt, kGe, kEq, kNe, kAnd, kOr,
+        // c ? a : b
+        kSelect,
+    };
+
+    struct Instr {
+        Op op;
+        uint32_t index = 0;  // kLoad: slot in values
+        double constant = 0;  // kConst
+    };
+
+    // Operands deeper than this are rejected by Compile()
+    static constexpr size_t kMaxStack = 64;
+
+    std::string text_;
+    std::vector<std::string> names_;
+    std::vector<Instr> program_;
+};
+
+}  // namespace bchtree::epics
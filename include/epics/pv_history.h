@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace bchtree::epics {
+
+// One numeric monitor update, stamped on arrival
+struct PVSample {
+    std::chrono::steady_clock::time_point time;
+    double value;
+};
+
+// Fixed-capacity ring of the last numeric monitor updates of a PV. The
+// buffer is allocated up front; pushing never allocates. One writer (the
+// monitor callback thread), any number of readers.
+class PVHistory {
+   public:
+    explicit PVHistory(size_t capacity);
+
+    size_t Capacity() const { return buffer_.size(); }
+    // When the ring started recording
+    std::chrono::steady_clock::time_point Since() const { return since_; }
+
+    void Push(const PVSample& sample);
+
+    // Number of samples pushed so far
+    uint64_t Sequence() const;
+
+    // Append the samples from sequence number from onwards to out, oldest
+    // first, and return the sequence number after the last one. Samples
+    // that the ring has already overwritten are skipped.
+    uint64_t ReadSince(uint64_t from, std::vector<PVSample>& out) const;
+
+   private:
+    const std::chrono::steady_clock::time_point since_;
+
+    mutable std::mutex mtx_;
+    std::vector<PVSample> buffer_;
+    uint64_t next_ = 0;
+};
+
+// Mean, min, max, standard deviation and rate of the samples in a sliding
+// window. Every sample is added and expired once and min/max use monotonic
+// queues, so all statistics cost O(1) amortized per sample.
+class WindowStats {
+   public:
+    // The samples of the last span
+    static WindowStats OverTime(std::chrono::steady_clock::duration span);
+    // The last count samples
+    static WindowStats OverCount(size_t count);
+
+    // Samples must come in time order
+    void Add(const PVSample& sample);
+    // Drop the samples that are older than the span at now
+    void Expire(std::chrono::steady_clock::time_point now);
+    void Clear();
+
+    size_t Count() const { return samples_.size(); }
+    // Undefined on an empty window
+    double Mean() const;
+    double Min() const { return min_.front().value; }
+    double Max() const { return max_.front().value; }
+    // Sample standard deviation, 0 below two samples
+    double Stddev() const;
+    // Updates per second: over the span for a time window, between the
+    // first and last sample for a count window
+    double Rate() const;
+
+   private:
+    struct Entry {
+        uint64_t seq;
+        double value;
+    };
+
+    WindowStats(std::chrono::steady_clock::duration span, size_t count)
+        : span_(span), count_(count) {}
+
+    void PopFront();
+
+    std::chrono::steady_clock::duration span_;
+    size_t count_;
+
+    std::deque<PVSample> samples_;
+    uint64_t front_seq_ = 0;  // sequence number of samples_.front()
+    std::deque<Entry> min_;   // increasing values
+    std::deque<Entry> max_;   // decreasing values
+
+    // Sums of value - shift_, which keeps them small for the variance
+    double shift_ = 0;
+    double sum_ = 0;
+    double sum_sq_ = 0;
+};
+
+}  // namespace bchtree::epics
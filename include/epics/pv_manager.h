@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "epics/pv.h"
+#include "epics/pv_transport.h"
+
+namespace bchtree::epics {
+
+// Registry slot of one PV name. Owned by the registry and by PVHandles.
+struct PVRegistryEntry {
+    explicit PVRegistryEntry(std::string_view pv_name) : name(pv_name) {}
+
+    const std::string name;
+    std::mutex mtx;  // guards pv
+    std::weak_ptr<PV> pv;
+    std::atomic<bool> removed{false};
+};
+
+// Interned PV name. Resolving a handle skips hashing and the registry locks;
+// nodes can keep one across executions.
+class PVHandle {
+   public:
+    PVHandle() = default;
+
+    const std::string& name() const { return entry_->name; }
+    explicit operator bool() const { return entry_ != nullptr; }
+
+   private:
+    friend class PVManager;
+    explicit PVHandle(std::shared_ptr<PVRegistryEntry> entry)
+        : entry_(std::move(entry)) {}
+
+    std::shared_ptr<PVRegistryEntry> entry_;
+};
+
+// One PV per name, created by a transport on first use. Names of the form
+// "<scheme>://<channel>" go to the transport added for the scheme, any
+// other name to the default transport.
+class PVManager {
+   public:
+    explicit PVManager(std::shared_ptr<PVTransport> transport)
+        : transport_(std::move(transport)) {}
+
+    // Serve "<scheme>://" names with transport. Add every transport before
+    // the first Get().
+    void AddTransport(std::string scheme,
+                      std::shared_ptr<PVTransport> transport);
+    // False if pv_name names a scheme without a transport
+    bool Serves(std::string_view pv_name) const;
+
+    // Throws std::invalid_argument if no transport serves pv_name
+    std::shared_ptr<PV> Get(std::string_view pv_name);
+    std::shared_ptr<PV> Get(const PVHandle& handle);
+
+    // The live PV of pv_name, nullptr if there is none. Never creates one.
+    std::shared_ptr<PV> Find(std::string_view pv_name) const;
+
+    // Get every PV, taking each registry shard lock once
+    std::vector<std::shared_ptr<PV>> GetMany(
+        const std::vector<std::string>& pv_names);
+
+    // Create the channels of all PVs, send the searches with one flush and
+    // wait up to timeout for them to connect. Returns the names of the PVs
+    // that are still disconnected. Only the PVs of this manager wake the
+    // wait early; any other PV is checked at the timeout.
+    std::vector<std::string> ConnectAll(
+        const std::vector<std::shared_ptr<PV>>& pvs,
+        std::chrono::milliseconds timeout);
+
+    // Make the calling thread able to issue requests; nodes call it once
+    // from their constructor
+    void Attach();
+    // Send the requests queued with flush=false
+    void Flush();
+
+    // Register the name without creating the PV
+    PVHandle Intern(std::string_view pv_name);
+
+    // Element cap applied to PVs created from now on (see
+    // PV::SetMaxElements)
+    void SetMaxArrayElements(size_t max_elements);
+    // Recorder given to PVs created from now on
+    void SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder);
+    // Registry the PVs created from now on report their metrics to
+    void SetMetrics(std::shared_ptr<MetricsRegistry> metrics);
+    // Monitor options of pv_name, applied when its PV is created and to
+    // the live PV, see PV::SetMonitorOptions. False if the live PV keeps
+    // its server side filter.
+    bool SetMonitorOptions(std::string_view pv_name,
+                           const MonitorOptions& options);
+
+    // Sum of PV::MonitorCounts over the live PVs
+    MonitorCounters MonitorCounts() const;
+
+    void Remove(std::string_view pv_name);
+    void Shutdown();
+    size_t CollectGarbage();
+    size_t RegistrySize() const;
+
+   private:
+    static constexpr size_t kShardCount = 16;
+
+    // Keys view the name stored in the entry, so lookups by string_view
+    // neither allocate nor copy
+    struct Shard {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<std::string_view, std::shared_ptr<PVRegistryEntry>>
+            entries;
+    };
+
+    // Connection changes of every PV created here. Each PV registers one
+    // callback when it is created, so waiting in ConnectAll() adds none.
+    struct ConnEvents {
+        std::mutex mtx;
+        std::condition_variable cv;
+        uint64_t count{0};
+    };
+
+    static size_t ShardIndex(std::string_view pv_name);
+    std::shared_ptr<PVRegistryEntry> FindOrInsert(std::string_view pv_name);
+    std::shared_ptr<PV> Resolve(PVRegistryEntry& entry);
+    PVTransport* TransportFor(std::string_view scheme) const;
+
+    std::shared_ptr<PVTransport> transport_;
+    std::vector<std::pair<std::string, std::shared_ptr<PVTransport>>>
+        scheme_transports_;
+    std::array<Shard, kShardCount> shards_;
+    // Shared with the PV callbacks, which may outlive the manager
+    std::shared_ptr<ConnEvents> conn_events_ =
+        std::make_shared<ConnEvents>();
+    std::atomic<size_t> max_array_elements_{PV::kUnlimitedElements};
+    std::shared_ptr<FlightRecorder> recorder_;
+    std::shared_ptr<MetricsRegistry> metrics_;
+
+    std::mutex monitor_options_mtx_;
+    std::map<std::string, MonitorOptions, std::less<>> monitor_options_;
+};
+
+}  // namespace bchtree::epics
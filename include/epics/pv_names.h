@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bchtree::epics {
+
+// Most names ExpandPVNames() produces, so that a typo such as
+// "{0..99999999}" fails instead of creating millions of channels
+constexpr size_t kMaxExpandedNames = 10000;
+
+// Expand a list of PV names into individual names.
+//
+// Names are separated by whitespace or ';'. Each name may contain brace
+// patterns which are expanded like the shell does:
+//   "SR:BPM{01..03}:X"  -> SR:BPM01:X, SR:BPM02:X, SR:BPM03:X
+//   "MAG:{QF,QD}:I"     -> MAG:QF:I, MAG:QD:I
+// Throws std::invalid_argument on malformed patterns, and when the names
+// or the alternatives of a pattern would exceed kMaxExpandedNames.
+std::vector<std::string> ExpandPVNames(std::string_view spec);
+
+// Split "pva://SR:X" into {"pva", "SR:X"}. A name without "://" has an
+// empty scheme.
+std::pair<std::string_view, std::string_view> SplitPVScheme(
+    std::string_view pv_name);
+
+// pv_name with "scheme://" in front, unless it already names a scheme or
+// scheme is empty
+std::string WithPVScheme(std::string_view scheme, std::string_view pv_name);
+
+// Channel name applying a server side channel filter, e.g. "SR:X" and
+// {"dbnd":{"abs":1}} give SR:X.{"dbnd":{"abs":1}}. An empty filter leaves
+// pv_name unchanged.
+std::string WithChannelFilter(std::string_view pv_name,
+                              std::string_view filter);
+
+}  // namespace bchtree::epics
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "epics/types.h"
+
+namespace bchtree::epics {
+
+struct PVPutEntry {
+    std::string pv;
+    PVScalarValue value;
+};
+
+using PVPutTable = std::vector<PVPutEntry>;
+
+// Parse a table of (pv, value) pairs.
+//
+// Entries are separated by newlines or ';' and written as "PV value" or
+// "PV=value". Text after '#' is a comment. Values that parse completely as
+// integers become int32_t, other numbers double, and everything else a
+// string (double quotes keep spaces and separators). PV names may use the
+// patterns of ExpandPVNames, in which case every expanded PV gets the value.
+// Throws std::invalid_argument on malformed entries.
+PVPutTable ParsePVPutTable(std::string_view text);
+
+// Same as ParsePVPutTable for the content of a file.
+// Throws std::runtime_error when the file cannot be read.
+PVPutTable LoadPVPutTable(const std::string& path);
+
+// Convert the textual value of a table entry.
+PVScalarValue ParsePVScalar(std::string_view text);
+
+}  // namespace bchtree::epics
@@ -0,0 +1,25 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "epics/pv.h"
+
+namespace bchtree::epics {
+
+// Creates the channels of one protocol. PVManager keeps one PV per name and
+// the nodes only see the PV interface, so the backend can be swapped without
+// touching them.
+class PVTransport {
+   public:
+    virtual ~PVTransport() = default;
+
+    // New, not yet connected channel
+    virtual std::shared_ptr<PV> CreatePV(const std::string& pv_name) = 0;
+
+    // Make the calling thread able to issue requests
+    virtual void Attach() {}
+    // Send the requests queued with flush=false
+    virtual void Flush() {}
+};
+
+}  // namespace bchtree::epics
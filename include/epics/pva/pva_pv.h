@@ -0,0 +1,84 @@
+#pragma once
+#include <pvxs/client.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "epics/pv.h"
+#include "epics/types.h"
+#include "flight_recorder.h"
+
+namespace bchtree::epics::pva {
+
+// pvAccess channel through the PVXS client. Normative types are mapped to
+// PVData: NTScalar and NTScalarArray by the type of their value field,
+// NTEnum to its index. Only value, alarm and timeStamp are requested.
+// ErrorCallback receives PV::kRequestError or PV::kConversionError.
+class PVAPV : public PV {
+   public:
+    PVAPV(pvxs::client::Context ctx, std::string pv_name);
+    ~PVAPV() override;
+
+    // pvAccess requests carry no element count; arrays arrive whole
+    void SetMaxElements(size_t) override {}
+    void SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder) override;
+    void AddConnCB(ConnCallback cb) override;
+    // Starts the monitor, which also tracks the connection
+    void Connect() override;
+
+
+    std::string GetPVname() const override;
+    bool IsConnected() const override;
+
+    // Public so that tests and benchmarks can drive it without a channel.
+    // Throws std::runtime_error for structures without a PVData mapping
+    // (e.g. NTTable).
+    static PVData DecodeValue(const pvxs::Value& top);
+
+   protected:
+    // Requests are sent right away; flush is ignored
+    bool DoGetCB(GetRequest* req, std::chrono::milliseconds timeout,
+                 bool flush) override;
+    bool DoPutCB(const PVScalarValue& v, PutRequest* req,
+                 bool flush) override;
+    bool MonitorOptionsChanged(const MonitorOptions& previous) override;
+
+   private:
+    void HandleEvents(pvxs::client::Subscription& sub);
+    void SetConnected(bool connected);
+    // Keep op alive until done is set; dropping it would cancel it
+    void KeepOperation(std::shared_ptr<pvxs::client::Operation> op,
+                       std::shared_ptr<std::atomic<bool>> done);
+
+    void RecordFlight(FlightEvent event, int32_t status,
+                      uint8_t to = 0) const {
+        if (recorder_) recorder_->Record(event, recorder_id_, 0, to, status);
+    }
+
+    struct PendingOperation {
+        std::shared_ptr<pvxs::client::Operation> op;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    pvxs::client::Context ctx_;
+    const std::string pv_name_;
+
+    // Guards sub_, channel_, connected_ and conn_cbs_
+    mutable std::mutex mtx_;
+    std::shared_ptr<pvxs::client::Subscription> sub_;
+    // pv_name_ with the server side filter, set by Connect()
+    std::string channel_;
+    bool connected_{false};
+    std::vector<ConnCallback> conn_cbs_;
+
+    std::mutex ops_mtx_;
+    std::vector<PendingOperation> ops_;
+
+    std::shared_ptr<FlightRecorder> recorder_;
+    uint32_t recorder_id_ = 0;
+};
+
+}  // namespace bchtree::epics::pva
@@ -0,0 +1,26 @@
+#pragma once
+#include <pvxs/client.h>
+
+#include <memory>
+#include <string>
+
+#include "epics/pv_transport.h"
+
+namespace bchtree::epics::pva {
+
+// PVTransport creating PVAPVs on one PVXS client context. The context is
+// thread-safe, so there is nothing to attach, and requests go out as soon
+// as they are issued.
+class PVATransport : public PVTransport {
+   public:
+    // Client configured from the EPICS_PVA_* environment variables
+    PVATransport();
+    explicit PVATransport(pvxs::client::Context ctx) : ctx_(std::move(ctx)) {}
+
+    std::shared_ptr<PV> CreatePV(const std::string& pv_name) override;
+
+   private:
+    pvxs::client::Context ctx_;
+};
+
+}  // namespace bchtree::epics::pva
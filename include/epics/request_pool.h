@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bchtree::epics {
+
+// Free list of request contexts, R having `R* next` and `uint64_t serial`
+// members. A context is allocated only when all the others are in flight,
+// so a PV doing one request at a time keeps reusing the same one. Contexts
+// live as long as the pool.
+//
+// Each acquisition gets a new serial, 0 while the context is free, so that
+// a context can be named without the risk of reaching its next request.
+template <typename R>
+class RequestPool {
+   public:
+    R* Acquire() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        R* request;
+        if (!free_) {
+            all_.push_back(std::make_unique<R>());
+            request = all_.back().get();
+        } else {
+            request = free_;
+            free_ = request->next;
+            request->next = nullptr;
+        }
+        request->serial = ++serial_;
+        return request;
+    }
+
+    // take(R&) runs under the lock before the context is free again, e.g.
+    // to move the callbacks out. Returns what take returns.
+    template <typename F>
+    auto Release(R* request, F&& take) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto taken = take(*request);
+        request->serial = 0;
+        request->next = free_;
+        free_ = request;
+        return taken;
+    }
+
+    // Run f(R&) under the lock if the context still serves the request
+    // with this serial and return its result, else false
+    template <typename F>
+    bool IfCurrent(R* request, uint64_t serial, F&& f) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (serial == 0 || request->serial != serial) return false;
+        return f(*request);
+    }
+
+    // Contexts allocated so far, in flight or free
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return all_.size();
+    }
+
+   private:
+    mutable std::mutex mtx_;
+    R* free_ = nullptr;
+    uint64_t serial_ = 0;
+    std::vector<std::unique_ptr<R>> all_;
+};
+
+}  // namespace bchtree::epics
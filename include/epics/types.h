@@ -1,29 +1,89 @@
 #pragma once
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 namespace bchtree::epics {
 
+// DBF_STRING value. CA strings hold at most 39 characters (MAX_STRING_SIZE
+// with the terminator), so they are kept inline and copying a value never
+// allocates. Longer strings, which only pvAccess sends, share one immutable
+// heap buffer like the arrays do.
+class PVString {
+   public:
+    static constexpr size_t kInlineCapacity = 39;
+
+    PVString() = default;
+    PVString(std::string_view s) {
+        if (s.size() <= kInlineCapacity) {
+            std::memcpy(inline_, s.data(), s.size());
+            size_ = static_cast<uint8_t>(s.size());
+        } else {
+            long_ = std::make_shared<const std::string>(s);
+        }
+    }
+    PVString(const std::string& s) : PVString(std::string_view(s)) {}
+    PVString(const char* s) : PVString(std::string_view(s)) {}
+
+    std::string_view view() const {
+        if (long_) return *long_;
+        return std::string_view(inline_, size_);
+    }
+    size_t size() const { return view().size(); }
+    std::string str() const { return std::string(view()); }
+
+    bool operator==(const PVString& other) const {
+        return view() == other.view();
+    }
+    bool operator!=(const PVString& other) const { return !(*this == other); }
+
+   private:
+    char inline_[kInlineCapacity] = {};
+    uint8_t size_ = 0;
+    std::shared_ptr<const std::string> long_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const PVString& s) {
+    return os << s.view();
+}
+
 using PVScalarValue = std::variant<int32_t,     // DBF_LONG
                                    float,       // DBF_FLOAT
                                    double,      // DBF_DOUBLE
                                    uint16_t,    // DBF_ENUM (index)
-                                   std::string  // DBF_STRING
+                                   PVString     // DBF_STRING
                                    >;
 
+// Immutable, reference-counted array buffer. The monitor cache, callbacks
+// and the blackboard share one buffer instead of copying the elements.
+template <typename T>
+using PVArray = std::shared_ptr<const std::vector<T>>;
+
+template <typename T>
+struct is_pv_array : std::false_type {};
+template <typename T>
+struct is_pv_array<PVArray<T>> : std::true_type {
+    using element_type = T;
+};
+template <typename T>
+inline constexpr bool is_pv_array_v = is_pv_array<T>::value;
+
 // COMMON array alternatives
-using PVArrayValue =
-    std::variant<std::vector<int32_t>,     // DBF_LONG
-                 std::vector<float>,       // DBF_FLOAT
-                 std::vector<double>,      // DBF_DOUBLE
-                 std::vector<uint16_t>,    // DBF_ENUM array (rare)
-                 std::vector<std::string>  // DBF_STRING
-                 >;
+using PVArrayValue = std::variant<PVArray<int32_t>,     // DBF_LONG
+                                  PVArray<float>,       // DBF_FLOAT
+                                  PVArray<double>,      // DBF_DOUBLE
+                                  PVArray<uint16_t>,    // DBF_ENUM array (rare)
+                                  PVArray<std::string>  // DBF_STRING
+                                  >;
 
 struct PVMeta {
     uint32_t severity = 0;
@@ -38,4 +98,23 @@ struct PVData {
     size_t count = 0;
 };
 
+// Value of a numeric scalar, nullopt for strings and arrays
+inline std::optional<double> NumericScalar(const PVData& data) {
+    const auto* scalar = std::get_if<PVScalarValue>(&data.value);
+    if (!scalar) return std::nullopt;
+    return std::visit(
+        [](const auto& v) -> std::optional<double> {
+            using V = std::decay_t<decltype(v)>;
+            if constexpr (std::is_arithmetic_v<V>) {
+                return static_cast<double>(v);
+            } else {
+                return std::nullopt;
+            }
+        },
+        *scalar);
+}
+
+// Results of a multi-PV read keyed by PV name
+using PVDataMap = std::unordered_map<std::string, PVData>;
+
 }  // namespace bchtree::epics
@@ -0,0 +1,30 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace bchtree {
+
+// Calls on_change from a background thread whenever the file is written
+// or replaced. The directory is watched rather than the file, so that
+// editors that save by renaming a new file over the old one are seen too.
+class FileWatcher {
+   public:
+    // Throws std::runtime_error if the directory can't be watched
+    FileWatcher(const std::string& path, std::function<void()> on_change);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+   private:
+    void Loop();
+
+    std::string name_;  // file name within the watched directory
+    std::function<void()> on_change_;
+    int inotify_fd_ = -1;
+    int stop_fd_ = -1;  // eventfd waking Loop() on destruction
+    std::thread thread_;
+};
+
+}  // namespace bchtree
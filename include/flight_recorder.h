@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bchtree {
+
+enum class FlightEvent : uint8_t {
+    NodeStatus = 0,  // subject: node id, from/to: BT::NodeStatus
+    CAConnect,       // subject: PV id, to: 1 up / 0 down
+    CAGet,           // subject: PV id, detail: ECA status
+    CAPut,
+    CAMonitor,
+};
+
+// One event. Dumps store the fields packed, 20 bytes per record.
+struct FlightRecord {
+    uint64_t time_ns;  // system_clock, since the epoch
+    uint32_t subject;
+    int32_t detail;
+    FlightEvent event;
+    uint8_t from;
+    uint8_t to;
+    uint8_t reserved;
+};
+
+// Always-on ring of the most recent node transitions and CA events. The
+// buffer is allocated once; Record() is wait-free and never allocates, so it
+// can be called from the tick thread and from CA callback threads. Names are
+// registered once, when a node or PV is created, and get ids unique to the
+// recorder, so that several trees, and the trees of successive reloads, can
+// share one.
+class FlightRecorder {
+   public:
+    static constexpr size_t kDefaultCapacity = 65536;
+
+    // Capacity is rounded up to a power of two
+    explicit FlightRecorder(size_t capacity = kDefaultCapacity);
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    void Record(FlightEvent event, uint32_t subject, uint8_t from, uint8_t to,
+                int32_t detail = 0) noexcept;
+
+    uint32_t AddNode(std::string_view name);
+    uint32_t AddPV(std::string_view pv_name);
+
+    // Records still in the ring, oldest first
+    std::vector<FlightRecord> Snapshot() const;
+    size_t Capacity() const { return slots_.size(); }
+
+    // Write the ring and the names to path. Thread-safe; returns false if
+    // the file cannot be written.
+    bool Dump(const std::string& path) const;
+
+   private:
+    // seq is 2 * index + 2 once the record at index is complete
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        FlightRecord record{};
+    };
+
+    std::vector<Slot> slots_;
+    uint64_t mask_;
+    std::atomic<uint64_t> head_{0};
+
+    mutable std::mutex dump_mtx_;  // serializes Dump()
+    mutable std::mutex names_mtx_;
+    std::map<uint32_t, std::string> node_names_;
+    std::vector<std::string> pv_names_;
+};
+
+// Content of a dump file
+struct FlightDump {
+    std::map<uint32_t, std::string> node_names;
+    std::vector<std::string> pv_names;
+    std::vector<FlightRecord> records;
+};
+
+// Throws std::runtime_error on a missing or malformed file
+FlightDump LoadFlightDump(const std::string& path);
+
+// One line per record, e.g.
+// "2026-01-01T03:00:00.123456789 NODE  ReadCurrent  RUNNING -> FAILURE"
+std::string FormatFlightRecord(const FlightDump& dump,
+                               const FlightRecord& record);
+
+// Dump the recorder to path whenever the process receives signo. Blocks
+// the signal in the calling thread, so call it from main() before any other
+// thread is started.
+void DumpFlightRecorderOnSignal(std::shared_ptr<FlightRecorder> recorder,
+                                int signo, std::string path);
+
+}  // namespace bchtree
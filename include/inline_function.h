@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bchtree {
+
+template <typename Signature, size_t Capacity = 48>
+class InlineFunction;
+
+// std::function with a larger small buffer: callables up to Capacity bytes
+// are stored in place, larger ones on the heap. Used for the callbacks of
+// the PV requests, which std::function would allocate for nearly always.
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+    static_assert(Capacity >= sizeof(void*), "room for the heap pointer");
+
+   public:
+    InlineFunction() = default;
+    InlineFunction(std::nullptr_t) {}
+
+    template <typename F,
+              typename = std::enable_if_t<
+                  !std::is_same_v<std::decay_t<F>, InlineFunction> &&
+                  std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+    InlineFunction(F&& f) {
+        using Fn = std::decay_t<F>;
+        // An empty std::function or a null pointer gives an empty one
+        if constexpr (std::is_constructible_v<bool, const Fn&>) {
+            if (!static_cast<bool>(f)) return;
+        }
+        Emplace<Fn>(std::forward<F>(f));
+    }
+
+    InlineFunction(const InlineFunction& other) : ops_(other.ops_) {
+        if (ops_) ops_->copy(storage_, other.storage_);
+    }
+    InlineFunction(InlineFunction&& other) noexcept : ops_(other.ops_) {
+        if (ops_) ops_->move(storage_, other.storage_);
+        other.ops_ = nullptr;
+    }
+
+    InlineFunction& operator=(const InlineFunction& other) {
+        if (this != &other) {
+            InlineFunction copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            ops_ = other.ops_;
+            if (ops_) ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+        return *this;
+    }
+    InlineFunction& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    ~InlineFunction() { Reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    R operator()(Args... args) const {
+        if (!ops_) throw std::bad_function_call();
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+   private:
+    struct Ops {
+        R (*invoke)(void*, Args&&...);
+        void (*copy)(void*, const void*);
+        void (*move)(void*, void*);  // leaves the source destroyed
+        void (*destroy)(void*);
+    };
+
+    template <typename Fn>
+    static constexpr bool kFitsInline =
+        sizeof(Fn) <= Capacity &&
+        alignof(Fn) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<Fn>;
+
+    template <typename Fn>
+    static Fn* Get(void* p) {
+        if constexpr (kFitsInline<Fn>) {
+            return std::launder(static_cast<Fn*>(p));
+        } else {
+            return *static_cast<Fn**>(p);
+        }
+    }
+
+    template <typename Fn>
+    static const Ops* OpsFor() {
+        static constexpr Ops ops{
+            [](void* p, Args&&... args) -> R {
+                return std::invoke(*Get<Fn>(p), std::forward<Args>(args)...);
+            },
+            [](void* dst, const void* src) {
+                const Fn& fn = *Get<Fn>(const_cast<void*>(src));
+                if constexpr (kFitsInline<Fn>) {
+                    new (dst) Fn(fn);
+                } else {
+                    new (dst) Fn*(new Fn(fn));
+                }
+            },
+            [](void* dst, void* src) {
+                if constexpr (kFitsInline<Fn>) {
+                    Fn* fn = Get<Fn>(src);
+                    new (dst) Fn(std::move(*fn));
+                    fn->~Fn();
+                } else {
+                    new (dst) Fn*(*static_cast<Fn**>(src));
+                }
+            },
+            [](void* p) {
+                if constexpr (kFitsInline<Fn>) {
+                    Get<Fn>(p)->~Fn();
+                } else {
+                    delete Get<Fn>(p);
+                }
+            },
+        };
+        return &ops;
+    }
+
+    template <typename Fn, typename F>
+    void Emplace(F&& f) {
+        if constexpr (kFitsInline<Fn>) {
+            new (storage_) Fn(std::forward<F>(f));
+        } else {
+            new (storage_) Fn*(new Fn(std::forward<F>(f)));
+        }
+        ops_ = OpsFor<Fn>();
+    }
+
+    void Reset() {
+        if (ops_) ops_->destroy(storage_);
+        ops_ = nullptr;
+    }
+
+    // mutable: calling a stored lambda may change its captures, as with
+    // std::function
+    alignas(std::max_align_t) mutable unsigned char storage_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+}  // namespace bchtree
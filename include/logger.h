@@ -1,23 +1,107 @@
 #pragma once
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+
+// Messages below this level are compiled out, whatever the runtime level.
+// One of the SPDLOG_LEVEL_* values, set with the BCHTREE_LOG_MIN_LEVEL
+// CMake cache variable.
+#ifndef BCHTREE_LOG_MIN_LEVEL
+#define BCHTREE_LOG_MIN_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+namespace spdlog::details {
+class thread_pool;
+}
 
 namespace bchtree {
+
+// What an async logger does when its queue is full
+enum class LogOverflow {
+    Block,       // the caller waits for the background thread
+    DropOldest,  // the oldest queued message is discarded and counted
+};
+
+struct AsyncLogOptions {
+    size_t queue_size{8192};  // messages
+    LogOverflow overflow{LogOverflow::Block};
+    std::chrono::seconds flush_interval{1};
+};
+
 class Logger {
    public:
+    ~Logger();
+
     void setLevel(const std::string& level);
     void setFile(const std::string& path);
-    void info(const std::string& msg);
-    void warn(const std::string& msg);
-    void error(const std::string& msg);
-    void debug(const std::string& msg);
+    void setConsole(bool enabled);
+    // Format and write messages on a background thread. Must be called
+    // before the first message.
+    void setAsync(const AsyncLogOptions& options);
+
+    // fmt-style logging. The level is checked before anything is
+    // formatted. C++17 only checks the format string at compile time when
+    // it is wrapped in FMT_STRING.
+    template <typename... Args>
+    void info(fmt::format_string<Args...> fmt, Args&&... args) {
+        log<spdlog::level::info>(fmt, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    void warn(fmt::format_string<Args...> fmt, Args&&... args) {
+        log<spdlog::level::warn>(fmt, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    void error(fmt::format_string<Args...> fmt, Args&&... args) {
+        log<spdlog::level::err>(fmt, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    void debug(fmt::format_string<Args...> fmt, Args&&... args) {
+        log<spdlog::level::debug>(fmt, std::forward<Args>(args)...);
+    }
+
+    // Already formatted messages
+    void info(const std::string& msg) { info("{}", msg); }
+    void warn(const std::string& msg) { warn("{}", msg); }
+    void error(const std::string& msg) { error("{}", msg); }
+    void debug(const std::string& msg) { debug("{}", msg); }
+
+    // Lets callers skip building arguments that are expensive on their own
+    bool shouldLog(spdlog::level::level_enum level) {
+        if (level < BCHTREE_LOG_MIN_LEVEL) return false;
+        ensure_init();
+        return logger_->should_log(level);
+    }
+
     void flush();
 
+    // Messages discarded by LogOverflow::DropOldest
+    size_t droppedMessages() const;
+
    private:
+    template <spdlog::level::level_enum Level, typename... Args>
+    void log(fmt::format_string<Args...> fmt, Args&&... args) {
+        if constexpr (Level >= BCHTREE_LOG_MIN_LEVEL) {
+            ensure_init();
+            logger_->log(Level, fmt, std::forward<Args>(args)...);
+        }
+    }
+
+    // Creates the logger on the first message; threads may race to it
     void ensure_init();
-    bool initialized_{false};
+    void init();
+    std::once_flag init_once_;
+    std::atomic<bool> initialized_{false};
     std::shared_ptr<spdlog::logger> logger_;
+    std::shared_ptr<spdlog::details::thread_pool> thread_pool_;
     std::string file_path_;
+    spdlog::level::level_enum level_{spdlog::level::info};
+    bool console_{true};
+    bool async_{false};
+    AsyncLogOptions async_options_;
 };
 }  // namespace bchtree
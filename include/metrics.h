@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace bchtree {
+
+// Log-linear histogram of durations in the style of HdrHistogram. Below
+// kSubBuckets us every microsecond has its bucket; above, each power of two
+// is split into kSubBuckets buckets, so a value is known to within 1/8.
+// Record() is lock-free and never allocates.
+class LatencyHistogram {
+   public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+    // 2^34 us, about 4.8 hours, goes into the last bucket
+    static constexpr size_t kMagnitudes = 32;
+    static constexpr size_t kBuckets = kMagnitudes * kSubBuckets;
+
+    void Record(std::chrono::nanoseconds value);
+
+    uint64_t Count() const;
+    std::chrono::nanoseconds Sum() const;
+    // Values recorded at or below bound, counted by whole buckets
+    uint64_t CountAtOrBelow(std::chrono::nanoseconds bound) const;
+    // Upper end of the bucket holding the q-quantile, q in [0, 1]
+    std::chrono::nanoseconds Quantile(double q) const;
+
+    // Bucket of a value in microseconds and the largest value in a bucket
+    static size_t BucketIndex(uint64_t us);
+    static uint64_t BucketMax(size_t index);
+
+   private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+};
+
+// Per tree node, filled by BTRunner
+struct NodeMetrics {
+    std::atomic<uint64_t> ticks{0};
+    LatencyHistogram tick_time;     // one tick() of the node and its children
+    LatencyHistogram running_time;  // from RUNNING to SUCCESS/FAILURE/halt
+};
+
+// Per PV, filled by PV
+struct PVMetrics {
+    LatencyHistogram get_time;  // request to reply
+    LatencyHistogram put_time;
+    std::atomic<uint64_t> get_errors{0};
+    std::atomic<uint64_t> put_errors{0};
+    std::atomic<int64_t> outstanding{0};  // gets and puts awaiting a reply
+    std::atomic<uint64_t> cancelled{0};    // by their node, before the reply
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> monitor_updates{0};  // delivered
+    std::atomic<uint64_t> monitor_dropped{0};  // filtered or undecodable
+};
+
+// Owns the metrics by name. Lookups take a lock, so callers look their
+// metrics up once and keep the pointer; the updates are lock-free.
+class MetricsRegistry {
+   public:
+    std::shared_ptr<NodeMetrics> ForNode(const std::string& tree,
+                                         const std::string& node);
+    std::shared_ptr<PVMetrics> ForPV(const std::string& pv_name);
+
+    // Prometheus text exposition format
+    std::string Prometheus() const;
+
+   private:
+    mutable std::mutex mtx_;
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<NodeMetrics>>
+        nodes_;
+    std::map<std::string, std::shared_ptr<PVMetrics>> pvs_;
+};
+
+// Publishes a registry in a file, rewritten atomically every interval, or
+// over HTTP on a localhost port. Both stop with the exporter.
+class MetricsExporter {
+   public:
+    explicit MetricsExporter(std::shared_ptr<const MetricsRegistry> registry);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Write once now. False if the file can't be written.
+    bool WriteFile(const std::string& path) const;
+    void StartFileWriter(std::string path, std::chrono::milliseconds interval);
+    // Serve GET requests on 127.0.0.1:port; 0 picks a free port. Returns
+    // the port. Throws std::runtime_error if it can't listen.
+    uint16_t Listen(uint16_t port);
+
+   private:
+    void ServeLoop();
+
+    std::shared_ptr<const MetricsRegistry> registry_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::thread file_thread_;
+
+    int listen_fd_ = -1;
+    std::thread http_thread_;
+};
+
+}  // namespace bchtree
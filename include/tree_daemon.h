@@ -0,0 +1,107 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epics/pv.h"
+#include "epics/pv_manager.h"
+#include "logger.h"
+#include "tree_scheduler.h"
+
+namespace bchtree {
+
+// One triggered run of the trees
+struct RunReport {
+    uint64_t run = 0;     // 1-based
+    std::string trigger;  // "pv", "socket", "signal" or the caller's name
+    bool success = false;
+    // From the first trigger of the run to its end, i.e. with the wait for
+    // a run already in progress
+    std::chrono::nanoseconds latency{0};
+    // From the start of the run to its end
+    std::chrono::nanoseconds duration{0};
+};
+
+// Keeps the trees of a TreeScheduler loaded and their PVs connected, and
+// runs them again on every trigger. Triggers arriving while a run is
+// pending are coalesced into it; triggers during a run queue one more run.
+class TreeDaemon {
+   public:
+    explicit TreeDaemon(std::shared_ptr<Logger> logger = nullptr);
+    ~TreeDaemon();
+
+    TreeDaemon(const TreeDaemon&) = delete;
+    TreeDaemon& operator=(const TreeDaemon&) = delete;
+
+    // Request a run. Returns the number of the run that will serve it.
+    uint64_t Trigger(const std::string& source);
+    // Wait until run `run` has finished. nullopt if stopped before.
+    std::optional<RunReport> WaitFor(uint64_t run);
+    // Latest finished run
+    std::optional<RunReport> LastRun() const;
+
+    // Trigger whenever the value of the PV changes. The first update only
+    // sets the reference value.
+    void TriggerOnPV(const std::shared_ptr<epics::PVManager>& pv_manager,
+                     const std::string& pv_name);
+    // Accept "run", "status" and "stop" lines on a Unix socket, see README.
+    // Each client is served on a thread of its own, so that one waiting
+    // for a run does not hold up the others.
+    void ListenOnSocket(const std::string& path);
+    // Trigger on trigger_signo, stop on SIGINT and SIGTERM. A second stop
+    // signal exits the process. Call before any other thread is started so
+    // that all of them inherit the signal mask.
+    void HandleSignals(int trigger_signo);
+
+    // Run the trees on each trigger until Stop()
+    void Serve(TreeScheduler& scheduler);
+    // Make Serve() return after the run in progress
+    void Stop();
+
+   private:
+    // Shared with the PV callbacks and the signal thread, which may
+    // outlive the daemon
+    struct State {
+        mutable std::mutex mtx;
+        std::condition_variable cv;
+        bool stopped = false;
+        bool pending = false;
+        std::string source;  // of the pending run
+        std::chrono::steady_clock::time_point triggered_at{};
+        uint64_t started = 0;
+        uint64_t completed = 0;
+        std::optional<RunReport> last;
+
+        uint64_t Trigger(const std::string& source);
+        void Stop();
+    };
+
+    // Clients served at once; more are turned away
+    static constexpr int kMaxClients = 16;
+
+    void AcceptLoop();
+    void ServeClient(int conn);
+    std::string HandleCommand(const std::string& command);
+
+    std::shared_ptr<Logger> logger_;
+    std::shared_ptr<State> state_;
+
+    std::vector<std::shared_ptr<epics::PV>> trigger_pvs_;
+
+    int socket_fd_ = -1;
+    std::string socket_path_;
+    std::thread socket_thread_;
+
+    // Client threads are detached; the destructor waits for them
+    std::mutex clients_mtx_;
+    std::condition_variable clients_cv_;
+    int clients_ = 0;
+};
+
+}  // namespace bchtree
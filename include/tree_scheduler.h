@@ -0,0 +1,77 @@
+#pragma once
+#include <behaviortree_cpp/basic_types.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bt_runner.h"
+#include "epics/pv_manager.h"
+
+namespace bchtree {
+
+// Counting semaphore bounding the trees that tick at the same time
+class TickSlots {
+   public:
+    explicit TickSlots(size_t slots);
+
+    void Acquire();
+    void Release();
+
+    size_t Slots() const { return slots_; }
+
+   private:
+    const size_t slots_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    size_t free_;
+};
+
+// Runs many trees in one process on a shared PVManager, so that channels
+// and monitors are created once however many trees use them.
+//
+// Every tree is driven by its own thread, which sleeps on the tree's
+// wake-up signal between ticks; BehaviorTree.CPP only lets the tree's own
+// thread wait on it. The ticks themselves are bounded by `workers` slots,
+// so at most that many trees run node code at once.
+class TreeScheduler {
+   public:
+    struct TreeReport {
+        std::string name;
+        BT::NodeStatus status{BT::NodeStatus::IDLE};
+        std::string error;  // what the tree threw, if anything
+        TreeStats stats;
+    };
+
+    TreeScheduler(std::shared_ptr<epics::PVManager> pv_manager,
+                  size_t workers);
+    ~TreeScheduler();
+
+    TreeScheduler(const TreeScheduler&) = delete;
+    TreeScheduler& operator=(const TreeScheduler&) = delete;
+
+    // Add a runner whose tree is registered. Call before Run().
+    void Add(std::string name, std::unique_ptr<BTRunner> runner);
+
+    // Run every tree until it finishes. True if all of them succeeded.
+    bool Run();
+
+    // Status and tick statistics per tree, in the order added
+    std::vector<TreeReport> Reports() const;
+
+   private:
+    struct Entry {
+        std::string name;
+        std::unique_ptr<BTRunner> runner;
+        BT::NodeStatus status{BT::NodeStatus::IDLE};
+        std::string error;
+    };
+
+    std::shared_ptr<epics::PVManager> pv_manager_;
+    std::shared_ptr<TickSlots> slots_;
+    std::vector<Entry> trees_;
+};
+
+}  // namespace bchtree
@@ -0,0 +1,145 @@
+#include "actions/cacalc_node.h"
+
+#include <stdexcept>
+
+namespace bchtree {
+
+CACalcNode::CACalcNode(const std::string& name, const BT::NodeConfig& cfg,
+                       std::shared_ptr<epics::PVManager> pv_manager,
+                       std::shared_ptr<DeadlineRegistry> deadlines)
+    : BT::StatefulActionNode(name, cfg),
+      pv_manager_(std::move(pv_manager)),
+      deadlines_(std::move(deadlines)) {
+    pv_manager_->Attach();
+
+    // A blackboard [expr] is only known when the node runs
+    const auto it = cfg.input_ports.find("expr");
+    if (it != cfg.input_ports.end() && !it->second.empty() &&
+        !isBlackboardPointer(it->second)) {
+        compile(it->second);
+    }
+}
+
+BT::PortsList CACalcNode::providedPorts() {
+    using namespace BT;
+    return {
+        InputPort<std::string>("expr"),
+        InputPort<bool>("until", "Wait until the result is true"),
+        InputPort<int>("timeout"),
+        OutputPort<double>("result"),
+    };
+}
+
+BT::NodeStatus CACalcNode::onStart() {
+    std::string text;
+    if (!getInput("expr", text)) {
+        throw BT::RuntimeError("CACalc: missing required input [expr]");
+    }
+    if (!expr_ || expr_->Text() != text) compile(text);
+
+    until_ = false;
+    getInput("until", until_);
+    timeout_ms_ = kDefaultTimeoutMs;
+    getInput("timeout", timeout_ms_);
+
+    if (pvs_.empty()) bindPVs();
+    for (const auto& pv : pvs_) pv->Connect();
+
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(timeout_ms_);
+    armDeadline();
+    return onRunning();
+}
+
+BT::NodeStatus CACalcNode::onRunning() {
+    // Armed before reading so that an update racing with the read still
+    // wakes the tree
+    waiting_ = true;
+
+    const auto value = evaluate();
+    if (value && (!until_ || epics::PVExpression::IsTrue(*value))) {
+        waiting_ = false;
+        disarmDeadline();
+        setOutput("result", *value);
+        return BT::NodeStatus::SUCCESS;
+    }
+
+    if (std::chrono::steady_clock::now() >= deadline_) {
+        waiting_ = false;
+        disarmDeadline();
+        return BT::NodeStatus::FAILURE;
+    }
+    return BT::NodeStatus::RUNNING;
+}
+
+void CACalcNode::onHalted() {
+    waiting_ = false;
+    disarmDeadline();
+}
+
+void CACalcNode::compile(const std::string& text) {
+    try {
+        expr_ = epics::PVExpression::Compile(text);
+    } catch (const std::invalid_argument& e) {
+        throw BT::RuntimeError("CACalc: ", e.what());
+    }
+    // The PVs of another expression are bound on the next start
+    unbindPVs();
+}
+
+void CACalcNode::bindPVs() {
+    const auto& names = expr_->Names();
+    pvs_.reserve(names.size());
+    monitor_ids_.reserve(names.size());
+    for (const auto& name : names) {
+        auto pv = pv_manager_->Get(name);
+        // Only a waiting node needs another tick
+        monitor_ids_.push_back(pv->AddMonitorCB(callbacks_.WrapMonitor(
+            [this](const epics::PVData&) { return waiting_.load(); },
+            [this](const epics::PVData&) {
+                if (waiting_.exchange(false)) emitWakeUpSignal();
+            })));
+        pvs_.push_back(std::move(pv));
+    }
+    values_.assign(names.size(), 0);
+}
+
+void CACalcNode::unbindPVs() {
+    // The PVs may outlive the binding, e.g. when other nodes use them
+    for (size_t i = 0; i < pvs_.size(); ++i) {
+        pvs_[i]->RemoveMonitorCB(monitor_ids_[i]);
+    }
+    pvs_.clear();
+    monitor_ids_.clear();
+}
+
+std::optional<double> CACalcNode::evaluate() {
+    for (size_t i = 0; i < pvs_.size(); ++i) {
+        // The cache keeps the last value of a disconnected PV
+        if (!pvs_[i]->IsConnected()) return std::nullopt;
+        const auto value = pvs_[i]->NumericValue();
+        if (!value) {
+            if (pvs_[i]->HasValue()) {
+                throw BT::RuntimeError("CACalc: ", expr_->Names()[i],
+                                       " is not a numeric scalar");
+            }
+            return std::nullopt;
+        }
+        values_[i] = *value;
+    }
+    return expr_->Evaluate(values_);
+}
+
+void CACalcNode::armDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = deadlines_->Arm(deadline_);
+}
+
+void CACalcNode::disarmDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = DeadlineRegistry::kInvalidId;
+}
+
+}  // namespace bchtree
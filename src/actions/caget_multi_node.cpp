@@ -0,0 +1,233 @@
+#include "actions/caget_multi_node.h"
+
+#include "epics/pv_names.h"
+
+namespace bchtree {
+
+CAGetMultiNode::CAGetMultiNode(
+    const std::string& name, const BT::NodeConfig& cfg,
+    std::shared_ptr<epics::PVManager> pv_manager,
+    std::shared_ptr<DeadlineRegistry> deadlines)
+    : BT::StatefulActionNode(name, cfg),
+      pv_manager_(std::move(pv_manager)),
+      deadlines_(std::move(deadlines)) {
+    pv_manager_->Attach();
+}
+
+BT::PortsList CAGetMultiNode::providedPorts() {
+    using namespace BT;
+    return {
+        InputPort<std::string>("pvs", "PV names or brace patterns"),
+        InputPort<int>("timeout"),
+        OutputPort<epics::PVDataMap>("result"),
+        OutputPort<std::vector<std::string>>("failed"),
+    };
+}
+
+BT::NodeStatus CAGetMultiNode::onStart() {
+    std::string spec;
+    if (!getInput("pvs", spec)) {
+        throw BT::RuntimeError("CAGetMulti: missing required input [pvs]");
+    }
+    timeout_ms_ = kDefaultTimeoutMs;
+    getInput("timeout", timeout_ms_);
+
+    if (slots_.empty() || spec != spec_) {
+        resolvePVs(spec);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++generation_;  // ignore replies to a previous execution
+        for (auto& slot : slots_) {
+            slot.state = SlotState::kPending;
+        }
+        remaining_ = slots_.size();
+    }
+
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(timeout_ms_);
+    armDeadline();
+
+    for (auto& slot : slots_) {
+        slot.pv->Connect();
+    }
+
+    return onRunning();
+}
+
+BT::NodeStatus CAGetMultiNode::onRunning() {
+    issuePendingGets();
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (remaining_ > 0) {
+            if (!deadlineExpired()) {
+                return BT::NodeStatus::RUNNING;
+            }
+            // timeout: whatever has not answered has failed
+            for (auto& slot : slots_) {
+                if (slot.state == SlotState::kPending ||
+                    slot.state == SlotState::kRequested) {
+                    slot.state = SlotState::kFailed;
+                }
+            }
+            remaining_ = 0;
+            ++generation_;
+        }
+    }
+
+    return finish();
+}
+
+void CAGetMultiNode::onHalted() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++generation_;
+    }
+    cancelRequests();
+    disarmDeadline();
+}
+
+void CAGetMultiNode::watchConnection(const std::shared_ptr<epics::PV>& pv) {
+    if (!watched_.insert(pv).second) return;
+    pv->AddConnCB(callbacks_.Wrap([this](bool) { emitWakeUpSignal(); }));
+}
+
+void CAGetMultiNode::resolvePVs(const std::string& spec) {
+    std::vector<std::string> names;
+    try {
+        names = epics::ExpandPVNames(spec);
+    } catch (const std::invalid_argument& e) {
+        throw BT::RuntimeError("CAGetMulti: ", e.what());
+    }
+    if (names.empty()) {
+        throw BT::RuntimeError("CAGetMulti: [pvs] is empty");
+    }
+
+    auto pvs = pv_manager_->GetMany(names);
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    slots_.clear();
+    slots_.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        Slot slot;
+        slot.pv = std::move(pvs[i]);
+        watchConnection(slot.pv);
+        slot.name = std::move(names[i]);
+        slots_.push_back(std::move(slot));
+    }
+    spec_ = spec;
+}
+
+void CAGetMultiNode::issuePendingGets() {
+    // Pick the connected PVs under the lock but call CA without it, so that
+    // CA callback threads never wait for the tick thread.
+    std::vector<size_t> ready;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        generation = generation_;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].state == SlotState::kPending &&
+                slots_[i].pv->IsConnected()) {
+                slots_[i].state = SlotState::kRequested;
+                ready.push_back(i);
+            }
+        }
+    }
+    if (ready.empty()) return;
+
+    const auto timeout = std::chrono::milliseconds(timeout_ms_);
+    for (size_t i : ready) {
+        bool status = slots_[i].pv->GetCB(
+            callbacks_.Wrap([this, generation, i](epics::PVData value) {
+                handleGetResult(generation, i, std::move(value));
+            }),
+            timeout,
+            callbacks_.Wrap(
+                [this, generation, i](int) { handleGetError(generation, i); }),
+            /*flush=*/false, &slots_[i].request);
+        if (!status) {
+            handleGetError(generation, i);
+        }
+    }
+
+    // One round trip for the whole batch
+    pv_manager_->Flush();
+}
+
+void CAGetMultiNode::handleGetResult(uint64_t generation, size_t index,
+                                     epics::PVData value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (generation != generation_) return;
+    if (slots_[index].state != SlotState::kRequested) return;
+
+    slots_[index].value = std::move(value);
+    slots_[index].state = SlotState::kDone;
+    if (--remaining_ == 0) emitWakeUpSignal();
+}
+
+void CAGetMultiNode::handleGetError(uint64_t generation, size_t index) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (generation != generation_) return;
+    if (slots_[index].state != SlotState::kRequested) return;
+
+    slots_[index].state = SlotState::kFailed;
+    if (--remaining_ == 0) emitWakeUpSignal();
+}
+
+BT::NodeStatus CAGetMultiNode::finish() {
+    // After a timeout, the gets that have not answered
+    cancelRequests();
+    disarmDeadline();
+
+    epics::PVDataMap result;
+    std::vector<std::string> failed;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        result.reserve(slots_.size());
+        for (const auto& slot : slots_) {
+            if (slot.state == SlotState::kDone) {
+                result.emplace(slot.name, slot.value);
+            } else {
+                failed.push_back(slot.name);
+            }
+        }
+    }
+
+    setOutput("result", result);
+    setOutput("failed", failed);
+
+    return failed.empty() ? BT::NodeStatus::SUCCESS : BT::NodeStatus::FAILURE;
+}
+
+void CAGetMultiNode::cancelRequests() {
+    for (auto& slot : slots_) {
+        if (slot.request) slot.pv->CancelRequest(slot.request);
+        slot.request = {};
+    }
+}
+
+// The registry flags the timeout at the deadline, when the runner expires
+// it before the tick
+void CAGetMultiNode::armDeadline() {
+    timed_out_ = false;
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = deadlines_->Arm(
+        deadline_, callbacks_.Wrap([this] { timed_out_ = true; }));
+}
+
+void CAGetMultiNode::disarmDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = DeadlineRegistry::kInvalidId;
+}
+
+bool CAGetMultiNode::deadlineExpired() const {
+    if (deadlines_) return timed_out_;
+    return std::chrono::steady_clock::now() >= deadline_;
+}
+
+}  // namespace bchtree
@@ -0,0 +1,242 @@
+#include "actions/caput_multi_node.h"
+
+#include <unordered_map>
+
+namespace bchtree {
+
+CAPutMultiNode::CAPutMultiNode(
+    const std::string& name, const BT::NodeConfig& cfg,
+    std::shared_ptr<epics::PVManager> pv_manager,
+    std::shared_ptr<DeadlineRegistry> deadlines)
+    : BT::StatefulActionNode(name, cfg),
+      pv_manager_(std::move(pv_manager)),
+      deadlines_(std::move(deadlines)) {
+    pv_manager_->Attach();
+}
+
+BT::PortsList CAPutMultiNode::providedPorts() {
+    using namespace BT;
+    return {
+        InputPort<epics::PVPutTable>("values", "(pv, value) table"),
+        InputPort<std::string>("file", "file holding a (pv, value) table"),
+        InputPort<int>("timeout"),
+        OutputPort<std::vector<std::string>>("failed"),
+    };
+}
+
+BT::NodeStatus CAPutMultiNode::onStart() {
+    timeout_ms_ = kDefaultTimeoutMs;
+    getInput("timeout", timeout_ms_);
+
+    resolvePVs(readTable());
+
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(timeout_ms_);
+    armDeadline();
+
+    for (auto& slot : slots_) {
+        slot.pv->Connect();
+    }
+
+    return onRunning();
+}
+
+BT::NodeStatus CAPutMultiNode::onRunning() {
+    issuePendingPuts();
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (failed_) {
+        lock.unlock();
+        return finish(BT::NodeStatus::FAILURE);
+    }
+    if (remaining_ == 0) {
+        lock.unlock();
+        return finish(BT::NodeStatus::SUCCESS);
+    }
+    if (deadlineExpired()) {
+        lock.unlock();
+        return finish(BT::NodeStatus::FAILURE);
+    }
+    return BT::NodeStatus::RUNNING;
+}
+
+void CAPutMultiNode::onHalted() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++generation_;
+    }
+    cancelRequests();
+    disarmDeadline();
+}
+
+epics::PVPutTable CAPutMultiNode::readTable() {
+    epics::PVPutTable table;
+
+    std::string file;
+    if (getInput("file", file) && !file.empty()) {
+        try {
+            table = epics::LoadPVPutTable(file);
+        } catch (const std::exception& e) {
+            throw BT::RuntimeError("CAPutMulti: ", e.what());
+        }
+    } else {
+        auto values = getInput<epics::PVPutTable>("values");
+        if (!values) {
+            throw BT::RuntimeError(
+                "CAPutMulti: missing or invalid input [values]: ",
+                values.error());
+        }
+        table = std::move(values.value());
+    }
+
+    if (table.empty()) {
+        throw BT::RuntimeError("CAPutMulti: PV table is empty");
+    }
+    return table;
+}
+
+void CAPutMultiNode::watchConnection(const std::shared_ptr<epics::PV>& pv) {
+    if (!watched_.insert(pv).second) return;
+    pv->AddConnCB(callbacks_.Wrap([this](bool) { emitWakeUpSignal(); }));
+}
+
+void CAPutMultiNode::resolvePVs(epics::PVPutTable table) {
+    // Keep the PV handles of the previous execution, the table usually only
+    // changes its values
+    std::unordered_map<std::string, std::shared_ptr<epics::PV>> known;
+    for (auto& slot : slots_) {
+        known.emplace(slot.name, std::move(slot.pv));
+    }
+
+    // Resolve the new names in one registry pass
+    for (const auto& entry : table) {
+        known.try_emplace(entry.pv);
+    }
+    std::vector<std::string> missing;
+    for (const auto& [pv_name, pv] : known) {
+        if (!pv) missing.push_back(pv_name);
+    }
+    auto pvs = pv_manager_->GetMany(missing);
+    for (size_t i = 0; i < missing.size(); ++i) {
+        watchConnection(pvs[i]);
+        known[missing[i]] = std::move(pvs[i]);
+    }
+
+    std::vector<Slot> slots;
+    slots.reserve(table.size());
+    for (auto& entry : table) {
+        Slot slot;
+        slot.pv = known[entry.pv];
+        slot.name = std::move(entry.pv);
+        slot.value = std::move(entry.value);
+        slots.push_back(std::move(slot));
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    ++generation_;  // ignore replies to a previous execution
+    slots_ = std::move(slots);
+    remaining_ = slots_.size();
+    failed_ = false;
+}
+
+void CAPutMultiNode::issuePendingPuts() {
+    // Pick the connected PVs under the lock but call CA without it, so that
+    // CA callback threads never wait for the tick thread.
+    std::vector<size_t> ready;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (failed_) return;
+        generation = generation_;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].state == SlotState::kPending &&
+                slots_[i].pv->IsConnected()) {
+                slots_[i].state = SlotState::kRequested;
+                ready.push_back(i);
+            }
+        }
+    }
+    if (ready.empty()) return;
+
+    for (size_t i : ready) {
+        bool status = slots_[i].pv->PutCB(
+            slots_[i].value,
+            callbacks_.Wrap([this, generation, i](bool success) {
+                handlePutResult(generation, i, success);
+            }),
+            /*flush=*/false, &slots_[i].request);
+        if (!status) {
+            handlePutResult(generation, i, false);
+        }
+    }
+
+    // One round trip for the whole batch
+    pv_manager_->Flush();
+}
+
+void CAPutMultiNode::handlePutResult(uint64_t generation, size_t index,
+                                     bool success) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (generation != generation_) return;
+    if (slots_[index].state != SlotState::kRequested) return;
+
+    if (!success) {
+        slots_[index].state = SlotState::kFailed;
+        failed_ = true;
+        emitWakeUpSignal();
+        return;
+    }
+
+    slots_[index].state = SlotState::kDone;
+    if (--remaining_ == 0) emitWakeUpSignal();
+}
+
+BT::NodeStatus CAPutMultiNode::finish(BT::NodeStatus status) {
+    // After a failure or a timeout, the puts that have not answered
+    cancelRequests();
+    disarmDeadline();
+
+    std::vector<std::string> failed;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++generation_;  // late replies no longer matter
+        for (const auto& slot : slots_) {
+            if (slot.state != SlotState::kDone) {
+                failed.push_back(slot.name);
+            }
+        }
+    }
+    setOutput("failed", failed);
+
+    return status;
+}
+
+void CAPutMultiNode::cancelRequests() {
+    for (auto& slot : slots_) {
+        if (slot.request) slot.pv->CancelRequest(slot.request);
+        slot.request = {};
+    }
+}
+
+// The registry flags the timeout at the deadline, when the runner expires
+// it before the tick
+void CAPutMultiNode::armDeadline() {
+    timed_out_ = false;
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = deadlines_->Arm(
+        deadline_, callbacks_.Wrap([this] { timed_out_ = true; }));
+}
+
+void CAPutMultiNode::disarmDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = DeadlineRegistry::kInvalidId;
+}
+
+bool CAPutMultiNode::deadlineExpired() const {
+    if (deadlines_) return timed_out_;
+    return std::chrono::steady_clock::now() >= deadline_;
+}
+
+}  // namespace bchtree
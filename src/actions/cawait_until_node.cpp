@@ -0,0 +1,166 @@
+#include "actions/cawait_until_node.h"
+
+#include <stdexcept>
+
+#include "epics/pv_table.h"
+
+namespace bchtree {
+
+CAWaitUntilNode::CAWaitUntilNode(
+    const std::string& name, const BT::NodeConfig& cfg,
+    std::shared_ptr<epics::PVManager> pv_manager,
+    std::shared_ptr<DeadlineRegistry> deadlines)
+    : BT::StatefulActionNode(name, cfg),
+      pv_manager_(std::move(pv_manager)),
+      deadlines_(std::move(deadlines)) {
+    pv_manager_->Attach();
+}
+
+BT::PortsList CAWaitUntilNode::providedPorts() {
+    using namespace BT;
+    return {
+        InputPort<std::string>("pv"),
+        InputPort<std::string>("op", "eq|ne|lt|le|gt|ge|within|mask|state"),
+        InputPort<std::string>("value"),
+        InputPort<double>("tolerance"),
+        InputPort<unsigned>("mask"),
+        InputPort<int>("timeout"),
+        OutputPort<epics::PVData>("result"),
+    };
+}
+
+BT::NodeStatus CAWaitUntilNode::onStart() {
+    std::string pv_name;
+    if (!getInput("pv", pv_name)) {
+        throw BT::RuntimeError("CAWaitUntil: missing required input [pv]");
+    }
+    auto condition = readCondition();
+    int timeout_ms = kDefaultTimeoutMs;
+    getInput("timeout", timeout_ms);
+
+    if (!pv_ || resolved_name_ != pv_name) {
+        resolvePV(pv_name);
+    }
+
+    // Armed before looking at the cache so that no update is missed
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        condition_ = std::move(condition);
+        matched_.reset();
+    }
+    waiting_ = true;
+    // The cache keeps the last value of a disconnected PV: only a live
+    // value may satisfy the condition
+    if (const auto snapshot = pv_->IsConnected() ? pv_->Snapshot() : nullptr) {
+        handleMonitorUpdate(*pv_, snapshot->data);
+    }
+
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(timeout_ms);
+    armDeadline();
+
+    pv_->Connect();
+    return onRunning();
+}
+
+BT::NodeStatus CAWaitUntilNode::onRunning() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (matched_) {
+            disarmDeadline();
+            setOutput("result", *matched_);
+            return BT::NodeStatus::SUCCESS;
+        }
+    }
+
+    if (std::chrono::steady_clock::now() >= deadline_) {
+        disarm();
+        return BT::NodeStatus::FAILURE;
+    }
+    return BT::NodeStatus::RUNNING;
+}
+
+void CAWaitUntilNode::onHalted() { disarm(); }
+
+epics::PVCondition CAWaitUntilNode::readCondition() {
+    std::string op_name = "eq";
+    getInput("op", op_name);
+    std::string value;
+    if (!getInput("value", value)) {
+        throw BT::RuntimeError("CAWaitUntil: missing required input [value]");
+    }
+    double tolerance = 0;
+    getInput("tolerance", tolerance);
+    unsigned mask = 0;
+    getInput("mask", mask);
+
+    try {
+        const auto op = epics::PVCondition::ParseOp(op_name);
+        if (op == epics::PVCondition::Op::kMask && mask == 0) {
+            throw std::invalid_argument("mask needs a non-zero [mask]");
+        }
+        // A state is compared as text even if it looks like a number
+        auto operand = op == epics::PVCondition::Op::kState
+                           ? epics::PVScalarValue{value}
+                           : epics::ParsePVScalar(value);
+        return epics::PVCondition(op, std::move(operand), tolerance, mask);
+    } catch (const std::invalid_argument& e) {
+        throw BT::RuntimeError("CAWaitUntil: ", e.what());
+    }
+}
+
+void CAWaitUntilNode::resolvePV(const std::string& pv_name) {
+    // The callback of the previous PV may still be running or queued: the
+    // generation tells its updates apart
+    if (pv_) pv_->RemoveMonitorCB(monitor_id_);
+    const uint64_t generation = ++generation_;
+    pv_ = pv_manager_->Get(pv_name);
+    resolved_name_ = pv_name;
+
+    epics::PV* pv = pv_.get();
+    monitor_id_ = pv_->AddMonitorCB(callbacks_.WrapMonitor(
+        [this, generation](const epics::PVData&) {
+            return generation == generation_.load() && waiting_.load();
+        },
+        [this, generation, pv](const epics::PVData& data) {
+            if (generation == generation_.load()) {
+                handleMonitorUpdate(*pv, data);
+            }
+        }));
+}
+
+void CAWaitUntilNode::handleMonitorUpdate(const epics::PV& pv,
+                                          const epics::PVData& data) {
+    const auto states = pv.EnumStrings();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!condition_ || !condition_->Matches(data, states.get())) return;
+        condition_.reset();
+        matched_ = data;
+    }
+    waiting_ = false;
+    emitWakeUpSignal();
+}
+
+void CAWaitUntilNode::disarm() {
+    waiting_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        condition_.reset();
+    }
+    disarmDeadline();
+}
+
+void CAWaitUntilNode::armDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = deadlines_->Arm(deadline_);
+}
+
+void CAWaitUntilNode::disarmDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = DeadlineRegistry::kInvalidId;
+}
+
+}  // namespace bchtree
@@ -0,0 +1,202 @@
+#include "actions/cawindow_stat_node.h"
+
+#include <algorithm>
+
+namespace bchtree {
+
+CAWindowStatNode::CAWindowStatNode(
+    const std::string& name, const BT::NodeConfig& cfg,
+    std::shared_ptr<epics::PVManager> pv_manager,
+    std::shared_ptr<DeadlineRegistry> deadlines)
+    : BT::StatefulActionNode(name, cfg),
+      pv_manager_(std::move(pv_manager)),
+      deadlines_(std::move(deadlines)) {
+    pv_manager_->Attach();
+}
+
+BT::PortsList CAWindowStatNode::providedPorts() {
+    using namespace BT;
+    return {
+        InputPort<std::string>("pv"),
+        InputPort<std::string>("stat", "mean|min|max|stddev|rate|count"),
+        InputPort<int>("window_ms"),
+        InputPort<int>("window_count"),
+        InputPort<int>("history", "Samples kept by the PV"),
+        InputPort<int>("timeout"),
+        OutputPort<double>("result"),
+    };
+}
+
+BT::NodeStatus CAWindowStatNode::onStart() {
+    readInputs();
+
+    if (!pv_ || resolved_name_ != pv_name_) {
+        pv_ = pv_manager_->Get(pv_name_);
+        resolved_name_ = pv_name_;
+        // Only a waiting node needs another tick
+        pv_->AddMonitorCB(callbacks_.WrapMonitor(
+            [this](const epics::PVData&) { return waiting_.load(); },
+            [this](const epics::PVData&) {
+                if (waiting_.exchange(false)) emitWakeUpSignal();
+            }));
+        history_.reset();
+    }
+
+    pv_->EnableHistory(
+        static_cast<size_t>(std::max(history_size_, window_count_)));
+    if (auto history = pv_->History(); history != history_) {
+        history_ = std::move(history);
+        window_.reset();
+    }
+    if (!window_ || window_ms_ != built_window_ms_ ||
+        window_count_ != built_window_count_) {
+        setUpWindow();
+    }
+
+    pv_->Connect();
+
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(timeout_ms_);
+    return onRunning();
+}
+
+BT::NodeStatus CAWindowStatNode::onRunning() {
+    // Armed before reading so that an update racing with the read still
+    // wakes the tree
+    waiting_ = true;
+
+    const auto now = std::chrono::steady_clock::now();
+    syncWindow(now);
+
+    if (const auto value = statistic(now)) {
+        waiting_ = false;
+        disarmDeadline();
+        setOutput("result", *value);
+        return BT::NodeStatus::SUCCESS;
+    }
+
+    if (now >= deadline_) {
+        waiting_ = false;
+        disarmDeadline();
+        return BT::NodeStatus::FAILURE;
+    }
+
+    // A time window completes without any update
+    auto wake_at = deadline_;
+    const auto complete_at =
+        history_->Since() + std::chrono::milliseconds(window_ms_);
+    if (window_ms_ > 0 && complete_at > now) {
+        wake_at = std::min(wake_at, complete_at);
+    }
+    armDeadline(wake_at);
+    return BT::NodeStatus::RUNNING;
+}
+
+void CAWindowStatNode::onHalted() {
+    waiting_ = false;
+    disarmDeadline();
+}
+
+CAWindowStatNode::Stat CAWindowStatNode::parseStat(const std::string& name) {
+    if (name == "mean") return Stat::kMean;
+    if (name == "min") return Stat::kMin;
+    if (name == "max") return Stat::kMax;
+    if (name == "stddev") return Stat::kStddev;
+    if (name == "rate") return Stat::kRate;
+    if (name == "count") return Stat::kCount;
+    throw BT::RuntimeError("CAWindowStat: unknown [stat] ", name);
+}
+
+void CAWindowStatNode::readInputs() {
+    if (!getInput("pv", pv_name_)) {
+        throw BT::RuntimeError("CAWindowStat: missing required input [pv]");
+    }
+
+    std::string stat = "mean";
+    getInput("stat", stat);
+    stat_ = parseStat(stat);
+
+    window_ms_ = 0;
+    window_count_ = 0;
+    getInput("window_ms", window_ms_);
+    getInput("window_count", window_count_);
+    if ((window_ms_ > 0) == (window_count_ > 0) || window_ms_ < 0 ||
+        window_count_ < 0) {
+        throw BT::RuntimeError(
+            "CAWindowStat: set one of [window_ms] and [window_count]");
+    }
+
+    history_size_ = kDefaultHistory;
+    getInput("history", history_size_);
+    if (history_size_ <= 0) {
+        throw BT::RuntimeError("CAWindowStat: [history] must be positive");
+    }
+
+    timeout_ms_ = kDefaultTimeoutMs;
+    getInput("timeout", timeout_ms_);
+}
+
+void CAWindowStatNode::setUpWindow() {
+    window_ = window_ms_ > 0
+                  ? epics::WindowStats::OverTime(
+                        std::chrono::milliseconds(window_ms_))
+                  : epics::WindowStats::OverCount(
+                        static_cast<size_t>(window_count_));
+    built_window_ms_ = window_ms_;
+    built_window_count_ = window_count_;
+    // Fill the new window from what the ring still holds
+    next_seq_ = 0;
+}
+
+void CAWindowStatNode::syncWindow(std::chrono::steady_clock::time_point now) {
+    buffer_.clear();
+    next_seq_ = history_->ReadSince(next_seq_, buffer_);
+    for (const auto& sample : buffer_) {
+        window_->Add(sample);
+    }
+    window_->Expire(now);
+}
+
+std::optional<double> CAWindowStatNode::statistic(
+    std::chrono::steady_clock::time_point now) const {
+    const bool complete =
+        window_ms_ > 0
+            ? now - history_->Since() >= std::chrono::milliseconds(window_ms_)
+            : window_->Count() >= static_cast<size_t>(window_count_);
+    if (!complete) return std::nullopt;
+
+    switch (stat_) {
+        case Stat::kCount:
+            return static_cast<double>(window_->Count());
+        case Stat::kRate:
+            return window_->Rate();
+        default:
+            break;
+    }
+    if (window_->Count() == 0) return std::nullopt;
+
+    switch (stat_) {
+        case Stat::kMin:
+            return window_->Min();
+        case Stat::kMax:
+            return window_->Max();
+        case Stat::kStddev:
+            return window_->Stddev();
+        default:
+            return window_->Mean();
+    }
+}
+
+void CAWindowStatNode::armDeadline(std::chrono::steady_clock::time_point at) {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = deadlines_->Arm(at);
+}
+
+void CAWindowStatNode::disarmDeadline() {
+    if (!deadlines_) return;
+    deadlines_->Disarm(deadline_id_);
+    deadline_id_ = DeadlineRegistry::kInvalidId;
+}
+
+}  // namespace bchtree
@@ -3,9 +3,28 @@
 #include <behaviortree_cpp/loggers/bt_cout_logger.h>
 #include <behaviortree_cpp/xml_parsing.h>
 
+#include <time.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <set>
+
+#include "actions/cacalc_node.h"
+#include "actions/caget_multi_node.h"
 #include "actions/caget_node.h"
+#include "actions/caput_multi_node.h"
 #include "actions/caput_node.h"
+#include "actions/cawait_until_node.h"
+#include "actions/cawindow_stat_node.h"
 #include "actions/print_node.h"
+#include "callback_guard.h"
+#include "epics/monitor_filter.h"
+#include "epics/pv_expression.h"
+#include "epics/pv_names.h"
+#include "epics/pv_table.h"
+#include "tree_scheduler.h"
 
 namespace bchtree {
 
@@ -25,54 +44,504 @@ bool BTRunner::Run() {
         return false;
     }
 
+    const std::string label = name_.empty() ? "" : " " + name_;
     if (logger_) {
-        logger_->info("Start Tree:");
+        logger_->info("Start Tree:{}", label);
+    }
+
+    // Between runs: Run() may be called again, e.g. by TreeDaemon
+    if (reload_pending_.exchange(false)) {
+        ReloadTree();
     }
+    tree_.haltTree();
 
     if (use_runner_logger_) {
+        runner_logger_.reset();
         runner_logger_ = std::make_unique<RunnerLogger>(tree_, logger_);
     }
+    const uint64_t dropped = callback_queue_->Dropped();
+    callback_queue_->SetActive(true);
+    BT::NodeStatus status;
+    try {
+        status = TickUntilDone();
+    } catch (...) {
+        callback_queue_->SetActive(false);
+        throw;
+    }
+    // Monitor updates arriving from now on are dropped and the other
+    // callbacks run in place; run the queued ones
+    callback_queue_->SetActive(false);
+    callback_queue_->Drain();
 
-    const BT::NodeStatus status = tree_.tickWhileRunning();
+    // The queue stayed full for longer than the PV threads would wait
+    if (logger_ && callback_queue_->Dropped() != dropped) {
+        logger_->warn("Tree:{} dropped {} monitor updates on a full queue",
+                      label, callback_queue_->Dropped() - dropped);
+    }
 
     if (logger_) {
-        logger_->info(std::string("End Tree: status=") + toStr(status));
+        logger_->info("End Tree:{} status={}", label, toStr(status));
+    }
+
+    if (status == BT::NodeStatus::FAILURE && recorder_) {
+        const bool dumped = recorder_->Dump(flight_dump_path_);
+        if (logger_) {
+            if (dumped) {
+                logger_->info("Flight recorder dumped to {}",
+                              flight_dump_path_);
+            } else {
+                logger_->error("Failed to dump flight recorder to {}",
+                               flight_dump_path_);
+            }
+        }
     }
 
     return status == BT::NodeStatus::SUCCESS;
 }
 
+BT::NodeStatus BTRunner::TickUntilDone() {
+    // Tick only when a node asked for it (CA callbacks emit the tree's
+    // wake-up signal) or when the earliest node deadline has passed.
+    BT::NodeStatus status = TimedTick();
+    while (status == BT::NodeStatus::RUNNING) {
+        const auto timeout = NextSleep();
+        tree_.sleep(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                timeout));
+        status = TimedTick();
+    }
+    return status;
+}
+
+namespace {
+std::chrono::nanoseconds ThreadCpuTime() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) +
+           std::chrono::nanoseconds(ts.tv_nsec);
+}
+}  // namespace
+
+BT::NodeStatus BTRunner::TimedTick() {
+    if (tick_slots_) tick_slots_->Acquire();
+    const auto cpu_start = ThreadCpuTime();
+    const auto start = std::chrono::steady_clock::now();
+
+    BT::NodeStatus status;
+    try {
+        // The PV events that came in since the last tick, in order, then
+        // the node timeouts that are due
+        callback_queue_->Drain();
+        deadlines_->Expire(std::chrono::steady_clock::now());
+        status = tree_.tickOnce();
+    } catch (...) {
+        if (tick_slots_) tick_slots_->Release();
+        throw;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    const auto cpu = ThreadCpuTime() - cpu_start;
+    if (tick_slots_) tick_slots_->Release();
+
+    // Single writer: plain load and store are enough
+    ticks_.store(ticks_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    tick_ns_.store(tick_ns_.load(std::memory_order_relaxed) + elapsed.count(),
+                   std::memory_order_relaxed);
+    cpu_ns_.store(cpu_ns_.load(std::memory_order_relaxed) + cpu.count(),
+                  std::memory_order_relaxed);
+    if (elapsed.count() > max_tick_ns_.load(std::memory_order_relaxed)) {
+        max_tick_ns_.store(elapsed.count(), std::memory_order_relaxed);
+    }
+    return status;
+}
+
+void BTRunner::RouteCallbacks() {
+    tree_.applyVisitor([this](BT::TreeNode* node) {
+        if (auto* owner = dynamic_cast<CallbackOwner*>(node)) {
+            owner->Callbacks().Route(callback_queue_,
+                                     [node] { node->emitWakeUpSignal(); });
+        }
+    });
+}
+
+void BTRunner::SetName(std::string name) { name_ = std::move(name); }
+
+void BTRunner::SetTickSlots(std::shared_ptr<TickSlots> slots) {
+    tick_slots_ = std::move(slots);
+}
+
+TreeStats BTRunner::Stats() const {
+    TreeStats stats;
+    stats.ticks = ticks_.load(std::memory_order_relaxed);
+    stats.tick_time =
+        std::chrono::nanoseconds(tick_ns_.load(std::memory_order_relaxed));
+    stats.max_tick_time =
+        std::chrono::nanoseconds(max_tick_ns_.load(std::memory_order_relaxed));
+    stats.cpu_time =
+        std::chrono::nanoseconds(cpu_ns_.load(std::memory_order_relaxed));
+    return stats;
+}
+
+std::chrono::steady_clock::duration BTRunner::NextSleep() const {
+    std::chrono::steady_clock::duration timeout = kMaxTickSleep;
+
+    if (auto earliest = deadlines_->Earliest()) {
+        const auto until = *earliest - std::chrono::steady_clock::now();
+        timeout = std::clamp(until, std::chrono::steady_clock::duration::zero(),
+                             timeout);
+    }
+    return timeout;
+}
+
 void BTRunner::SetLogger(std::shared_ptr<Logger> logger) { logger_ = logger; }
 void BTRunner::UseRunnerLogger() { use_runner_logger_ = true; }
 
-void BTRunner::RegisterTreeFromFile(const std::string& treePath) {
-    blackboard_ = BT::Blackboard::create();
+void BTRunner::SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder,
+                                 std::string dump_path) {
+    recorder_ = std::move(recorder);
+    flight_dump_path_ = std::move(dump_path);
+}
+
+void BTRunner::RegisterNodes() {
+    factory_.registerNodeType<CAGetNode<epics::PVData>>("CAGet", pv_manager_,
+                                                        deadlines_);
+    factory_.registerNodeType<CAGetNode<double>>("CAGetDouble", pv_manager_,
+                                                 deadlines_);
+    factory_.registerNodeType<CAGetNode<int>>("CAGetInt", pv_manager_,
+                                              deadlines_);
+    factory_.registerNodeType<CAGetNode<std::string>>(
+        "CAGetString", pv_manager_, deadlines_);
+    factory_.registerNodeType<CAGetArrayNode<double>>(
+        "CAGetArrayDouble", pv_manager_, deadlines_);
+    factory_.registerNodeType<CAGetArrayNode<int>>("CAGetArrayInt",
+                                                   pv_manager_, deadlines_);
+    factory_.registerNodeType<CAGetArrayNode<std::string>>(
+        "CAGetArrayString", pv_manager_, deadlines_);
+    factory_.registerNodeType<CAGetMultiNode>("CAGetMulti", pv_manager_,
+                                              deadlines_);
+    factory_.registerNodeType<CAWindowStatNode>("CAWindowStat", pv_manager_,
+                                                deadlines_);
+    factory_.registerNodeType<CAWaitUntilNode>("CAWaitUntil", pv_manager_,
+                                               deadlines_);
+    factory_.registerNodeType<CACalcNode>("CACalc", pv_manager_, deadlines_);
+
+    factory_.registerNodeType<CAPutNode<double>>("CAPutDouble", pv_manager_,
+                                                 deadlines_);
+    factory_.registerNodeType<CAPutNode<int>>("CAPutInt", pv_manager_,
+                                              deadlines_);
+    factory_.registerNodeType<CAPutNode<std::string>>(
+        "CAPutString", pv_manager_, deadlines_);
+    factory_.registerNodeType<CAPutMultiNode>("CAPutMulti", pv_manager_,
+                                              deadlines_);
+    // pvAccess variants: [pv] names without a scheme use pva://
+    const std::string pva = "pva";
+    factory_.registerNodeType<CAGetNode<epics::PVData>>("PVAGet", pv_manager_,
+                                                        deadlines_, pva);
+    factory_.registerNodeType<CAGetNode<double>>("PVAGetDouble", pv_manager_,
+                                                 deadlines_, pva);
+    factory_.registerNodeType<CAGetNode<int>>("PVAGetInt", pv_manager_,
+                                              deadlines_, pva);
+    factory_.registerNodeType<CAGetNode<std::string>>(
+        "PVAGetString", pv_manager_, deadlines_, pva);
+    factory_.registerNodeType<CAGetArrayNode<double>>(
+        "PVAGetArrayDouble", pv_manager_, deadlines_, pva);
+    factory_.registerNodeType<CAGetArrayNode<int>>(
+        "PVAGetArrayInt", pv_manager_, deadlines_, pva);
+    factory_.registerNodeType<CAGetArrayNode<std::string>>(
+        "PVAGetArrayString", pv_manager_, deadlines_, pva);
+    factory_.registerNodeType<CAPutNode<double>>("PVAPutDouble", pv_manager_,
+                                                 deadlines_, pva);
+    factory_.registerNodeType<CAPutNode<int>>("PVAPutInt", pv_manager_,
+                                              deadlines_, pva);
+    factory_.registerNodeType<CAPutNode<std::string>>(
+        "PVAPutString", pv_manager_, deadlines_, pva);
+    for (const char* id :
+         {"PVAGet", "PVAGetDouble", "PVAGetInt", "PVAGetString",
+          "PVAGetArrayDouble", "PVAGetArrayInt", "PVAGetArrayString",
+          "PVAPutDouble", "PVAPutInt", "PVAPutString"}) {
+        pv_schemes_[id] = pva;
+    }
 
-    factory_.registerNodeType<CAGetNode<epics::PVData>>("CAGet", ctx_,
-                                                        pv_manager_);
-    factory_.registerNodeType<CAGetNode<double>>("CAGetDouble", ctx_,
-                                                 pv_manager_);
-    factory_.registerNodeType<CAGetNode<int>>("CAGetInt", ctx_, pv_manager_);
-    factory_.registerNodeType<CAGetNode<std::string>>("CAGetString", ctx_,
-                                                      pv_manager_);
-
-    factory_.registerNodeType<CAPutNode<double>>("CAPutDouble", ctx_,
-                                                 pv_manager_);
-    factory_.registerNodeType<CAPutNode<int>>("CAPutInt", ctx_, pv_manager_);
-    factory_.registerNodeType<CAPutNode<std::string>>("CAPutString", ctx_,
-                                                      pv_manager_);
     factory_.registerNodeType<PrintNode>("Print");
+}
+
+std::string BTRunner::MetricsName() const {
+    if (!name_.empty()) return name_;
+    return std::filesystem::path(tree_path_).stem().string();
+}
+
+void BTRunner::SetMetrics(std::shared_ptr<MetricsRegistry> metrics) {
+    metrics_ = std::move(metrics);
+}
+
+void BTRunner::RegisterTreeFromFile(const std::string& treePath) {
+    if (!nodes_registered_) {
+        RegisterNodes();
+        nodes_registered_ = true;
+    }
+    tree_path_ = treePath;
 
+    blackboard_ = BT::Blackboard::create();
+    factory_.clearRegisteredBehaviorTrees();
     factory_.registerBehaviorTreeFromFile(treePath);
     tree_ = factory_.createTree("MainTree", blackboard_);
+    // Options must be known before the PVs are created
+    ApplyMonitorOptions(tree_);
+    tree_pv_names_ = CollectPVNames(tree_);
+    RouteCallbacks();
+
+    if (recorder_) {
+        flight_logger_ =
+            std::make_unique<FlightRecorderLogger>(tree_, recorder_,
+                                                   MetricsName());
+    }
+    if (metrics_) {
+        metrics_logger_ =
+            std::make_unique<MetricsLogger>(tree_, *metrics_, MetricsName());
+    }
+
+    if (connect_timeout_.count() > 0) {
+        ConnectTreePVs();
+    }
 
     initialized_ = true;
 }
 
+bool BTRunner::ReloadTree() {
+    // Build the new tree next to the old one, which stays if this fails
+    auto blackboard = BT::Blackboard::create();
+    BT::Tree tree;
+    std::vector<std::string> names;
+    try {
+        factory_.clearRegisteredBehaviorTrees();
+        factory_.registerBehaviorTreeFromFile(tree_path_);
+        tree = factory_.createTree("MainTree", blackboard);
+        names = CollectPVNames(tree);
+    } catch (const std::exception& e) {
+        if (logger_) {
+            logger_->error("BTRunner: keeping the current tree, reload of {} "
+                           "failed: {}",
+                           tree_path_, e.what());
+        }
+        return false;
+    }
+    // Live PVs the new tree shares with the old one take its options too
+    ApplyMonitorOptions(tree);
+
+    // Hold the live PVs the new tree shares with the old one, so that
+    // destroying the old nodes does not close their channels
+    std::vector<std::shared_ptr<epics::PV>> kept;
+    for (const auto& name : names) {
+        if (auto pv = pv_manager_->Find(name)) kept.push_back(std::move(pv));
+    }
+
+    // The loggers observe the nodes of the old tree
+    runner_logger_.reset();
+    flight_logger_.reset();
+    metrics_logger_.reset();
+    tree_ = std::move(tree);
+    blackboard_ = std::move(blackboard);
+    RouteCallbacks();
+    if (recorder_) {
+        flight_logger_ =
+            std::make_unique<FlightRecorderLogger>(tree_, recorder_,
+                                                   MetricsName());
+    }
+    if (metrics_) {
+        metrics_logger_ =
+            std::make_unique<MetricsLogger>(tree_, *metrics_, MetricsName());
+    }
+
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    std::set_difference(names.begin(), names.end(), tree_pv_names_.begin(),
+                        tree_pv_names_.end(), std::back_inserter(added));
+    std::set_difference(tree_pv_names_.begin(), tree_pv_names_.end(),
+                        names.begin(), names.end(),
+                        std::back_inserter(removed));
+    if (logger_) {
+        logger_->info("BTRunner: reloaded {}: {} PVs kept, {} added, {} "
+                      "removed",
+                      tree_path_, kept.size(), added.size(), removed.size());
+        if (!added.empty()) {
+            logger_->info("BTRunner: added PVs: {}", fmt::join(added, " "));
+        }
+        if (!removed.empty()) {
+            logger_->info("BTRunner: removed PVs: {}",
+                          fmt::join(removed, " "));
+        }
+    }
+    tree_pv_names_ = std::move(names);
+
+    // Drops the PVs only the old tree used
+    tree_pvs_ = std::move(kept);
+    if (connect_timeout_.count() > 0) {
+        ConnectTreePVs();
+    }
+    pv_manager_->CollectGarbage();
+    return true;
+}
+
+void BTRunner::WatchTreeFile() {
+    watcher_ = std::make_unique<FileWatcher>(tree_path_, [this] {
+        if (logger_) {
+            logger_->info("BTRunner: {} changed, reloading before the next "
+                          "run",
+                          tree_path_);
+        }
+        reload_pending_ = true;
+    });
+}
+
+void BTRunner::SetConnectTimeout(std::chrono::milliseconds timeout) {
+    connect_timeout_ = timeout;
+}
+
+const std::vector<std::string>& BTRunner::MissingPVs() const {
+    return missing_pvs_;
+}
+
+namespace {
+// Only literal port values are known before the tree runs; blackboard
+// entries are resolved by the nodes themselves.
+bool LiteralPort(const BT::PortsRemapping& ports, const char* key,
+                 std::string& value) {
+    auto it = ports.find(key);
+    if (it == ports.end() || it->second.empty() ||
+        BT::TreeNode::isBlackboardPointer(it->second)) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+}  // namespace
+
+std::string BTRunner::NodePVName(const BT::TreeNode& node,
+                                 const std::string& pv) const {
+    auto scheme = pv_schemes_.find(node.registrationName());
+    return scheme == pv_schemes_.end()
+               ? pv
+               : epics::WithPVScheme(scheme->second, pv);
+}
+
+void BTRunner::ApplyMonitorOptions(const BT::Tree& tree) {
+    // Spec of each PV, to spot nodes that disagree
+    std::map<std::string, std::string> specs;
+    tree.applyVisitor([&](const BT::TreeNode* node) {
+        const auto& ports = node->config().input_ports;
+        std::string pv;
+        std::string spec;
+        if (!LiteralPort(ports, "pv", pv) ||
+            !LiteralPort(ports, "monitor", spec)) {
+            return;
+        }
+        epics::MonitorOptions options;
+        try {
+            options = epics::ParseMonitorOptions(spec);
+        } catch (const std::invalid_argument&) {
+            return;  // reported by the node when it runs
+        }
+
+        const std::string name = NodePVName(*node, pv);
+        const auto [it, added] = specs.emplace(name, spec);
+        if (!added && it->second != spec && logger_) {
+            logger_->warn("BTRunner: {} has monitor=\"{}\" and \"{}\"; "
+                          "using the latter",
+                          name, it->second, spec);
+        }
+        if (!pv_manager_->SetMonitorOptions(name, options) && logger_) {
+            logger_->warn("BTRunner: {} keeps its server side filter until "
+                          "its channel is created again",
+                          name);
+        }
+    });
+}
+
+std::vector<std::string> BTRunner::CollectPVNames(const BT::Tree& tree) const {
+    std::set<std::string> names;
+    tree.applyVisitor([&](const BT::TreeNode* node) {
+        const auto& ports = node->config().input_ports;
+        std::string value;
+        try {
+            if (LiteralPort(ports, "pv", value)) {
+                names.insert(NodePVName(*node, value));
+            }
+            if (LiteralPort(ports, "pvs", value)) {
+                for (auto& name : epics::ExpandPVNames(value)) {
+                    names.insert(std::move(name));
+                }
+            }
+            if (LiteralPort(ports, "values", value)) {
+                for (auto& entry : epics::ParsePVPutTable(value)) {
+                    names.insert(std::move(entry.pv));
+                }
+            }
+            if (LiteralPort(ports, "expr", value)) {
+                for (const auto& name :
+                     epics::PVExpression::Compile(value).Names()) {
+                    names.insert(name);
+                }
+            }
+            if (LiteralPort(ports, "file", value)) {
+                for (auto& entry : epics::LoadPVPutTable(value)) {
+                    names.insert(std::move(entry.pv));
+                }
+            }
+        } catch (const std::exception&) {
+            // Malformed specs are reported by the node when it runs
+        }
+    });
+
+    // Names of a protocol without a transport fail in their node
+    std::vector<std::string> served;
+    for (const auto& name : names) {
+        if (pv_manager_->Serves(name)) served.push_back(name);
+    }
+    return served;
+}
+
+void BTRunner::ConnectTreePVs() {
+    const auto& names = tree_pv_names_;
+    if (names.empty()) return;
+
+    if (logger_) {
+        logger_->info("BTRunner: connecting {} PVs", names.size());
+    }
+
+    tree_pvs_ = pv_manager_->GetMany(names);
+    missing_pvs_ = pv_manager_->ConnectAll(tree_pvs_, connect_timeout_);
+
+    if (logger_ && !missing_pvs_.empty()) {
+        logger_->warn("BTRunner: PVs not connected after {} ms: {}",
+                      connect_timeout_.count(), fmt::join(missing_pvs_, " "));
+    }
+}
+
 RunnerLogger::RunnerLogger(const BT::Tree& tree, std::shared_ptr<Logger> logger)
     : StatusChangeLogger(tree.rootNode()), logger_(std::move(logger)) {}
 RunnerLogger::~RunnerLogger() = default;
 
+namespace {
+// Same text as BT::toStr(status, true), without building a string
+const char* ColoredStatus(BT::NodeStatus status) {
+    switch (status) {
+        case BT::NodeStatus::SUCCESS:
+            return "\x1b[32mSUCCESS\x1b[0m";
+        case BT::NodeStatus::FAILURE:
+            return "\x1b[31mFAILURE\x1b[0m";
+        case BT::NodeStatus::RUNNING:
+            return "\x1b[33mRUNNING\x1b[0m";
+        case BT::NodeStatus::SKIPPED:
+            return "\x1b[34mSKIPPED\x1b[0m";
+        case BT::NodeStatus::IDLE:
+            return "\x1b[36mIDLE\x1b[0m";
+    }
+    return "Undefined";
+}
+}  // namespace
+
 void RunnerLogger::callback(BT::Duration timestamp, const BT::TreeNode& node,
                             BT::NodeStatus prev_status, BT::NodeStatus status) {
     // https://github.com/BehaviorTree/BehaviorTree.CPP/blob/master/src/loggers/bt_cout_logger.cpp
@@ -81,19 +550,69 @@ void RunnerLogger::callback(BT::Duration timestamp, const BT::TreeNode& node,
     constexpr const char* whitespaces = "                         ";
     constexpr size_t ws_count = 25;
 
+    if (!logger_->shouldLog(spdlog::level::debug)) return;
+
     const double since_epoch = duration<double>(timestamp).count();
 
     const std::string& name = node.name();
     const char* padding = &whitespaces[std::min(ws_count, name.size())];
 
-    const std::string prev_str = BT::toStr(prev_status, /*colored=*/true);
-    const std::string curr_str = BT::toStr(status, /*colored=*/true);
-
-    char buffer[256];
-    std::snprintf(buffer, sizeof(buffer), " [%.3f]: %s%s %s -> %s", since_epoch,
-                  name.c_str(), padding, prev_str.c_str(), curr_str.c_str());
-    logger_->debug(buffer);
+    logger_->debug(FMT_STRING(" [{:.3f}]: {}{} {} -> {}"), since_epoch, name,
+                   padding, ColoredStatus(prev_status),
+                   ColoredStatus(status));
 }
 
 void RunnerLogger::flush() { logger_->flush(); }
+
+FlightRecorderLogger::FlightRecorderLogger(
+    const BT::Tree& tree, std::shared_ptr<FlightRecorder> recorder,
+    const std::string& tree_name)
+    : StatusChangeLogger(tree.rootNode()), recorder_(std::move(recorder)) {
+    tree.applyVisitor([&](const BT::TreeNode* node) {
+        const uint16_t uid = node->UID();
+        if (uid >= ids_.size()) ids_.resize(uid + 1);
+        ids_[uid] = recorder_->AddNode(tree_name + "/" + node->fullPath());
+    });
+}
+
+void FlightRecorderLogger::callback(BT::Duration, const BT::TreeNode& node,
+                                    BT::NodeStatus prev_status,
+                                    BT::NodeStatus status) {
+    if (node.UID() >= ids_.size()) return;
+    recorder_->Record(FlightEvent::NodeStatus, ids_[node.UID()],
+                      static_cast<uint8_t>(prev_status),
+                      static_cast<uint8_t>(status));
+}
+
+MetricsLogger::MetricsLogger(BT::Tree& tree, MetricsRegistry& registry,
+                             const std::string& tree_name)
+    : StatusChangeLogger(tree.rootNode()) {
+    tree.applyVisitor([&](BT::TreeNode* node) {
+        auto metrics = registry.ForNode(tree_name, node->fullPath());
+        // Captures no this: the nodes may outlive the logger
+        node->setTickMonitorCallback(
+            [metrics](BT::TreeNode&, BT::NodeStatus,
+                      std::chrono::microseconds duration) {
+                metrics->ticks.fetch_add(1, std::memory_order_relaxed);
+                metrics->tick_time.Record(duration);
+            });
+        nodes_[node->UID()].metrics = std::move(metrics);
+    });
+}
+
+void MetricsLogger::callback(BT::Duration timestamp, const BT::TreeNode& node,
+                             BT::NodeStatus prev_status,
+                             BT::NodeStatus status) {
+    auto it = nodes_.find(node.UID());
+    if (it == nodes_.end()) return;
+
+    Entry& entry = it->second;
+    if (status == BT::NodeStatus::RUNNING) {
+        entry.running_since = timestamp;
+    } else if (prev_status == BT::NodeStatus::RUNNING) {
+        // Finished or halted
+        entry.metrics->running_time.Record(timestamp - entry.running_since);
+    }
+}
+
 }  // namespace bchtree
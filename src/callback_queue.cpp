@@ -0,0 +1,110 @@
+#include "callback_queue.h"
+
+#include <iterator>
+
+namespace bchtree {
+
+namespace {
+// At least two slots: with one, a full slot reads as free to producers
+size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+}  // namespace
+
+CallbackQueue::CallbackQueue(size_t capacity)
+    : slots_(new Slot[RoundUpToPowerOfTwo(capacity)]),
+      mask_(RoundUpToPowerOfTwo(capacity) - 1) {
+    for (size_t i = 0; i <= mask_; ++i) {
+        slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+CallbackQueue::~CallbackQueue() {
+    // Destroy what was never run
+    while (true) {
+        Slot& slot = slots_[head_ & mask_];
+        if (slot.seq.load(std::memory_order_acquire) != head_ + 1) break;
+        slot.destroy(slot.storage);
+        slot.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+    }
+}
+
+size_t CallbackQueue::Drain() {
+    consumer_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+    size_t ran = 0;
+    while (ran <= mask_) {
+        Slot& slot = slots_[head_ & mask_];
+        if (slot.seq.load(std::memory_order_acquire) != head_ + 1) break;
+
+        // Free the slot even if the task throws
+        struct Release {
+            Slot& slot;
+            size_t& head;
+            size_t capacity;
+            ~Release() {
+                slot.destroy(slot.storage);
+                slot.seq.store(head + capacity, std::memory_order_release);
+                ++head;
+            }
+        } release{slot, head_, mask_ + 1};
+
+        ++ran;
+        slot.run(slot.storage);
+    }
+    if (has_overflow_.load(std::memory_order_acquire)) ran += DrainOverflow();
+    return ran;
+}
+
+size_t CallbackQueue::DrainOverflow() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(overflow_mtx_);
+        tasks.swap(overflow_);
+        has_overflow_.store(false, std::memory_order_relaxed);
+    }
+
+    size_t next = 0;
+    try {
+        for (; next < tasks.size(); ++next) tasks[next]();
+    } catch (...) {
+        // Like a throwing slot: remove the task, keep the ones after it
+        std::lock_guard<std::mutex> lock(overflow_mtx_);
+        overflow_.insert(overflow_.begin(),
+                         std::make_move_iterator(tasks.begin() + next + 1),
+                         std::make_move_iterator(tasks.end()));
+        has_overflow_.store(!overflow_.empty(), std::memory_order_relaxed);
+        throw;
+    }
+    return tasks.size();
+}
+
+void CallbackQueue::SetActive(bool active) {
+    active_.store(active, std::memory_order_relaxed);
+}
+
+bool CallbackQueue::Active() const {
+    return active_.load(std::memory_order_relaxed);
+}
+
+bool CallbackQueue::OnConsumerThread() const {
+    return consumer_.load(std::memory_order_relaxed) ==
+           std::this_thread::get_id();
+}
+
+uint64_t CallbackQueue::Overflows() const {
+    return overflows_.load(std::memory_order_relaxed);
+}
+
+void CallbackQueue::CountDropped() {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t CallbackQueue::Dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+}  // namespace bchtree
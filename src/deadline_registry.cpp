@@ -0,0 +1,203 @@
+#include "deadline_registry.h"
+
+#include <algorithm>
+
+namespace bchtree {
+
+DeadlineRegistry::DeadlineRegistry() : origin_(Clock::now()) {
+    for (auto& level : slots_) level.fill(kNil);
+}
+
+DeadlineRegistry::Id DeadlineRegistry::Arm(Clock::time_point deadline,
+                                           Callback on_expiry) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint32_t index = free_;
+    if (index == kNil) {
+        index = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+    } else {
+        free_ = entries_[index].next;
+    }
+
+    Entry& entry = entries_[index];
+    entry.deadline = deadline;
+    entry.on_expiry = std::move(on_expiry);
+    Insert(index);
+    ++size_;
+    return (Id{entry.generation} << 32) | index;
+}
+
+void DeadlineRegistry::Disarm(Id id) {
+    if (id == kInvalidId) return;
+
+    Callback on_expiry;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        const auto index = static_cast<uint32_t>(id);
+        if (index >= entries_.size()) return;
+        Entry& entry = entries_[index];
+        if (entry.generation != (id >> 32) || !entry.list) return;
+
+        // Destroyed without the lock
+        on_expiry = std::move(entry.on_expiry);
+        Free(index);
+    }
+}
+
+size_t DeadlineRegistry::Expire(Clock::time_point now) {
+    std::vector<Callback> due;
+    size_t expired = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        const uint64_t target = ToTick(now);
+        while (true) {
+            // Deadlines within the current millisecond may not be due yet
+            uint32_t index = slots_[0][now_tick_ & (kSlots - 1)];
+            while (index != kNil) {
+                Entry& entry = entries_[index];
+                const uint32_t next = entry.next;
+                if (entry.deadline <= now) {
+                    if (entry.on_expiry) {
+                        due.push_back(std::move(entry.on_expiry));
+                    }
+                    Free(index);
+                    ++expired;
+                }
+                index = next;
+            }
+            if (now_tick_ >= target) break;
+
+            if (size_ == 0) {
+                now_tick_ = target;
+                break;
+            }
+            // Skip ahead to the next slot of the lowest level in use
+            uint64_t step = 1;
+            for (size_t level = 0; level < kLevels && !level_size_[level];
+                 ++level) {
+                step <<= kSlotBits;
+            }
+            now_tick_ = std::min(target, (now_tick_ | (step - 1)) + 1);
+            if ((now_tick_ & (kSlots - 1)) == 0) Cascade(now_tick_);
+        }
+    }
+
+    for (auto& on_expiry : due) on_expiry();
+    return expired;
+}
+
+std::optional<DeadlineRegistry::Clock::time_point> DeadlineRegistry::Earliest()
+    const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (size_ == 0) return std::nullopt;
+
+    // The first slot in use of the lowest level in use holds the earliest
+    // deadline: every level covers the time before the next one
+    for (size_t level = 0; level < kLevels; ++level) {
+        if (!level_size_[level]) continue;
+        const uint64_t base = now_tick_ >> (kSlotBits * level);
+        for (uint64_t k = 0; k < kSlots; ++k) {
+            const uint32_t head = slots_[level][(base + k) & (kSlots - 1)];
+            if (head != kNil) return EarliestIn(head);
+        }
+    }
+    return EarliestIn(overflow_);
+}
+
+size_t DeadlineRegistry::Size() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return size_;
+}
+
+uint64_t DeadlineRegistry::ToTick(Clock::time_point t) const {
+    if (t <= origin_) return 0;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(t - origin_)
+            .count());
+}
+
+void DeadlineRegistry::Insert(uint32_t index) {
+    Entry& entry = entries_[index];
+    // Past deadlines go to the current slot, for the next Expire()
+    const uint64_t tick = std::max(ToTick(entry.deadline), now_tick_);
+
+    // The lowest level whose slots share the wheel's position one level
+    // up: a slot ahead of the wheel, never one revolution later
+    uint8_t level = kOverflow;
+    uint32_t* list = &overflow_;
+    for (uint8_t l = 0; l < kLevels; ++l) {
+        const unsigned up = kSlotBits * (l + 1);
+        if ((tick >> up) == (now_tick_ >> up)) {
+            level = l;
+            list = &slots_[l][(tick >> (kSlotBits * l)) & (kSlots - 1)];
+            break;
+        }
+    }
+
+    entry.level = level;
+    entry.list = list;
+    entry.prev = kNil;
+    entry.next = *list;
+    if (*list != kNil) entries_[*list].prev = index;
+    *list = index;
+    ++level_size_[level];
+}
+
+void DeadlineRegistry::Unlink(uint32_t index) {
+    Entry& entry = entries_[index];
+    if (entry.prev != kNil) {
+        entries_[entry.prev].next = entry.next;
+    } else {
+        *entry.list = entry.next;
+    }
+    if (entry.next != kNil) entries_[entry.next].prev = entry.prev;
+    --level_size_[entry.level];
+    entry.list = nullptr;
+    entry.prev = kNil;
+    entry.next = kNil;
+}
+
+void DeadlineRegistry::Free(uint32_t index) {
+    Unlink(index);
+    Entry& entry = entries_[index];
+    entry.on_expiry = nullptr;
+    ++entry.generation;  // stale ids no longer match
+    entry.next = free_;
+    free_ = index;
+    --size_;
+}
+
+void DeadlineRegistry::Cascade(uint64_t tick) {
+    // Highest level first: its deadlines may land in a slot of the level
+    // below that is redistributed next
+    if ((tick & ((uint64_t{1} << (kSlotBits * kLevels)) - 1)) == 0) {
+        Reinsert(&overflow_);
+    }
+    for (size_t level = kLevels - 1; level > 0; --level) {
+        if (tick & ((uint64_t{1} << (kSlotBits * level)) - 1)) continue;
+        Reinsert(&slots_[level][(tick >> (kSlotBits * level)) & (kSlots - 1)]);
+    }
+}
+
+void DeadlineRegistry::Reinsert(uint32_t* list) {
+    uint32_t index = *list;
+    while (index != kNil) {
+        const uint32_t next = entries_[index].next;
+        Unlink(index);
+        Insert(index);
+        index = next;
+    }
+}
+
+std::optional<DeadlineRegistry::Clock::time_point>
+DeadlineRegistry::EarliestIn(uint32_t head) const {
+    std::optional<Clock::time_point> earliest;
+    for (uint32_t index = head; index != kNil; index = entries_[index].next) {
+        if (!earliest || entries_[index].deadline < *earliest) {
+            earliest = entries_[index].deadline;
+        }
+    }
+    return earliest;
+}
+
+}  // namespace bchtree
@@ -43,6 +43,12 @@ void CAContextManager::EnsureAttached() {
     }
 }
 
+void CAContextManager::Flush() {
+    // Send every request queued by this thread in one go
+    EnsureAttached();
+    ca_flush_io();
+}
+
 void CAContextManager::Shutdown() {
     std::lock_guard<std::mutex> lock(mtx_);
     if (!initialized_) return;
@@ -1,15 +1,20 @@
 #include "epics/ca/ca_pv.h"
 
+#include <algorithm>
+#include <utility>
+
+#include "epics/pv_names.h"
+
 namespace bchtree::epics::ca {
 
-struct PutCBCtx {
-    CAPV* self;
-    PutCallback cb;
-};
+static_assert(kMonitorValue == DBE_VALUE && kMonitorLog == DBE_LOG &&
+                  kMonitorAlarm == DBE_ALARM &&
+                  kMonitorProperty == DBE_PROPERTY,
+              "MonitorEvent bits must match DBE_*");
 
 struct PutScalarVisitor {
     chid cid;
-    PutCBCtx* cb_ctx;
+    void* cb_ctx;
     caEventCallBackFunc* handler;
 
     bool operator()(int32_t v) const {
@@ -28,9 +33,11 @@ struct PutScalarVisitor {
         int rc = ca_put_callback(DBR_ENUM, cid, &v, handler, cb_ctx);
         return (rc == ECA_NORMAL);
     }
-    bool operator()(const std::string& s) const {
+    bool operator()(const PVString& s) const {
         char buf[MAX_STRING_SIZE] = {};
-        std::strncpy(buf, s.c_str(), MAX_STRING_SIZE - 1);
+        const std::string_view view = s.view();
+        std::memcpy(buf, view.data(),
+                    std::min<size_t>(view.size(), MAX_STRING_SIZE - 1));
         int rc = ca_put_callback(DBR_STRING, cid, buf, handler, cb_ctx);
         return (rc == ECA_NORMAL);
     }
@@ -47,6 +54,17 @@ CAPV::~CAPV() {
     }
 }
 
+void CAPV::SetMaxElements(size_t max_elements) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    max_elements_ = max_elements;
+}
+
+void CAPV::SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    recorder_id_ = recorder ? recorder->AddPV(pv_name_) : 0;
+    recorder_ = std::move(recorder);
+}
+
 void CAPV::AddConnCB(ConnCallback cb) {
     std::lock_guard<std::mutex> lock(mtx_);
     conn_cbs_.push_back(std::move(cb));
@@ -56,31 +74,41 @@ void CAPV::Connect() {
     std::lock_guard<std::mutex> lock(mtx_);
     if (chid_) return;
 
-    int st = ca_create_channel(pv_name_.c_str(), &ConnHandler, this,
+    // A server side filter applies to the whole channel, gets included
+    const std::string channel =
+        WithChannelFilter(pv_name_, GetMonitorOptions().server_filter);
+    int st = ca_create_channel(channel.c_str(), &ConnHandler, this,
                                CA_PRIORITY_DEFAULT, &chid_);
     if (st != ECA_NORMAL) throw std::runtime_error("ca_create_channel failed");
 }
 
-bool CAPV::PutCB(const PVScalarValue& v, PutCallback cb) {
-    auto cb_ctx = std::make_unique<PutCBCtx>();
-    cb_ctx->self = this;
-    cb_ctx->cb = std::move(cb);
+bool CAPV::DoGetCB(GetRequest* req, std::chrono::milliseconds,
+                   bool flush) {
+    const chtype dbr_type = PreferredGetType(native_type_);
 
-    // Pass cb_ctx pointer to user
-    PutCBCtx* raw = cb_ctx.release();
+    // The request is the user pointer, back to us in GetHandler
+    int st = ca_array_get_callback(dbr_type, RequestCount(), chid_,
+                                   &GetHandler, req);
+    if (st != ECA_NORMAL) {
+        std::cout << "status=" << st << " : " << ca_message(st) << "\n";
+        return false;
+    }
+    if (flush) {
+        ca_flush_io();
+    }
 
-    PutScalarVisitor visitor{chid_, raw, &PutHandler};
-    bool success = std::visit(visitor, v);
+    return true;
+}
 
-    ca_flush_io();
+bool CAPV::DoPutCB(const PVScalarValue& v, PutRequest* req, bool flush) {
+    PutScalarVisitor visitor{chid_, req, &PutHandler};
+    bool success = std::visit(visitor, v);
 
-    if (!success) {
-        // Reclaim ownership
-        std::unique_ptr<PutCBCtx> reclaim(raw);
-        return false;
+    if (flush) {
+        ca_flush_io();
     }
 
-    return true;
+    return success;
 }
 
 std::string CAPV::GetPVname() const { return pv_name_; };
@@ -94,55 +122,156 @@ void CAPV::ConnHandler(struct connection_handler_args args) {
     auto* self = static_cast<CAPV*>(ca_puser(args.chid));
     if (!self) return;
 
-    std::lock_guard<std::mutex> lock(self->mtx_);
-    self->connected_ = (args.op == CA_OP_CONN_UP);
+    const bool connected = (args.op == CA_OP_CONN_UP);
+    std::vector<ConnCallback> cbs;
+    {
+        std::lock_guard<std::mutex> lock(self->mtx_);
+        self->connected_ = connected;
+        self->RecordFlight(FlightEvent::CAConnect, ECA_NORMAL, connected);
+
+        if (connected) {
+            self->native_type_ = ca_field_type(self->chid_);
+            self->elem_count_ = ca_element_count(self->chid_);
+            // The state names, for conditions on them. Requested before the
+            // subscription, so they arrive before the first update.
+            if (self->native_type_ == DBF_ENUM) {
+                ca_array_get_callback(DBR_CTRL_ENUM, 1, self->chid_,
+                                      &EnumHandler, nullptr);
+            }
+        }
+        cbs = self->conn_cbs_;
 
-    if (self->connected_) {
-        self->native_type_ = ca_field_type(self->chid_);
-        self->elem_count_ = ca_element_count(self->chid_);
+        // Alway start monitor for now
+        self->EnsureStartMonitor();
     }
 
-    std::vector<ConnCallback> cbs;
-    cbs = self->conn_cbs_;
+    // Without the lock, like the other backends: a callback may call back
+    // into this PV
     for (auto& cb : cbs) {
-        if (cb) cb(self->connected_);
+        if (cb) cb(connected);
     }
+}
 
-    // Alway start monitor for now
-    self->EnsureStartMonitor();
+void CAPV::GetHandler(struct event_handler_args args) {
+    auto* req = static_cast<GetRequest*>(args.usr);
+    if (!req || !req->pv) return;
+    auto* self = static_cast<CAPV*>(req->pv);
+    self->RecordFlight(FlightEvent::CAGet, args.status);
+
+    if (args.status != ECA_NORMAL) {
+        self->FailGet(req, args.status);
+        return;
+    }
+
+    PVData sample;
+    try {
+        sample = DecodePV(args.type, args.count, args.dbr, self->IsArray());
+    } catch (const std::runtime_error&) {
+        self->FailGet(req, ECA_BADTYPE);
+        return;
+    }
+
+    self->CompleteGet(req, std::move(sample));
 }
 
 void CAPV::PutHandler(struct event_handler_args args) {
-    std::unique_ptr<PutCBCtx> cb_ctx(static_cast<PutCBCtx*>(args.usr));
-    if (!cb_ctx || !cb_ctx->self) return;
+    auto* req = static_cast<PutRequest*>(args.usr);
+    if (!req || !req->pv) return;
+    auto* self = static_cast<CAPV*>(req->pv);
+    self->RecordFlight(FlightEvent::CAPut, args.status);
 
-    bool success{args.status == ECA_NORMAL};
-    cb_ctx->cb(success);
+    self->CompletePut(req, args.status == ECA_NORMAL);
 }
 
 void CAPV::MonitorHandler(struct event_handler_args args) {
     auto* self = static_cast<CAPV*>(args.usr);
     if (!self) return;
+    self->RecordFlight(FlightEvent::CAMonitor, args.status);
 
     if (args.status != ECA_NORMAL) {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(self->mtx_);
-    self->pvdata_ = DecodePVScalar(args.type, args.dbr);
+    PVData sample;
+    try {
+        sample = DecodePV(args.type, args.count, args.dbr, self->IsArray());
+    } catch (const std::runtime_error&) {
+        // Nothing may escape on the CA thread
+        self->DropMonitor();
+        return;
+    }
+    self->PublishMonitor(std::move(sample));
+}
+
+bool CAPV::MonitorOptionsChanged(const MonitorOptions& previous) {
+    const MonitorOptions options = GetMonitorOptions();
+    // ca_clear_subscription waits for the CA callbacks, and ConnHandler
+    // takes mtx_ inside one: make the CA calls without holding mtx_
+    evid stale = nullptr;
+    chid channel = nullptr;
+    chtype dbr_type = 0;
+    unsigned long count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        channel = chid_;
+        if (evid_ && options.events != previous.events) {
+            std::swap(stale, evid_);
+            dbr_type = PreferredGetType(native_type_);
+            count = RequestCount();
+        }
+    }
+
+    // Subscribe again with the new event mask
+    if (stale) {
+        ca_clear_subscription(stale);
+        evid fresh = nullptr;
+        const int st = ca_create_subscription(dbr_type, count, channel,
+                                              options.events,
+                                              &CAPV::MonitorHandler, this,
+                                              &fresh);
+        if (st != ECA_NORMAL) {
+            std::cout << "status=" << st << " : " << ca_message(st) << "\n";
+        } else {
+            bool raced;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                raced = evid_ != nullptr;
+                if (!raced) evid_ = fresh;
+            }
+            // A reconnect subscribed meanwhile, with the same options
+            if (raced) ca_clear_subscription(fresh);
+        }
+        ca_flush_io();
+    }
+    // The filter is part of the channel name
+    return !channel || options.server_filter == previous.server_filter;
+}
+
+void CAPV::EnumHandler(struct event_handler_args args) {
+    // Outlived by the channel like the connection handler
+    auto* self = static_cast<CAPV*>(ca_puser(args.chid));
+    if (!self || args.status != ECA_NORMAL) return;
+
+    const auto* v = static_cast<const dbr_ctrl_enum*>(args.dbr);
+    std::vector<std::string> strings;
+    const int count = std::clamp<int>(v->no_str, 0, MAX_ENUM_STATES);
+    strings.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        strings.emplace_back(v->strs[i],
+                             strnlen(v->strs[i], MAX_ENUM_STRING_SIZE));
+    }
+    self->SetEnumStrings(std::move(strings));
 }
 
 void CAPV::EnsureStartMonitor() {
     if (!connected_ or !chid_) return;  // Not connected
     if (evid_) return;                  // Alread started
 
-    const short dbf = ca_field_type(chid_);
     const chtype dbr_type = PreferredGetType(native_type_);
+    const unsigned long cnt = RequestCount();
 
-    // Only scalar value is supported now
-    const unsigned long cnt = 1;
-
-    int st = ca_create_subscription(dbr_type, cnt, chid_, DBE_VALUE | DBE_ALARM,
+    int st = ca_create_subscription(dbr_type, cnt, chid_,
+                                    GetMonitorOptions().events,
                                     &CAPV::MonitorHandler, this, &evid_);
     if (st != ECA_NORMAL) {
         std::cout << "status=" << st << " : " << ca_message(st) << "\n";
@@ -156,12 +285,23 @@ void CAPV::ClearMonitor() {
     evid_ = nullptr;
 }
 
+PVData CAPV::DecodePV(chtype type, long count, const void* dbr,
+                      bool is_array) {
+    if (is_array) {
+        return DecodePVArray(type, count, dbr);
+    }
+    return DecodePVScalar(type, dbr);
+}
+
 PVData CAPV::DecodePVScalar(chtype type, const void* dbr) {
     PVData data{};
+    data.count = 1;
     switch (type) {
         case DBR_TIME_STRING: {
             auto v = static_cast<const dbr_time_string*>(dbr);
-            data.value = bchtree::epics::PVScalarValue{v->value};
+            const std::string_view text(v->value,
+                                        strnlen(v->value, MAX_STRING_SIZE));
+            data.value = bchtree::epics::PVScalarValue{PVString(text)};
             break;
         }
         case DBR_TIME_DOUBLE: {
@@ -184,6 +324,12 @@ PVData CAPV::DecodePVScalar(chtype type, const void* dbr) {
             data.value = bchtree::epics::PVScalarValue{v->value};
             break;
         }
+        case DBR_TIME_CHAR: {
+            auto v = static_cast<const dbr_time_char*>(dbr);
+            data.value =
+                bchtree::epics::PVScalarValue{static_cast<int32_t>(v->value)};
+            break;
+        }
         case DBR_TIME_ENUM: {
             auto v = static_cast<const dbr_time_enum*>(dbr);
             data.value = bchtree::epics::PVScalarValue{v->value};
@@ -196,6 +342,84 @@ PVData CAPV::DecodePVScalar(chtype type, const void* dbr) {
     return data;
 }
 
+namespace {
+
+// Copy 'count' elements that start at 'first' into a new shared buffer
+template <typename E, typename S>
+PVArray<E> MakePVArray(const S* first, long count) {
+    auto arr = std::make_shared<std::vector<E>>();
+    if (count > 0) arr->assign(first, first + count);
+    return arr;
+}
+
+}  // namespace
+
+PVData CAPV::DecodePVArray(chtype type, long count, const void* dbr) {
+    PVData data{};
+    data.count = count > 0 ? static_cast<size_t>(count) : 0;
+
+    switch (type) {
+        case DBR_TIME_STRING: {
+            auto v = static_cast<const dbr_time_string*>(dbr);
+            const dbr_string_t* first = &v->value;
+            auto arr = std::make_shared<std::vector<std::string>>();
+            arr->reserve(data.count);
+            for (size_t i = 0; i < data.count; ++i) {
+                arr->emplace_back(first[i], strnlen(first[i], MAX_STRING_SIZE));
+            }
+            data.value = PVArrayValue{PVArray<std::string>(std::move(arr))};
+            break;
+        }
+        case DBR_TIME_DOUBLE: {
+            auto v = static_cast<const dbr_time_double*>(dbr);
+            data.value = PVArrayValue{MakePVArray<double>(&v->value, count)};
+            break;
+        }
+        case DBR_TIME_FLOAT: {
+            auto v = static_cast<const dbr_time_float*>(dbr);
+            data.value = PVArrayValue{MakePVArray<float>(&v->value, count)};
+            break;
+        }
+        case DBR_TIME_LONG: {
+            auto v = static_cast<const dbr_time_long*>(dbr);
+            data.value = PVArrayValue{MakePVArray<int32_t>(&v->value, count)};
+            break;
+        }
+        case DBR_TIME_INT: {
+            auto v = static_cast<const dbr_time_short*>(dbr);
+            data.value = PVArrayValue{MakePVArray<int32_t>(&v->value, count)};
+            break;
+        }
+        case DBR_TIME_CHAR: {
+            auto v = static_cast<const dbr_time_char*>(dbr);
+            data.value = PVArrayValue{MakePVArray<int32_t>(&v->value, count)};
+            break;
+        }
+        case DBR_TIME_ENUM: {
+            auto v = static_cast<const dbr_time_enum*>(dbr);
+            data.value = PVArrayValue{MakePVArray<uint16_t>(&v->value, count)};
+            break;
+        }
+        default: {
+            throw std::runtime_error("unsupported DBR type");
+        }
+    }
+    return data;
+}
+
+// A one element channel is a scalar unless a node asked for an array
+bool CAPV::IsArray() const { return ArrayExpected() || elem_count_ > 1; }
+
+unsigned long CAPV::RequestCount() const {
+    if (!IsArray()) return 1;
+
+    // Count 0 asks the server for the current (dynamic) array length
+    if (max_elements_ == kUnlimitedElements || max_elements_ >= elem_count_) {
+        return 0;
+    }
+    return static_cast<unsigned long>(max_elements_);
+}
+
 chtype CAPV::PreferredGetType(chtype dbf) {
     return static_cast<chtype>(dbf_type_to_DBR_TIME(dbf));
 }
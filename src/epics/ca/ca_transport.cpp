@@ -0,0 +1,15 @@
+#include "epics/ca/ca_transport.h"
+
+#include "epics/ca/ca_pv.h"
+
+namespace bchtree::epics::ca {
+
+std::shared_ptr<PV> CATransport::CreatePV(const std::string& pv_name) {
+    return std::make_shared<CAPV>(ctx_, pv_name);
+}
+
+void CATransport::Attach() { ctx_->EnsureAttached(); }
+
+void CATransport::Flush() { ctx_->Flush(); }
+
+}  // namespace bchtree::epics::ca
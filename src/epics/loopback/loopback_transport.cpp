@@ -0,0 +1,485 @@
+#include "epics/loopback/loopback_transport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "epics/pv.h"
+
+namespace bchtree::epics::loopback {
+
+namespace {
+
+PVData ScalarData(PVScalarValue value) {
+    PVData data;
+    data.value = std::move(value);
+    data.meta.timestamp = std::chrono::system_clock::now();
+    data.count = 1;
+    return data;
+}
+
+// Numeric scalars count up, anything else is left alone
+bool Increment(PVData& data) {
+    auto* scalar = std::get_if<PVScalarValue>(&data.value);
+    if (!scalar) return false;
+
+    const bool changed = std::visit(
+        [](auto& v) {
+            using V = std::decay_t<decltype(v)>;
+            if constexpr (std::is_arithmetic_v<V>) {
+                v = static_cast<V>(v + 1);
+                return true;
+            } else {
+                return false;
+            }
+        },
+        *scalar);
+    if (changed) data.meta.timestamp = std::chrono::system_clock::now();
+    return changed;
+}
+
+}  // namespace
+
+class LoopbackPV;
+
+// Values and the worker thread. Shared by the transport and its PVs; the
+// worker keeps it alive until Stop().
+class LoopbackServer : public std::enable_shared_from_this<LoopbackServer> {
+   public:
+    using Task = std::function<void()>;
+
+    explicit LoopbackServer(LoopbackOptions options) : options_(options) {}
+
+    void Start();
+    void Stop();
+
+    // Run task on the worker after delay. False once stopped.
+    bool Schedule(std::chrono::microseconds delay, Task task);
+    std::chrono::microseconds Latency() const { return options_.latency; }
+
+    // Current value, and pv receives the updates from now on. nullopt if
+    // the name does not exist; if it is disconnected, pv is connected when
+    // it comes back.
+    std::optional<PVData> Subscribe(const std::string& pv_name,
+                                    std::weak_ptr<LoopbackPV> pv);
+    std::optional<PVData> Read(const std::string& pv_name) const;
+    // Store the value, creating the name if needed, and post the monitor
+    // updates, or connect the subscribers of a disconnected name
+    void Write(const std::string& pv_name, PVData data);
+    // A client put: like Write() but false, storing nothing, if the name
+    // is unknown or disconnected
+    bool Put(const std::string& pv_name, PVData data);
+    void Disconnect(const std::string& pv_name);
+
+   private:
+    struct Channel {
+        PVData value;
+        std::vector<std::weak_ptr<LoopbackPV>> subscribers;
+        bool online = true;
+    };
+
+    struct Event {
+        std::chrono::steady_clock::time_point due;
+        uint64_t seq;
+        Task task;
+    };
+
+    // Min-heap on (due, seq): equal due times run in submission order
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+        }
+    };
+
+    using Subscribers = std::vector<std::shared_ptr<LoopbackPV>>;
+
+    void Run();
+    void UpdateAll();
+    Channel* FindLocked(const std::string& pv_name);
+    // Live subscribers of the channel; expired ones are dropped
+    static Subscribers TakeSubscribers(Channel& channel);
+    static void Notify(const Subscribers& pvs, const PVData& data);
+
+    const LoopbackOptions options_;
+
+    mutable std::mutex mtx_;  // guards channels_
+    std::unordered_map<std::string, Channel> channels_;
+
+    std::mutex queue_mtx_;  // guards queue_, next_seq_ and stop_
+    std::condition_variable cv_;
+    std::vector<Event> queue_;
+    uint64_t next_seq_ = 0;
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+class LoopbackPV : public PV, public std::enable_shared_from_this<LoopbackPV> {
+   public:
+    LoopbackPV(std::shared_ptr<LoopbackServer> server, std::string pv_name)
+        : server_(std::move(server)), pv_name_(std::move(pv_name)) {}
+
+    // Arrays are always delivered whole
+    void SetMaxElements(size_t) override {}
+    void SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder) override;
+    void AddConnCB(ConnCallback cb) override;
+    void Connect() override;
+
+    std::string GetPVname() const override { return pv_name_; }
+    bool IsConnected() const override { return connected_; }
+
+    // Called on the worker thread
+    void OnConnect(PVData data);
+    void OnDisconnect();
+    void OnMonitor(const PVData& data);
+
+   protected:
+    bool DoGetCB(GetRequest* req, std::chrono::milliseconds timeout,
+                 bool flush) override;
+    bool DoPutCB(const PVScalarValue& v, PutRequest* req,
+                 bool flush) override;
+
+   private:
+    void RecordFlight(FlightEvent event, uint8_t to = 0) const {
+        if (recorder_) recorder_->Record(event, recorder_id_, 0, to);
+    }
+
+    std::shared_ptr<LoopbackServer> server_;
+    const std::string pv_name_;
+    std::atomic<bool> connecting_{false};
+    std::atomic<bool> connected_{false};
+
+    std::mutex mtx_;  // guards conn_cbs_
+    std::vector<ConnCallback> conn_cbs_;
+
+    std::shared_ptr<FlightRecorder> recorder_;
+    uint32_t recorder_id_ = 0;
+};
+
+// ---- LoopbackServer ----
+
+void LoopbackServer::Start() {
+    worker_ = std::thread([self = shared_from_this()] { self->Run(); });
+
+    if (options_.update_rate_hz > 0) {
+        Schedule(std::chrono::microseconds(0), [this] { UpdateAll(); });
+    }
+}
+
+void LoopbackServer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+
+    if (!worker_.joinable()) return;
+    // Stopped from a callback: the worker exits once the callback returns
+    if (worker_.get_id() == std::this_thread::get_id()) {
+        worker_.detach();
+    } else {
+        worker_.join();
+    }
+}
+
+bool LoopbackServer::Schedule(std::chrono::microseconds delay, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mtx_);
+        if (stop_) return false;
+
+        queue_.push_back(Event{std::chrono::steady_clock::now() + delay,
+                               next_seq_++, std::move(task)});
+        std::push_heap(queue_.begin(), queue_.end(), Later{});
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void LoopbackServer::Run() {
+    std::unique_lock<std::mutex> lock(queue_mtx_);
+    while (!stop_) {
+        if (queue_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        const auto due = queue_.front().due;
+        if (std::chrono::steady_clock::now() < due) {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+
+        std::pop_heap(queue_.begin(), queue_.end(), Later{});
+        Task task = std::move(queue_.back().task);
+        queue_.pop_back();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+void LoopbackServer::UpdateAll() {
+    std::vector<std::pair<Subscribers, PVData>> updates;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& [name, channel] : channels_) {
+            if (!channel.online || !Increment(channel.value)) continue;
+            auto pvs = TakeSubscribers(channel);
+            if (pvs.empty()) continue;
+            updates.emplace_back(std::move(pvs), channel.value);
+        }
+    }
+    for (const auto& [pvs, data] : updates) {
+        Notify(pvs, data);
+    }
+
+    const auto period = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::duration<double>(1.0 / options_.update_rate_hz));
+    Schedule(period, [this] { UpdateAll(); });
+}
+
+LoopbackServer::Channel* LoopbackServer::FindLocked(
+    const std::string& pv_name) {
+    auto it = channels_.find(pv_name);
+    if (it != channels_.end()) return &it->second;
+    if (!options_.create_on_demand) return nullptr;
+
+    return &channels_.emplace(pv_name, Channel{ScalarData(0.0), {}})
+                .first->second;
+}
+
+std::optional<PVData> LoopbackServer::Subscribe(const std::string& pv_name,
+                                                std::weak_ptr<LoopbackPV> pv) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Channel* channel = FindLocked(pv_name);
+    if (!channel) return std::nullopt;
+
+    channel->subscribers.push_back(std::move(pv));
+    if (!channel->online) return std::nullopt;
+    return channel->value;
+}
+
+std::optional<PVData> LoopbackServer::Read(const std::string& pv_name) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = channels_.find(pv_name);
+    if (it == channels_.end() || !it->second.online) return std::nullopt;
+    return it->second.value;
+}
+
+void LoopbackServer::Write(const std::string& pv_name, PVData data) {
+    Subscribers pvs;
+    bool reconnect;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Channel& channel = channels_[pv_name];
+        channel.value = data;
+        reconnect = !std::exchange(channel.online, true);
+        pvs = TakeSubscribers(channel);
+    }
+    if (pvs.empty()) return;
+
+    // Connection and monitor callbacks only run on the worker
+    Schedule(std::chrono::microseconds(0),
+             [pvs = std::move(pvs), data = std::move(data), reconnect] {
+                 if (!reconnect) {
+                     Notify(pvs, data);
+                     return;
+                 }
+                 for (const auto& pv : pvs) pv->OnConnect(data);
+             });
+}
+
+bool LoopbackServer::Put(const std::string& pv_name, PVData data) {
+    Subscribers pvs;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = channels_.find(pv_name);
+        if (it == channels_.end() || !it->second.online) return false;
+        it->second.value = data;
+        pvs = TakeSubscribers(it->second);
+    }
+    if (!pvs.empty()) {
+        Schedule(std::chrono::microseconds(0),
+                 [pvs = std::move(pvs), data = std::move(data)] {
+                     Notify(pvs, data);
+                 });
+    }
+    return true;
+}
+
+void LoopbackServer::Disconnect(const std::string& pv_name) {
+    Subscribers pvs;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = channels_.find(pv_name);
+        if (it == channels_.end() || !it->second.online) return;
+        it->second.online = false;
+        // Kept subscribed, to be connected again
+        pvs = TakeSubscribers(it->second);
+    }
+    if (pvs.empty()) return;
+
+    Schedule(std::chrono::microseconds(0), [pvs = std::move(pvs)] {
+        for (const auto& pv : pvs) pv->OnDisconnect();
+    });
+}
+
+LoopbackServer::Subscribers LoopbackServer::TakeSubscribers(
+    Channel& channel) {
+    Subscribers pvs;
+    auto& subscribers = channel.subscribers;
+    for (auto it = subscribers.begin(); it != subscribers.end();) {
+        if (auto pv = it->lock()) {
+            pvs.push_back(std::move(pv));
+            ++it;
+        } else {
+            it = subscribers.erase(it);
+        }
+    }
+    return pvs;
+}
+
+void LoopbackServer::Notify(const Subscribers& pvs, const PVData& data) {
+    for (const auto& pv : pvs) {
+        pv->OnMonitor(data);
+    }
+}
+
+// ---- LoopbackPV ----
+
+void LoopbackPV::SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder) {
+    recorder_id_ = recorder ? recorder->AddPV(pv_name_) : 0;
+    recorder_ = std::move(recorder);
+}
+
+void LoopbackPV::AddConnCB(ConnCallback cb) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    conn_cbs_.push_back(std::move(cb));
+}
+
+void LoopbackPV::Connect() {
+    if (connecting_.exchange(true)) return;
+
+    server_->Schedule(server_->Latency(), [self = weak_from_this()] {
+        auto pv = self.lock();
+        if (!pv) return;
+        // An unknown name stays disconnected, like a PV no IOC serves
+        if (auto data = pv->server_->Subscribe(pv->pv_name_, self)) {
+            pv->OnConnect(std::move(*data));
+        }
+    });
+}
+
+// The requests belong to the pools of the PV: a request whose PV is gone
+// is dropped with them
+bool LoopbackPV::DoGetCB(GetRequest* req, std::chrono::milliseconds, bool) {
+    if (!connected_) return false;
+
+    return server_->Schedule(
+        server_->Latency(), [self = weak_from_this(), req] {
+            auto pv = self.lock();
+            if (!pv) return;
+            pv->RecordFlight(FlightEvent::CAGet);
+            // Names are never removed once connected
+            if (auto data = pv->server_->Read(pv->pv_name_)) {
+                pv->CompleteGet(req, std::move(*data));
+            } else {
+                pv->FailGet(req, kRequestError);
+            }
+        });
+}
+
+bool LoopbackPV::DoPutCB(const PVScalarValue& v, PutRequest* req, bool) {
+    if (!connected_) return false;
+
+    return server_->Schedule(
+        server_->Latency(), [self = weak_from_this(), v, req]() mutable {
+            auto pv = self.lock();
+            if (!pv) return;
+            pv->RecordFlight(FlightEvent::CAPut);
+            // Fails if the channel went offline since the put was issued
+            const bool written =
+                pv->server_->Put(pv->pv_name_, ScalarData(std::move(v)));
+            // After the monitor updates posted by Put()
+            pv->server_->Schedule(std::chrono::microseconds(0),
+                                  [self, req, written] {
+                                      if (auto pv = self.lock()) {
+                                          pv->CompletePut(req, written);
+                                      }
+                                  });
+        });
+}
+
+void LoopbackPV::OnConnect(PVData data) {
+    connected_ = true;
+    RecordFlight(FlightEvent::CAConnect, 1);
+
+    std::vector<ConnCallback> cbs;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        cbs = conn_cbs_;
+    }
+    for (auto& cb : cbs) {
+        if (cb) cb(true);
+    }
+
+    // First monitor update, as CA sends on subscription
+    OnMonitor(data);
+}
+
+void LoopbackPV::OnDisconnect() {
+    connected_ = false;
+    RecordFlight(FlightEvent::CAConnect, 0);
+
+    std::vector<ConnCallback> cbs;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        cbs = conn_cbs_;
+    }
+    for (auto& cb : cbs) {
+        if (cb) cb(false);
+    }
+}
+
+void LoopbackPV::OnMonitor(const PVData& data) {
+    RecordFlight(FlightEvent::CAMonitor);
+    PublishMonitor(data);
+}
+
+// ---- LoopbackTransport ----
+
+LoopbackTransport::LoopbackTransport(LoopbackOptions options)
+    : server_(std::make_shared<LoopbackServer>(options)) {
+    server_->Start();
+}
+
+LoopbackTransport::~LoopbackTransport() { server_->Stop(); }
+
+std::shared_ptr<PV> LoopbackTransport::CreatePV(const std::string& pv_name) {
+    return std::make_shared<LoopbackPV>(server_, pv_name);
+}
+
+void LoopbackTransport::AddPV(const std::string& pv_name, PVData initial) {
+    server_->Write(pv_name, std::move(initial));
+}
+
+void LoopbackTransport::SetValue(const std::string& pv_name,
+                                 PVScalarValue value) {
+    server_->Write(pv_name, ScalarData(std::move(value)));
+}
+
+void LoopbackTransport::Disconnect(const std::string& pv_name) {
+    server_->Disconnect(pv_name);
+}
+
+std::optional<PVData> LoopbackTransport::GetValue(
+    const std::string& pv_name) const {
+    return server_->Read(pv_name);
+}
+
+}  // namespace bchtree::epics::loopback
@@ -0,0 +1,199 @@
+#include "epics/monitor_filter.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "epics/pv_names.h"
+
+namespace bchtree::epics {
+
+namespace {
+
+bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Next blank separated token of s, removed from s
+std::string_view NextToken(std::string_view& s) {
+    while (!s.empty() && IsBlank(s.front())) s.remove_prefix(1);
+    size_t end = 0;
+    while (end < s.size() && !IsBlank(s[end])) ++end;
+    const std::string_view token = s.substr(0, end);
+    s.remove_prefix(end);
+    return token;
+}
+
+double ParseNonNegative(std::string_view key, std::string_view text) {
+    const std::string str(text);
+    char* end = nullptr;
+    const double value = std::strtod(str.c_str(), &end);
+    if (str.empty() || *end != '\0' || !(value >= 0)) {
+        throw std::invalid_argument("malformed monitor option: " +
+                                    std::string(key) + "=" + str);
+    }
+    return value;
+}
+
+size_t ParseCount(std::string_view key, std::string_view text) {
+    const std::string str(text);
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(str.c_str(), &end, 10);
+    if (str.empty() || *end != '\0' || errno != 0 || str.front() == '-') {
+        throw std::invalid_argument("malformed monitor option: " +
+                                    std::string(key) + "=" + str);
+    }
+    return static_cast<size_t>(value);
+}
+
+uint32_t ParseEvents(std::string_view text) {
+    uint32_t events = 0;
+    while (!text.empty()) {
+        const size_t comma = text.find(',');
+        const std::string_view name = text.substr(0, comma);
+        if (name == "value") {
+            events |= kMonitorValue;
+        } else if (name == "log" || name == "archive") {
+            events |= kMonitorLog;
+        } else if (name == "alarm") {
+            events |= kMonitorAlarm;
+        } else if (name == "property") {
+            events |= kMonitorProperty;
+        } else {
+            throw std::invalid_argument("unknown monitor event: " +
+                                        std::string(name));
+        }
+        if (comma == std::string_view::npos) break;
+        text.remove_prefix(comma + 1);
+    }
+    if (events == 0) {
+        throw std::invalid_argument("monitor option events is empty");
+    }
+    return events;
+}
+
+}  // namespace
+
+bool MonitorOptions::operator==(const MonitorOptions& other) const {
+    return events == other.events && abs_deadband == other.abs_deadband &&
+           rel_deadband == other.rel_deadband &&
+           max_rate_hz == other.max_rate_hz &&
+           server_filter == other.server_filter &&
+           history == other.history;
+}
+
+MonitorFilter::MonitorFilter(const MonitorOptions& options)
+    : abs_deadband_(options.abs_deadband),
+      rel_deadband_(options.rel_deadband),
+      active_(options.abs_deadband > 0 || options.rel_deadband > 0 ||
+              options.max_rate_hz > 0) {
+    if (options.max_rate_hz > 0) {
+        min_interval_ = std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / options.max_rate_hz));
+    }
+}
+
+bool MonitorFilter::Accept(const PVData& data,
+                           std::chrono::steady_clock::time_point now) {
+    if (!active_) return true;
+
+    if (!has_last_ || data.meta.severity != last_severity_ ||
+        data.meta.status != last_status_) {
+        Remember(data, now);
+        return true;
+    }
+
+    if (now - last_time_ < min_interval_) return false;
+
+    const auto value = NumericScalar(data);
+    if (last_numeric_ && value) {
+        const double change = std::abs(*value - last_value_);
+        if (abs_deadband_ > 0 && change <= abs_deadband_) return false;
+        if (rel_deadband_ > 0 &&
+            change <= rel_deadband_ * std::abs(last_value_)) {
+            return false;
+        }
+    }
+
+    Remember(data, now);
+    return true;
+}
+
+void MonitorFilter::Remember(const PVData& data,
+                             std::chrono::steady_clock::time_point now) {
+    has_last_ = true;
+    const auto value = NumericScalar(data);
+    last_numeric_ = value.has_value();
+    last_value_ = value.value_or(0);
+    last_severity_ = data.meta.severity;
+    last_status_ = data.meta.status;
+    last_time_ = now;
+}
+
+MonitorOptions ParseMonitorOptions(std::string_view spec) {
+    MonitorOptions options;
+    for (auto token = NextToken(spec); !token.empty();
+         token = NextToken(spec)) {
+        const size_t eq = token.find('=');
+        if (eq == std::string_view::npos) {
+            throw std::invalid_argument("malformed monitor option: " +
+                                        std::string(token));
+        }
+        const std::string_view key = token.substr(0, eq);
+        const std::string_view value = token.substr(eq + 1);
+
+        if (key == "events") {
+            options.events = ParseEvents(value);
+        } else if (key == "deadband") {
+            options.abs_deadband = ParseNonNegative(key, value);
+        } else if (key == "rel_deadband") {
+            options.rel_deadband = ParseNonNegative(key, value);
+        } else if (key == "max_rate") {
+            options.max_rate_hz = ParseNonNegative(key, value);
+        } else if (key == "filter") {
+            options.server_filter = std::string(value);
+        } else if (key == "history") {
+            options.history = ParseCount(key, value);
+        } else {
+            throw std::invalid_argument("unknown monitor option: " +
+                                        std::string(key));
+        }
+    }
+    return options;
+}
+
+MonitorConfig ParseMonitorConfig(std::string_view text) {
+    MonitorConfig config;
+    while (!text.empty()) {
+        const size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size()
+                                                         : eol + 1);
+
+        line = line.substr(0, line.find('#'));
+        const std::string_view pv = NextToken(line);
+        if (pv.empty()) continue;
+
+        const MonitorOptions options = ParseMonitorOptions(line);
+        for (auto& name : ExpandPVNames(pv)) {
+            config.emplace_back(std::move(name), options);
+        }
+    }
+    return config;
+}
+
+MonitorConfig LoadMonitorConfig(const std::string& path) {
+    std::ifstream ifs(path);
+    if (!ifs) {
+        throw std::runtime_error("cannot open monitor config: " + path);
+    }
+
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return ParseMonitorConfig(oss.str());
+}
+
+}  // namespace bchtree::epics
@@ -0,0 +1,358 @@
+#include "epics/pv.h"
+
+#include <utility>
+
+namespace bchtree::epics {
+
+MonitorCallbackId PV::AddMonitorCB(MonitorCallback cb) {
+    std::lock_guard<std::mutex> lock(monitor_mtx_);
+    auto cbs = std::make_shared<
+        std::vector<std::pair<MonitorCallbackId, MonitorCallback>>>();
+    if (monitor_cbs_) *cbs = *monitor_cbs_;
+    const MonitorCallbackId id = ++last_monitor_id_;
+    cbs->emplace_back(id, std::move(cb));
+
+    std::atomic_store(&monitor_cbs_, decltype(monitor_cbs_)(std::move(cbs)));
+    return id;
+}
+
+void PV::RemoveMonitorCB(MonitorCallbackId id) {
+    std::lock_guard<std::mutex> lock(monitor_mtx_);
+    if (!monitor_cbs_) return;
+    auto cbs = std::make_shared<
+        std::vector<std::pair<MonitorCallbackId, MonitorCallback>>>();
+    cbs->reserve(monitor_cbs_->size());
+    for (const auto& entry : *monitor_cbs_) {
+        if (entry.first != id) cbs->push_back(entry);
+    }
+
+    std::atomic_store(&monitor_cbs_, decltype(monitor_cbs_)(std::move(cbs)));
+}
+
+void PV::SetMetrics(std::shared_ptr<PVMetrics> metrics) {
+    metrics_ = std::move(metrics);
+    if (!metrics_) return;
+    AddConnCB([metrics = metrics_](bool connected) {
+        auto& counter = connected ? metrics->connects : metrics->disconnects;
+        counter.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+bool PV::SetMonitorOptions(const MonitorOptions& options) {
+    MonitorOptions previous;
+    {
+        std::lock_guard<std::mutex> lock(options_mtx_);
+        if (monitor_options_ == options) return true;
+        previous = std::exchange(monitor_options_, options);
+    }
+
+    // A new filter starts without a last value: the next update passes
+    auto filter = std::make_shared<MonitorFilter>(options);
+    if (!filter->Active()) filter.reset();
+    std::atomic_store(&monitor_filter_, std::move(filter));
+    if (options.history > 0) EnableHistory(options.history);
+
+    if (options.events == previous.events &&
+        options.server_filter == previous.server_filter) {
+        return true;
+    }
+    return MonitorOptionsChanged(previous);
+}
+
+MonitorOptions PV::GetMonitorOptions() const {
+    std::lock_guard<std::mutex> lock(options_mtx_);
+    return monitor_options_;
+}
+
+MonitorCounters PV::MonitorCounts() const {
+    return {delivered_.load(std::memory_order_relaxed),
+            dropped_.load(std::memory_order_relaxed)};
+}
+
+std::shared_ptr<const std::vector<std::string>> PV::EnumStrings() const {
+    return std::atomic_load(&enum_strings_);
+}
+
+void PV::SetEnumStrings(std::vector<std::string> strings) {
+    std::atomic_store(&enum_strings_,
+                      std::shared_ptr<const std::vector<std::string>>(
+                          std::make_shared<std::vector<std::string>>(
+                              std::move(strings))));
+}
+
+void PV::ExpectArray() {
+    expect_array_.store(true, std::memory_order_relaxed);
+}
+
+bool PV::ArrayExpected() const {
+    return expect_array_.load(std::memory_order_relaxed);
+}
+
+void PV::DropMonitor() {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_) {
+        metrics_->monitor_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PV::EnableHistory(size_t capacity) {
+    std::lock_guard<std::mutex> lock(history_mtx_);
+    const auto current = std::atomic_load(&history_);
+    if (current && current->Capacity() >= capacity) return;
+    std::atomic_store(&history_, std::make_shared<PVHistory>(capacity));
+}
+
+std::shared_ptr<const PVHistory> PV::History() const {
+    return std::atomic_load(&history_);
+}
+
+std::shared_ptr<const PVSnapshot> PV::Snapshot() const {
+    return cache_.Load();
+}
+
+uint64_t PV::UpdateCount() const { return cache_.Version(); }
+
+bool PV::HasValue() const { return cache_.Version() > 0; }
+
+std::optional<double> PV::NumericValue() const {
+    const auto numeric = cache_.LoadNumeric();
+    if (!numeric) return std::nullopt;
+    // LoadNumeric holds no strings
+    return std::visit(
+        [](const auto& v) -> std::optional<double> {
+            if constexpr (std::is_arithmetic_v<std::decay_t<decltype(v)>>) {
+                return static_cast<double>(v);
+            } else {
+                return std::nullopt;
+            }
+        },
+        *numeric);
+}
+
+size_t PV::RequestContexts() const {
+    return get_requests_.Size() + put_requests_.Size();
+}
+
+uint64_t PV::DroppedErrors() const {
+    return dropped_errors_.load(std::memory_order_relaxed);
+}
+
+bool PV::Saturated() const {
+    return cancelled_in_flight_.load(std::memory_order_relaxed) >=
+           kMaxCancelledRequests;
+}
+
+bool PV::GetCB(GetCallback cb, std::chrono::milliseconds timeout,
+               ErrorCallback err_cb, bool flush, RequestHandle* handle) {
+    if (Saturated()) return false;
+
+    GetRequest* req = get_requests_.Acquire();
+    req->cb = std::move(cb);
+    req->err_cb = std::move(err_cb);
+    req->pv = this;
+    // Read before the backend may complete it
+    const uint64_t serial = req->serial;
+    if (metrics_) {
+        req->start = std::chrono::steady_clock::now();
+        metrics_->outstanding.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (DoGetCB(req, timeout, flush)) {
+        if (handle) *handle = {req, serial, false};
+        return true;
+    }
+
+    if (metrics_) {
+        metrics_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    }
+    get_requests_.Release(req, [](GetRequest& r) {
+        r.cb = nullptr;
+        r.err_cb = nullptr;
+        return true;
+    });
+    return false;
+}
+
+bool PV::PutCB(const PVScalarValue& v, PutCallback cb, bool flush,
+               RequestHandle* handle) {
+    if (Saturated()) return false;
+
+    PutRequest* req = put_requests_.Acquire();
+    req->cb = std::move(cb);
+    req->pv = this;
+    const uint64_t serial = req->serial;
+    if (metrics_) {
+        req->start = std::chrono::steady_clock::now();
+        metrics_->outstanding.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (DoPutCB(v, req, flush)) {
+        if (handle) *handle = {req, serial, true};
+        return true;
+    }
+
+    if (metrics_) {
+        metrics_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    }
+    put_requests_.Release(req, [](PutRequest& r) {
+        r.cb = nullptr;
+        return true;
+    });
+    return false;
+}
+
+bool PV::CancelRequest(const RequestHandle& handle) {
+    if (!handle) return false;
+
+    // Destroyed without the pool's lock
+    GetCallback cb;
+    ErrorCallback err_cb;
+    PutCallback put_cb;
+    bool cancelled;
+    if (handle.put) {
+        cancelled = put_requests_.IfCurrent(
+            static_cast<PutRequest*>(handle.request), handle.serial,
+            [&](PutRequest& r) {
+                if (r.cancelled) return false;
+                r.cancelled = true;
+                put_cb = std::move(r.cb);
+                return true;
+            });
+    } else {
+        cancelled = get_requests_.IfCurrent(
+            static_cast<GetRequest*>(handle.request), handle.serial,
+            [&](GetRequest& r) {
+                if (r.cancelled) return false;
+                r.cancelled = true;
+                cb = std::move(r.cb);
+                err_cb = std::move(r.err_cb);
+                return true;
+            });
+    }
+    if (!cancelled) return false;
+
+    cancelled_in_flight_.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_) {
+        metrics_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+        metrics_->cancelled.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+namespace {
+// What a completion takes out of its context before releasing it
+struct TakenGet {
+    GetCallback cb;
+    ErrorCallback err_cb;
+    std::chrono::steady_clock::time_point start;
+    bool cancelled;
+};
+
+struct TakenPut {
+    PutCallback cb;
+    std::chrono::steady_clock::time_point start;
+    bool cancelled;
+};
+}  // namespace
+
+void PV::CompleteGet(GetRequest* req, PVData data) {
+    // Released first, so that the callback may issue the next get with the
+    // same context
+    TakenGet taken = get_requests_.Release(req, [](GetRequest& r) {
+        TakenGet t{std::move(r.cb), std::move(r.err_cb), r.start,
+                   r.cancelled};
+        r.cancelled = false;
+        return t;
+    });
+    if (taken.cancelled) {
+        cancelled_in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (metrics_) {
+        metrics_->get_time.Record(std::chrono::steady_clock::now() -
+                                  taken.start);
+        metrics_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (taken.cb) taken.cb(std::move(data));
+}
+
+void PV::FailGet(GetRequest* req, int status) {
+    TakenGet taken = get_requests_.Release(req, [](GetRequest& r) {
+        TakenGet t{std::move(r.cb), std::move(r.err_cb), r.start,
+                   r.cancelled};
+        r.cancelled = false;
+        return t;
+    });
+    if (taken.cancelled) {
+        cancelled_in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (metrics_) {
+        metrics_->get_errors.fetch_add(1, std::memory_order_relaxed);
+        metrics_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    }
+    // Never throws on the callback thread
+    if (!taken.err_cb) {
+        dropped_errors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    taken.err_cb(status);
+}
+
+void PV::CompletePut(PutRequest* req, bool success) {
+    TakenPut taken = put_requests_.Release(req, [](PutRequest& r) {
+        TakenPut t{std::move(r.cb), r.start, r.cancelled};
+        r.cancelled = false;
+        return t;
+    });
+    if (taken.cancelled) {
+        cancelled_in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (metrics_) {
+        metrics_->put_time.Record(std::chrono::steady_clock::now() -
+                                  taken.start);
+        if (!success) {
+            metrics_->put_errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        metrics_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (taken.cb) taken.cb(success);
+}
+
+void PV::PublishMonitor(PVData data) {
+    const auto filter = std::atomic_load(&monitor_filter_);
+    if (filter && !filter->Accept(data, std::chrono::steady_clock::now())) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        if (metrics_) {
+            metrics_->monitor_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    delivered_.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_) {
+        metrics_->monitor_updates.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (auto history = std::atomic_load(&history_)) {
+        if (const auto value = NumericScalar(data)) {
+            history->Push({std::chrono::steady_clock::now(), *value});
+        }
+    }
+
+    // No lock on this path: the tick thread reads the cache concurrently
+    cache_.Publish(std::move(data));
+
+    const auto cbs = std::atomic_load(&monitor_cbs_);
+    if (!cbs) return;
+
+    const auto snapshot = cache_.Load();
+    for (auto& [id, cb] : *cbs) {
+        if (cb) cb(snapshot->data);
+    }
+}
+
+}  // namespace bchtree::epics
@@ -0,0 +1,149 @@
+#include "epics/pv_cache.h"
+
+#include <cstring>
+#include <utility>
+
+namespace bchtree::epics {
+
+namespace {
+
+template <typename T>
+uint64_t ToBits(T v) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &v, sizeof(T));
+    return bits;
+}
+
+template <typename T>
+T FromBits(uint64_t bits) {
+    T v;
+    std::memcpy(&v, &bits, sizeof(T));
+    return v;
+}
+
+template <size_t I>
+PVScalarValue MakeNumeric(uint64_t bits) {
+    using S = std::variant_alternative_t<I, PVScalarValue>;
+    static_assert(std::is_arithmetic_v<S>, "not a numeric alternative");
+    return PVScalarValue{std::in_place_index<I>, FromBits<S>(bits)};
+}
+
+}  // namespace
+
+uint64_t PVCache::Publish(PVData data) {
+    uint64_t bits = 0;
+    uint8_t index = kNotNumeric;
+    if (const auto* sv = std::get_if<PVScalarValue>(&data.value)) {
+        std::visit(
+            [&](const auto& v) {
+                using S = std::decay_t<decltype(v)>;
+                if constexpr (std::is_arithmetic_v<S>) {
+                    bits = ToBits(v);
+                    index = static_cast<uint8_t>(sv->index());
+                }
+            },
+            *sv);
+    }
+
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    const uint64_t version = seq / 2 + 1;
+
+    auto snapshot = TakeSpare();
+    if (snapshot) {
+        snapshot->data = std::move(data);
+        snapshot->version = version;
+    } else {
+        snapshot = std::make_shared<PVSnapshot>(
+            PVSnapshot{std::move(data), version});
+    }
+
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    numeric_bits_.store(bits, std::memory_order_relaxed);
+    numeric_index_.store(index, std::memory_order_relaxed);
+    std::atomic_store_explicit(
+        &snapshot_, std::shared_ptr<const PVSnapshot>(snapshot),
+        std::memory_order_release);
+
+    seq_.store(seq + 2, std::memory_order_release);
+
+    Retire(std::exchange(current_, std::move(snapshot)));
+    return version;
+}
+
+std::shared_ptr<PVSnapshot> PVCache::TakeSpare() {
+    for (auto& spare : spares_) {
+        // Unpublished, so no reader can take a new reference: a count of
+        // one stays one
+        if (spare && spare.use_count() == 1) {
+            // Pairs with the release of the last reader's reference
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return std::move(spare);
+        }
+    }
+    return nullptr;
+}
+
+void PVCache::Retire(std::shared_ptr<PVSnapshot> snapshot) {
+    if (!snapshot) return;
+    for (auto& spare : spares_) {
+        if (!spare) {
+            spare = std::move(snapshot);
+            return;
+        }
+    }
+    // All slots taken by snapshots readers still hold: let it go
+}
+
+std::shared_ptr<const PVSnapshot> PVCache::Load() const {
+    return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+}
+
+std::optional<PVScalarValue> PVCache::LoadNumeric() const {
+    uint64_t bits = 0;
+    uint8_t index = kNotNumeric;
+    bool consistent = false;
+
+    for (int i = 0; i < kMaxSeqRetries && !consistent; ++i) {
+        const uint64_t seq = seq_.load(std::memory_order_acquire);
+        if (seq & 1) continue;  // writer in progress
+
+        bits = numeric_bits_.load(std::memory_order_relaxed);
+        index = numeric_index_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        consistent = (seq_.load(std::memory_order_relaxed) == seq);
+    }
+
+    if (!consistent) {
+        // The writer was preempted mid-update: take the snapshot instead of
+        // spinning
+        const auto snapshot = Load();
+        if (!snapshot) return std::nullopt;
+        const auto* sv = std::get_if<PVScalarValue>(&snapshot->data.value);
+        if (!sv || std::holds_alternative<PVString>(*sv)) {
+            return std::nullopt;
+        }
+        return *sv;
+    }
+
+    switch (index) {
+        case 0:
+            return MakeNumeric<0>(bits);
+        case 1:
+            return MakeNumeric<1>(bits);
+        case 2:
+            return MakeNumeric<2>(bits);
+        case 3:
+            return MakeNumeric<3>(bits);
+        default:
+            return std::nullopt;
+    }
+}
+
+uint64_t PVCache::Version() const {
+    return seq_.load(std::memory_order_acquire) / 2;
+}
+
+}  // namespace bchtree::epics
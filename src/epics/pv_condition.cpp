@@ -0,0 +1,105 @@
+#include "epics/pv_condition.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace bchtree::epics {
+
+namespace {
+
+std::optional<double> AsNumber(const PVScalarValue& value) {
+    return NumericScalar(PVData{value, {}, 1});
+}
+
+std::string AsText(const PVScalarValue& value) {
+    return std::visit(
+        [](const auto& v) -> std::string {
+            using V = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<V, PVString>) {
+                return v.str();
+            } else if constexpr (std::is_floating_point_v<V>) {
+                // Same text as ParsePVScalar reads back, e.g. "1.5"
+                std::string text = std::to_string(v);
+                text.erase(text.find_last_not_of('0') + 1);
+                if (text.back() == '.') text.pop_back();
+                return text;
+            } else {
+                return std::to_string(v);
+            }
+        },
+        value);
+}
+
+}  // namespace
+
+PVCondition::Op PVCondition::ParseOp(std::string_view name) {
+    if (name == "eq" || name == "==") return Op::kEq;
+    if (name == "ne" || name == "!=") return Op::kNe;
+    if (name == "lt" || name == "<") return Op::kLt;
+    if (name == "le" || name == "<=") return Op::kLe;
+    if (name == "gt" || name == ">") return Op::kGt;
+    if (name == "ge" || name == ">=") return Op::kGe;
+    if (name == "within") return Op::kWithin;
+    if (name == "mask") return Op::kMask;
+    if (name == "state") return Op::kState;
+    throw std::invalid_argument("unknown condition: " + std::string(name));
+}
+
+PVCondition::PVCondition(Op op, PVScalarValue operand, double tolerance,
+                         uint32_t mask)
+    : op_(op), operand_(std::move(operand)), tolerance_(tolerance),
+      mask_(mask) {
+    if (op_ == Op::kState || op_ == Op::kEq || op_ == Op::kNe) return;
+    if (!AsNumber(operand_)) {
+        throw std::invalid_argument("condition needs a numeric operand: " +
+                                    AsText(operand_));
+    }
+}
+
+bool PVCondition::Matches(const PVData& data,
+                          const std::vector<std::string>* states) const {
+    const auto* scalar = std::get_if<PVScalarValue>(&data.value);
+    if (!scalar) return false;
+
+    if (op_ == Op::kState) {
+        const std::string operand = AsText(operand_);
+        const auto* index = std::get_if<uint16_t>(scalar);
+        if (index && states && *index < states->size() &&
+            (*states)[*index] == operand) {
+            return true;
+        }
+        return AsText(*scalar) == operand;
+    }
+
+    const auto value = AsNumber(*scalar);
+    const auto operand = AsNumber(operand_);
+    if (op_ == Op::kEq || op_ == Op::kNe) {
+        const bool equal = (value && operand)
+                               ? *value == *operand
+                               : AsText(*scalar) == AsText(operand_);
+        return equal == (op_ == Op::kEq);
+    }
+    if (!value) return false;
+
+    switch (op_) {
+        case Op::kLt:
+            return *value < *operand;
+        case Op::kLe:
+            return *value <= *operand;
+        case Op::kGt:
+            return *value > *operand;
+        case Op::kGe:
+            return *value >= *operand;
+        case Op::kWithin:
+            return std::abs(*value - *operand) <= tolerance_;
+        case Op::kMask: {
+            const auto bits = static_cast<uint32_t>(std::llround(*value));
+            const auto want = static_cast<uint32_t>(std::llround(*operand));
+            return (bits & mask_) == (want & mask_);
+        }
+        default:
+            return false;
+    }
+}
+
+}  // namespace bchtree::epics
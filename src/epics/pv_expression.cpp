@@ -0,0 +1,472 @@
+#include "epics/pv_expression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace bchtree::epics {
+
+namespace {
+
+bool IsNameStart(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool IsNameChar(char c) { return IsNameStart(c) || c == ':' || c == '.'; }
+
+}  // namespace
+
+// Recursive descent over the grammar in pv_expression.h, emitting the
+// program in postfix order
+class PVExpressionParser {
+   public:
+    using Op = PVExpression::Op;
+
+    explicit PVExpressionParser(std::string_view text) : text_(text) {
+        expr_.text_ = std::string(text);
+    }
+
+    PVExpression Parse() {
+        next();
+        conditional();
+        if (kind_ != Kind::kEnd) fail("unexpected '" + token_ + "'");
+        checkStack();
+        return std::move(expr_);
+    }
+
+   private:
+    enum class Kind { kEnd, kNumber, kName, kSymbol };
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::invalid_argument("expression: " + what + " at column " +
+                                    std::to_string(token_pos_ + 1) + " of " +
+                                    std::string(text_));
+    }
+
+    void next() {
+        while (pos_ < text_.size() &&
+               std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            ++pos_;
+        }
+        token_pos_ = pos_;
+        if (pos_ == text_.size()) {
+            kind_ = Kind::kEnd;
+            token_ = "end";
+            return;
+        }
+
+        const char c = text_[pos_];
+        if (c == '\'') {
+            const size_t close = text_.find('\'', pos_ + 1);
+            if (close == std::string_view::npos || close == pos_ + 1) {
+                fail("unterminated or empty quoted name");
+            }
+            kind_ = Kind::kName;
+            token_ = std::string(text_.substr(pos_ + 1, close - pos_ - 1));
+            pos_ = close + 1;
+            return;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            // A number unless name characters follow, e.g. 13BMD:m1
+            const std::string rest(text_.substr(pos_));
+            char* end = nullptr;
+            const double value = std::strtod(rest.c_str(), &end);
+            const size_t length = static_cast<size_t>(end - rest.c_str());
+            if (length > 0 &&
+                (length == rest.size() || !IsNameChar(rest[length]))) {
+                kind_ = Kind::kNumber;
+                number_ = value;
+                token_ = rest.substr(0, length);
+                pos_ += length;
+                return;
+            }
+        }
+
+        if (IsNameStart(c)) {
+            const size_t start = pos_;
+            while (pos_ < text_.size() && IsNameChar(text_[pos_])) ++pos_;
+            token_ = std::string(text_.substr(start, pos_ - start));
+            kind_ = Kind::kName;
+            if (token_ == "and") token_ = "&&";
+            if (token_ == "or") token_ = "||";
+            if (token_ == "not") token_ = "!";
+            if (token_ == "&&" || token_ == "||" || token_ == "!") {
+                kind_ = Kind::kSymbol;
+            }
+            return;
+        }
+
+        static constexpr std::string_view kTwoChar[] = {"<=", ">=", "==",
+                                                        "!=", "&&", "||"};
+        kind_ = Kind::kSymbol;
+        for (auto symbol : kTwoChar) {
+            if (text_.substr(pos_, 2) == symbol) {
+                token_ = std::string(symbol);
+                pos_ += 2;
+                return;
+            }
+        }
+        if (std::string_view("+-*/%<>!?:(),").find(c) ==
+            std::string_view::npos) {
+            fail(std::string("unexpected '") + c + "'");
+        }
+        token_ = std::string(1, c);
+        ++pos_;
+    }
+
+    bool accept(std::string_view symbol) {
+        if (kind_ != Kind::kSymbol || token_ != symbol) return false;
+        next();
+        return true;
+    }
+
+    void expect(std::string_view symbol) {
+        if (!accept(symbol)) {
+            fail("expected '" + std::string(symbol) + "' instead of '" +
+                 token_ + "'");
+        }
+    }
+
+    void conditional() {
+        logicalOr();
+        if (!accept("?")) return;
+        conditional();
+        expect(":");
+        conditional();
+        emit(Op::kSelect);
+    }
+
+    void logicalOr() {
+        logicalAnd();
+        while (accept("||")) {
+            logicalAnd();
+            emit(Op::kOr);
+        }
+    }
+
+    void logicalAnd() {
+        equality();
+        while (accept("&&")) {
+            equality();
+            emit(Op::kAnd);
+        }
+    }
+
+    void equality() {
+        relational();
+        while (true) {
+            Op op;
+            if (accept("==")) {
+                op = Op::kEq;
+            } else if (accept("!=")) {
+                op = Op::kNe;
+            } else {
+                return;
+            }
+            relational();
+            emit(op);
+        }
+    }
+
+    void relational() {
+        additive();
+        while (true) {
+            Op op;
+            if (accept("<")) {
+                op = Op::kLt;
+            } else if (accept("<=")) {
+                op = Op::kLe;
+            } else if (accept(">")) {
+                op = Op::kGt;
+            } else if (accept(">=")) {
+                op = Op::kGe;
+            } else {
+                return;
+            }
+            additive();
+            emit(op);
+        }
+    }
+
+    void additive() {
+        multiplicative();
+        while (true) {
+            Op op;
+            if (accept("+")) {
+                op = Op::kAdd;
+            } else if (accept("-")) {
+                op = Op::kSub;
+            } else {
+                return;
+            }
+            multiplicative();
+            emit(op);
+        }
+    }
+
+    void multiplicative() {
+        unary();
+        while (true) {
+            Op op;
+            if (accept("*")) {
+                op = Op::kMul;
+            } else if (accept("/")) {
+                op = Op::kDiv;
+            } else if (accept("%")) {
+                op = Op::kMod;
+            } else {
+                return;
+            }
+            unary();
+            emit(op);
+        }
+    }
+
+    void unary() {
+        if (accept("-")) {
+            unary();
+            emit(Op::kNeg);
+        } else if (accept("!")) {
+            unary();
+            emit(Op::kNot);
+        } else if (accept("+")) {
+            unary();
+        } else {
+            primary();
+        }
+    }
+
+    void primary() {
+        if (kind_ == Kind::kNumber) {
+            emitConst(number_);
+            next();
+            return;
+        }
+        if (kind_ == Kind::kName) {
+            std::string name = std::move(token_);
+            next();
+            if (accept("(")) {
+                function(name);
+            } else {
+                load(std::move(name));
+            }
+            return;
+        }
+        if (accept("(")) {
+            conditional();
+            expect(")");
+            return;
+        }
+        fail("expected a value instead of '" + token_ + "'");
+    }
+
+    void function(const std::string& name) {
+        struct Function {
+            std::string_view name;
+            Op op;
+            int arity;
+        };
+        static constexpr Function kFunctions[] = {
+            {"abs", Op::kAbs, 1},     {"sqrt", Op::kSqrt, 1},
+            {"exp", Op::kExp, 1},     {"log", Op::kLog, 1},
+            {"floor", Op::kFloor, 1}, {"ceil", Op::kCeil, 1},
+            {"min", Op::kMin, 2},     {"max", Op::kMax, 2},
+            {"pow", Op::kPow, 2},
+        };
+        const auto it =
+            std::find_if(std::begin(kFunctions), std::end(kFunctions),
+                         [&](const Function& f) { return f.name == name; });
+        if (it == std::end(kFunctions)) fail("unknown function " + name);
+
+        for (int i = 0; i < it->arity; ++i) {
+            if (i > 0) expect(",");
+            conditional();
+        }
+        expect(")");
+        emit(it->op);
+    }
+
+    void load(std::string name) {
+        auto& names = expr_.names_;
+        const auto it = std::find(names.begin(), names.end(), name);
+        const auto index = static_cast<uint32_t>(it - names.begin());
+        if (it == names.end()) names.push_back(std::move(name));
+        expr_.program_.push_back({Op::kLoad, index, 0});
+    }
+
+    void emitConst(double value) {
+        expr_.program_.push_back({Op::kConst, 0, value});
+    }
+
+    // Fold op into a constant when all its operands are constants
+    void emit(Op op) {
+        auto& program = expr_.program_;
+        const size_t arity = Arity(op);
+        const bool constant = std::all_of(
+            program.end() - static_cast<std::ptrdiff_t>(arity), program.end(),
+            [](const PVExpression::Instr& i) { return i.op == Op::kConst; });
+        program.push_back({op, 0, 0});
+        if (!constant) return;
+
+        PVExpression folded;
+        folded.program_.assign(
+            program.end() - static_cast<std::ptrdiff_t>(arity + 1),
+            program.end());
+        const double value = folded.Evaluate(nullptr);
+        program.resize(program.size() - arity - 1);
+        emitConst(value);
+    }
+
+    static size_t Arity(Op op) {
+        switch (op) {
+            case Op::kConst:
+            case Op::kLoad:
+                return 0;
+            case Op::kNeg:
+            case Op::kNot:
+            case Op::kAbs:
+            case Op::kSqrt:
+            case Op::kExp:
+            case Op::kLog:
+            case Op::kFloor:
+            case Op::kCeil:
+                return 1;
+            case Op::kSelect:
+                return 3;
+            default:
+                return 2;
+        }
+    }
+
+    void checkStack() {
+        size_t depth = 0;
+        for (const auto& instr : expr_.program_) {
+            depth = depth - Arity(instr.op) + 1;
+            if (depth > PVExpression::kMaxStack) {
+                throw std::invalid_argument("expression too deeply nested: " +
+                                            std::string(text_));
+            }
+        }
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    size_t token_pos_ = 0;
+    Kind kind_ = Kind::kEnd;
+    std::string token_;
+    double number_ = 0;
+    PVExpression expr_;
+};
+
+PVExpression PVExpression::Compile(std::string_view text) {
+    return PVExpressionParser(text).Parse();
+}
+
+double PVExpression::Evaluate(const double* values) const {
+    if (program_.empty()) return std::numeric_limits<double>::quiet_NaN();
+
+    double stack[kMaxStack];
+    double* top = stack;  // one past the last operand
+
+    for (const Instr& instr : program_) {
+        switch (instr.op) {
+            case Op::kConst:
+                *top++ = instr.constant;
+                break;
+            case Op::kLoad:
+                *top++ = values[instr.index];
+                break;
+            case Op::kNeg:
+                top[-1] = -top[-1];
+                break;
+            case Op::kNot:
+                top[-1] = IsTrue(top[-1]) ? 0 : 1;
+                break;
+            case Op::kAbs:
+                top[-1] = std::abs(top[-1]);
+                break;
+            case Op::kSqrt:
+                top[-1] = std::sqrt(top[-1]);
+                break;
+            case Op::kExp:
+                top[-1] = std::exp(top[-1]);
+                break;
+            case Op::kLog:
+                top[-1] = std::log(top[-1]);
+                break;
+            case Op::kFloor:
+                top[-1] = std::floor(top[-1]);
+                break;
+            case Op::kCeil:
+                top[-1] = std::ceil(top[-1]);
+                break;
+            case Op::kSelect:
+                top -= 2;
+                top[-1] = IsTrue(top[-1]) ? top[0] : top[1];
+                break;
+            default: {
+                const double b = *--top;
+                double& a = top[-1];
+                switch (instr.op) {
+                    case Op::kAdd:
+                        a += b;
+                        break;
+                    case Op::kSub:
+                        a -= b;
+                        break;
+                    case Op::kMul:
+                        a *= b;
+                        break;
+                    case Op::kDiv:
+                        a /= b;
+                        break;
+                    case Op::kMod:
+                        a = std::fmod(a, b);
+                        break;
+                    case Op::kMin:
+                        a = std::min(a, b);
+                        break;
+                    case Op::kMax:
+                        a = std::max(a, b);
+                        break;
+                    case Op::kPow:
+                        a = std::pow(a, b);
+                        break;
+                    case Op::kLt:
+                        a = a < b;
+                        break;
+                    case Op::kLe:
+                        a = a <= b;
+                        break;
+                    case Op::kGt:
+                        a = a > b;
+                        break;
+                    case Op::kGe:
+                        a = a >= b;
+                        break;
+                    case Op::kEq:
+                        a = a == b;
+                        break;
+                    case Op::kNe:
+                        a = a != b;
+                        break;
+                    case Op::kAnd:
+                        a = IsTrue(a) && IsTrue(b);
+                        break;
+                    case Op::kOr:
+                        a = IsTrue(a) || IsTrue(b);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+    return stack[0];
+}
+
+}  // namespace bchtree::epics
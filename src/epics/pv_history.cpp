@@ -0,0 +1,131 @@
+#include "epics/pv_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace bchtree::epics {
+
+PVHistory::PVHistory(size_t capacity)
+    : since_(std::chrono::steady_clock::now()), buffer_(capacity) {
+    if (capacity == 0) {
+        throw std::invalid_argument("PVHistory: capacity must be positive");
+    }
+}
+
+void PVHistory::Push(const PVSample& sample) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    buffer_[next_ % buffer_.size()] = sample;
+    ++next_;
+}
+
+uint64_t PVHistory::Sequence() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return next_;
+}
+
+uint64_t PVHistory::ReadSince(uint64_t from,
+                              std::vector<PVSample>& out) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const uint64_t oldest =
+        next_ > buffer_.size() ? next_ - buffer_.size() : 0;
+    for (uint64_t seq = std::max(from, oldest); seq < next_; ++seq) {
+        out.push_back(buffer_[seq % buffer_.size()]);
+    }
+    return next_;
+}
+
+WindowStats WindowStats::OverTime(std::chrono::steady_clock::duration span) {
+    if (span <= std::chrono::steady_clock::duration::zero()) {
+        throw std::invalid_argument("WindowStats: span must be positive");
+    }
+    return WindowStats(span, 0);
+}
+
+WindowStats WindowStats::OverCount(size_t count) {
+    if (count == 0) {
+        throw std::invalid_argument("WindowStats: count must be positive");
+    }
+    return WindowStats(std::chrono::steady_clock::duration::zero(), count);
+}
+
+void WindowStats::Add(const PVSample& sample) {
+    if (samples_.empty()) {
+        shift_ = sample.value;
+        sum_ = 0;
+        sum_sq_ = 0;
+    }
+
+    const uint64_t seq = front_seq_ + samples_.size();
+    samples_.push_back(sample);
+
+    const double d = sample.value - shift_;
+    sum_ += d;
+    sum_sq_ += d * d;
+
+    while (!min_.empty() && min_.back().value >= sample.value) {
+        min_.pop_back();
+    }
+    min_.push_back({seq, sample.value});
+    while (!max_.empty() && max_.back().value <= sample.value) {
+        max_.pop_back();
+    }
+    max_.push_back({seq, sample.value});
+
+    if (count_ > 0 && samples_.size() > count_) PopFront();
+}
+
+void WindowStats::Expire(std::chrono::steady_clock::time_point now) {
+    if (count_ > 0) return;
+    while (!samples_.empty() && now - samples_.front().time > span_) {
+        PopFront();
+    }
+}
+
+void WindowStats::Clear() {
+    front_seq_ += samples_.size();
+    samples_.clear();
+    min_.clear();
+    max_.clear();
+}
+
+void WindowStats::PopFront() {
+    const double d = samples_.front().value - shift_;
+    sum_ -= d;
+    sum_sq_ -= d * d;
+
+    if (min_.front().seq == front_seq_) min_.pop_front();
+    if (max_.front().seq == front_seq_) max_.pop_front();
+    samples_.pop_front();
+    ++front_seq_;
+}
+
+double WindowStats::Mean() const {
+    return shift_ + sum_ / static_cast<double>(samples_.size());
+}
+
+double WindowStats::Stddev() const {
+    const size_t n = samples_.size();
+    if (n < 2) return 0;
+    const double variance =
+        (sum_sq_ - sum_ * sum_ / static_cast<double>(n)) /
+        static_cast<double>(n - 1);
+    // Rounding can leave a tiny negative variance
+    return std::sqrt(std::max(variance, 0.0));
+}
+
+double WindowStats::Rate() const {
+    using Seconds = std::chrono::duration<double>;
+    if (count_ == 0) {
+        return static_cast<double>(samples_.size()) /
+               std::chrono::duration_cast<Seconds>(span_).count();
+    }
+    if (samples_.size() < 2) return 0;
+    const double elapsed = std::chrono::duration_cast<Seconds>(
+                               samples_.back().time - samples_.front().time)
+                               .count();
+    return elapsed > 0 ? static_cast<double>(samples_.size() - 1) / elapsed
+                       : 0;
+}
+
+}  // namespace bchtree::epics
@@ -0,0 +1,308 @@
+#include "epics/pv_manager.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <stdexcept>
+
+#include "epics/pv_names.h"
+
+namespace bchtree::epics {
+
+size_t PVManager::ShardIndex(std::string_view pv_name) {
+    return std::hash<std::string_view>{}(pv_name) % kShardCount;
+}
+
+std::shared_ptr<PVRegistryEntry> PVManager::FindOrInsert(
+    std::string_view pv_name) {
+    Shard& shard = shards_[ShardIndex(pv_name)];
+
+    // Read-mostly: existing names only take the shared lock
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.entries.find(pv_name);
+        if (it != shard.entries.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.entries.find(pv_name);
+    if (it != shard.entries.end()) return it->second;
+
+    auto entry = std::make_shared<PVRegistryEntry>(pv_name);
+    shard.entries.emplace(std::string_view(entry->name), entry);
+    return entry;
+}
+
+PVTransport* PVManager::TransportFor(std::string_view scheme) const {
+    if (scheme.empty()) return transport_.get();
+    for (const auto& [name, transport] : scheme_transports_) {
+        if (name == scheme) return transport.get();
+    }
+    return nullptr;
+}
+
+void PVManager::AddTransport(std::string scheme,
+                             std::shared_ptr<PVTransport> transport) {
+    scheme_transports_.emplace_back(std::move(scheme), std::move(transport));
+}
+
+bool PVManager::Serves(std::string_view pv_name) const {
+    return TransportFor(SplitPVScheme(pv_name).first) != nullptr;
+}
+
+std::shared_ptr<PV> PVManager::Resolve(PVRegistryEntry& entry) {
+    std::lock_guard<std::mutex> lock(entry.mtx);
+    std::shared_ptr<PV> pv = entry.pv.lock();
+    if (!pv) {
+        // First use or expired -> recreate
+        const auto [scheme, channel] = SplitPVScheme(entry.name);
+        PVTransport* transport = TransportFor(scheme);
+        if (!transport) {
+            throw std::invalid_argument("PVManager: no transport for " +
+                                        entry.name);
+        }
+        pv = transport->CreatePV(std::string(channel));
+        pv->AddConnCB([events = conn_events_](bool) {
+            std::lock_guard<std::mutex> lock(events->mtx);
+            ++events->count;
+            events->cv.notify_all();
+        });
+        pv->SetMaxElements(max_array_elements_.load());
+        if (auto recorder = std::atomic_load(&recorder_)) {
+            pv->SetFlightRecorder(std::move(recorder));
+        }
+        if (auto metrics = std::atomic_load(&metrics_)) {
+            pv->SetMetrics(metrics->ForPV(entry.name));
+        }
+        {
+            std::lock_guard<std::mutex> options_lock(monitor_options_mtx_);
+            auto it = monitor_options_.find(entry.name);
+            if (it != monitor_options_.end()) {
+                pv->SetMonitorOptions(it->second);
+            }
+        }
+        entry.pv = pv;
+    }
+    return pv;
+}
+
+std::shared_ptr<PV> PVManager::Get(std::string_view pv_name) {
+    return Resolve(*FindOrInsert(pv_name));
+}
+
+std::shared_ptr<PV> PVManager::Get(const PVHandle& handle) {
+    if (!handle) {
+        throw std::invalid_argument("PVManager: empty PV handle");
+    }
+    // A removed entry is no longer in the registry, go through the name so
+    // that the handle keeps working
+    if (handle.entry_->removed.load(std::memory_order_acquire)) {
+        return Get(handle.name());
+    }
+    return Resolve(*handle.entry_);
+}
+
+std::shared_ptr<PV> PVManager::Find(std::string_view pv_name) const {
+    std::shared_ptr<PVRegistryEntry> entry;
+    {
+        const Shard& shard = shards_[ShardIndex(pv_name)];
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.entries.find(pv_name);
+        if (it == shard.entries.end()) return nullptr;
+        entry = it->second;
+    }
+    std::lock_guard<std::mutex> lock(entry->mtx);
+    return entry->pv.lock();
+}
+
+std::vector<std::shared_ptr<PV>> PVManager::GetMany(
+    const std::vector<std::string>& pv_names) {
+    std::vector<std::shared_ptr<PVRegistryEntry>> entries(pv_names.size());
+
+    // Group the names by shard
+    std::array<std::vector<size_t>, kShardCount> by_shard;
+    for (size_t i = 0; i < pv_names.size(); ++i) {
+        by_shard[ShardIndex(pv_names[i])].push_back(i);
+    }
+
+    for (size_t s = 0; s < kShardCount; ++s) {
+        if (by_shard[s].empty()) continue;
+
+        Shard& shard = shards_[s];
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        for (size_t i : by_shard[s]) {
+            const std::string& name = pv_names[i];
+            auto it = shard.entries.find(name);
+            if (it == shard.entries.end()) {
+                auto entry = std::make_shared<PVRegistryEntry>(name);
+                it = shard.entries
+                         .emplace(std::string_view(entry->name), entry)
+                         .first;
+            }
+            entries[i] = it->second;
+        }
+    }
+
+    std::vector<std::shared_ptr<PV>> pvs;
+    pvs.reserve(entries.size());
+    for (auto& entry : entries) {
+        pvs.push_back(Resolve(*entry));
+    }
+    return pvs;
+}
+
+std::vector<std::string> PVManager::ConnectAll(
+    const std::vector<std::shared_ptr<PV>>& pvs,
+    std::chrono::milliseconds timeout) {
+    ConnEvents& events = *conn_events_;
+    for (const auto& pv : pvs) pv->Connect();
+    Flush();
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto all_connected = [&pvs] {
+        return std::all_of(pvs.begin(), pvs.end(),
+                           [](const auto& pv) { return pv->IsConnected(); });
+    };
+
+    // IsConnected() may take the PV lock, which the callback thread can hold
+    // while it calls our callback, so never check it with events.mtx held
+    while (true) {
+        uint64_t seen;
+        {
+            std::lock_guard<std::mutex> lock(events.mtx);
+            seen = events.count;
+        }
+        if (all_connected()) break;
+
+        std::unique_lock<std::mutex> lock(events.mtx);
+        if (!events.cv.wait_until(lock, deadline,
+                                  [&] { return events.count != seen; })) {
+            break;
+        }
+    }
+
+    std::vector<std::string> missing;
+    for (const auto& pv : pvs) {
+        if (!pv->IsConnected()) missing.push_back(pv->GetPVname());
+    }
+    return missing;
+}
+
+void PVManager::Attach() {
+    transport_->Attach();
+    for (auto& [scheme, transport] : scheme_transports_) {
+        if (transport != transport_) transport->Attach();
+    }
+}
+
+void PVManager::Flush() {
+    transport_->Flush();
+    for (auto& [scheme, transport] : scheme_transports_) {
+        if (transport != transport_) transport->Flush();
+    }
+}
+
+PVHandle PVManager::Intern(std::string_view pv_name) {
+    return PVHandle(FindOrInsert(pv_name));
+}
+
+void PVManager::SetMaxArrayElements(size_t max_elements) {
+    max_array_elements_ = max_elements;
+}
+
+void PVManager::SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder) {
+    std::atomic_store(&recorder_, std::move(recorder));
+}
+
+void PVManager::SetMetrics(std::shared_ptr<MetricsRegistry> metrics) {
+    std::atomic_store(&metrics_, std::move(metrics));
+}
+
+bool PVManager::SetMonitorOptions(std::string_view pv_name,
+                                  const MonitorOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(monitor_options_mtx_);
+        auto it = monitor_options_.find(pv_name);
+        if (it != monitor_options_.end()) {
+            it->second = options;
+        } else {
+            monitor_options_.emplace(std::string(pv_name), options);
+        }
+    }
+    // Outside the lock, which Resolve() takes under the entry lock. A PV
+    // created meanwhile already has the options.
+    if (auto pv = Find(pv_name)) return pv->SetMonitorOptions(options);
+    return true;
+}
+
+void PVManager::Remove(std::string_view pv_name) {
+    Shard& shard = shards_[ShardIndex(pv_name)];
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.entries.find(pv_name);
+    if (it == shard.entries.end()) return;
+
+    it->second->removed = true;
+    shard.entries.erase(it);
+}
+
+void PVManager::Shutdown() {
+    // Keep it simple: just clear the registry.
+    // PV instances will be destroyed when all external shared_ptrs are
+    // released.
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        for (auto& [name, entry] : shard.entries) {
+            entry->removed = true;
+        }
+        shard.entries.clear();
+    }
+}
+
+size_t PVManager::RegistrySize() const {
+    size_t size = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+MonitorCounters PVManager::MonitorCounts() const {
+    MonitorCounters total;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto& [name, entry] : shard.entries) {
+            std::shared_ptr<PV> pv;
+            {
+                std::lock_guard<std::mutex> entry_lock(entry->mtx);
+                pv = entry->pv.lock();
+            }
+            if (!pv) continue;
+            const auto counts = pv->MonitorCounts();
+            total.delivered += counts.delivered;
+            total.dropped += counts.dropped;
+        }
+    }
+    return total;
+}
+
+size_t PVManager::CollectGarbage() {
+    size_t erased = 0;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            PVRegistryEntry& entry = *it->second;
+            std::lock_guard<std::mutex> entry_lock(entry.mtx);
+            if (entry.pv.expired()) {
+                entry.removed = true;
+                it = shard.entries.erase(it);
+                ++erased;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return erased;
+}
+
+}  // namespace bchtree::epics
@@ -0,0 +1,178 @@
+#include "epics/pv_names.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace bchtree::epics {
+
+namespace {
+
+bool IsSeparator(char c) {
+    return c == ';' || std::isspace(static_cast<unsigned char>(c));
+}
+
+bool IsInteger(std::string_view s) {
+    if (s.empty()) return false;
+    size_t i = (s[0] == '-') ? 1 : 0;
+    if (i == s.size()) return false;
+    for (; i < s.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
+    }
+    return true;
+}
+
+// Find the '}' matching the '{' at open_pos
+size_t FindClosingBrace(std::string_view s, size_t open_pos) {
+    int depth = 0;
+    for (size_t i = open_pos; i < s.size(); ++i) {
+        if (s[i] == '{') ++depth;
+        if (s[i] == '}' && --depth == 0) return i;
+    }
+    throw std::invalid_argument("unbalanced '{' in PV pattern: " +
+                                std::string(s));
+}
+
+// Expand "lo..hi" (zero padded when either end has a leading zero)
+bool ExpandRange(std::string_view inner, std::vector<std::string>& out) {
+    const size_t dots = inner.find("..");
+    if (dots == std::string_view::npos) return false;
+
+    const std::string_view lo_str = inner.substr(0, dots);
+    const std::string_view hi_str = inner.substr(dots + 2);
+    if (!IsInteger(lo_str) || !IsInteger(hi_str)) return false;
+
+    const long lo = std::strtol(std::string(lo_str).c_str(), nullptr, 10);
+    const long hi = std::strtol(std::string(hi_str).c_str(), nullptr, 10);
+    // Unsigned, so that the difference can't overflow
+    const auto ulo = static_cast<unsigned long>(lo);
+    const auto uhi = static_cast<unsigned long>(hi);
+    const unsigned long span = lo <= hi ? uhi - ulo : ulo - uhi;
+    if (span >= kMaxExpandedNames) {
+        throw std::invalid_argument("PV pattern expands to more than " +
+                                    std::to_string(kMaxExpandedNames) +
+                                    " names: {" + std::string(inner) + "}");
+    }
+
+    const bool padded = (lo_str.size() > 1 && lo_str[0] == '0') ||
+                        (hi_str.size() > 1 && hi_str[0] == '0');
+    const size_t width = padded ? std::max(lo_str.size(), hi_str.size()) : 0;
+
+    const long step = (lo <= hi) ? 1 : -1;
+    for (long i = lo;; i += step) {
+        std::string num = std::to_string(i);
+        if (num.size() < width) num.insert(0, width - num.size(), '0');
+        out.push_back(std::move(num));
+        if (i == hi) break;
+    }
+    return true;
+}
+
+// Split "a,b,{c,d}" on top-level commas
+std::vector<std::string> SplitAlternatives(std::string_view inner) {
+    std::vector<std::string> alts;
+    int depth = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < inner.size(); ++i) {
+        if (inner[i] == '{') ++depth;
+        if (inner[i] == '}') --depth;
+        if (inner[i] == ',' && depth == 0) {
+            alts.emplace_back(inner.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    alts.emplace_back(inner.substr(start));
+    return alts;
+}
+
+void ExpandOne(std::string_view name, std::vector<std::string>& out) {
+    const size_t open = name.find('{');
+    if (open == std::string_view::npos) {
+        if (name.find('}') != std::string_view::npos) {
+            throw std::invalid_argument("unbalanced '}' in PV pattern: " +
+                                        std::string(name));
+        }
+        if (out.size() >= kMaxExpandedNames) {
+            throw std::invalid_argument("PV names expand to more than " +
+                                        std::to_string(kMaxExpandedNames) +
+                                        " names");
+        }
+        out.emplace_back(name);
+        return;
+    }
+
+    const size_t close = FindClosingBrace(name, open);
+    const std::string_view prefix = name.substr(0, open);
+    const std::string_view inner = name.substr(open + 1, close - open - 1);
+    const std::string_view suffix = name.substr(close + 1);
+
+    std::vector<std::string> parts;
+    if (!ExpandRange(inner, parts)) {
+        for (const auto& alt : SplitAlternatives(inner)) {
+            ExpandOne(alt, parts);
+        }
+    }
+
+    for (const auto& part : parts) {
+        std::string expanded;
+        expanded.reserve(prefix.size() + part.size() + suffix.size());
+        expanded.append(prefix).append(part).append(suffix);
+        ExpandOne(expanded, out);
+    }
+}
+
+}  // namespace
+
+std::vector<std::string> ExpandPVNames(std::string_view spec) {
+    std::vector<std::string> names;
+
+    size_t i = 0;
+    while (i < spec.size()) {
+        while (i < spec.size() && IsSeparator(spec[i])) ++i;
+        if (i == spec.size()) break;
+
+        // A token ends at a separator outside of braces
+        size_t j = i;
+        int depth = 0;
+        while (j < spec.size() && (depth > 0 || !IsSeparator(spec[j]))) {
+            if (spec[j] == '{') ++depth;
+            if (spec[j] == '}') --depth;
+            ++j;
+        }
+
+        ExpandOne(spec.substr(i, j - i), names);
+        i = j;
+    }
+    return names;
+}
+
+std::pair<std::string_view, std::string_view> SplitPVScheme(
+    std::string_view pv_name) {
+    constexpr std::string_view kSeparator = "://";
+    const size_t pos = pv_name.find(kSeparator);
+    if (pos == std::string_view::npos) return {{}, pv_name};
+    return {pv_name.substr(0, pos), pv_name.substr(pos + kSeparator.size())};
+}
+
+std::string WithPVScheme(std::string_view scheme, std::string_view pv_name) {
+    if (scheme.empty() || !SplitPVScheme(pv_name).first.empty()) {
+        return std::string(pv_name);
+    }
+    std::string name;
+    name.reserve(scheme.size() + 3 + pv_name.size());
+    name.append(scheme).append("://").append(pv_name);
+    return name;
+}
+
+std::string WithChannelFilter(std::string_view pv_name,
+                              std::string_view filter) {
+    std::string channel(pv_name);
+    if (filter.empty()) return channel;
+    // Filters follow a field name; "SR:X." stands for the VAL field
+    if (channel.find('.') == std::string::npos) channel += '.';
+    channel += filter;
+    return channel;
+}
+
+}  // namespace bchtree::epics
@@ -0,0 +1,119 @@
+#include "epics/pv_table.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "epics/pv_names.h"
+
+namespace bchtree::epics {
+
+namespace {
+
+bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+std::string_view Trim(std::string_view s) {
+    while (!s.empty() && IsBlank(s.front())) s.remove_prefix(1);
+    while (!s.empty() && IsBlank(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// Split on newlines and ';' outside of double quotes, dropping comments
+std::vector<std::string_view> SplitEntries(std::string_view text) {
+    std::vector<std::string_view> entries;
+    bool quoted = false;
+    bool comment = false;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= text.size(); ++i) {
+        const char c = (i < text.size()) ? text[i] : '\n';
+        if (comment && c != '\n') continue;
+
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (!quoted && (c == '\n' || c == ';' || c == '#')) {
+            if (!comment) {
+                entries.push_back(Trim(text.substr(start, i - start)));
+            }
+            comment = (c == '#');
+            start = i + 1;
+        }
+    }
+    return entries;
+}
+
+}  // namespace
+
+PVScalarValue ParsePVScalar(std::string_view text) {
+    text = Trim(text);
+
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+        return std::string(text.substr(1, text.size() - 2));
+    }
+
+    const std::string str(text);
+    if (!str.empty()) {
+        char* end = nullptr;
+        errno = 0;
+        const long lv = std::strtol(str.c_str(), &end, 10);
+        if (*end == '\0' && errno == 0 &&
+            lv >= std::numeric_limits<int32_t>::min() &&
+            lv <= std::numeric_limits<int32_t>::max()) {
+            return static_cast<int32_t>(lv);
+        }
+
+        errno = 0;
+        const double dv = std::strtod(str.c_str(), &end);
+        if (*end == '\0' && errno == 0) {
+            return dv;
+        }
+    }
+    return str;
+}
+
+PVPutTable ParsePVPutTable(std::string_view text) {
+    PVPutTable table;
+
+    for (std::string_view entry : SplitEntries(text)) {
+        if (entry.empty()) continue;
+
+        size_t sep = 0;
+        while (sep < entry.size() && entry[sep] != '=' &&
+               !IsBlank(entry[sep])) {
+            ++sep;
+        }
+
+        const std::string_view pv = entry.substr(0, sep);
+        std::string_view rest = Trim(entry.substr(sep));
+        if (!rest.empty() && rest.front() == '=') {
+            rest = Trim(rest.substr(1));
+        }
+        if (pv.empty() || rest.empty()) {
+            throw std::invalid_argument("malformed PV table entry: " +
+                                        std::string(entry));
+        }
+        const PVScalarValue value = ParsePVScalar(rest);
+
+        for (auto& name : ExpandPVNames(pv)) {
+            table.push_back({std::move(name), value});
+        }
+    }
+    return table;
+}
+
+PVPutTable LoadPVPutTable(const std::string& path) {
+    std::ifstream ifs(path);
+    if (!ifs) {
+        throw std::runtime_error("cannot open PV table: " + path);
+    }
+
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return ParsePVPutTable(oss.str());
+}
+
+}  // namespace bchtree::epics
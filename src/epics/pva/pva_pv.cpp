@@ -0,0 +1,311 @@
+#include "epics/pva/pva_pv.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "epics/pv_names.h"
+
+namespace bchtree::epics::pva {
+
+namespace {
+
+// Partial-field request: the rest of the structure is never transferred
+constexpr const char* kFieldRequest = "field(value,alarm,timeStamp)";
+
+// Copy a pvAccess array into a PVArray of E, converting the elements
+template <typename E>
+PVData MakeArrayData(const pvxs::Value& value) {
+    const auto arr = value.as<pvxs::shared_array<const E>>();
+    PVData data{};
+    data.value = PVArrayValue{PVArray<E>(
+        std::make_shared<const std::vector<E>>(arr.begin(), arr.end()))};
+    data.count = arr.size();
+    return data;
+}
+
+// Integers that int32_t can't hold are read as double, exact up to 2^53
+bool IsWideInteger(pvxs::TypeCode code) {
+    return code == pvxs::TypeCode::Int64 || code == pvxs::TypeCode::UInt32 ||
+           code == pvxs::TypeCode::UInt64;
+}
+
+PVData DecodeArray(const pvxs::Value& value) {
+    switch (value.type().code) {
+        case pvxs::TypeCode::Float64A:
+            return MakeArrayData<double>(value);
+        case pvxs::TypeCode::Float32A:
+            return MakeArrayData<float>(value);
+        case pvxs::TypeCode::StringA:
+            return MakeArrayData<std::string>(value);
+        default:
+            break;
+    }
+    if (IsWideInteger(value.type().scalarOf())) {
+        return MakeArrayData<double>(value);
+    }
+    if (value.type().scalarOf().kind() == pvxs::Kind::Integer ||
+        value.type().scalarOf().kind() == pvxs::Kind::Bool) {
+        return MakeArrayData<int32_t>(value);
+    }
+    throw std::runtime_error("unsupported pvAccess type");
+}
+
+PVData DecodeScalar(const pvxs::Value& value) {
+    PVData data{};
+    data.count = 1;
+    switch (value.type().kind()) {
+        case pvxs::Kind::Real:
+            if (value.type().code == pvxs::TypeCode::Float32) {
+                data.value = PVScalarValue{value.as<float>()};
+            } else {
+                data.value = PVScalarValue{value.as<double>()};
+            }
+            break;
+        case pvxs::Kind::Integer:
+        case pvxs::Kind::Bool:
+            if (IsWideInteger(value.type())) {
+                data.value = PVScalarValue{value.as<double>()};
+            } else {
+                data.value = PVScalarValue{value.as<int32_t>()};
+            }
+            break;
+        case pvxs::Kind::String:
+            data.value = PVScalarValue{value.as<std::string>()};
+            break;
+        case pvxs::Kind::Compound:
+            // NTEnum
+            if (auto index = value["index"]) {
+                data.value = PVScalarValue{index.as<uint16_t>()};
+                break;
+            }
+            throw std::runtime_error("unsupported pvAccess type");
+        default:
+            throw std::runtime_error("unsupported pvAccess type");
+    }
+    return data;
+}
+
+}  // namespace
+
+PVAPV::PVAPV(pvxs::client::Context ctx, std::string pv_name)
+    : ctx_(std::move(ctx)), pv_name_(std::move(pv_name)) {}
+
+PVAPV::~PVAPV() {
+    // cancel() waits for a callback in progress, so none runs after this
+    std::shared_ptr<pvxs::client::Subscription> sub;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        sub = std::move(sub_);
+    }
+    if (sub) sub->cancel();
+
+    std::lock_guard<std::mutex> lock(ops_mtx_);
+    for (auto& pending : ops_) {
+        pending.op->cancel();
+    }
+}
+
+void PVAPV::SetFlightRecorder(std::shared_ptr<FlightRecorder> recorder) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    recorder_id_ = recorder ? recorder->AddPV(pv_name_) : 0;
+    recorder_ = std::move(recorder);
+}
+
+void PVAPV::AddConnCB(ConnCallback cb) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    conn_cbs_.push_back(std::move(cb));
+}
+
+void PVAPV::Connect() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (sub_) return;
+
+    // The event mask has no pvAccess counterpart; the filter is passed in
+    // the channel name as QSRV expects it
+    channel_ = WithChannelFilter(pv_name_, GetMonitorOptions().server_filter);
+    sub_ = ctx_.monitor(channel_)
+               .pvRequest(kFieldRequest)
+               .maskConnected(false)
+               .maskDisconnected(false)
+               .event([this](pvxs::client::Subscription& sub) {
+                   HandleEvents(sub);
+               })
+               .exec();
+}
+
+bool PVAPV::MonitorOptionsChanged(const MonitorOptions& previous) {
+    const MonitorOptions options = GetMonitorOptions();
+    std::lock_guard<std::mutex> lock(mtx_);
+    // No event mask; the filter is part of the channel name
+    return !sub_ || options.server_filter == previous.server_filter;
+}
+
+bool PVAPV::DoGetCB(GetRequest* req, std::chrono::milliseconds, bool) {
+    auto done = std::make_shared<std::atomic<bool>>(false);
+
+    // The channel of the monitor, server side filter included, as with CA
+    std::string channel;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        channel = channel_.empty() ? pv_name_ : channel_;
+    }
+
+    auto op =
+        ctx_.get(channel)
+            .pvRequest(kFieldRequest)
+            .result([this, done, req](pvxs::client::Result&& result) {
+                done->store(true);
+
+                pvxs::Value top;
+                try {
+                    top = result();
+                } catch (const std::exception&) {
+                    RecordFlight(FlightEvent::CAGet, kRequestError);
+                    FailGet(req, kRequestError);
+                    return;
+                }
+                RecordFlight(FlightEvent::CAGet, 0);
+
+                PVData sample;
+                try {
+                    sample = DecodeValue(top);
+                } catch (const std::runtime_error&) {
+                    FailGet(req, kConversionError);
+                    return;
+                }
+                CompleteGet(req, std::move(sample));
+            })
+            .exec();
+
+    KeepOperation(std::move(op), std::move(done));
+    return true;
+}
+
+bool PVAPV::DoPutCB(const PVScalarValue& v, PutRequest* req, bool) {
+    auto done = std::make_shared<std::atomic<bool>>(false);
+
+    auto builder = ctx_.put(pv_name_);
+    std::visit(
+        [&builder](const auto& value) {
+            using V = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<V, uint16_t>) {
+                // Enum index of an NTEnum
+                builder.set("value.index", value);
+            } else if constexpr (std::is_same_v<V, PVString>) {
+                builder.set("value", value.str());
+            } else {
+                builder.set("value", value);
+            }
+        },
+        v);
+
+    auto op = builder
+                  .result([this, done, req](pvxs::client::Result&& result) {
+                      done->store(true);
+                      bool success = true;
+                      try {
+                          result();
+                      } catch (const std::exception&) {
+                          success = false;
+                      }
+                      RecordFlight(FlightEvent::CAPut,
+                                   success ? 0 : kRequestError);
+                      CompletePut(req, success);
+                  })
+                  .exec();
+
+    KeepOperation(std::move(op), std::move(done));
+    return true;
+}
+
+std::string PVAPV::GetPVname() const { return pv_name_; }
+
+bool PVAPV::IsConnected() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return connected_;
+}
+
+PVData PVAPV::DecodeValue(const pvxs::Value& top) {
+    const pvxs::Value value = top["value"];
+    if (!value) throw std::runtime_error("pvAccess value has no value field");
+
+    PVData data = value.type().isarray() ? DecodeArray(value)
+                                         : DecodeScalar(value);
+
+    if (auto severity = top["alarm.severity"]) {
+        data.meta.severity = severity.as<uint32_t>();
+    }
+    if (auto status = top["alarm.status"]) {
+        data.meta.status = status.as<uint32_t>();
+    }
+    if (auto seconds = top["timeStamp.secondsPastEpoch"]) {
+        // pvAccess counts from the POSIX epoch
+        std::chrono::nanoseconds since_epoch =
+            std::chrono::seconds(seconds.as<int64_t>());
+        if (auto nanos = top["timeStamp.nanoseconds"]) {
+            since_epoch += std::chrono::nanoseconds(nanos.as<int32_t>());
+        }
+        data.meta.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                since_epoch));
+    }
+    return data;
+}
+
+void PVAPV::HandleEvents(pvxs::client::Subscription& sub) {
+    // One callback may stand for several queued events
+    while (true) {
+        try {
+            pvxs::Value update = sub.pop();
+            if (!update) return;
+
+            RecordFlight(FlightEvent::CAMonitor, 0);
+            // The state names of an NTEnum come with the first update
+            if (!EnumStrings()) {
+                if (auto choices = update["value.choices"]) {
+                    const auto names =
+                        choices.as<pvxs::shared_array<const std::string>>();
+                    SetEnumStrings({names.begin(), names.end()});
+                }
+            }
+            PublishMonitor(DecodeValue(update));
+        } catch (const pvxs::client::Connected&) {
+            SetConnected(true);
+        } catch (const pvxs::client::Finished&) {
+            SetConnected(false);
+            return;
+        } catch (const pvxs::client::Disconnect&) {
+            SetConnected(false);
+        } catch (const std::exception&) {
+            // Remote error or a structure without a PVData mapping
+            RecordFlight(FlightEvent::CAMonitor, kRequestError);
+        }
+    }
+}
+
+void PVAPV::SetConnected(bool connected) {
+    std::vector<ConnCallback> cbs;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        connected_ = connected;
+        cbs = conn_cbs_;
+    }
+    RecordFlight(FlightEvent::CAConnect, 0, connected);
+
+    for (auto& cb : cbs) {
+        if (cb) cb(connected);
+    }
+}
+
+void PVAPV::KeepOperation(std::shared_ptr<pvxs::client::Operation> op,
+                          std::shared_ptr<std::atomic<bool>> done) {
+    std::lock_guard<std::mutex> lock(ops_mtx_);
+    ops_.erase(std::remove_if(ops_.begin(), ops_.end(),
+                              [](const PendingOperation& pending) {
+                                  return pending.done->load();
+                              }),
+               ops_.end());
+    ops_.push_back(PendingOperation{std::move(op), std::move(done)});
+}
+
+}  // namespace bchtree::epics::pva
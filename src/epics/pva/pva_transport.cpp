@@ -0,0 +1,13 @@
+#include "epics/pva/pva_transport.h"
+
+#include "epics/pva/pva_pv.h"
+
+namespace bchtree::epics::pva {
+
+PVATransport::PVATransport() : ctx_(pvxs::client::Context::fromEnv()) {}
+
+std::shared_ptr<PV> PVATransport::CreatePV(const std::string& pv_name) {
+    return std::make_shared<PVAPV>(ctx_, pv_name);
+}
+
+}  // namespace bchtree::epics::pva
@@ -0,0 +1,72 @@
+#include "file_watcher.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace bchtree {
+
+FileWatcher::FileWatcher(const std::string& path,
+                         std::function<void()> on_change)
+    : on_change_(std::move(on_change)) {
+    const std::filesystem::path file(path);
+    name_ = file.filename().string();
+    std::string dir = file.parent_path().string();
+    if (dir.empty()) dir = ".";
+
+    inotify_fd_ = inotify_init1(IN_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || stop_fd_ < 0 ||
+        inotify_add_watch(inotify_fd_, dir.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        const std::string err = std::strerror(errno);
+        if (inotify_fd_ >= 0) close(inotify_fd_);
+        if (stop_fd_ >= 0) close(stop_fd_);
+        throw std::runtime_error("FileWatcher: can't watch " + dir + ": " +
+                                 err);
+    }
+
+    thread_ = std::thread([this] { Loop(); });
+}
+
+FileWatcher::~FileWatcher() {
+    const uint64_t one = 1;
+    (void)!write(stop_fd_, &one, sizeof(one));
+    thread_.join();
+    close(inotify_fd_);
+    close(stop_fd_);
+}
+
+void FileWatcher::Loop() {
+    alignas(inotify_event) char buf[4096];
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+
+        const ssize_t len = read(inotify_fd_, buf, sizeof(buf));
+        if (len <= 0) continue;
+
+        // One call per batch of events, a save often writes several
+        bool changed = false;
+        for (ssize_t off = 0; off < len;) {
+            const auto* event =
+                reinterpret_cast<const inotify_event*>(buf + off);
+            if (event->len > 0 && name_ == event->name) changed = true;
+            off += sizeof(inotify_event) + event->len;
+        }
+        if (changed) on_change_();
+    }
+}
+
+}  // namespace bchtree
@@ -0,0 +1,284 @@
+#include "flight_recorder.h"
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+namespace bchtree {
+
+namespace {
+
+// File layout, native byte order:
+//   magic[8]
+//   u32 node count, then per node: u32 uid, u32 length, name
+//   u32 PV count, then per PV: u32 length, name
+//   u64 record count, then the packed records
+constexpr char kMagic[8] = {'B', 'C', 'H', 'F', 'R', '0', '0', '1'};
+
+size_t RoundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+template <typename T>
+void WriteRaw(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteString(std::ostream& out, const std::string& s) {
+    WriteRaw(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+template <typename T>
+T ReadRaw(std::istream& in) {
+    T value{};
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+        throw std::runtime_error("FlightRecorder: truncated dump");
+    }
+    return value;
+}
+
+std::string ReadString(std::istream& in) {
+    const auto size = ReadRaw<uint32_t>(in);
+    std::string s(size, '\0');
+    if (!in.read(s.data(), size)) {
+        throw std::runtime_error("FlightRecorder: truncated dump");
+    }
+    return s;
+}
+
+// Same values as BT::NodeStatus
+const char* NodeStatusName(uint8_t status) {
+    static constexpr const char* kNames[] = {"IDLE", "RUNNING", "SUCCESS",
+                                             "FAILURE", "SKIPPED"};
+    return status < std::size(kNames) ? kNames[status] : "?";
+}
+
+}  // namespace
+
+FlightRecorder::FlightRecorder(size_t capacity)
+    : slots_(RoundUpPow2(std::max<size_t>(capacity, 1))),
+      mask_(slots_.size() - 1) {}
+
+void FlightRecorder::Record(FlightEvent event, uint32_t subject, uint8_t from,
+                            uint8_t to, int32_t detail) noexcept {
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+
+    const uint64_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index & mask_];
+
+    // Odd while the record is written, so that Snapshot() skips it
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.record.time_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    slot.record.subject = subject;
+    slot.record.detail = detail;
+    slot.record.event = event;
+    slot.record.from = from;
+    slot.record.to = to;
+    slot.record.reserved = 0;
+
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+}
+
+uint32_t FlightRecorder::AddNode(std::string_view name) {
+    std::lock_guard<std::mutex> lock(names_mtx_);
+    const auto id = static_cast<uint32_t>(node_names_.size());
+    node_names_.emplace(id, name);
+    return id;
+}
+
+uint32_t FlightRecorder::AddPV(std::string_view pv_name) {
+    std::lock_guard<std::mutex> lock(names_mtx_);
+    pv_names_.emplace_back(pv_name);
+    return static_cast<uint32_t>(pv_names_.size() - 1);
+}
+
+std::vector<FlightRecord> FlightRecorder::Snapshot() const {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t first = head > slots_.size() ? head - slots_.size() : 0;
+
+    std::vector<FlightRecord> records;
+    records.reserve(head - first);
+    for (uint64_t i = first; i < head; ++i) {
+        const Slot& slot = slots_[i & mask_];
+        if (slot.seq.load(std::memory_order_acquire) != 2 * i + 2) continue;
+
+        const FlightRecord record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Overwritten while copying
+        if (slot.seq.load(std::memory_order_relaxed) != 2 * i + 2) continue;
+
+        records.push_back(record);
+    }
+    return records;
+}
+
+bool FlightRecorder::Dump(const std::string& path) const {
+    const auto records = Snapshot();
+
+    // Written next to the target and renamed, so that a reader never sees a
+    // partial dump. One dump at a time: the runners and the signal thread
+    // share the temporary file.
+    std::lock_guard<std::mutex> dump_lock(dump_mtx_);
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        out.write(kMagic, sizeof(kMagic));
+        {
+            std::lock_guard<std::mutex> lock(names_mtx_);
+            WriteRaw(out, static_cast<uint32_t>(node_names_.size()));
+            for (const auto& [uid, name] : node_names_) {
+                WriteRaw(out, uid);
+                WriteString(out, name);
+            }
+            WriteRaw(out, static_cast<uint32_t>(pv_names_.size()));
+            for (const auto& name : pv_names_) {
+                WriteString(out, name);
+            }
+        }
+
+        WriteRaw(out, static_cast<uint64_t>(records.size()));
+        for (const auto& r : records) {
+            WriteRaw(out, r.time_ns);
+            WriteRaw(out, r.subject);
+            WriteRaw(out, r.detail);
+            WriteRaw(out, r.event);
+            WriteRaw(out, r.from);
+            WriteRaw(out, r.to);
+            WriteRaw(out, r.reserved);
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+FlightDump LoadFlightDump(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("FlightRecorder: cannot open " + path);
+    }
+
+    char magic[sizeof(kMagic)];
+    if (!in.read(magic, sizeof(magic)) ||
+        !std::equal(std::begin(magic), std::end(magic), kMagic)) {
+        throw std::runtime_error("FlightRecorder: not a flight dump: " + path);
+    }
+
+    FlightDump dump;
+    const auto node_count = ReadRaw<uint32_t>(in);
+    for (uint32_t i = 0; i < node_count; ++i) {
+        const auto uid = ReadRaw<uint32_t>(in);
+        dump.node_names[uid] = ReadString(in);
+    }
+    const auto pv_count = ReadRaw<uint32_t>(in);
+    for (uint32_t i = 0; i < pv_count; ++i) {
+        dump.pv_names.push_back(ReadString(in));
+    }
+
+    const auto record_count = ReadRaw<uint64_t>(in);
+    for (uint64_t i = 0; i < record_count; ++i) {
+        FlightRecord r{};
+        r.time_ns = ReadRaw<uint64_t>(in);
+        r.subject = ReadRaw<uint32_t>(in);
+        r.detail = ReadRaw<int32_t>(in);
+        r.event = ReadRaw<FlightEvent>(in);
+        r.from = ReadRaw<uint8_t>(in);
+        r.to = ReadRaw<uint8_t>(in);
+        r.reserved = ReadRaw<uint8_t>(in);
+        dump.records.push_back(r);
+    }
+    return dump;
+}
+
+std::string FormatFlightRecord(const FlightDump& dump,
+                               const FlightRecord& record) {
+    const std::time_t seconds =
+        static_cast<std::time_t>(record.time_ns / 1000000000);
+    std::tm tm{};
+    localtime_r(&seconds, &tm);
+
+    char time_buf[32];
+    std::strftime(time_buf, sizeof(time_buf), "%Y-%m-%dT%H:%M:%S", &tm);
+
+    auto pv_name = [&](uint32_t id) -> std::string {
+        return id < dump.pv_names.size() ? dump.pv_names[id]
+                                         : "pv#" + std::to_string(id);
+    };
+
+    char line[512];
+    const unsigned long nanos =
+        static_cast<unsigned long>(record.time_ns % 1000000000);
+    switch (record.event) {
+        case FlightEvent::NodeStatus: {
+            auto it = dump.node_names.find(record.subject);
+            const std::string name = it != dump.node_names.end()
+                                         ? it->second
+                                         : "node#" +
+                                               std::to_string(record.subject);
+            std::snprintf(line, sizeof(line), "%s.%09lu NODE    %s  %s -> %s",
+                          time_buf, nanos, name.c_str(),
+                          NodeStatusName(record.from),
+                          NodeStatusName(record.to));
+            break;
+        }
+        case FlightEvent::CAConnect:
+            std::snprintf(line, sizeof(line), "%s.%09lu CONNECT %s  %s",
+                          time_buf, nanos, pv_name(record.subject).c_str(),
+                          record.to ? "up" : "down");
+            break;
+        case FlightEvent::CAGet:
+        case FlightEvent::CAPut:
+        case FlightEvent::CAMonitor: {
+            const char* kind = record.event == FlightEvent::CAGet   ? "GET    "
+                               : record.event == FlightEvent::CAPut ? "PUT    "
+                                                                    : "MONITOR";
+            std::snprintf(line, sizeof(line), "%s.%09lu %s %s  status=%d",
+                          time_buf, nanos, kind,
+                          pv_name(record.subject).c_str(), record.detail);
+            break;
+        }
+        default:
+            std::snprintf(line, sizeof(line), "%s.%09lu event=%u", time_buf,
+                          nanos, static_cast<unsigned>(record.event));
+            break;
+    }
+    return line;
+}
+
+void DumpFlightRecorderOnSignal(std::shared_ptr<FlightRecorder> recorder,
+                                int signo, std::string path) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signo);
+    // Threads started later inherit the mask, so only the waiter below
+    // receives the signal
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    std::thread([recorder = std::move(recorder), set, path = std::move(path)] {
+        int sig = 0;
+        while (sigwait(&set, &sig) == 0) {
+            recorder->Dump(path);
+        }
+    }).detach();
+}
+
+}  // namespace bchtree
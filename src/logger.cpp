@@ -1,56 +1,97 @@
 #include "logger.h"
 
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 namespace bchtree {
+Logger::~Logger() {
+    if (!logger_) return;
+    // An async logger is drained when its thread pool is destroyed; posting
+    // a flush could overrun a queued message
+    if (!async_) logger_->flush();
+    if (spdlog::get(logger_->name()) == logger_) {
+        spdlog::drop(logger_->name());
+    }
+}
+
 void Logger::setLevel(const std::string& level) {
     if (level == "info")
-        spdlog::set_level(spdlog::level::info);
+        level_ = spdlog::level::info;
     else if (level == "warn")
-        spdlog::set_level(spdlog::level::warn);
+        level_ = spdlog::level::warn;
     else if (level == "error")
-        spdlog::set_level(spdlog::level::err);
+        level_ = spdlog::level::err;
     else if (level == "debug")
-        spdlog::set_level(spdlog::level::debug);
+        level_ = spdlog::level::debug;
     else
-        spdlog::set_level(spdlog::level::info);
+        level_ = spdlog::level::info;
+
+    if (initialized_.load(std::memory_order_acquire)) {
+        logger_->set_level(level_);
+    }
 }
 
 void Logger::setFile(const std::string& path) { file_path_ = path; }
+void Logger::setConsole(bool enabled) { console_ = enabled; }
+
+void Logger::setAsync(const AsyncLogOptions& options) {
+    async_ = true;
+    async_options_ = options;
+}
 
 void Logger::ensure_init() {
-    if (initialized_) return;
-    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-    std::vector<spdlog::sink_ptr> sinks{console_sink};
+    if (initialized_.load(std::memory_order_acquire)) return;
+    std::call_once(init_once_, [this] { init(); });
+}
+
+void Logger::init() {
+    std::vector<spdlog::sink_ptr> sinks;
+    if (console_) {
+        sinks.push_back(
+            std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    }
 
     if (!file_path_.empty()) {
         auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
             file_path_, true);
         sinks.push_back(file_sink);
     }
-    logger_ =
-        std::make_shared<spdlog::logger>("bt", sinks.begin(), sinks.end());
-    spdlog::set_pattern("%Y-%m-%dT%H:%M:%S.%e %z [%l] %v");
-    initialized_ = true;
-}
 
-void Logger::info(const std::string& msg) {
-    ensure_init();
-    spdlog::info(msg);
-}
-void Logger::warn(const std::string& msg) {
-    ensure_init();
-    spdlog::warn(msg);
+    if (async_) {
+        const auto policy =
+            async_options_.overflow == LogOverflow::DropOldest
+                ? spdlog::async_overflow_policy::overrun_oldest
+                : spdlog::async_overflow_policy::block;
+        // The logger only keeps a weak reference to its pool
+        thread_pool_ = std::make_shared<spdlog::details::thread_pool>(
+            async_options_.queue_size, 1);
+        logger_ = std::make_shared<spdlog::async_logger>(
+            "bt", sinks.begin(), sinks.end(), thread_pool_, policy);
+    } else {
+        logger_ =
+            std::make_shared<spdlog::logger>("bt", sinks.begin(), sinks.end());
+    }
+    logger_->set_level(level_);
+    logger_->set_pattern("%Y-%m-%dT%H:%M:%S.%e %z [%l] %v");
+    logger_->flush_on(spdlog::level::warn);
+
+    // Registered so that spdlog's periodic flusher sees it
+    if (async_) {
+        spdlog::drop(logger_->name());
+        spdlog::register_logger(logger_);
+        spdlog::flush_every(async_options_.flush_interval);
+    }
+    initialized_.store(true, std::memory_order_release);
 }
-void Logger::error(const std::string& msg) {
-    ensure_init();
-    spdlog::error(msg);
+
+void Logger::flush() {
+    if (initialized_.load(std::memory_order_acquire)) logger_->flush();
 }
-void Logger::debug(const std::string& msg) {
-    ensure_init();
-    spdlog::debug(msg);
+
+size_t Logger::droppedMessages() const {
+    if (!initialized_.load(std::memory_order_acquire)) return 0;
+    return thread_pool_ ? thread_pool_->overrun_counter() : 0;
 }
-void Logger::flush() { logger_->flush(); }
 
 }  // namespace bchtree
@@ -1,18 +1,47 @@
+#include <csignal>
 #include <cxxopts.hpp>
+#include <filesystem>
 #include <iostream>
 
 #include "bt_runner.h"
+#include "epics/ca/ca_transport.h"
+#include "epics/loopback/loopback_transport.h"
+#include "epics/monitor_filter.h"
+#ifdef BCHTREE_WITH_PVA
+#include "epics/pva/pva_transport.h"
+#endif
 #include "logger.h"
+#include "metrics.h"
+#include "tree_daemon.h"
+#include "tree_scheduler.h"
 
 int main(int argc, char** argv) {
     cxxopts::Options options("bch-tree-cli", "bch-tree CLI Runner");
 
     // clang-format off
     options.add_options()
-      ("t,tree", "XML tree file", cxxopts::value<std::string>())
+      ("t,tree", "XML tree file, repeat to run several trees", cxxopts::value<std::vector<std::string>>())
+      ("workers", "trees ticking at the same time", cxxopts::value<size_t>()->default_value("4"))
       ("log-level", "log level (info|warn|error|debug)", cxxopts::value<std::string>()->default_value("info"))
       ("log-file", "log file path", cxxopts::value<std::string>()->default_value(""))
-      ("print-tree", "print tree", cxxopts::value<bool>()->default_value("false")->implicit_value("true")),
+      ("log-async", "write logs from a background thread", cxxopts::value<bool>()->default_value("false")->implicit_value("true"))
+      ("log-queue-size", "async log queue size in messages", cxxopts::value<size_t>()->default_value("8192"))
+      ("log-overflow", "when the async log queue is full (block|drop)", cxxopts::value<std::string>()->default_value("block"))
+      ("log-flush-interval", "async log flush interval in seconds", cxxopts::value<int>()->default_value("1"))
+      ("flight-records", "events kept by the flight recorder (0: off)", cxxopts::value<size_t>()->default_value("65536"))
+      ("flight-dump", "flight recorder dump file, written on failure, SIGUSR1 and exit", cxxopts::value<std::string>()->default_value("bch-tree.flight"))
+      ("print-tree", "print tree", cxxopts::value<bool>()->default_value("false")->implicit_value("true"))
+      ("connect-timeout", "ms to wait for the tree PVs to connect (0: skip)", cxxopts::value<int>()->default_value("2000"))
+      ("transport", "PV transport (ca|loopback: in-process values, no IOC)", cxxopts::value<std::string>()->default_value("ca"))
+      ("max-array-elements", "cap on array elements per PV (0: no cap)", cxxopts::value<size_t>()->default_value("0"))
+      ("daemon", "keep the trees loaded and rerun them on SIGUSR2, --trigger-pv or --socket", cxxopts::value<bool>()->default_value("false")->implicit_value("true"))
+      ("trigger-pv", "with --daemon, rerun the trees when this PV changes", cxxopts::value<std::string>()->default_value(""))
+      ("socket", "with --daemon, Unix socket accepting run|status|stop", cxxopts::value<std::string>()->default_value(""))
+      ("watch", "with --daemon, reload a tree before its next run when its file changes", cxxopts::value<bool>()->default_value("false")->implicit_value("true"))
+      ("metrics-file", "write Prometheus metrics to this file", cxxopts::value<std::string>()->default_value(""))
+      ("metrics-interval", "ms between rewrites of --metrics-file", cxxopts::value<int>()->default_value("5000"))
+      ("metrics-port", "serve Prometheus metrics on 127.0.0.1:port (0: off)", cxxopts::value<int>()->default_value("0"))
+      ("monitor-config", "monitor options per PV, one \"PV options\" line each", cxxopts::value<std::string>()->default_value(""))
       ("h,help", "print usage");
     // clang-format on
 
@@ -22,6 +51,14 @@ int main(int argc, char** argv) {
         return 2;
     }
 
+    // Before any thread starts, see DumpFlightRecorderOnSignal
+    std::shared_ptr<bchtree::FlightRecorder> recorder;
+    const auto flight_dump = result["flight-dump"].as<std::string>();
+    if (const size_t records = result["flight-records"].as<size_t>()) {
+        recorder = std::make_shared<bchtree::FlightRecorder>(records);
+        bchtree::DumpFlightRecorderOnSignal(recorder, SIGUSR1, flight_dump);
+    }
+
     auto logger = std::make_shared<bchtree::Logger>();
     auto log_level = result["log-level"].as<std::string>();
     logger->setLevel(log_level);
@@ -31,25 +68,160 @@ int main(int argc, char** argv) {
         logger->setFile(logfile);
     }
 
-    auto ctx = std::make_shared<bchtree::epics::ca::CAContextManager>();
-    ctx->Init();
-    auto pv_manager = std::make_shared<bchtree::epics::ca::PVManager>(ctx);
+    // Before any thread starts, like the flight recorder signal
+    std::unique_ptr<bchtree::TreeDaemon> daemon;
+    if (result["daemon"].as<bool>()) {
+        daemon = std::make_unique<bchtree::TreeDaemon>(logger);
+        daemon->HandleSignals(SIGUSR2);
+    }
+
+    if (result["log-async"].as<bool>()) {
+        bchtree::AsyncLogOptions async_options;
+        async_options.queue_size = result["log-queue-size"].as<size_t>();
+        const auto overflow = result["log-overflow"].as<std::string>();
+        if (overflow == "drop") {
+            async_options.overflow = bchtree::LogOverflow::DropOldest;
+        } else if (overflow != "block") {
+            std::cerr << "unknown --log-overflow: " << overflow << std::endl;
+            return 2;
+        }
+        async_options.flush_interval =
+            std::chrono::seconds(result["log-flush-interval"].as<int>());
+        logger->setAsync(async_options);
+    }
+
+    // Serves plain and ca:// names; pva_transport serves pva:// names
+    std::shared_ptr<bchtree::epics::PVTransport> transport;
+    std::shared_ptr<bchtree::epics::PVTransport> pva_transport;
+    const auto transport_name = result["transport"].as<std::string>();
+    if (transport_name == "ca") {
+        auto ctx = std::make_shared<bchtree::epics::ca::CAContextManager>();
+        ctx->Init();
+        transport = std::make_shared<bchtree::epics::ca::CATransport>(ctx);
+#ifdef BCHTREE_WITH_PVA
+        pva_transport = std::make_shared<bchtree::epics::pva::PVATransport>();
+#endif
+    } else if (transport_name == "loopback") {
+        transport =
+            std::make_shared<bchtree::epics::loopback::LoopbackTransport>();
+        pva_transport = transport;
+    } else {
+        std::cerr << "unknown --transport: " << transport_name << std::endl;
+        return 2;
+    }
+    auto pv_manager = std::make_shared<bchtree::epics::PVManager>(transport);
+    pv_manager->AddTransport("ca", transport);
+    if (pva_transport) {
+        pv_manager->AddTransport("pva", pva_transport);
+    }
+    pv_manager->SetMaxArrayElements(result["max-array-elements"].as<size_t>());
+    if (const auto path = result["monitor-config"].as<std::string>();
+        !path.empty()) {
+        for (const auto& [name, options] :
+             bchtree::epics::LoadMonitorConfig(path)) {
+            pv_manager->SetMonitorOptions(name, options);
+        }
+    }
+
+    if (recorder) {
+        pv_manager->SetFlightRecorder(recorder);
+    }
 
-    bchtree::BTRunner runner(ctx, pv_manager);
-    runner.SetLogger(logger);
-    if (log_level == "debug") {
-        runner.UseRunnerLogger();
+    std::shared_ptr<bchtree::MetricsRegistry> metrics;
+    std::unique_ptr<bchtree::MetricsExporter> metrics_exporter;
+    const auto metrics_file = result["metrics-file"].as<std::string>();
+    const int metrics_port = result["metrics-port"].as<int>();
+    if (!metrics_file.empty() || metrics_port > 0) {
+        metrics = std::make_shared<bchtree::MetricsRegistry>();
+        pv_manager->SetMetrics(metrics);
+        metrics_exporter = std::make_unique<bchtree::MetricsExporter>(metrics);
+        if (!metrics_file.empty()) {
+            metrics_exporter->StartFileWriter(
+                metrics_file, std::chrono::milliseconds(
+                                  result["metrics-interval"].as<int>()));
+        }
+        if (metrics_port > 0) {
+            const auto port = metrics_exporter->Listen(
+                static_cast<uint16_t>(metrics_port));
+            logger->info("Serving metrics on http://127.0.0.1:{}/metrics",
+                         port);
+        }
     }
 
-    const std::string treePath = result["tree"].as<std::string>();
-    runner.RegisterTreeFromFile(treePath);
+    const auto tree_paths = result["tree"].as<std::vector<std::string>>();
+    bchtree::TreeScheduler scheduler(pv_manager,
+                                     result["workers"].as<size_t>());
+    for (const auto& tree_path : tree_paths) {
+        const auto name = std::filesystem::path(tree_path).stem().string();
+        auto runner = std::make_unique<bchtree::BTRunner>(pv_manager);
+        runner->SetLogger(logger);
+        if (tree_paths.size() > 1) {
+            runner->SetName(name);
+        }
+        if (recorder) {
+            runner->SetFlightRecorder(recorder, flight_dump);
+        }
+        if (metrics) {
+            runner->SetMetrics(metrics);
+        }
+        if (log_level == "debug") {
+            runner->UseRunnerLogger();
+        }
 
+        runner->SetConnectTimeout(
+            std::chrono::milliseconds(result["connect-timeout"].as<int>()));
+        runner->RegisterTreeFromFile(tree_path);
+        if (daemon && result["watch"].as<bool>()) {
+            runner->WatchTreeFile();
+        }
+
+        if (result["print-tree"].as<bool>()) {
+            runner->PrintTree();
+            continue;
+        }
+        scheduler.Add(name, std::move(runner));
+    }
     if (result["print-tree"].as<bool>()) {
-        runner.PrintTree();
         return 0;
     }
 
-    bool success = runner.Run();
+    bool success = true;
+    if (daemon) {
+        if (const auto pv = result["trigger-pv"].as<std::string>();
+            !pv.empty()) {
+            daemon->TriggerOnPV(pv_manager, pv);
+        }
+        if (const auto path = result["socket"].as<std::string>();
+            !path.empty()) {
+            daemon->ListenOnSocket(path);
+        }
+        logger->info("Waiting for triggers");
+        daemon->Serve(scheduler);
+    } else {
+        success = scheduler.Run();
+    }
+    if (recorder) {
+        recorder->Dump(flight_dump);
+    }
+    for (const auto& report : scheduler.Reports()) {
+        using ms = std::chrono::duration<double, std::milli>;
+        logger->info(
+            "Tree {}: status={} ticks={} tick={:.3f}ms max_tick={:.3f}ms "
+            "cpu={:.3f}ms",
+            report.name, BT::toStr(report.status), report.stats.ticks,
+            ms(report.stats.tick_time).count(),
+            ms(report.stats.max_tick_time).count(),
+            ms(report.stats.cpu_time).count());
+        if (!report.error.empty()) {
+            logger->error("Tree {}: {}", report.name, report.error);
+        }
+    }
+    const auto monitor_counts = pv_manager->MonitorCounts();
+    logger->debug("Monitor updates: {} delivered, {} dropped by filters",
+                  monitor_counts.delivered, monitor_counts.dropped);
+    if (const size_t dropped = logger->droppedMessages()) {
+        logger->warn("Dropped {} log messages", dropped);
+    }
     if (success) {
         return 0;
     }
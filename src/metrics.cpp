@@ -0,0 +1,383 @@
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace bchtree {
+
+// ---- LatencyHistogram ----
+
+size_t LatencyHistogram::BucketIndex(uint64_t us) {
+    if (us < kSubBuckets) return us;
+    const int msb = 63 - __builtin_clzll(us);
+    const size_t magnitude = msb - kSubBucketBits + 1;
+    const size_t sub = (us >> (msb - kSubBucketBits)) - kSubBuckets;
+    return std::min(magnitude * kSubBuckets + sub, kBuckets - 1);
+}
+
+uint64_t LatencyHistogram::BucketMax(size_t index) {
+    const size_t magnitude = index / kSubBuckets;
+    const uint64_t sub = index % kSubBuckets;
+    if (magnitude == 0) return sub;
+    const uint64_t width = uint64_t{1} << (magnitude - 1);
+    return ((kSubBuckets + sub) << (magnitude - 1)) + width - 1;
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds value) {
+    const uint64_t ns = value.count() > 0 ? value.count() : 0;
+    buckets_[BucketIndex(ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds LatencyHistogram::Sum() const {
+    return std::chrono::nanoseconds(sum_ns_.load(std::memory_order_relaxed));
+}
+
+uint64_t LatencyHistogram::CountAtOrBelow(
+    std::chrono::nanoseconds bound) const {
+    const auto bound_us =
+        static_cast<uint64_t>(std::max<int64_t>(bound.count(), 0) / 1000);
+    uint64_t count = 0;
+    for (size_t i = 0; i < kBuckets && BucketMax(i) <= bound_us; ++i) {
+        count += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+std::chrono::nanoseconds LatencyHistogram::Quantile(double q) const {
+    // The buckets are read one by one while others record, so the total
+    // is taken from them rather than from count_
+    std::array<uint64_t, kBuckets> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) return std::chrono::nanoseconds(0);
+
+    const auto target = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= target) return std::chrono::microseconds(BucketMax(i));
+    }
+    return std::chrono::microseconds(BucketMax(kBuckets - 1));
+}
+
+// ---- MetricsRegistry ----
+
+std::shared_ptr<NodeMetrics> MetricsRegistry::ForNode(const std::string& tree,
+                                                      const std::string& node) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& metrics = nodes_[{tree, node}];
+    if (!metrics) metrics = std::make_shared<NodeMetrics>();
+    return metrics;
+}
+
+std::shared_ptr<PVMetrics> MetricsRegistry::ForPV(const std::string& pv_name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& metrics = pvs_[pv_name];
+    if (!metrics) metrics = std::make_shared<PVMetrics>();
+    return metrics;
+}
+
+namespace {
+
+// Prometheus "le" bounds of the exported histograms, in seconds
+constexpr double kBounds[] = {0.00005, 0.0001, 0.00025, 0.0005, 0.001,
+                              0.0025,  0.005,  0.01,    0.025,  0.05,
+                              0.1,     0.25,   0.5,     1,      2.5,
+                              5,       10,     30,      60};
+
+std::string Escape(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string Number(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+void Header(std::string& out, const char* name, const char* type,
+            const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void Sample(std::string& out, const char* name, const std::string& labels,
+            const std::string& value) {
+    out += name;
+    out += '{';
+    out += labels;
+    out += "} ";
+    out += value;
+    out += '\n';
+}
+
+void Histogram(std::string& out, const char* name, const std::string& labels,
+               const LatencyHistogram& histogram) {
+    const std::string bucket = std::string(name) + "_bucket";
+    for (double bound : kBounds) {
+        const auto ns = std::chrono::nanoseconds(
+            static_cast<int64_t>(std::llround(bound * 1e9)));
+        Sample(out, bucket.c_str(), labels + ",le=\"" + Number(bound) + "\"",
+               std::to_string(histogram.CountAtOrBelow(ns)));
+    }
+    const uint64_t count = histogram.Count();
+    Sample(out, bucket.c_str(), labels + ",le=\"+Inf\"",
+           std::to_string(count));
+    Sample(out, (std::string(name) + "_sum").c_str(), labels,
+           Number(std::chrono::duration<double>(histogram.Sum()).count()));
+    Sample(out, (std::string(name) + "_count").c_str(), labels,
+           std::to_string(count));
+}
+
+template <typename Map, typename Label, typename Emit>
+void Family(std::string& out, const Map& map, const char* name,
+            const char* type, const char* help, Label label, Emit emit) {
+    if (map.empty()) return;
+    Header(out, name, type, help);
+    for (const auto& [key, metrics] : map) emit(label(key), *metrics);
+}
+
+}  // namespace
+
+std::string MetricsRegistry::Prometheus() const {
+    // Copy the pointers so that the formatting runs without the lock
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<NodeMetrics>>
+        nodes;
+    std::map<std::string, std::shared_ptr<PVMetrics>> pvs;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        nodes = nodes_;
+        pvs = pvs_;
+    }
+
+    auto node_label = [](const std::pair<std::string, std::string>& key) {
+        return "tree=\"" + Escape(key.first) + "\",node=\"" +
+               Escape(key.second) + "\"";
+    };
+    auto pv_label = [](const std::string& key) {
+        return "pv=\"" + Escape(key) + "\"";
+    };
+
+    std::string out;
+    Family(out, nodes, "bchtree_node_ticks_total", "counter",
+           "Ticks of a tree node", node_label,
+           [&](const std::string& labels, const NodeMetrics& m) {
+               Sample(out, "bchtree_node_ticks_total", labels,
+                      std::to_string(m.ticks.load()));
+           });
+    Family(out, nodes, "bchtree_node_tick_seconds", "histogram",
+           "Duration of one tick of a node, children included", node_label,
+           [&](const std::string& labels, const NodeMetrics& m) {
+               Histogram(out, "bchtree_node_tick_seconds", labels,
+                         m.tick_time);
+           });
+    Family(out, nodes, "bchtree_node_running_seconds", "histogram",
+           "Time a node spent RUNNING before it completed or was halted",
+           node_label, [&](const std::string& labels, const NodeMetrics& m) {
+               Histogram(out, "bchtree_node_running_seconds", labels,
+                         m.running_time);
+           });
+
+    Family(out, pvs, "bchtree_pv_get_seconds", "histogram",
+           "Round trip of a get request", pv_label,
+           [&](const std::string& labels, const PVMetrics& m) {
+               Histogram(out, "bchtree_pv_get_seconds", labels, m.get_time);
+           });
+    Family(out, pvs, "bchtree_pv_put_seconds", "histogram",
+           "Round trip of a put request", pv_label,
+           [&](const std::string& labels, const PVMetrics& m) {
+               Histogram(out, "bchtree_pv_put_seconds", labels, m.put_time);
+           });
+    const struct {
+        const char* name;
+        const char* type;
+        const char* help;
+        int64_t (*read)(const PVMetrics&);
+    } scalars[] = {
+        {"bchtree_pv_get_errors_total", "counter", "Failed get requests",
+         [](const PVMetrics& m) { return int64_t(m.get_errors.load()); }},
+        {"bchtree_pv_put_errors_total", "counter", "Failed put requests",
+         [](const PVMetrics& m) { return int64_t(m.put_errors.load()); }},
+        {"bchtree_pv_outstanding_requests", "gauge",
+         "Get and put requests awaiting a reply",
+         [](const PVMetrics& m) { return int64_t(m.outstanding.load()); }},
+        {"bchtree_pv_cancelled_total", "counter",
+         "Get and put requests cancelled before their reply",
+         [](const PVMetrics& m) { return int64_t(m.cancelled.load()); }},
+        {"bchtree_pv_connects_total", "counter", "Connections of the channel",
+         [](const PVMetrics& m) { return int64_t(m.connects.load()); }},
+        {"bchtree_pv_disconnects_total", "counter",
+         "Disconnections of the channel",
+         [](const PVMetrics& m) { return int64_t(m.disconnects.load()); }},
+        {"bchtree_pv_monitor_updates_total", "counter",
+         "Monitor updates delivered to the cache and the nodes",
+         [](const PVMetrics& m) { return int64_t(m.monitor_updates.load()); }},
+        {"bchtree_pv_monitor_dropped_total", "counter",
+         "Monitor updates dropped by the filter or not decodable",
+         [](const PVMetrics& m) { return int64_t(m.monitor_dropped.load()); }},
+    };
+    for (const auto& scalar : scalars) {
+        Family(out, pvs, scalar.name, scalar.type, scalar.help, pv_label,
+               [&](const std::string& labels, const PVMetrics& m) {
+                   Sample(out, scalar.name, labels,
+                          std::to_string(scalar.read(m)));
+               });
+    }
+    return out;
+}
+
+// ---- MetricsExporter ----
+
+MetricsExporter::MetricsExporter(
+    std::shared_ptr<const MetricsRegistry> registry)
+    : registry_(std::move(registry)) {}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    // Wakes accept() in ServeLoop
+    if (listen_fd_ >= 0) shutdown(listen_fd_, SHUT_RDWR);
+
+    if (file_thread_.joinable()) file_thread_.join();
+    if (http_thread_.joinable()) http_thread_.join();
+    if (listen_fd_ >= 0) close(listen_fd_);
+}
+
+bool MetricsExporter::WriteFile(const std::string& path) const {
+    // Readers such as the node_exporter textfile collector never see a
+    // partial file
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << registry_->Prometheus();
+        if (!out) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+void MetricsExporter::StartFileWriter(std::string path,
+                                      std::chrono::milliseconds interval) {
+    file_thread_ = std::thread([this, path = std::move(path), interval] {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!stopped_) {
+            lock.unlock();
+            WriteFile(path);
+            lock.lock();
+            cv_.wait_for(lock, interval, [this] { return stopped_; });
+        }
+        // Final values at exit
+        lock.unlock();
+        WriteFile(path);
+    });
+}
+
+uint16_t MetricsExporter::Listen(uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("MetricsExporter: socket: ") +
+                                 std::strerror(errno));
+    }
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(fd, 8) < 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        const std::string err = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("MetricsExporter: listen on port " +
+                                 std::to_string(port) + ": " + err);
+    }
+
+    listen_fd_ = fd;
+    http_thread_ = std::thread([this] { ServeLoop(); });
+    return ntohs(addr.sin_port);
+}
+
+void MetricsExporter::ServeLoop() {
+    while (true) {
+        const int conn = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            return;  // shut down by the destructor
+        }
+        timeval timeout{1, 0};
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // Only the request line matters; the rest of the request is ignored
+        char buf[1024];
+        const ssize_t n = read(conn, buf, sizeof(buf));
+        std::string response;
+        if (n >= 4 && std::memcmp(buf, "GET ", 4) == 0) {
+            const std::string body = registry_->Prometheus();
+            response =
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " +
+                std::to_string(body.size()) +
+                "\r\nConnection: close\r\n\r\n" + body;
+        } else {
+            response =
+                "HTTP/1.1 405 Method Not Allowed\r\n"
+                "Content-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+
+        size_t sent = 0;
+        while (sent < response.size()) {
+            const ssize_t w = send(conn, response.data() + sent,
+                                   response.size() - sent, MSG_NOSIGNAL);
+            if (w <= 0) break;
+            sent += w;
+        }
+        close(conn);
+    }
+}
+
+}  // namespace bchtree
@@ -0,0 +1,276 @@
+#include "tree_daemon.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace bchtree {
+
+namespace {
+
+double Millis(std::chrono::nanoseconds d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+std::string FormatReport(const RunReport& report) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf),
+                  "run %llu %s trigger=%s latency_ms=%.3f duration_ms=%.3f",
+                  static_cast<unsigned long long>(report.run),
+                  report.success ? "SUCCESS" : "FAILURE",
+                  report.trigger.c_str(), Millis(report.latency),
+                  Millis(report.duration));
+    return buf;
+}
+
+}  // namespace
+
+uint64_t TreeDaemon::State::Trigger(const std::string& trigger) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!pending) {
+        pending = true;
+        source = trigger;
+        triggered_at = std::chrono::steady_clock::now();
+    }
+    cv.notify_all();
+    // The pending run is always the next one to start
+    return started + 1;
+}
+
+void TreeDaemon::State::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopped = true;
+    }
+    cv.notify_all();
+}
+
+TreeDaemon::TreeDaemon(std::shared_ptr<Logger> logger)
+    : logger_(std::move(logger)), state_(std::make_shared<State>()) {}
+
+TreeDaemon::~TreeDaemon() {
+    Stop();
+    if (socket_thread_.joinable()) socket_thread_.join();
+    {
+        // Stop() ended their waits; a silent client times out
+        std::unique_lock<std::mutex> lock(clients_mtx_);
+        clients_cv_.wait(lock, [this] { return clients_ == 0; });
+    }
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        unlink(socket_path_.c_str());
+    }
+}
+
+uint64_t TreeDaemon::Trigger(const std::string& source) {
+    return state_->Trigger(source);
+}
+
+std::optional<RunReport> TreeDaemon::WaitFor(uint64_t run) {
+    std::unique_lock<std::mutex> lock(state_->mtx);
+    state_->cv.wait(lock, [&] {
+        return state_->stopped || state_->completed >= run;
+    });
+    if (state_->completed < run) return std::nullopt;
+    return state_->last;
+}
+
+std::optional<RunReport> TreeDaemon::LastRun() const {
+    std::lock_guard<std::mutex> lock(state_->mtx);
+    return state_->last;
+}
+
+void TreeDaemon::TriggerOnPV(
+    const std::shared_ptr<epics::PVManager>& pv_manager,
+    const std::string& pv_name) {
+    pv_manager->Attach();
+    auto pv = pv_manager->Get(pv_name);
+
+    using Value = decltype(epics::PVData::value);
+    auto last = std::make_shared<std::optional<Value>>();
+    if (const auto snapshot = pv->Snapshot()) {
+        *last = snapshot->data.value;
+    }
+    // Monitor callbacks are serialized, so `last` needs no lock
+    std::weak_ptr<State> weak = state_;
+    pv->AddMonitorCB([weak, last](const epics::PVData& data) {
+        const bool changed = last->has_value() && **last != data.value;
+        *last = data.value;
+        if (!changed) return;
+        if (auto state = weak.lock()) state->Trigger("pv");
+    });
+    pv->Connect();
+    trigger_pvs_.push_back(std::move(pv));
+}
+
+void TreeDaemon::ListenOnSocket(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("TreeDaemon: bad socket path: " + path);
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("TreeDaemon: socket: ") +
+                                 std::strerror(errno));
+    }
+    // A socket file left behind by a previous daemon
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(fd, 8) < 0) {
+        const std::string err = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("TreeDaemon: listen on " + path + ": " + err);
+    }
+
+    socket_fd_ = fd;
+    socket_path_ = path;
+    socket_thread_ = std::thread([this] { AcceptLoop(); });
+}
+
+void TreeDaemon::AcceptLoop() {
+    while (true) {
+        const int conn = accept4(socket_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            return;  // shut down by Stop()
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(clients_mtx_);
+            if (clients_ < kMaxClients) {
+                ++clients_;
+                std::thread([this, conn] { ServeClient(conn); }).detach();
+                continue;
+            }
+        }
+        static constexpr char kBusy[] = "error busy\n";
+        (void)!write(conn, kBusy, sizeof(kBusy) - 1);
+        close(conn);
+    }
+}
+
+void TreeDaemon::ServeClient(int conn) {
+    // A silent client gives up its thread after a second
+    timeval timeout{1, 0};
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string line;
+    char c;
+    while (line.size() < 64 && read(conn, &c, 1) == 1 && c != '\n') {
+        line.push_back(c);
+    }
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    const std::string reply = HandleCommand(line) + "\n";
+    // Best effort: the client may be gone
+    (void)!write(conn, reply.data(), reply.size());
+    close(conn);
+
+    // Last use of this: notified under the lock so that the destructor
+    // can't return before
+    std::lock_guard<std::mutex> lock(clients_mtx_);
+    --clients_;
+    clients_cv_.notify_all();
+}
+
+std::string TreeDaemon::HandleCommand(const std::string& command) {
+    if (command == "run") {
+        const auto report = WaitFor(Trigger("socket"));
+        return report ? FormatReport(*report) : "stopped";
+    }
+    if (command == "status") {
+        const auto report = LastRun();
+        return report ? FormatReport(*report) : "idle";
+    }
+    if (command == "stop") {
+        Stop();
+        return "stopping";
+    }
+    return "error unknown command: " + command;
+}
+
+void TreeDaemon::HandleSignals(int trigger_signo) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, trigger_signo);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    // Same scheme as DumpFlightRecorderOnSignal
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    std::weak_ptr<State> weak = state_;
+    std::thread([weak, set, trigger_signo] {
+        bool stopping = false;
+        int sig = 0;
+        while (sigwait(&set, &sig) == 0) {
+            if (sig != trigger_signo) {
+                // The run in progress did not finish in time
+                if (stopping) std::_Exit(1);
+                stopping = true;
+            }
+            auto state = weak.lock();
+            if (!state) continue;
+            if (stopping) {
+                state->Stop();
+            } else {
+                state->Trigger("signal");
+            }
+        }
+    }).detach();
+}
+
+void TreeDaemon::Serve(TreeScheduler& scheduler) {
+    while (true) {
+        RunReport report;
+        std::chrono::steady_clock::time_point triggered_at;
+        {
+            std::unique_lock<std::mutex> lock(state_->mtx);
+            state_->cv.wait(lock, [this] {
+                return state_->stopped || state_->pending;
+            });
+            if (state_->stopped) return;
+            state_->pending = false;
+            report.run = ++state_->started;
+            report.trigger = std::move(state_->source);
+            triggered_at = state_->triggered_at;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        report.success = scheduler.Run();
+        const auto end = std::chrono::steady_clock::now();
+        report.latency = end - triggered_at;
+        report.duration = end - start;
+
+        if (logger_) {
+            logger_->info("Run {} ({}): {} latency={:.3f}ms duration={:.3f}ms",
+                          report.run, report.trigger,
+                          report.success ? "SUCCESS" : "FAILURE",
+                          Millis(report.latency), Millis(report.duration));
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            state_->completed = report.run;
+            state_->last = std::move(report);
+        }
+        state_->cv.notify_all();
+    }
+}
+
+void TreeDaemon::Stop() {
+    state_->Stop();
+    // Wakes the accept loop
+    if (socket_fd_ >= 0) shutdown(socket_fd_, SHUT_RDWR);
+}
+
+}  // namespace bchtree
@@ -0,0 +1,83 @@
+#include "tree_scheduler.h"
+
+#include <stdexcept>
+#include <thread>
+
+namespace bchtree {
+
+TickSlots::TickSlots(size_t slots) : slots_(slots), free_(slots) {
+    if (slots == 0) {
+        throw std::invalid_argument("TickSlots: need at least one slot");
+    }
+}
+
+void TickSlots::Acquire() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return free_ > 0; });
+    --free_;
+}
+
+void TickSlots::Release() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++free_;
+    }
+    cv_.notify_one();
+}
+
+TreeScheduler::TreeScheduler(std::shared_ptr<epics::PVManager> pv_manager,
+                             size_t workers)
+    : pv_manager_(std::move(pv_manager)),
+      slots_(std::make_shared<TickSlots>(workers)) {}
+
+TreeScheduler::~TreeScheduler() = default;
+
+void TreeScheduler::Add(std::string name, std::unique_ptr<BTRunner> runner) {
+    runner->SetTickSlots(slots_);
+    Entry entry;
+    entry.name = std::move(name);
+    entry.runner = std::move(runner);
+    trees_.push_back(std::move(entry));
+}
+
+bool TreeScheduler::Run() {
+    std::vector<std::thread> threads;
+    threads.reserve(trees_.size());
+    for (auto& entry : trees_) {
+        // Nothing of an earlier run, e.g. in daemon mode
+        entry.status = BT::NodeStatus::IDLE;
+        entry.error.clear();
+        threads.emplace_back([this, &entry] {
+            try {
+                // The nodes issue requests from this thread
+                pv_manager_->Attach();
+                entry.status = entry.runner->Run() ? BT::NodeStatus::SUCCESS
+                                                   : BT::NodeStatus::FAILURE;
+            } catch (const std::exception& e) {
+                // A node error ends its own tree only
+                entry.status = BT::NodeStatus::FAILURE;
+                entry.error = e.what();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& entry : trees_) {
+        if (entry.status != BT::NodeStatus::SUCCESS) return false;
+    }
+    return true;
+}
+
+std::vector<TreeScheduler::TreeReport> TreeScheduler::Reports() const {
+    std::vector<TreeReport> reports;
+    reports.reserve(trees_.size());
+    for (const auto& entry : trees_) {
+        reports.push_back({entry.name, entry.status, entry.error,
+                           entry.runner->Stats()});
+    }
+    return reports;
+}
+
+}  // namespace bchtree
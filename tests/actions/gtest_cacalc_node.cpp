@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "actions/cacalc_node.h"
+#include "loopback_fixture.h"
+
+namespace bchtree {
+
+class CACalcNodeTest : public LoopbackFixture {
+   protected:
+    void SetUp() override {
+        factory_.registerNodeType<CACalcNode>("CACalc", pv_manager_);
+    }
+
+    BT::Tree Tree(const std::string& attrs) {
+        return TreeOf(R"(<CACalc result="{out}" )" + attrs + "/>");
+    }
+};
+
+TEST_F(CACalcNodeTest, EvaluatesMonitorValues) {
+    transport_->SetValue("LB:A", 2.0);
+    transport_->SetValue("LB:B", int32_t{3});
+    auto tree = Tree(R"(expr="LB:A * 2 + LB:B")");
+
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    EXPECT_DOUBLE_EQ(tree.rootBlackboard()->get<double>("out"), 7);
+
+    // Reaches the cache on the loopback thread
+    transport_->SetValue("LB:B", int32_t{-4});
+    auto pv = pv_manager_->Get("LB:B");
+    for (int i = 0; i < 200 && pv->GetAs<int>() != -4; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    EXPECT_DOUBLE_EQ(tree.rootBlackboard()->get<double>("out"), 0);
+}
+
+TEST_F(CACalcNodeTest, UntilWaitsForTrueResult) {
+    auto tree = Tree(R"(expr="LB:X &gt;= 5" until="true" timeout="2000")");
+
+    std::thread writer([this] {
+        for (int v = 1; v <= 6; ++v) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            transport_->SetValue("LB:X", static_cast<double>(v));
+        }
+    });
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    writer.join();
+    EXPECT_EQ(tree.rootBlackboard()->get<double>("out"), 1);
+}
+
+TEST_F(CACalcNodeTest, FailsAfterTimeout) {
+    auto tree = Tree(R"(expr="LB:X > 100" until="true" timeout="100")");
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(100));
+}
+
+TEST_F(CACalcNodeTest, WaitsForDisconnectedPV) {
+    transport_->SetValue("LB:A", 2.0);
+    auto tree = Tree(R"(expr="LB:A + 1" timeout="100")");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+
+    // The cached value of a disconnected PV is not used
+    transport_->Disconnect("LB:A");
+    auto pv = pv_manager_->Get("LB:A");
+    for (int i = 0; i < 200 && pv->IsConnected(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(pv->HasValue());
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+
+    std::thread writer([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        transport_->SetValue("LB:A", 4.0);
+    });
+    auto retry = Tree(R"(expr="LB:A + 1" timeout="2000")");
+    EXPECT_EQ(retry.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    writer.join();
+    EXPECT_DOUBLE_EQ(retry.rootBlackboard()->get<double>("out"), 5);
+}
+
+TEST_F(CACalcNodeTest, SyntaxErrorFailsTreeCreation) {
+    EXPECT_THROW(Tree(R"(expr="LB:A +")"), BT::RuntimeError);
+}
+
+TEST_F(CACalcNodeTest, StringPVIsRejected) {
+    transport_->SetValue("LB:S", std::string("abc"));
+    auto tree = Tree(R"(expr="LB:S + 1")");
+    EXPECT_THROW(tree.tickWhileRunning(), BT::RuntimeError);
+}
+
+}  // namespace bchtree
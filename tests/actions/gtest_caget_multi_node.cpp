@@ -0,0 +1,91 @@
+#include <behaviortree_cpp/bt_factory.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "actions/caget_multi_node.h"
+#include "loopback_fixture.h"
+#include "metrics.h"
+#include "softioc_fixture.h"
+
+namespace bchtree {
+
+class CAGetMultiNodeFixture : public SoftIocFixture {
+   protected:
+    BT::BehaviorTreeFactory factory;
+    std::shared_ptr<epics::PVManager> pv_manager =
+        std::make_shared<epics::PVManager>(transport_);
+
+    void SetUp() override {
+        factory.registerNodeType<CAGetMultiNode>("CAGetMulti", pv_manager);
+    }
+};
+
+TEST_F(CAGetMultiNodeFixture, ReadsAllPVs) {
+    const char* xml = R"(
+<root BTCPP_format="4">
+  <BehaviorTree ID="Main">
+    <CAGetMulti pvs="TEST:AO; TEST:{LO,STRO}" timeout="3000"
+                result="{values}" failed="{failed}" />
+  </BehaviorTree>
+</root>)";
+
+    auto tree = factory.createTreeFromText(xml);
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+
+    auto values = tree.rootBlackboard()->get<epics::PVDataMap>("values");
+    EXPECT_EQ(values.size(), 3u);
+    EXPECT_EQ(values.count("TEST:STRO"), 1u);
+    EXPECT_TRUE(
+        tree.rootBlackboard()->get<std::vector<std::string>>("failed").empty());
+}
+
+TEST_F(CAGetMultiNodeFixture, ReportsMissingPVs) {
+    const char* xml = R"(
+<root BTCPP_format="4">
+  <BehaviorTree ID="Main">
+    <CAGetMulti pvs="TEST:AO TEST:MISSING" timeout="1000"
+                result="{values}" failed="{failed}" />
+  </BehaviorTree>
+</root>)";
+
+    auto tree = factory.createTreeFromText(xml);
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+
+    auto values = tree.rootBlackboard()->get<epics::PVDataMap>("values");
+    EXPECT_EQ(values.count("TEST:AO"), 1u);
+
+    auto failed =
+        tree.rootBlackboard()->get<std::vector<std::string>>("failed");
+    ASSERT_EQ(failed.size(), 1u);
+    EXPECT_EQ(failed[0], "TEST:MISSING");
+}
+
+// Every request waits 300ms for its reply
+class CAGetMultiNodeSlowTest : public LoopbackFixture {
+   protected:
+    CAGetMultiNodeSlowTest()
+        : LoopbackFixture(Latency(std::chrono::milliseconds(300))) {}
+
+    void SetUp() override {
+        factory_.registerNodeType<CAGetMultiNode>("CAGetMulti", pv_manager_);
+    }
+};
+
+TEST_F(CAGetMultiNodeSlowTest, TimeoutCancelsTheGets) {
+    auto pv = pv_manager_->Get("LB:X");
+    auto metrics = std::make_shared<PVMetrics>();
+    pv->SetMetrics(metrics);
+    ASSERT_TRUE(
+        pv_manager_->ConnectAll({pv}, std::chrono::seconds(2)).empty());
+
+    auto tree = TreeOf(R"(<CAGetMulti pvs="LB:X" timeout="50"/>)");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+    EXPECT_EQ(metrics->cancelled, 1u);
+    EXPECT_EQ(metrics->outstanding, 0);
+}
+
+}  // namespace bchtree
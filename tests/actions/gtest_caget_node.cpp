@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "actions/caget_node.h"
+#include "loopback_fixture.h"
+
+namespace bchtree {
+
+class CAGetNodeTest : public LoopbackFixture {
+   protected:
+    using LoopbackFixture::LoopbackFixture;
+
+    void SetUp() override {
+        factory_.registerNodeType<CAGetNode<double>>("CAGetDouble",
+                                                     pv_manager_);
+    }
+
+    BT::Tree Tree(const std::string& attrs) {
+        return TreeOf(R"(<CAGetDouble result="{out}" use_monitor="false" )" +
+                      attrs + "/>");
+    }
+};
+
+TEST_F(CAGetNodeTest, ReadsValue) {
+    transport_->SetValue("LB:X", 2.5);
+    auto tree = Tree(R"(pv="LB:X")");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    EXPECT_DOUBLE_EQ(tree.rootBlackboard()->get<double>("out"), 2.5);
+}
+
+TEST_F(CAGetNodeTest, FailedReplyFailsWithoutTimeout) {
+    transport_->SetValue("LB:S", std::string("abc"));
+    auto tree = Tree(R"(pv="LB:S" timeout="5000")");
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::seconds(2));
+}
+
+// Every request waits 500ms for its reply
+class CAGetNodeSlowTest : public CAGetNodeTest {
+   protected:
+    CAGetNodeSlowTest()
+        : CAGetNodeTest(Latency(std::chrono::milliseconds(500))) {}
+};
+
+TEST_F(CAGetNodeSlowTest, SaturatedPVFailsTheNodeOnly) {
+    auto pv = pv_manager_->Get("LB:X");
+    ASSERT_TRUE(
+        pv_manager_->ConnectAll({pv}, std::chrono::seconds(2)).empty());
+
+    // Gets abandoned to an IOC that hangs
+    epics::RequestHandle get;
+    for (size_t i = 0; i < epics::PV::kMaxCancelledRequests; ++i) {
+        ASSERT_TRUE(pv->GetCB([](epics::PVData) {}, std::chrono::seconds(1),
+                              nullptr, true, &get));
+        ASSERT_TRUE(pv->CancelRequest(get));
+    }
+    ASSERT_TRUE(pv->Saturated());
+
+    auto tree = Tree(R"(pv="LB:X")");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+}
+
+}  // namespace bchtree
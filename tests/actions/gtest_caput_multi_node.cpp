@@ -0,0 +1,92 @@
+#include <behaviortree_cpp/bt_factory.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "actions/caput_multi_node.h"
+#include "loopback_fixture.h"
+#include "metrics.h"
+#include "softioc_fixture.h"
+
+namespace bchtree {
+
+class CAPutMultiNodeFixture : public SoftIocFixture {
+   protected:
+    BT::BehaviorTreeFactory factory;
+    std::shared_ptr<epics::PVManager> pv_manager =
+        std::make_shared<epics::PVManager>(transport_);
+
+    void SetUp() override {
+        factory.registerNodeType<CAPutMultiNode>("CAPutMulti", pv_manager);
+    }
+};
+
+TEST_F(CAPutMultiNodeFixture, WritesAllPVs) {
+    const char* xml = R"(
+<root BTCPP_format="4">
+  <BehaviorTree ID="Main">
+    <CAPutMulti values="TEST:AO 4.5; TEST:LO 7; TEST:STRO &quot;multi&quot;"
+                timeout="3000" failed="{failed}" />
+  </BehaviorTree>
+</root>)";
+
+    auto tree = factory.createTreeFromText(xml);
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    EXPECT_TRUE(
+        tree.rootBlackboard()->get<std::vector<std::string>>("failed").empty());
+
+    FILE* fp = popen("caget -t TEST:LO", "r");
+    ASSERT_NE(fp, nullptr);
+    char buf[256]{};
+    ASSERT_TRUE(fgets(buf, sizeof(buf), fp) != nullptr);
+    pclose(fp);
+    EXPECT_EQ(std::string(buf).rfind("7", 0), 0u);
+}
+
+TEST_F(CAPutMultiNodeFixture, ReportsUnacknowledgedPVs) {
+    const char* xml = R"(
+<root BTCPP_format="4">
+  <BehaviorTree ID="Main">
+    <CAPutMulti values="TEST:AO 1.0; TEST:MISSING 2" timeout="1000"
+                failed="{failed}" />
+  </BehaviorTree>
+</root>)";
+
+    auto tree = factory.createTreeFromText(xml);
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+
+    auto failed =
+        tree.rootBlackboard()->get<std::vector<std::string>>("failed");
+    ASSERT_EQ(failed.size(), 1u);
+    EXPECT_EQ(failed[0], "TEST:MISSING");
+}
+
+// Every request waits 300ms for its reply
+class CAPutMultiNodeSlowTest : public LoopbackFixture {
+   protected:
+    CAPutMultiNodeSlowTest()
+        : LoopbackFixture(Latency(std::chrono::milliseconds(300))) {}
+
+    void SetUp() override {
+        factory_.registerNodeType<CAPutMultiNode>("CAPutMulti", pv_manager_);
+    }
+};
+
+TEST_F(CAPutMultiNodeSlowTest, TimeoutCancelsThePuts) {
+    auto pv = pv_manager_->Get("LB:X");
+    auto metrics = std::make_shared<PVMetrics>();
+    pv->SetMetrics(metrics);
+    ASSERT_TRUE(
+        pv_manager_->ConnectAll({pv}, std::chrono::seconds(2)).empty());
+
+    auto tree = TreeOf(R"(<CAPutMulti values="LB:X 1.0" timeout="50"/>)");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+    EXPECT_EQ(metrics->cancelled, 1u);
+    EXPECT_EQ(metrics->outstanding, 0);
+}
+
+}  // namespace bchtree
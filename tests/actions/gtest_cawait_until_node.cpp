@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "actions/cawait_until_node.h"
+#include "loopback_fixture.h"
+
+namespace bchtree {
+
+class CAWaitUntilNodeTest : public LoopbackFixture {
+   protected:
+    void SetUp() override {
+        factory_.registerNodeType<CAWaitUntilNode>("CAWaitUntil",
+                                                   pv_manager_);
+    }
+
+    BT::Tree Tree(const std::string& attrs) {
+        return TreeOf(R"(<CAWaitUntil pv="LB:X" result="{out}" )" + attrs +
+                      "/>");
+    }
+};
+
+TEST_F(CAWaitUntilNodeTest, SucceedsWhenUpdateSatisfies) {
+    auto tree = Tree(R"(op="ge" value="5" timeout="2000")");
+
+    std::thread writer([this] {
+        for (int v = 1; v <= 6; ++v) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            transport_->SetValue("LB:X", static_cast<double>(v));
+        }
+    });
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+    writer.join();
+
+    auto out = tree.rootBlackboard()->get<epics::PVData>("out");
+    EXPECT_GE(epics::PV::extract_as<double>(out), 5);
+}
+
+TEST_F(CAWaitUntilNodeTest, SucceedsOnCurrentValue) {
+    transport_->SetValue("LB:X", 1.0);
+    auto tree = Tree(R"(op="within" value="1.1" tolerance="0.2")");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+}
+
+TEST_F(CAWaitUntilNodeTest, IgnoresValueOfDisconnectedPV) {
+    transport_->SetValue("LB:X", 1.0);
+    auto tree = Tree(R"(op="eq" value="1" timeout="100")");
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+
+    transport_->Disconnect("LB:X");
+    auto pv = pv_manager_->Get("LB:X");
+    for (int i = 0; i < 200 && pv->IsConnected(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(pv->HasValue());
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+}
+
+TEST_F(CAWaitUntilNodeTest, IgnoresThePVOfAnEarlierName) {
+    transport_->SetValue("LB:A", 6.0);
+    transport_->SetValue("LB:B", 0.0);
+    auto tree =
+        TreeOf(R"(<CAWaitUntil pv="{name}" op="ge" value="5" timeout="300"/>)");
+    tree.rootBlackboard()->set("name", std::string("LB:A"));
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+
+    // Updates of LB:A satisfy the condition but no longer count
+    tree.rootBlackboard()->set("name", std::string("LB:B"));
+    std::thread writer([this] {
+        for (int v = 7; v < 12; ++v) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            transport_->SetValue("LB:A", static_cast<double>(v));
+        }
+    });
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+    writer.join();
+}
+
+TEST_F(CAWaitUntilNodeTest, FailsAfterTimeout) {
+    auto tree = Tree(R"(op="eq" value="42" timeout="100")");
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::FAILURE);
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(100));
+}
+
+TEST_F(CAWaitUntilNodeTest, RejectsBadCondition) {
+    auto tree = Tree(R"(op="about" value="1")");
+    EXPECT_THROW(tree.tickWhileRunning(), BT::RuntimeError);
+}
+
+}  // namespace bchtree
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "actions/cawindow_stat_node.h"
+#include "loopback_fixture.h"
+
+namespace bchtree {
+
+// The loopback server adds 1 to the value on every update
+class CAWindowStatNodeTest : public LoopbackFixture {
+   protected:
+    CAWindowStatNodeTest() : LoopbackFixture(Options()) {}
+
+    static epics::loopback::LoopbackOptions Options() {
+        epics::loopback::LoopbackOptions options;
+        options.update_rate_hz = 200;
+        return options;
+    }
+
+    void SetUp() override {
+        factory_.registerNodeType<CAWindowStatNode>("CAWindowStat",
+                                                    pv_manager_);
+    }
+
+    double Run(const std::string& attrs) {
+        auto tree =
+            TreeOf(R"(<CAWindowStat pv="LB:X" result="{out}" )" + attrs + "/>");
+        EXPECT_EQ(tree.tickWhileRunning(), BT::NodeStatus::SUCCESS);
+        return tree.rootBlackboard()->get<double>("out");
+    }
+};
+
+TEST_F(CAWindowStatNodeTest, CountWindow) {
+    EXPECT_DOUBLE_EQ(Run(R"(window_count="5" stat="count")"), 5);
+    EXPECT_DOUBLE_EQ(Run(R"(window_count="5" stat="stddev")"),
+                     std::sqrt(2.5));
+
+    const double min = Run(R"(window_count="5" stat="min")");
+    const double max = Run(R"(window_count="5" stat="max")");
+    EXPECT_GE(max - min, 4);
+}
+
+TEST_F(CAWindowStatNodeTest, TimeWindow) {
+    const double rate = Run(R"(window_ms="200" stat="rate")");
+    EXPECT_GT(rate, 100);
+    EXPECT_LT(rate, 300);
+}
+
+TEST_F(CAWindowStatNodeTest, RejectsAmbiguousWindow) {
+    auto tree = TreeOf(
+        R"(<CAWindowStat pv="LB:X" window_ms="10" window_count="10" )"
+        R"(result="{out}"/>)");
+    EXPECT_THROW(tree.tickWhileRunning(), BT::RuntimeError);
+}
+
+}  // namespace bchtree
@@ -2,12 +2,14 @@
 #include <db_access.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <future>
 #include <string>
 #include <thread>
+#include <variant>
 #include <vector>
 
 #include "epics/ca/ca_pv.h"
@@ -64,6 +66,22 @@ TEST_F(SoftIocFixture, CAPV_OnConnection) {
     EXPECT_TRUE(is_connected);
 }
 
+TEST_F(SoftIocFixture, CAPV_OnMonitor) {
+    CAPV pv(ctx_, "TEST:AO");
+
+    std::promise<void> got_update;
+    std::atomic<bool> notified{false};
+    pv.AddMonitorCB([&](const bchtree::epics::PVData&) {
+        if (!notified.exchange(true)) got_update.set_value();
+    });
+    EXPECT_FALSE(pv.HasValue());
+
+    pv.Connect();
+    ASSERT_EQ(got_update.get_future().wait_for(4s), std::future_status::ready)
+        << "No monitor event";
+    EXPECT_TRUE(pv.HasValue());
+}
+
 TEST_F(SoftIocFixture, CAPV_PutCB_Double) {
     CAPV pv(ctx_, "TEST:AO");
     pv.Connect();
@@ -195,3 +213,117 @@ TEST_F(SoftIocFixture, CAPV_Disconnect_Reconnect) {
     EXPECT_FALSE(states[1]);
     EXPECT_TRUE(states[2]);
 }
+
+TEST_F(SoftIocFixture, CAPV_Array_GetCBAs_and_GetAs) {
+    using bchtree::epics::PVArray;
+
+    int rc = system("caput -a TEST:WF 3 1.5 2.5 3.5 > /dev/null");
+    ASSERT_EQ(rc, 0);
+
+    CAPV pv(ctx_, "TEST:WF");
+    std::promise<void> got_update;
+    std::atomic<bool> notified{false};
+    pv.AddMonitorCB([&](const bchtree::epics::PVData&) {
+        if (!notified.exchange(true)) got_update.set_value();
+    });
+    pv.Connect();
+    ASSERT_TRUE(WaitUntilConnected(pv));
+    ASSERT_EQ(got_update.get_future().wait_for(4s), std::future_status::ready);
+
+    // Monitor cache: both reads share one buffer
+    auto a1 = pv.GetAs<PVArray<double>>();
+    auto a2 = pv.GetAs<PVArray<double>>();
+    ASSERT_NE(a1, nullptr);
+    EXPECT_EQ(a1.get(), a2.get());
+    EXPECT_EQ(*a1, (std::vector<double>{1.5, 2.5, 3.5}));
+
+    // Element type conversion
+    auto ints = pv.GetAs<PVArray<int32_t>>();
+    EXPECT_EQ(*ints, (std::vector<int32_t>{1, 2, 3}));
+
+    std::promise<PVArray<double>> got_cb;
+    pv.GetCBAs<PVArray<double>>(
+        [&](PVArray<double> value) { got_cb.set_value(value); }, 1000ms);
+    auto fut = got_cb.get_future();
+    ASSERT_EQ(fut.wait_for(4s), std::future_status::ready);
+    EXPECT_EQ(*fut.get(), (std::vector<double>{1.5, 2.5, 3.5}));
+}
+
+TEST_F(SoftIocFixture, CAPV_Array_MaxElements) {
+    using bchtree::epics::PVArray;
+
+    int rc = system("caput -a TEST:WF 4 1 2 3 4 > /dev/null");
+    ASSERT_EQ(rc, 0);
+
+    CAPV pv(ctx_, "TEST:WF");
+    pv.SetMaxElements(2);
+    pv.Connect();
+    ASSERT_TRUE(WaitUntilConnected(pv));
+
+    std::promise<PVArray<double>> got_cb;
+    pv.GetCBAs<PVArray<double>>(
+        [&](PVArray<double> value) { got_cb.set_value(value); }, 1000ms);
+    auto fut = got_cb.get_future();
+    ASSERT_EQ(fut.wait_for(4s), std::future_status::ready);
+    EXPECT_EQ(*fut.get(), (std::vector<double>{1, 2}));
+}
+
+TEST_F(SoftIocFixture, CAPV_Array_SingleElement) {
+    using bchtree::epics::PVArray;
+    using bchtree::epics::PVArrayValue;
+
+    int rc = system("caput -a TEST:WF1 1 4.5 > /dev/null");
+    ASSERT_EQ(rc, 0);
+
+    // NELM=1 is still an array when the node asks for one
+    CAPV pv(ctx_, "TEST:WF1");
+    pv.ExpectArray();
+    pv.Connect();
+    ASSERT_TRUE(WaitUntilConnected(pv));
+
+    std::promise<bchtree::epics::PVData> got_cb;
+    pv.GetCB([&](bchtree::epics::PVData data) { got_cb.set_value(data); },
+             1000ms);
+    auto fut = got_cb.get_future();
+    ASSERT_EQ(fut.wait_for(4s), std::future_status::ready);
+    const auto data = fut.get();
+    ASSERT_TRUE(std::holds_alternative<PVArrayValue>(data.value));
+    EXPECT_EQ(*CAPV::extract_as<PVArray<double>>(data),
+              (std::vector<double>{4.5}));
+}
+
+TEST_F(SoftIocFixture, CAPV_ScalarChar) {
+    int rc = system("caput -a TEST:CHAR 1 7 > /dev/null");
+    ASSERT_EQ(rc, 0);
+
+    CAPV pv(ctx_, "TEST:CHAR");
+    std::promise<void> got_update;
+    std::atomic<bool> notified{false};
+    pv.AddMonitorCB([&](const bchtree::epics::PVData&) {
+        if (!notified.exchange(true)) got_update.set_value();
+    });
+    pv.Connect();
+    ASSERT_TRUE(WaitUntilConnected(pv));
+    ASSERT_EQ(got_update.get_future().wait_for(4s), std::future_status::ready);
+
+    EXPECT_EQ(pv.GetAs<int32_t>(), 7);
+    EXPECT_EQ(pv.MonitorCounts().dropped, 0u);
+}
+
+TEST_F(SoftIocFixture, CAPV_EnumStrings) {
+    CAPV pv(ctx_, "TEST:BO");
+    std::promise<void> got_update;
+    std::atomic<bool> notified{false};
+    pv.AddMonitorCB([&](const bchtree::epics::PVData&) {
+        if (!notified.exchange(true)) got_update.set_value();
+    });
+    pv.Connect();
+    ASSERT_TRUE(WaitUntilConnected(pv));
+    ASSERT_EQ(got_update.get_future().wait_for(4s), std::future_status::ready);
+
+    // Requested ahead of the subscription, so known by the first update
+    const auto states = pv.EnumStrings();
+    ASSERT_NE(states, nullptr);
+    EXPECT_EQ(*states, (std::vector<std::string>{"CLOSED", "OPEN"}));
+    EXPECT_EQ(pv.GetAs<uint16_t>(), 1);
+}
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "epics/loopback/loopback_transport.h"
+#include "epics/pv_manager.h"
+
+using namespace std::chrono_literals;
+using namespace bchtree::epics;
+using bchtree::epics::loopback::LoopbackOptions;
+using bchtree::epics::loopback::LoopbackTransport;
+
+namespace {
+
+PVData Scalar(PVScalarValue value) {
+    PVData data;
+    data.value = std::move(value);
+    data.count = 1;
+    return data;
+}
+
+template <typename Pred>
+bool WaitFor(Pred pred, std::chrono::milliseconds timeout = 2s) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(1ms);
+    }
+    return pred();
+}
+
+}  // namespace
+
+TEST(LoopbackTransport, ConnectDeliversInitialValue) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    transport->AddPV("LB:AO", Scalar(1.5));
+    PVManager manager(transport);
+
+    auto pvs = manager.GetMany({"LB:AO"});
+    EXPECT_TRUE(manager.ConnectAll(pvs, 1s).empty());
+    ASSERT_TRUE(WaitFor([&] { return pvs[0]->HasValue(); }));
+    EXPECT_DOUBLE_EQ(pvs[0]->GetAs<double>(), 1.5);
+}
+
+TEST(LoopbackTransport, UnknownNameStaysDisconnected) {
+    LoopbackOptions options;
+    options.create_on_demand = false;
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    transport->AddPV("LB:AO", Scalar(0.0));
+    PVManager manager(transport);
+
+    auto pvs = manager.GetMany({"LB:AO", "LB:NO_SUCH_PV"});
+    auto missing = manager.ConnectAll(pvs, 100ms);
+
+    ASSERT_EQ(missing.size(), 1u);
+    EXPECT_EQ(missing[0], "LB:NO_SUCH_PV");
+    EXPECT_FALSE(pvs[1]->GetCB([](PVData) {}, 100ms));
+}
+
+TEST(LoopbackTransport, DisconnectUntilNextWrite) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    transport->AddPV("LB:AO", Scalar(1.0));
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    std::atomic<int> downs{0};
+    pv->AddConnCB([&](bool connected) {
+        if (!connected) ++downs;
+    });
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    transport->Disconnect("LB:AO");
+    ASSERT_TRUE(WaitFor([&] { return !pv->IsConnected(); }));
+    EXPECT_EQ(downs, 1);
+    EXPECT_FALSE(pv->GetCB([](PVData) {}, 100ms));
+
+    transport->SetValue("LB:AO", 2.0);
+    ASSERT_TRUE(WaitFor([&] { return pv->IsConnected(); }));
+    ASSERT_TRUE(WaitFor([&] { return pv->GetAs<double>() == 2.0; }));
+}
+
+TEST(LoopbackTransport, PutToDisconnectedChannelFails) {
+    LoopbackOptions options;
+    options.latency = 50ms;
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    transport->AddPV("LB:AO", Scalar(1.0));
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    std::promise<bool> result;
+    ASSERT_TRUE(pv->PutCB(PVScalarValue{2.0},
+                          [&](bool ok) { result.set_value(ok); }));
+    // Before the put reaches the server
+    transport->Disconnect("LB:AO");
+
+    auto future = result.get_future();
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    EXPECT_FALSE(future.get());
+    EXPECT_FALSE(pv->IsConnected());
+    EXPECT_FALSE(transport->GetValue("LB:AO").has_value());
+}
+
+TEST(LoopbackTransport, PutUpdatesMonitorsBeforeCompleting) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+    ASSERT_TRUE(WaitFor([&] { return pv->HasValue(); }));
+
+    std::promise<double> seen_by_put;
+    ASSERT_TRUE(pv->PutCB(PVScalarValue{3.0}, [&](bool ok) {
+        EXPECT_TRUE(ok);
+        seen_by_put.set_value(pv->GetAs<double>());
+    }));
+
+    auto future = seen_by_put.get_future();
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    EXPECT_DOUBLE_EQ(future.get(), 3.0);
+
+    auto stored = transport->GetValue("LB:AO");
+    ASSERT_TRUE(stored.has_value());
+    EXPECT_DOUBLE_EQ(PV::extract_as<double>(*stored), 3.0);
+}
+
+TEST(LoopbackTransport, RemovedMonitorCallbackIsNotCalled) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    transport->AddPV("LB:AO", Scalar(1.0));
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    std::atomic<int> first{0};
+    std::atomic<int> second{0};
+    const auto id = pv->AddMonitorCB([&](const PVData&) { ++first; });
+    pv->AddMonitorCB([&](const PVData&) { ++second; });
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+    ASSERT_TRUE(WaitFor([&] { return first == 1 && second == 1; }));
+
+    pv->RemoveMonitorCB(id);
+    transport->SetValue("LB:AO", 2.0);
+    ASSERT_TRUE(WaitFor([&] { return second == 2; }));
+    EXPECT_EQ(first, 1);
+}
+
+TEST(LoopbackTransport, GetCBAsConvertsTheReply) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    transport->AddPV("LB:LO", Scalar(int32_t{7}));
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:LO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    std::promise<double> value;
+    ASSERT_TRUE(pv->GetCBAs<double>([&](double v) { value.set_value(v); },
+                                    1s));
+
+    auto future = value.get_future();
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    EXPECT_DOUBLE_EQ(future.get(), 7.0);
+}
+
+TEST(LoopbackTransport, RequestsReuseTheirContexts) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    for (int i = 0; i < 10; ++i) {
+        std::promise<void> got;
+        ASSERT_TRUE(pv->GetCB([&](PVData) { got.set_value(); }, 1s));
+        ASSERT_EQ(got.get_future().wait_for(2s), std::future_status::ready);
+
+        std::promise<void> put;
+        ASSERT_TRUE(pv->PutCB(PVScalarValue{double(i)},
+                              [&](bool) { put.set_value(); }));
+        ASSERT_EQ(put.get_future().wait_for(2s), std::future_status::ready);
+    }
+    // One for the gets, one for the puts
+    EXPECT_EQ(pv->RequestContexts(), 2u);
+}
+
+TEST(LoopbackTransport, CancelledRequestsRunNoCallback) {
+    LoopbackOptions options;
+    options.latency = 50ms;
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    // What the callbacks hold is freed at once
+    auto held = std::make_shared<std::atomic<int>>(0);
+    RequestHandle get;
+    RequestHandle put;
+    for (size_t i = 0; i < PV::kMaxCancelledRequests; ++i) {
+        ASSERT_TRUE(pv->GetCB([held](PVData) { ++*held; }, 1s, nullptr, true,
+                              &get));
+        ASSERT_TRUE(pv->CancelRequest(get));
+        EXPECT_FALSE(pv->CancelRequest(get));
+    }
+    EXPECT_EQ(held.use_count(), 1);
+
+    // Until the replies come back, the PV refuses more requests
+    EXPECT_FALSE(pv->PutCB(PVScalarValue{1.0}, [](bool) {}, true, &put));
+    ASSERT_TRUE(WaitFor([&] {
+        return pv->PutCB(PVScalarValue{1.0}, [held](bool) { ++*held; }, true,
+                         &put);
+    }));
+    ASSERT_TRUE(WaitFor([&] { return *held == 1; }));
+    EXPECT_FALSE(pv->CancelRequest(put));
+    EXPECT_LE(pv->RequestContexts(), PV::kMaxCancelledRequests + 1);
+}
+
+TEST(LoopbackTransport, ConversionFailureReachesErrorCallback) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    transport->AddPV("LB:STRO", Scalar(std::string("abc")));
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:STRO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    std::promise<int> status;
+    ASSERT_TRUE(pv->GetCBAs<double>(
+        [](double) { FAIL() << "string converted to double"; }, 1s,
+        [&](int st) { status.set_value(st); }));
+
+    auto future = status.get_future();
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    EXPECT_EQ(future.get(), PV::kConversionError);
+}
+
+TEST(LoopbackTransport, ErrorWithoutCallbackIsCounted) {
+    auto transport = std::make_shared<LoopbackTransport>();
+    transport->AddPV("LB:STRO", Scalar(std::string("abc")));
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:STRO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    // Would have thrown on the callback thread
+    ASSERT_TRUE(pv->GetCBAs<double>([](double) {}, 1s));
+    EXPECT_TRUE(WaitFor([&] { return pv->DroppedErrors() == 1; }));
+}
+
+TEST(LoopbackTransport, LatencyDelaysReplies) {
+    LoopbackOptions options;
+    options.latency = 20ms;
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    std::promise<void> done;
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(pv->GetCB([&](PVData) { done.set_value(); }, 1s));
+
+    auto future = done.get_future();
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+}
+
+TEST(LoopbackTransport, UpdateRateDrivesMonitors) {
+    LoopbackOptions options;
+    options.update_rate_hz = 1000;
+    auto transport = std::make_shared<LoopbackTransport>(options);
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+
+    EXPECT_TRUE(WaitFor([&] { return pv->UpdateCount() >= 10; }));
+    EXPECT_GE(pv->GetAs<double>(), 9.0);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include "epics/monitor_filter.h"
+
+using namespace bchtree::epics;
+using namespace std::chrono_literals;
+
+namespace {
+
+PVData Scalar(double value, uint32_t severity = 0) {
+    PVData data{};
+    data.value = PVScalarValue{value};
+    data.meta.severity = severity;
+    data.count = 1;
+    return data;
+}
+
+const auto kStart = std::chrono::steady_clock::time_point{};
+
+}  // namespace
+
+TEST(MonitorFilterTest, DefaultPassesEverything) {
+    MonitorFilter filter;
+    EXPECT_FALSE(filter.Active());
+    EXPECT_TRUE(filter.Accept(Scalar(1), kStart));
+    EXPECT_TRUE(filter.Accept(Scalar(1), kStart));
+}
+
+TEST(MonitorFilterTest, AbsoluteDeadband) {
+    MonitorOptions options;
+    options.abs_deadband = 0.5;
+    MonitorFilter filter(options);
+
+    EXPECT_TRUE(filter.Accept(Scalar(1.0), kStart));
+    EXPECT_FALSE(filter.Accept(Scalar(1.4), kStart));
+    EXPECT_FALSE(filter.Accept(Scalar(1.5), kStart));
+    EXPECT_TRUE(filter.Accept(Scalar(1.6), kStart));
+    // Compared with the last delivered value, not the last received one
+    EXPECT_FALSE(filter.Accept(Scalar(2.0), kStart));
+    EXPECT_TRUE(filter.Accept(Scalar(0.5), kStart));
+}
+
+TEST(MonitorFilterTest, RelativeDeadband) {
+    MonitorOptions options;
+    options.rel_deadband = 0.1;
+    MonitorFilter filter(options);
+
+    EXPECT_TRUE(filter.Accept(Scalar(100), kStart));
+    EXPECT_FALSE(filter.Accept(Scalar(105), kStart));
+    EXPECT_TRUE(filter.Accept(Scalar(111), kStart));
+}
+
+TEST(MonitorFilterTest, MaxRate) {
+    MonitorOptions options;
+    options.max_rate_hz = 10;
+    MonitorFilter filter(options);
+
+    EXPECT_TRUE(filter.Accept(Scalar(1), kStart));
+    EXPECT_FALSE(filter.Accept(Scalar(2), kStart + 50ms));
+    EXPECT_TRUE(filter.Accept(Scalar(3), kStart + 100ms));
+    EXPECT_FALSE(filter.Accept(Scalar(4), kStart + 150ms));
+}
+
+TEST(MonitorFilterTest, AlarmChangesAlwaysPass) {
+    MonitorOptions options;
+    options.abs_deadband = 10;
+    options.max_rate_hz = 1;
+    MonitorFilter filter(options);
+
+    EXPECT_TRUE(filter.Accept(Scalar(1), kStart));
+    EXPECT_TRUE(filter.Accept(Scalar(1, 2), kStart + 1ms));
+    EXPECT_FALSE(filter.Accept(Scalar(1, 2), kStart + 2ms));
+    EXPECT_TRUE(filter.Accept(Scalar(1, 0), kStart + 3ms));
+}
+
+TEST(MonitorFilterTest, DeadbandSkipsArrays) {
+    MonitorOptions options;
+    options.abs_deadband = 10;
+    MonitorFilter filter(options);
+
+    PVData array{};
+    array.value = PVArrayValue{
+        PVArray<double>(std::make_shared<const std::vector<double>>(3, 1.0))};
+    EXPECT_TRUE(filter.Accept(array, kStart));
+    EXPECT_TRUE(filter.Accept(array, kStart));
+}
+
+TEST(MonitorOptionsTest, ParsesSpec) {
+    const auto options = ParseMonitorOptions(
+        R"(events=value,log deadband=0.5 rel_deadband=0.01 max_rate=20 )"
+        R"(filter={"dbnd":{"abs":1}} history=500)");
+
+    EXPECT_EQ(options.events, kMonitorValue | kMonitorLog);
+    EXPECT_DOUBLE_EQ(options.abs_deadband, 0.5);
+    EXPECT_DOUBLE_EQ(options.rel_deadband, 0.01);
+    EXPECT_DOUBLE_EQ(options.max_rate_hz, 20);
+    EXPECT_EQ(options.server_filter, R"({"dbnd":{"abs":1}})");
+    EXPECT_EQ(options.history, 500u);
+
+    EXPECT_EQ(ParseMonitorOptions(""), MonitorOptions{});
+}
+
+TEST(MonitorOptionsTest, ThrowsOnMalformedSpec) {
+    EXPECT_THROW(ParseMonitorOptions("deadband"), std::invalid_argument);
+    EXPECT_THROW(ParseMonitorOptions("deadband=-1"), std::invalid_argument);
+    EXPECT_THROW(ParseMonitorOptions("max_rate=fast"), std::invalid_argument);
+    EXPECT_THROW(ParseMonitorOptions("events=often"), std::invalid_argument);
+    EXPECT_THROW(ParseMonitorOptions("history=1.5"), std::invalid_argument);
+    EXPECT_THROW(ParseMonitorOptions("period=1"), std::invalid_argument);
+}
+
+TEST(MonitorOptionsTest, ParsesConfig) {
+    const auto config = ParseMonitorConfig(
+        "# noisy BPMs\n"
+        "SR:BPM{1..2}:X  deadband=0.01 max_rate=10\n"
+        "\n"
+        "SR:DCCT  events=log  # archive deadband\n");
+
+    ASSERT_EQ(config.size(), 3u);
+    EXPECT_EQ(config[0].first, "SR:BPM1:X");
+    EXPECT_EQ(config[1].first, "SR:BPM2:X");
+    EXPECT_DOUBLE_EQ(config[1].second.max_rate_hz, 10);
+    EXPECT_EQ(config[2].first, "SR:DCCT");
+    EXPECT_EQ(config[2].second.events, kMonitorLog);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "epics/pv_cache.h"
+
+using namespace bchtree::epics;
+
+static PVData MakeDouble(double v) {
+    PVData d;
+    d.value = PVScalarValue{v};
+    d.count = 1;
+    return d;
+}
+
+TEST(PVCacheTest, EmptyUntilFirstPublish) {
+    PVCache cache;
+    EXPECT_EQ(cache.Load(), nullptr);
+    EXPECT_EQ(cache.Version(), 0u);
+}
+
+TEST(PVCacheTest, PublishIncrementsVersion) {
+    PVCache cache;
+    EXPECT_EQ(cache.Publish(MakeDouble(1.0)), 1u);
+    EXPECT_EQ(cache.Publish(MakeDouble(2.0)), 2u);
+
+    auto snap = cache.Load();
+    ASSERT_NE(snap, nullptr);
+    EXPECT_EQ(snap->version, 2u);
+    EXPECT_EQ(cache.Version(), 2u);
+    EXPECT_DOUBLE_EQ(
+        std::get<double>(std::get<PVScalarValue>(snap->data.value)), 2.0);
+}
+
+TEST(PVCacheTest, LoadNumericKeepsScalarType) {
+    PVCache cache;
+    EXPECT_FALSE(cache.LoadNumeric().has_value());
+
+    cache.Publish(MakeDouble(2.5));
+    auto v = cache.LoadNumeric();
+    ASSERT_TRUE(v.has_value());
+    EXPECT_DOUBLE_EQ(std::get<double>(*v), 2.5);
+
+    PVData i;
+    i.value = PVScalarValue{int32_t{-7}};
+    cache.Publish(i);
+    v = cache.LoadNumeric();
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<int32_t>(*v), -7);
+
+    PVData s;
+    s.value = PVScalarValue{std::string("text")};
+    cache.Publish(s);
+    EXPECT_FALSE(cache.LoadNumeric().has_value());
+}
+
+TEST(PVCacheTest, SnapshotOutlivesLaterUpdates) {
+    PVCache cache;
+    cache.Publish(MakeDouble(1.0));
+    auto old = cache.Load();
+    // Enough updates to go through every spare snapshot
+    for (int i = 2; i <= 20; ++i) cache.Publish(MakeDouble(i));
+
+    EXPECT_EQ(old->version, 1u);
+    EXPECT_DOUBLE_EQ(
+        std::get<double>(std::get<PVScalarValue>(old->data.value)), 1.0);
+}
+
+TEST(PVCacheTest, ReusesReleasedSnapshots) {
+    PVCache cache;
+    std::vector<const PVSnapshot*> seen;
+    for (int i = 1; i <= 20; ++i) {
+        cache.Publish(MakeDouble(i));
+        seen.push_back(cache.Load().get());
+    }
+    // A handful of snapshots take turns
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+    EXPECT_LE(seen.size(), 3u);
+
+    auto snap = cache.Load();
+    EXPECT_EQ(snap->version, 20u);
+    EXPECT_DOUBLE_EQ(
+        std::get<double>(std::get<PVScalarValue>(snap->data.value)), 20.0);
+}
+
+TEST(PVCacheTest, ReadersSeeConsistentMonotonicSnapshots) {
+    PVCache cache;
+    constexpr int kUpdates = 20000;
+    std::atomic<bool> stop{false};
+
+    // The value always equals the version, so a torn read would show
+    std::thread writer([&] {
+        for (int i = 1; i <= kUpdates; ++i) {
+            cache.Publish(MakeDouble(static_cast<double>(i)));
+        }
+        stop = true;
+    });
+
+    std::vector<std::thread> readers;
+    std::atomic<int> errors{0};
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while (!stop) {
+                auto snap = cache.Load();
+                if (!snap) continue;
+                const double v =
+                    std::get<double>(std::get<PVScalarValue>(snap->data.value));
+                if (v != static_cast<double>(snap->version) ||
+                    snap->version < last) {
+                    ++errors;
+                }
+                last = snap->version;
+
+                if (auto num = cache.LoadNumeric()) {
+                    if (std::get<double>(*num) < v) ++errors;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& t : readers) t.join();
+
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_EQ(cache.Version(), static_cast<uint64_t>(kUpdates));
+}
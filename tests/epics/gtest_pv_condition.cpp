@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "epics/pv_condition.h"
+
+using namespace bchtree::epics;
+using Op = PVCondition::Op;
+
+namespace {
+
+PVData Scalar(PVScalarValue value) { return PVData{std::move(value), {}, 1}; }
+
+}  // namespace
+
+TEST(PVConditionTest, ParsesOps) {
+    EXPECT_EQ(PVCondition::ParseOp("eq"), Op::kEq);
+    EXPECT_EQ(PVCondition::ParseOp(">="), Op::kGe);
+    EXPECT_EQ(PVCondition::ParseOp("within"), Op::kWithin);
+    EXPECT_THROW(PVCondition::ParseOp("about"), std::invalid_argument);
+}
+
+TEST(PVConditionTest, ComparesNumbers) {
+    EXPECT_TRUE(PVCondition(Op::kEq, 3).Matches(Scalar(3.0)));
+    EXPECT_FALSE(PVCondition(Op::kNe, 3).Matches(Scalar(int32_t{3})));
+    EXPECT_TRUE(PVCondition(Op::kLt, 3).Matches(Scalar(2.5)));
+    EXPECT_FALSE(PVCondition(Op::kGt, 3).Matches(Scalar(3.0)));
+    EXPECT_TRUE(PVCondition(Op::kGe, 3).Matches(Scalar(3.0)));
+    EXPECT_TRUE(PVCondition(Op::kLe, 1).Matches(Scalar(uint16_t{1})));
+}
+
+TEST(PVConditionTest, Within) {
+    PVCondition near(Op::kWithin, 10.0, 0.5);
+    EXPECT_TRUE(near.Matches(Scalar(10.4)));
+    EXPECT_TRUE(near.Matches(Scalar(9.5)));
+    EXPECT_FALSE(near.Matches(Scalar(10.6)));
+}
+
+TEST(PVConditionTest, Mask) {
+    // Bit 1 set, bit 2 clear
+    PVCondition bits(Op::kMask, 0x2, 0.0, 0x6);
+    EXPECT_TRUE(bits.Matches(Scalar(int32_t{0x3})));
+    EXPECT_FALSE(bits.Matches(Scalar(int32_t{0x6})));
+}
+
+TEST(PVConditionTest, StateAndStrings) {
+    EXPECT_TRUE(PVCondition(Op::kState, std::string("OPEN"))
+                    .Matches(Scalar(std::string("OPEN"))));
+    EXPECT_TRUE(
+        PVCondition(Op::kState, std::string("2")).Matches(Scalar(uint16_t{2})));
+    EXPECT_TRUE(
+        PVCondition(Op::kState, std::string("1.5")).Matches(Scalar(1.5)));
+    EXPECT_TRUE(PVCondition(Op::kNe, std::string("OPEN"))
+                    .Matches(Scalar(std::string("CLOSED"))));
+}
+
+TEST(PVConditionTest, EnumStateNames) {
+    const std::vector<std::string> states{"CLOSED", "OPEN"};
+    PVCondition open(Op::kState, std::string("OPEN"));
+    EXPECT_TRUE(open.Matches(Scalar(uint16_t{1}), &states));
+    EXPECT_FALSE(open.Matches(Scalar(uint16_t{0}), &states));
+    // Names not known yet, or an index past them
+    EXPECT_FALSE(open.Matches(Scalar(uint16_t{1})));
+    EXPECT_FALSE(open.Matches(Scalar(uint16_t{5}), &states));
+    // The index still matches
+    EXPECT_TRUE(PVCondition(Op::kState, std::string("1"))
+                    .Matches(Scalar(uint16_t{1}), &states));
+}
+
+TEST(PVConditionTest, RejectsArraysAndTextOperands) {
+    PVData array{};
+    array.value = PVArrayValue{
+        PVArray<double>(std::make_shared<const std::vector<double>>(1, 1.0))};
+    EXPECT_FALSE(PVCondition(Op::kEq, 1.0).Matches(array));
+
+    EXPECT_THROW(PVCondition(Op::kGt, std::string("high")),
+                 std::invalid_argument);
+}
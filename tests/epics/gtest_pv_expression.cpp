@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "epics/pv_expression.h"
+
+using bchtree::epics::PVExpression;
+using Names = std::vector<std::string>;
+
+namespace {
+
+double Eval(const std::string& text, std::vector<double> values = {}) {
+    return PVExpression::Compile(text).Evaluate(values);
+}
+
+}  // namespace
+
+TEST(PVExpressionTest, CollectsNamesInOrderOfFirstUse) {
+    auto expr = PVExpression::Compile("(A:CUR * 1.2 + B:OFF) > LIM + A:CUR");
+    EXPECT_EQ(expr.Names(), (Names{"A:CUR", "B:OFF", "LIM"}));
+    EXPECT_EQ(expr.Evaluate({10, 1, 20}), 0);
+    EXPECT_EQ(expr.Evaluate({10, 10, 11}), 1);
+}
+
+TEST(PVExpressionTest, FollowsCPrecedence) {
+    EXPECT_DOUBLE_EQ(Eval("1 + 2 * 3 - 4 / 2"), 5);
+    EXPECT_DOUBLE_EQ(Eval("-(1 + 2) * 3"), -9);
+    EXPECT_DOUBLE_EQ(Eval("7 % 4 + 2e1"), 23);
+    EXPECT_EQ(Eval("1 < 2 == 2 > 1"), 1);
+    EXPECT_EQ(Eval("1 || 0 && 0"), 1);
+    EXPECT_DOUBLE_EQ(Eval("0 ? 1 : 2 ? 3 : 4"), 3);
+}
+
+TEST(PVExpressionTest, LogicAndFunctions) {
+    EXPECT_EQ(Eval("not A and B or !C", {0, 1, 1}), 1);
+    EXPECT_EQ(Eval("A && B", {NAN, 1}), 0);
+    EXPECT_DOUBLE_EQ(Eval("max(abs(A), pow(2, 3)) + min(A, 1)", {-9}), 0);
+    EXPECT_DOUBLE_EQ(Eval("sqrt(floor(16.5)) + ceil(0.1)"), 5);
+    EXPECT_TRUE(std::isnan(Eval("log(-1)")));
+}
+
+TEST(PVExpressionTest, QuotedAndNumericLookingNames) {
+    auto expr = PVExpression::Compile("'LI-01:CUR' - 13BMD:m1 + 'and'");
+    EXPECT_EQ(expr.Names(), (Names{"LI-01:CUR", "13BMD:m1", "and"}));
+    EXPECT_DOUBLE_EQ(expr.Evaluate({5, 2, 1}), 4);
+}
+
+TEST(PVExpressionTest, ConditionalNeedsSpaceBeforeColon) {
+    EXPECT_DOUBLE_EQ(Eval("A ? B : 2", {1, 5}), 5);
+    // "B:2" is one name
+    EXPECT_THROW(PVExpression::Compile("A ? B:2"), std::invalid_argument);
+}
+
+TEST(PVExpressionTest, RejectsSyntaxErrors) {
+    for (const char* text : {"", "1 +", "(A", "A B", "foo(1)", "min(1)",
+                             "A # B", "''", "'A", "1 ? 2"}) {
+        EXPECT_THROW(PVExpression::Compile(text), std::invalid_argument)
+            << text;
+    }
+
+    // Constants fold, so only nested operands can overflow the stack
+    std::string deep = "A";
+    for (int i = 0; i < 100; ++i) deep = "A + (" + deep + ")";
+    EXPECT_THROW(PVExpression::Compile(deep), std::invalid_argument);
+    EXPECT_DOUBLE_EQ(Eval(std::string(100, '-') + "1"), 1);
+}
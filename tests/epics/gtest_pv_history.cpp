@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "epics/pv_history.h"
+
+using namespace bchtree::epics;
+using namespace std::chrono_literals;
+
+namespace {
+
+const auto kStart = std::chrono::steady_clock::time_point{};
+
+PVSample At(std::chrono::milliseconds offset, double value) {
+    return {kStart + offset, value};
+}
+
+}  // namespace
+
+TEST(PVHistoryTest, ReadsSinceSequence) {
+    PVHistory history(4);
+    history.Push(At(0ms, 1));
+    history.Push(At(1ms, 2));
+
+    std::vector<PVSample> out;
+    uint64_t next = history.ReadSince(0, out);
+    EXPECT_EQ(next, 2u);
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[1].value, 2);
+
+    history.Push(At(2ms, 3));
+    out.clear();
+    next = history.ReadSince(next, out);
+    EXPECT_EQ(next, 3u);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].value, 3);
+}
+
+TEST(PVHistoryTest, SkipsOverwrittenSamples) {
+    PVHistory history(3);
+    for (int i = 0; i < 5; ++i) {
+        history.Push(At(std::chrono::milliseconds(i), i));
+    }
+
+    std::vector<PVSample> out;
+    EXPECT_EQ(history.ReadSince(0, out), 5u);
+    ASSERT_EQ(out.size(), 3u);
+    EXPECT_EQ(out.front().value, 2);
+    EXPECT_EQ(out.back().value, 4);
+    EXPECT_THROW(PVHistory(0), std::invalid_argument);
+}
+
+TEST(WindowStatsTest, CountWindow) {
+    auto window = WindowStats::OverCount(3);
+    for (double v : {5.0, 1.0, 3.0, 2.0}) {
+        window.Add(At(0ms, v));
+    }
+
+    // 1, 3, 2 remain
+    EXPECT_EQ(window.Count(), 3u);
+    EXPECT_DOUBLE_EQ(window.Mean(), 2.0);
+    EXPECT_DOUBLE_EQ(window.Min(), 1.0);
+    EXPECT_DOUBLE_EQ(window.Max(), 3.0);
+    EXPECT_DOUBLE_EQ(window.Stddev(), 1.0);
+
+    window.Add(At(0ms, 4.0));  // 3, 2, 4
+    EXPECT_DOUBLE_EQ(window.Min(), 2.0);
+    EXPECT_DOUBLE_EQ(window.Max(), 4.0);
+}
+
+TEST(WindowStatsTest, TimeWindowExpires) {
+    auto window = WindowStats::OverTime(100ms);
+    window.Add(At(0ms, 10));
+    window.Add(At(50ms, 20));
+    window.Add(At(120ms, 30));
+
+    window.Expire(kStart + 130ms);
+    EXPECT_EQ(window.Count(), 2u);
+    EXPECT_DOUBLE_EQ(window.Mean(), 25);
+    EXPECT_DOUBLE_EQ(window.Min(), 20);
+    EXPECT_DOUBLE_EQ(window.Rate(), 20);
+
+    window.Expire(kStart + 300ms);
+    EXPECT_EQ(window.Count(), 0u);
+    EXPECT_DOUBLE_EQ(window.Rate(), 0);
+
+    // Sums restart from the next sample
+    window.Add(At(310ms, 1e9 + 1));
+    window.Add(At(320ms, 1e9 + 3));
+    EXPECT_DOUBLE_EQ(window.Mean(), 1e9 + 2);
+    EXPECT_NEAR(window.Stddev(), std::sqrt(2.0), 1e-9);
+}
+
+TEST(WindowStatsTest, CountWindowRate) {
+    auto window = WindowStats::OverCount(10);
+    window.Add(At(0ms, 1));
+    EXPECT_DOUBLE_EQ(window.Rate(), 0);
+    window.Add(At(100ms, 1));
+    window.Add(At(200ms, 1));
+    EXPECT_DOUBLE_EQ(window.Rate(), 10);
+}
@@ -0,0 +1,305 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "epics/ca/ca_transport.h"
+#include "epics/loopback/loopback_transport.h"
+#include "epics/pv_manager.h"
+#include "softioc_fixture.h"
+
+using namespace bchtree::epics;
+using namespace bchtree::epics::ca;
+using namespace std::chrono_literals;
+
+namespace {
+
+bool WaitForValue(const PV& pv) {
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (!pv.HasValue() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    return pv.HasValue();
+}
+
+}  // namespace
+
+class PVManagerTest : public ::testing::Test {
+   protected:
+    static inline auto transport_{
+        std::make_shared<CATransport>(std::make_shared<CAContextManager>())};
+    std::unique_ptr<PVManager> manager_{
+        std::make_unique<PVManager>(transport_)};
+};
+
+TEST_F(PVManagerTest, ReturnsSameInstanceWhileAlive) {
+    auto p1 = manager_->Get("TEST:PV1");
+    auto p2 = manager_->Get("TEST:PV1");
+
+    EXPECT_EQ(p1.get(), p2.get());
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, RecreatesAfterLastExternalReleased) {
+    {
+        auto p = manager_->Get("TEST:PV2");
+        EXPECT_EQ(manager_->RegistrySize(), 1u);
+    }  // p goes out of scope -> only weak_ptr remains
+
+    // GC should remove the expired entry
+    EXPECT_EQ(manager_->CollectGarbage(), 1u);
+    EXPECT_EQ(manager_->RegistrySize(), 0u);
+
+    // A new instance should be created
+    auto p2 = manager_->Get("TEST:PV2");
+    EXPECT_NE(p2, nullptr);
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, FindDoesNotCreate) {
+    EXPECT_EQ(manager_->Find("TEST:PV5"), nullptr);
+    EXPECT_EQ(manager_->RegistrySize(), 0u);
+
+    auto p = manager_->Get("TEST:PV5");
+    EXPECT_EQ(manager_->Find("TEST:PV5"), p);
+
+    p.reset();
+    EXPECT_EQ(manager_->Find("TEST:PV5"), nullptr);
+}
+
+TEST_F(PVManagerTest, CollectGarbageCountsExpiredOnly) {
+    auto alive = manager_->Get("TEST:PV3");
+    {
+        auto temp = manager_->Get("TEST:PV4");
+        EXPECT_EQ(manager_->RegistrySize(), 2u);
+        // After temp destroyed, PV4 loses all external refs
+    }
+
+    // GC removes PV4 but keeps PV3
+    EXPECT_EQ(manager_->CollectGarbage(), 1u);
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, RemoveErasesRegistryEvenIfAlive) {
+    auto p = manager_->Get("TEST:PV5");
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+
+    manager_->Remove("TEST:PV5");
+    EXPECT_EQ(manager_->RegistrySize(), 0u);
+
+    // External shared_ptr 'p' remains valid
+    EXPECT_NE(p, nullptr);
+
+    // Get again should create a new instance (different pointer)
+    auto p2 = manager_->Get("TEST:PV5");
+    EXPECT_NE(p.get(), p2.get());
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, ShutdownClearsRegistry) {
+    auto p = manager_->Get("TEST:PV6");
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+
+    manager_->Shutdown();
+    EXPECT_EQ(manager_->RegistrySize(), 0u);
+
+    // External shared_ptr remains valid
+    EXPECT_NE(p, nullptr);
+}
+
+TEST_F(PVManagerTest, ConcurrentGetSingleCreation) {
+    const int N = 8;
+    std::vector<std::shared_ptr<PV>> results(N);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < N; ++i) {
+        threads.emplace_back(
+            [&, i] { results[i] = manager_->Get("TEST:PV7"); });
+    }
+    for (auto& t : threads) t.join();
+
+    // All threads should obtain the same instance
+    auto* first = results[0].get();
+    for (int i = 1; i < N; ++i) {
+        EXPECT_EQ(first, results[i].get());
+    }
+
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, DifferentNamesAreDifferentInstances) {
+    auto a = manager_->Get("TEST:PV8A");
+    auto b = manager_->Get("TEST:PV8B");
+
+    EXPECT_NE(a.get(), b.get());
+    EXPECT_EQ(manager_->RegistrySize(), 2u);
+}
+
+TEST_F(PVManagerTest, LookupByStringView) {
+    const std::string name = "TEST:PV9";
+    auto p1 = manager_->Get(name);
+    auto p2 = manager_->Get(std::string_view(name));
+
+    EXPECT_EQ(p1.get(), p2.get());
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, GetManyMatchesGet) {
+    std::vector<std::string> names;
+    for (int i = 0; i < 40; ++i) {
+        names.push_back("TEST:MANY" + std::to_string(i));
+    }
+    names.push_back("TEST:MANY0");  // duplicate
+
+    auto single = manager_->Get("TEST:MANY1");
+    auto pvs = manager_->GetMany(names);
+
+    ASSERT_EQ(pvs.size(), names.size());
+    EXPECT_EQ(pvs[1].get(), single.get());
+    EXPECT_EQ(pvs[0].get(), pvs.back().get());
+    EXPECT_EQ(manager_->RegistrySize(), 40u);
+}
+
+TEST_F(PVManagerTest, HandleResolvesToSameInstance) {
+    auto handle = manager_->Intern("TEST:PV10");
+    ASSERT_TRUE(handle);
+    EXPECT_EQ(handle.name(), "TEST:PV10");
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+
+    auto p1 = manager_->Get(handle);
+    auto p2 = manager_->Get("TEST:PV10");
+    EXPECT_EQ(p1.get(), p2.get());
+}
+
+TEST_F(PVManagerTest, HandleSurvivesRemove) {
+    auto handle = manager_->Intern("TEST:PV11");
+    auto p1 = manager_->Get(handle);
+
+    manager_->Remove("TEST:PV11");
+    EXPECT_EQ(manager_->RegistrySize(), 0u);
+
+    // The handle goes back through the registry and re-registers the name
+    auto p2 = manager_->Get(handle);
+    EXPECT_NE(p1.get(), p2.get());
+    EXPECT_EQ(p2.get(), manager_->Get("TEST:PV11").get());
+    EXPECT_EQ(manager_->RegistrySize(), 1u);
+}
+
+TEST_F(PVManagerTest, EmptyHandleThrows) {
+    PVHandle handle;
+    EXPECT_FALSE(handle);
+    EXPECT_THROW(manager_->Get(handle), std::invalid_argument);
+}
+
+TEST(PVManagerSchemeTest, RoutesNamesByScheme) {
+    auto ca = std::make_shared<loopback::LoopbackTransport>();
+    auto pva = std::make_shared<loopback::LoopbackTransport>();
+    pva->AddPV("SR:X", PVData{PVScalarValue{2.0}, {}, 1});
+
+    PVManager manager(ca);
+    manager.AddTransport("pva", pva);
+
+    EXPECT_TRUE(manager.Serves("SR:X"));
+    EXPECT_TRUE(manager.Serves("pva://SR:X"));
+    EXPECT_FALSE(manager.Serves("xyz://SR:X"));
+    EXPECT_THROW(manager.Get("xyz://SR:X"), std::invalid_argument);
+
+    auto plain = manager.Get("SR:X");
+    auto prefixed = manager.Get("pva://SR:X");
+    EXPECT_NE(plain.get(), prefixed.get());
+    EXPECT_EQ(prefixed->GetPVname(), "SR:X");
+
+    ASSERT_TRUE(manager.ConnectAll({plain, prefixed}, 1s).empty());
+    ASSERT_TRUE(WaitForValue(*prefixed));
+    ASSERT_TRUE(WaitForValue(*plain));
+    EXPECT_DOUBLE_EQ(prefixed->GetAs<double>(), 2.0);
+    EXPECT_DOUBLE_EQ(plain->GetAs<double>(), 0.0);
+}
+
+TEST(PVManagerMonitorTest, AppliesMonitorOptions) {
+    auto transport = std::make_shared<loopback::LoopbackTransport>();
+    PVManager manager(transport);
+    MonitorOptions options;
+    options.abs_deadband = 1.0;
+    manager.SetMonitorOptions("LB:X", options);
+
+    auto pv = manager.Get("LB:X");
+    EXPECT_DOUBLE_EQ(pv->GetMonitorOptions().abs_deadband, 1.0);
+    EXPECT_DOUBLE_EQ(manager.Get("LB:Y")->GetMonitorOptions().abs_deadband,
+                     0.0);
+
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+    ASSERT_TRUE(WaitForValue(*pv));
+
+    transport->SetValue("LB:X", 0.5);
+    transport->SetValue("LB:X", 2.0);
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (pv->MonitorCounts().delivered < 2 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    EXPECT_DOUBLE_EQ(pv->GetAs<double>(), 2.0);
+    EXPECT_EQ(pv->MonitorCounts().delivered, 2u);
+    EXPECT_EQ(pv->MonitorCounts().dropped, 1u);
+    EXPECT_EQ(manager.MonitorCounts().dropped, 1u);
+}
+
+TEST(PVManagerMonitorTest, AppliesMonitorOptionsToLivePV) {
+    auto transport = std::make_shared<loopback::LoopbackTransport>();
+    PVManager manager(transport);
+    auto pv = manager.Get("LB:X");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+    ASSERT_TRUE(WaitForValue(*pv));
+
+    MonitorOptions options;
+    options.abs_deadband = 1.0;
+    options.history = 8;
+    EXPECT_TRUE(manager.SetMonitorOptions("LB:X", options));
+    EXPECT_DOUBLE_EQ(pv->GetMonitorOptions().abs_deadband, 1.0);
+    EXPECT_NE(pv->History(), nullptr);
+
+    // The new filter passes its first update and drops the small step
+    transport->SetValue("LB:X", 5.0);
+    transport->SetValue("LB:X", 5.5);
+    transport->SetValue("LB:X", 7.0);
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (pv->GetAs<double>() != 7.0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_DOUBLE_EQ(pv->GetAs<double>(), 7.0);
+    EXPECT_EQ(pv->MonitorCounts().dropped, 1u);
+}
+
+TEST_F(SoftIocFixture, PVManager_ConnectAllReportsMissing) {
+    PVManager manager(transport_);
+    auto pvs = manager.GetMany({"TEST:AO", "TEST:LO", "TEST:NO_SUCH_PV"});
+
+    const auto start = std::chrono::steady_clock::now();
+    auto missing = manager.ConnectAll(pvs, std::chrono::milliseconds(1000));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(missing.size(), 1u);
+    EXPECT_EQ(missing[0], "TEST:NO_SUCH_PV");
+    EXPECT_TRUE(pvs[0]->IsConnected());
+    EXPECT_TRUE(pvs[1]->IsConnected());
+    EXPECT_GE(elapsed, std::chrono::milliseconds(1000));
+}
+
+TEST_F(SoftIocFixture, PVManager_ConnectAllReturnsOnceConnected) {
+    PVManager manager(transport_);
+    auto pvs = manager.GetMany({"TEST:AO", "TEST:STRO"});
+
+    const auto start = std::chrono::steady_clock::now();
+    auto missing = manager.ConnectAll(pvs, std::chrono::seconds(10));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_TRUE(missing.empty());
+    EXPECT_LT(elapsed, std::chrono::seconds(10));
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "epics/pv_names.h"
+
+using bchtree::epics::ExpandPVNames;
+using bchtree::epics::kMaxExpandedNames;
+using bchtree::epics::SplitPVScheme;
+using bchtree::epics::WithChannelFilter;
+using bchtree::epics::WithPVScheme;
+using Names = std::vector<std::string>;
+
+TEST(PVNamesTest, SplitsOnWhitespaceAndSemicolon) {
+    EXPECT_EQ(ExpandPVNames("A:1 A:2;A:3\n A:4 ;"),
+              (Names{"A:1", "A:2", "A:3", "A:4"}));
+    EXPECT_TRUE(ExpandPVNames("  ").empty());
+}
+
+TEST(PVNamesTest, ExpandsZeroPaddedRange) {
+    EXPECT_EQ(ExpandPVNames("SR:BPM{08..10}:X"),
+              (Names{"SR:BPM08:X", "SR:BPM09:X", "SR:BPM10:X"}));
+    EXPECT_EQ(ExpandPVNames("M{3..1}"), (Names{"M3", "M2", "M1"}));
+}
+
+TEST(PVNamesTest, ExpandsAlternativesAndNesting) {
+    EXPECT_EQ(ExpandPVNames("MAG:{QF,QD}:I"),
+              (Names{"MAG:QF:I", "MAG:QD:I"}));
+    EXPECT_EQ(ExpandPVNames("B{1..2}:{X,Y}"),
+              (Names{"B1:X", "B1:Y", "B2:X", "B2:Y"}));
+    EXPECT_EQ(ExpandPVNames("{A,B{1..2}}"), (Names{"A", "B1", "B2"}));
+}
+
+TEST(PVNamesTest, ThrowsOnUnbalancedBraces) {
+    EXPECT_THROW(ExpandPVNames("A{1..2"), std::invalid_argument);
+    EXPECT_THROW(ExpandPVNames("A}"), std::invalid_argument);
+}
+
+TEST(PVNamesTest, ThrowsOnTooManyNames) {
+    EXPECT_EQ(ExpandPVNames("X{1..10000}").size(), kMaxExpandedNames);
+    EXPECT_THROW(ExpandPVNames("X{0..99999999}"), std::invalid_argument);
+    EXPECT_THROW(ExpandPVNames("X{-9223372036854775807..1}"),
+                 std::invalid_argument);
+    // Each range is small, their product is not
+    EXPECT_THROW(ExpandPVNames("X{0..999}{0..999}"), std::invalid_argument);
+    EXPECT_THROW(ExpandPVNames("A{1..6000} B{1..6000}"),
+                 std::invalid_argument);
+}
+
+TEST(PVNamesTest, SplitsScheme) {
+    auto [scheme, name] = SplitPVScheme("pva://SR:BPM01:X");
+    EXPECT_EQ(scheme, "pva");
+    EXPECT_EQ(name, "SR:BPM01:X");
+
+    std::tie(scheme, name) = SplitPVScheme("SR:BPM01:X");
+    EXPECT_TRUE(scheme.empty());
+    EXPECT_EQ(name, "SR:BPM01:X");
+}
+
+TEST(PVNamesTest, AddsSchemeOnlyWhenMissing) {
+    EXPECT_EQ(WithPVScheme("pva", "SR:X"), "pva://SR:X");
+    EXPECT_EQ(WithPVScheme("pva", "ca://SR:X"), "ca://SR:X");
+    EXPECT_EQ(WithPVScheme("", "SR:X"), "SR:X");
+}
+
+TEST(PVNamesTest, AppendsChannelFilter) {
+    const std::string filter = R"({"dbnd":{"abs":1}})";
+    EXPECT_EQ(WithChannelFilter("SR:X", filter), "SR:X." + filter);
+    EXPECT_EQ(WithChannelFilter("SR:X.VAL", filter), "SR:X.VAL" + filter);
+    EXPECT_EQ(WithChannelFilter("SR:X", ""), "SR:X");
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "epics/pv_table.h"
+
+using namespace bchtree::epics;
+
+TEST(PVTableTest, ParsesScalarTypes) {
+    EXPECT_EQ(std::get<int32_t>(ParsePVScalar("42")), 42);
+    EXPECT_DOUBLE_EQ(std::get<double>(ParsePVScalar(" 1.5e3 ")), 1500.0);
+    EXPECT_EQ(std::get<PVString>(ParsePVScalar("ON")).view(), "ON");
+    EXPECT_EQ(std::get<PVString>(ParsePVScalar("\"12\"")).view(), "12");
+}
+
+TEST(PVTableTest, ParsesEntriesAndComments) {
+    auto table = ParsePVPutTable(
+        "A:CUR 1.5   # setpoint\n"
+        "B:MODE=\"Run; fast\"; C:CNT = 3\n"
+        "# full line comment\n");
+
+    ASSERT_EQ(table.size(), 3u);
+    EXPECT_EQ(table[0].pv, "A:CUR");
+    EXPECT_DOUBLE_EQ(std::get<double>(table[0].value), 1.5);
+    EXPECT_EQ(table[1].pv, "B:MODE");
+    EXPECT_EQ(std::get<PVString>(table[1].value).view(), "Run; fast");
+    EXPECT_EQ(table[2].pv, "C:CNT");
+    EXPECT_EQ(std::get<int32_t>(table[2].value), 3);
+}
+
+TEST(PVTableTest, ExpandsPatternsWithSameValue) {
+    auto table = ParsePVPutTable("MAG:{QF,QD}:I 0");
+    ASSERT_EQ(table.size(), 2u);
+    EXPECT_EQ(table[0].pv, "MAG:QF:I");
+    EXPECT_EQ(table[1].pv, "MAG:QD:I");
+}
+
+TEST(PVTableTest, ThrowsOnMissingValue) {
+    EXPECT_THROW(ParsePVPutTable("A:CUR"), std::invalid_argument);
+    EXPECT_THROW(ParsePVPutTable("A:CUR ="), std::invalid_argument);
+}
+
+TEST(PVTableTest, LoadsFromFile) {
+    const std::string path = ::testing::TempDir() + "bch-pv-table.txt";
+    {
+        std::ofstream ofs(path);
+        ofs << "A:CUR 1\nB:CUR 2\n";
+    }
+    auto table = LoadPVPutTable(path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(table.size(), 2u);
+    EXPECT_THROW(LoadPVPutTable(path), std::runtime_error);
+}
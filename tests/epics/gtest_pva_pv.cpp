@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <pvxs/data.h>
+#include <pvxs/nt.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "epics/loopback/loopback_transport.h"
+#include "epics/pv_manager.h"
+#include "epics/pva/pva_pv.h"
+#include "epics/pva/pva_transport.h"
+#include "softioc_runner.h"
+
+using namespace bchtree::epics;
+using namespace bchtree::epics::pva;
+using namespace std::chrono_literals;
+
+// softIocPVA serves the records over pvAccess (QSRV) as well
+class PVAFixture : public ::testing::Test {
+   protected:
+    static inline SoftIocRunner runner_{};
+    static inline std::shared_ptr<PVATransport> transport_;
+
+    static void SetUpTestSuite() {
+        setenv("EPICS_PVA_AUTO_ADDR_LIST", "NO", 1);
+        setenv("EPICS_PVA_ADDR_LIST", "127.0.0.1", 1);
+        transport_ = std::make_shared<PVATransport>();
+
+        runner_.Start(R"DB(
+            record(ao, "PVA:AO") {
+                field(VAL,  "1.5")
+                field(PINI, "YES")
+            }
+            record(mbbo, "PVA:MBBO") {
+                field(ZRST, "Off")
+                field(ONST, "On")
+                field(VAL,  "1")
+                field(PINI, "YES")
+            }
+            record(waveform, "PVA:WF") {
+                field(FTVL, "DOUBLE")
+                field(NELM, "4")
+            }
+        )DB",
+                      "softIocPVA");
+
+        std::this_thread::sleep_for(800ms);
+    }
+    static void TearDownTestSuite() {
+        transport_.reset();
+        runner_.KillIfRunning();
+    }
+
+    // Wait for a get reply converted to T
+    template <typename T>
+    static T GetValue(PV& pv) {
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool done = false;
+        T value{};
+        pv.GetCBAs<T>(
+            [&](T v) {
+                std::lock_guard<std::mutex> lock(mtx);
+                value = std::move(v);
+                done = true;
+                cv.notify_one();
+            },
+            1s);
+        std::unique_lock<std::mutex> lock(mtx);
+        EXPECT_TRUE(cv.wait_for(lock, 2s, [&] { return done; }));
+        return value;
+    }
+
+    static bool Put(PV& pv, const PVScalarValue& v) {
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool done = false;
+        bool success = false;
+        pv.PutCB(v, [&](bool ok) {
+            std::lock_guard<std::mutex> lock(mtx);
+            success = ok;
+            done = true;
+            cv.notify_one();
+        });
+        std::unique_lock<std::mutex> lock(mtx);
+        EXPECT_TRUE(cv.wait_for(lock, 2s, [&] { return done; }));
+        return success;
+    }
+};
+
+TEST_F(PVAFixture, ConnectsAndMonitors) {
+    PVManager manager(transport_);
+    auto pv = manager.Get("PVA:AO");
+
+    EXPECT_TRUE(manager.ConnectAll({pv}, 2s).empty());
+
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (!pv->HasValue() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_TRUE(pv->HasValue());
+    EXPECT_DOUBLE_EQ(pv->GetAs<double>(), 1.5);
+}
+
+TEST_F(PVAFixture, PutThenGet) {
+    auto pv = transport_->CreatePV("PVA:AO");
+
+    ASSERT_TRUE(Put(*pv, PVScalarValue{2.25}));
+    EXPECT_DOUBLE_EQ(GetValue<double>(*pv), 2.25);
+}
+
+TEST_F(PVAFixture, EnumReadsAsIndex) {
+    auto pv = transport_->CreatePV("PVA:MBBO");
+
+    EXPECT_EQ(GetValue<uint16_t>(*pv), 1);
+    ASSERT_TRUE(Put(*pv, PVScalarValue{uint16_t{0}}));
+    EXPECT_EQ(GetValue<uint16_t>(*pv), 0);
+}
+
+TEST_F(PVAFixture, GetsArray) {
+    ASSERT_EQ(system("caput -a PVA:WF 3 1 2 3 > /dev/null"), 0);
+    auto pv = transport_->CreatePV("PVA:WF");
+
+    const auto arr = GetValue<PVArray<double>>(*pv);
+    ASSERT_TRUE(arr);
+    EXPECT_EQ(*arr, (std::vector<double>{1, 2, 3}));
+}
+
+TEST_F(PVAFixture, RoutesPvaScheme) {
+    PVManager manager(std::make_shared<loopback::LoopbackTransport>());
+    manager.AddTransport("pva", transport_);
+
+    auto pv = manager.Get("pva://PVA:AO");
+    EXPECT_EQ(pv->GetPVname(), "PVA:AO");
+    EXPECT_TRUE(manager.ConnectAll({pv}, 2s).empty());
+}
+
+TEST(PVAPVDecode, ScalarWithMeta) {
+    auto top = pvxs::nt::NTScalar{pvxs::TypeCode::Float64}.create();
+    top["value"] = 4.5;
+    top["alarm.severity"] = 2;
+    top["timeStamp.secondsPastEpoch"] = 10;
+
+    const auto data = PVAPV::DecodeValue(top);
+    EXPECT_DOUBLE_EQ(PV::extract_as<double>(data), 4.5);
+    EXPECT_EQ(data.meta.severity, 2u);
+    EXPECT_EQ(data.meta.timestamp,
+              std::chrono::system_clock::time_point(10s));
+}
+
+TEST(PVAPVDecode, WideIntegersReadAsDouble) {
+    auto top = pvxs::nt::NTScalar{pvxs::TypeCode::UInt32}.create();
+    top["value"] = uint32_t{4000000000u};
+    EXPECT_DOUBLE_EQ(PV::extract_as<double>(PVAPV::DecodeValue(top)),
+                     4000000000.0);
+
+    top = pvxs::nt::NTScalar{pvxs::TypeCode::Int64}.create();
+    top["value"] = int64_t{-(int64_t{1} << 40)};
+    EXPECT_DOUBLE_EQ(PV::extract_as<double>(PVAPV::DecodeValue(top)),
+                     -1099511627776.0);
+}
+
+TEST(PVAPVDecode, RejectsStructureWithoutValue) {
+    auto top = pvxs::TypeDef(pvxs::TypeCode::Struct,
+                             {pvxs::members::Int32("other")})
+                   .create();
+    EXPECT_THROW(PVAPV::DecodeValue(top), std::exception);
+}
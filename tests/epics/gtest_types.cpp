@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "epics/pv.h"
+#include "epics/types.h"
+
+using namespace bchtree::epics;
+
+TEST(PVStringTest, KeepsCAStringsInline) {
+    const std::string text(PVString::kInlineCapacity, 'x');
+    PVString s(text);
+    EXPECT_EQ(s.size(), text.size());
+    EXPECT_EQ(s.view(), text);
+
+    PVString copy = s;
+    EXPECT_EQ(copy, s);
+    EXPECT_NE(copy.view().data(), s.view().data());
+}
+
+TEST(PVStringTest, SharesLongerStrings) {
+    const std::string text(100, 'y');
+    PVString s(text);
+    EXPECT_EQ(s.str(), text);
+
+    PVString copy = s;
+    EXPECT_EQ(copy.view().data(), s.view().data());
+}
+
+TEST(PVStringTest, ExtractsAsStdString) {
+    PVData data;
+    data.value = PVScalarValue{"SR:STATE:RUNNING:NOMINAL"};
+    data.count = 1;
+    EXPECT_EQ(PV::extract_as<std::string>(data), "SR:STATE:RUNNING:NOMINAL");
+    EXPECT_FALSE(NumericScalar(data).has_value());
+    EXPECT_THROW(PV::extract_as<double>(data), std::runtime_error);
+}
+
+TEST(PVDataTest, ScalarsAreInline) {
+    // The variant holds every scalar, strings included, without the heap
+    EXPECT_LE(sizeof(PVScalarValue), 64u);
+    EXPECT_TRUE(std::is_nothrow_move_constructible_v<PVData>);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "bt_runner.h"
+#include "epics/loopback/loopback_transport.h"
+
+using namespace bchtree;
+
+class BTRunnerReloadTest : public ::testing::Test {
+   protected:
+    std::shared_ptr<epics::loopback::LoopbackTransport> transport =
+        std::make_shared<epics::loopback::LoopbackTransport>();
+    std::shared_ptr<epics::PVManager> pv_manager =
+        std::make_shared<epics::PVManager>(transport);
+    std::string path =
+        (std::filesystem::temp_directory_path() / "bch-reload.xml").string();
+
+    void WriteTree(const std::string& pv1, const std::string& pv2) {
+        std::ofstream(path)
+            << R"(<root BTCPP_format="4"><BehaviorTree ID="MainTree">)"
+            << R"(<Sequence><CAGetDouble pv=")" << pv1 << R"("/>)"
+            << R"(<CAGetDouble pv=")" << pv2 << R"("/></Sequence>)"
+            << "</BehaviorTree></root>";
+    }
+
+    void TearDown() override { std::filesystem::remove(path); }
+};
+
+TEST_F(BTRunnerReloadTest, KeepsSharedChannels) {
+    WriteTree("LB:A", "LB:B");
+    BTRunner runner(pv_manager);
+    runner.RegisterTreeFromFile(path);
+    ASSERT_TRUE(runner.Run());
+    std::weak_ptr<epics::PV> a = pv_manager->Find("LB:A");
+    std::weak_ptr<epics::PV> b = pv_manager->Find("LB:B");
+    ASSERT_FALSE(a.expired());
+    ASSERT_FALSE(b.expired());
+
+    WriteTree("LB:A", "LB:C");
+    ASSERT_TRUE(runner.ReloadTree());
+
+    EXPECT_EQ(pv_manager->Find("LB:A"), a.lock());
+    EXPECT_TRUE(b.expired());
+    EXPECT_NE(pv_manager->Find("LB:C"), nullptr);
+    EXPECT_TRUE(runner.Run());
+}
+
+TEST_F(BTRunnerReloadTest, KeepsTreeIfFileDoesNotLoad) {
+    WriteTree("LB:A", "LB:B");
+    BTRunner runner(pv_manager);
+    runner.RegisterTreeFromFile(path);
+
+    std::ofstream(path) << "<root";
+    EXPECT_FALSE(runner.ReloadTree());
+    EXPECT_TRUE(runner.Run());
+    EXPECT_NE(pv_manager->Find("LB:B"), nullptr);
+}
+
+TEST_F(BTRunnerReloadTest, ReloadsChangedFileBeforeRun) {
+    WriteTree("LB:A", "LB:B");
+    BTRunner runner(pv_manager);
+    runner.RegisterTreeFromFile(path);
+    runner.WatchTreeFile();
+
+    WriteTree("LB:A", "LB:D");
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!pv_manager->Find("LB:D") &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        EXPECT_TRUE(runner.Run());
+    }
+    EXPECT_NE(pv_manager->Find("LB:D"), nullptr);
+}
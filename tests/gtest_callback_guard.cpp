@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "callback_guard.h"
+
+using namespace bchtree;
+
+TEST(CallbackGuard, CallsUntilClosed) {
+    int calls = 0;
+    CallbackGuard guard;
+    std::function<void(int)> cb = guard.Wrap([&](int n) { calls += n; });
+
+    cb(2);
+    EXPECT_EQ(calls, 2);
+    guard.Close();
+    cb(3);
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(CallbackGuard, OutlivedByCallback) {
+    std::function<void()> cb;
+    bool called = false;
+    {
+        CallbackGuard guard;
+        cb = guard.Wrap([&] { called = true; });
+    }
+    cb();
+    EXPECT_FALSE(called);
+}
+
+TEST(CallbackGuard, CloseWaitsForRunningCallback) {
+    CallbackGuard guard;
+    std::atomic<bool> entered{false};
+    std::atomic<bool> finished{false};
+    auto cb = guard.Wrap([&] {
+        entered = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        finished = true;
+    });
+
+    std::thread caller(cb);
+    while (!entered) std::this_thread::yield();
+    guard.Close();
+    EXPECT_TRUE(finished);
+    caller.join();
+}
+
+TEST(CallbackGuard, CallbackMayRunAnotherCallback) {
+    CallbackGuard guard;
+    int inner_calls = 0;
+    std::function<void()> inner = guard.Wrap([&] { ++inner_calls; });
+    std::function<void()> outer = guard.Wrap([&] { inner(); });
+
+    outer();
+    EXPECT_EQ(inner_calls, 1);
+}
+
+TEST(CallbackGuard, RoutedCallbacksRunOnDrain) {
+    auto queue = std::make_shared<CallbackQueue>(8);
+    queue->SetActive(true);
+    int wakes = 0;
+    CallbackGuard guard;
+    guard.Route(queue, [&] { ++wakes; });
+
+    std::vector<int> seen;
+    std::function<void(int)> cb = guard.Wrap([&](int n) { seen.push_back(n); });
+    std::thread producer([&] {
+        cb(1);
+        cb(2);
+    });
+    producer.join();
+    EXPECT_TRUE(seen.empty());
+    EXPECT_EQ(wakes, 2);
+
+    EXPECT_EQ(queue->Drain(), 2u);
+    EXPECT_EQ(seen, (std::vector<int>{1, 2}));
+
+    // In place on the draining thread, and once inactive
+    cb(3);
+    queue->SetActive(false);
+    std::thread([&] { cb(4); }).join();
+    EXPECT_EQ(seen, (std::vector<int>{1, 2, 3, 4}));
+    EXPECT_EQ(queue->Drain(), 0u);
+    EXPECT_EQ(queue->Dropped(), 0u);
+}
+
+TEST(CallbackGuard, CompletionsOverflowAFullQueue) {
+    auto queue = std::make_shared<CallbackQueue>(2);
+    queue->SetActive(true);
+    int wakes = 0;
+    CallbackGuard guard;
+    guard.Route(queue, [&] { ++wakes; });
+
+    std::vector<int> seen;
+    std::function<void(int)> cb = guard.Wrap([&](int n) { seen.push_back(n); });
+    std::thread([&] {
+        for (int i = 0; i < 4; ++i) cb(i);
+    }).join();
+    EXPECT_TRUE(seen.empty());
+    EXPECT_EQ(wakes, 4);
+
+    EXPECT_EQ(queue->Drain(), 4u);
+    EXPECT_EQ(seen, (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(queue->Dropped(), 0u);
+}
+
+TEST(CallbackGuard, FullQueueDropsMonitorUpdatesAfterRetries) {
+    auto queue = std::make_shared<CallbackQueue>(2);
+    queue->SetActive(true);
+    int wakes = 0;
+    CallbackGuard guard;
+    guard.Route(queue, [&] { ++wakes; });
+
+    int calls = 0;
+    std::function<void()> cb =
+        guard.WrapMonitor([] { return true; }, [&] { ++calls; });
+    // Never in place on the producer thread, even with the queue full
+    std::thread([&] {
+        for (int i = 0; i < 3; ++i) cb();
+    }).join();
+    EXPECT_EQ(calls, 0);
+    EXPECT_EQ(queue->Dropped(), 1u);
+    EXPECT_EQ(wakes, 2 + CallbackGuard::kFullQueueRetries);
+
+    EXPECT_EQ(queue->Drain(), 2u);
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(CallbackGuard, QueuedCallbackSkippedAfterClose) {
+    auto queue = std::make_shared<CallbackQueue>(8);
+    queue->SetActive(true);
+    bool called = false;
+    std::function<void()> cb;
+    {
+        CallbackGuard guard;
+        guard.Route(queue, nullptr);
+        cb = guard.Wrap([&] { called = true; });
+        std::thread(cb).join();
+    }
+    EXPECT_EQ(queue->Drain(), 1u);
+    EXPECT_FALSE(called);
+}
+
+TEST(CallbackGuard, UnwantedMonitorUpdatesAreNotQueued) {
+    auto queue = std::make_shared<CallbackQueue>(8);
+    queue->SetActive(true);
+    int wakes = 0;
+    CallbackGuard guard;
+    guard.Route(queue, [&] { ++wakes; });
+
+    std::atomic<bool> waiting{false};
+    std::vector<int> seen;
+    std::function<void(int)> cb = guard.WrapMonitor(
+        [&](int) { return waiting.load(); },
+        [&](int n) { seen.push_back(n); });
+    std::thread([&] {
+        cb(1);
+        waiting = true;
+        cb(2);
+    }).join();
+    EXPECT_EQ(wakes, 1);
+
+    EXPECT_EQ(queue->Drain(), 1u);
+    EXPECT_EQ(seen, (std::vector<int>{2}));
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "callback_queue.h"
+
+using namespace bchtree;
+
+TEST(CallbackQueue, RunsInPushOrder) {
+    CallbackQueue queue(4);
+    queue.SetActive(true);
+    std::vector<int> seen;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue.Push([&seen, i] { seen.push_back(i); }));
+    }
+    EXPECT_EQ(queue.Drain(), 3u);
+    EXPECT_EQ(seen, (std::vector<int>{0, 1, 2}));
+    EXPECT_EQ(queue.Drain(), 0u);
+}
+
+TEST(CallbackQueue, RefusesWhenFullOrInactive) {
+    CallbackQueue queue(3);
+    EXPECT_EQ(queue.Capacity(), 4u);
+    EXPECT_FALSE(queue.Push([] {}));
+
+    queue.SetActive(true);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.Push([] {}));
+    EXPECT_FALSE(queue.Push([] {}));
+    EXPECT_EQ(queue.Overflows(), 1u);
+
+    EXPECT_EQ(queue.Drain(), 4u);
+    EXPECT_TRUE(queue.Push([] {}));
+}
+
+TEST(CallbackQueue, PostOverflowsAFullRing) {
+    CallbackQueue queue(2);
+    std::vector<int> seen;
+    EXPECT_FALSE(queue.Post([&] { seen.push_back(-1); }));
+
+    queue.SetActive(true);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.Post([&seen, i] { seen.push_back(i); }));
+    }
+    EXPECT_EQ(queue.Overflows(), 2u);
+    EXPECT_EQ(queue.Drain(), 4u);
+    EXPECT_EQ(seen, (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(queue.Drain(), 0u);
+}
+
+TEST(CallbackQueue, ThrowingTaskIsRemoved) {
+    CallbackQueue queue(4);
+    queue.SetActive(true);
+    int calls = 0;
+    queue.Push([] { throw std::runtime_error("failed"); });
+    queue.Push([&] { ++calls; });
+
+    EXPECT_THROW(queue.Drain(), std::runtime_error);
+    EXPECT_EQ(queue.Drain(), 1u);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(CallbackQueue, LargeTasksAndPendingTasksAreDestroyed) {
+    auto token = std::make_shared<int>(0);
+    {
+        CallbackQueue queue(4);
+        queue.SetActive(true);
+        std::array<char, CallbackQueue::kTaskSize> big{};
+        queue.Push([token, big] { (void)big; });
+        queue.Push([token] {});
+        EXPECT_EQ(token.use_count(), 3);
+    }
+    EXPECT_EQ(token.use_count(), 1);
+}
+
+TEST(CallbackQueue, KeepsTheOrderOfEachProducer) {
+    constexpr int kProducers = 4;
+    constexpr int kPushes = 20000;
+    CallbackQueue queue(256);
+    queue.SetActive(true);
+
+    std::array<int, kProducers> last;
+    last.fill(-1);
+    bool ordered = true;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kPushes; ++i) {
+                while (!queue.Push([&, p, i] {
+                    if (last[p] + 1 != i) ordered = false;
+                    last[p] = i;
+                })) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    size_t ran = 0;
+    while (ran < size_t{kProducers} * kPushes) ran += queue.Drain();
+    for (auto& t : producers) t.join();
+
+    EXPECT_TRUE(ordered);
+    for (int p = 0; p < kProducers; ++p) EXPECT_EQ(last[p], kPushes - 1);
+}
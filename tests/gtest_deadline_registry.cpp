@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "deadline_registry.h"
+
+using namespace std::chrono_literals;
+using bchtree::DeadlineRegistry;
+
+TEST(DeadlineRegistryTest, EmptyHasNoEarliest) {
+    DeadlineRegistry deadlines;
+    EXPECT_FALSE(deadlines.Earliest().has_value());
+    EXPECT_EQ(deadlines.Size(), 0u);
+}
+
+TEST(DeadlineRegistryTest, EarliestIsMinimumOfArmed) {
+    DeadlineRegistry deadlines;
+    const auto now = DeadlineRegistry::Clock::now();
+
+    deadlines.Arm(now + 300ms);
+    deadlines.Arm(now + 100ms);
+    deadlines.Arm(now + 200ms);
+
+    ASSERT_TRUE(deadlines.Earliest().has_value());
+    EXPECT_EQ(*deadlines.Earliest(), now + 100ms);
+    EXPECT_EQ(deadlines.Size(), 3u);
+}
+
+TEST(DeadlineRegistryTest, DisarmRemovesOnlyGivenId) {
+    DeadlineRegistry deadlines;
+    const auto now = DeadlineRegistry::Clock::now();
+
+    auto first = deadlines.Arm(now + 100ms);
+    deadlines.Arm(now + 100ms);  // same deadline, different owner
+    deadlines.Arm(now + 200ms);
+
+    deadlines.Disarm(first);
+    EXPECT_EQ(deadlines.Size(), 2u);
+    EXPECT_EQ(*deadlines.Earliest(), now + 100ms);
+
+    // Disarming twice or an invalid id is a no-op
+    deadlines.Disarm(first);
+    deadlines.Disarm(DeadlineRegistry::kInvalidId);
+    EXPECT_EQ(deadlines.Size(), 2u);
+}
+
+TEST(DeadlineRegistryTest, ExpireRunsDueCallbacksOnly) {
+    DeadlineRegistry deadlines;
+    const auto now = DeadlineRegistry::Clock::now();
+    int fired = 0;
+
+    deadlines.Arm(now + 10ms, [&] { fired += 1; });
+    deadlines.Arm(now + 10ms + 300us, [&] { fired += 10; });
+    deadlines.Arm(now + 20ms);
+
+    EXPECT_EQ(deadlines.Expire(now + 9ms), 0u);
+    EXPECT_EQ(fired, 0);
+
+    // Within the same millisecond, only what is due
+    EXPECT_EQ(deadlines.Expire(now + 10ms + 100us), 1u);
+    EXPECT_EQ(fired, 1);
+    EXPECT_EQ(*deadlines.Earliest(), now + 10ms + 300us);
+
+    EXPECT_EQ(deadlines.Expire(now + 1s), 2u);
+    EXPECT_EQ(fired, 11);
+    EXPECT_EQ(deadlines.Size(), 0u);
+    EXPECT_FALSE(deadlines.Earliest().has_value());
+}
+
+TEST(DeadlineRegistryTest, FarDeadlinesCascadeToTheirExactTime) {
+    DeadlineRegistry deadlines;
+    const auto now = DeadlineRegistry::Clock::now();
+    std::vector<int> fired;
+
+    // One per level and one in the overflow list
+    const std::vector<std::chrono::milliseconds> delays = {
+        5ms, 300ms, 30s, 1h, 10h};
+    for (size_t i = 0; i < delays.size(); ++i) {
+        deadlines.Arm(now + delays[i],
+                      [&fired, i] { fired.push_back(static_cast<int>(i)); });
+    }
+
+    for (size_t i = 0; i < delays.size(); ++i) {
+        ASSERT_EQ(*deadlines.Earliest(), now + delays[i]);
+        deadlines.Expire(now + delays[i] - 1us);
+        EXPECT_EQ(fired.size(), i);
+        deadlines.Expire(now + delays[i]);
+        EXPECT_EQ(fired.size(), i + 1);
+    }
+    EXPECT_EQ(fired, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(DeadlineRegistryTest, DisarmedOrExpiredIdIsStale) {
+    DeadlineRegistry deadlines;
+    const auto now = DeadlineRegistry::Clock::now();
+    bool fired = false;
+
+    auto disarmed = deadlines.Arm(now + 5ms, [&] { fired = true; });
+    deadlines.Disarm(disarmed);
+    auto expired = deadlines.Arm(now + 5ms);
+    deadlines.Expire(now + 5ms);
+    EXPECT_FALSE(fired);
+
+    // The entries are reused; the old ids must not remove the new deadline
+    auto armed = deadlines.Arm(now + 50ms);
+    deadlines.Disarm(disarmed);
+    deadlines.Disarm(expired);
+    EXPECT_EQ(deadlines.Size(), 1u);
+    deadlines.Disarm(armed);
+    EXPECT_EQ(deadlines.Size(), 0u);
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "file_watcher.h"
+
+using namespace bchtree;
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+bool WaitFor(const std::atomic<int>& count, int want) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (count.load() < want) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST(FileWatcher, SeesWrites) {
+    const auto path = TempPath("bch-watch-write.xml");
+    std::ofstream(path) << "a";
+
+    std::atomic<int> changes{0};
+    FileWatcher watcher(path, [&] { ++changes; });
+    std::ofstream(path) << "b";
+    EXPECT_TRUE(WaitFor(changes, 1));
+
+    std::filesystem::remove(path);
+}
+
+TEST(FileWatcher, SeesReplacementByRename) {
+    const auto path = TempPath("bch-watch-rename.xml");
+    const auto tmp = TempPath("bch-watch-rename.xml.tmp");
+    std::ofstream(path) << "a";
+
+    std::atomic<int> changes{0};
+    FileWatcher watcher(path, [&] { ++changes; });
+    std::ofstream(tmp) << "b";
+    // The write of the temporary file is not a change of path
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(changes.load(), 0);
+
+    std::filesystem::rename(tmp, path);
+    EXPECT_TRUE(WaitFor(changes, 1));
+
+    std::filesystem::remove(path);
+}
+
+TEST(FileWatcher, ThrowsForMissingDirectory) {
+    EXPECT_THROW(FileWatcher("/nonexistent-bch-dir/tree.xml", [] {}),
+                 std::runtime_error);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "flight_recorder.h"
+
+using namespace bchtree;
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+}  // namespace
+
+TEST(FlightRecorder, RoundsCapacityUpToPowerOfTwo) {
+    FlightRecorder recorder(100);
+    EXPECT_EQ(recorder.Capacity(), 128u);
+}
+
+TEST(FlightRecorder, KeepsMostRecentRecordsInOrder) {
+    FlightRecorder recorder(8);
+    for (uint32_t i = 0; i < 20; ++i) {
+        recorder.Record(FlightEvent::CAGet, i, 0, 0, 1);
+    }
+
+    const auto records = recorder.Snapshot();
+    ASSERT_EQ(records.size(), 8u);
+    for (uint32_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(records[i].subject, 12 + i);
+    }
+    EXPECT_LE(records.front().time_ns, records.back().time_ns);
+}
+
+TEST(FlightRecorder, ConcurrentWritersDoNotLoseRecords) {
+    constexpr int kThreads = 4;
+    constexpr uint32_t kPerThread = 1000;
+    FlightRecorder recorder(kThreads * kPerThread);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&recorder, t] {
+            for (uint32_t i = 0; i < kPerThread; ++i) {
+                recorder.Record(FlightEvent::CAMonitor, t, 0, 0, 1);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(recorder.Snapshot().size(), kThreads * kPerThread);
+}
+
+TEST(FlightRecorder, DumpRoundTrip) {
+    FlightRecorder recorder(16);
+    EXPECT_EQ(recorder.AddNode("Main/Open"), 0u);
+    const uint32_t read = recorder.AddNode("Main/ReadCurrent");
+    const uint32_t pv = recorder.AddPV("TEST:AO");
+
+    recorder.Record(FlightEvent::CAConnect, pv, 0, 1);
+    recorder.Record(FlightEvent::NodeStatus, read, 1, 3);
+    recorder.Record(FlightEvent::CAGet, pv, 0, 0, 192);
+
+    const auto path = TempPath("bch_tree_flight.bin");
+    ASSERT_TRUE(recorder.Dump(path));
+
+    const auto dump = LoadFlightDump(path);
+    ASSERT_EQ(dump.records.size(), 3u);
+    ASSERT_EQ(dump.pv_names.size(), 1u);
+    EXPECT_EQ(dump.node_names.at(read), "Main/ReadCurrent");
+    EXPECT_EQ(dump.records[2].detail, 192);
+
+    const auto connect = FormatFlightRecord(dump, dump.records[0]);
+    EXPECT_NE(connect.find("CONNECT TEST:AO  up"), std::string::npos);
+    const auto node = FormatFlightRecord(dump, dump.records[1]);
+    EXPECT_NE(node.find("Main/ReadCurrent  RUNNING -> FAILURE"),
+              std::string::npos);
+    const auto get = FormatFlightRecord(dump, dump.records[2]);
+    EXPECT_NE(get.find("GET     TEST:AO  status=192"), std::string::npos);
+
+    std::remove(path.c_str());
+}
+
+TEST(FlightRecorder, ConcurrentDumpsShareThePath) {
+    FlightRecorder recorder(1024);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        recorder.Record(FlightEvent::CAMonitor, i, 0, 0);
+    }
+
+    const auto path = TempPath("bch_tree_flight_concurrent.bin");
+    std::vector<std::thread> threads;
+    std::atomic<int> failed{0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; ++i) {
+                if (!recorder.Dump(path)) ++failed;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(failed, 0);
+    EXPECT_EQ(LoadFlightDump(path).records.size(), 1000u);
+    std::remove(path.c_str());
+}
+
+TEST(FlightRecorder, LoadRejectsOtherFiles) {
+    const auto path = TempPath("bch_tree_not_flight.bin");
+    {
+        FILE* fp = std::fopen(path.c_str(), "w");
+        std::fputs("hello", fp);
+        std::fclose(fp);
+    }
+    EXPECT_THROW(LoadFlightDump(path), std::runtime_error);
+    EXPECT_THROW(LoadFlightDump(TempPath("bch_tree_missing.bin")),
+                 std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "inline_function.h"
+
+using namespace bchtree;
+
+TEST(InlineFunction, EmptyFromNullOrEmptyFunction) {
+    InlineFunction<void(int)> from_null = nullptr;
+    EXPECT_FALSE(from_null);
+    EXPECT_THROW(from_null(1), std::bad_function_call);
+
+    InlineFunction<void(int)> from_function = std::function<void(int)>();
+    EXPECT_FALSE(from_function);
+
+    void (*pointer)(int) = nullptr;
+    InlineFunction<void(int)> from_pointer = pointer;
+    EXPECT_FALSE(from_pointer);
+}
+
+TEST(InlineFunction, CopiesAndMovesTheCaptures) {
+    auto count = std::make_shared<int>(0);
+    InlineFunction<int(int)> add = [count](int n) { return *count += n; };
+    EXPECT_EQ(count.use_count(), 2);
+
+    InlineFunction<int(int)> copy = add;
+    EXPECT_EQ(count.use_count(), 3);
+    EXPECT_EQ(copy(2), 2);
+    EXPECT_EQ(add(3), 5);
+
+    InlineFunction<int(int)> moved = std::move(copy);
+    EXPECT_FALSE(copy);
+    EXPECT_EQ(moved(1), 6);
+    EXPECT_EQ(count.use_count(), 3);
+
+    moved = nullptr;
+    add = nullptr;
+    EXPECT_EQ(count.use_count(), 1);
+}
+
+TEST(InlineFunction, LargeCallablesGoToTheHeap) {
+    auto count = std::make_shared<int>(0);
+    std::array<char, 64> padding{};
+    padding[0] = 'x';
+    InlineFunction<std::string(), 16> large = [count, padding] {
+        ++*count;
+        return std::string(1, padding[0]);
+    };
+    EXPECT_EQ(large(), "x");
+
+    InlineFunction<std::string(), 16> copy = large;
+    InlineFunction<std::string(), 16> moved = std::move(large);
+    EXPECT_EQ(copy(), "x");
+    EXPECT_EQ(moved(), "x");
+    EXPECT_EQ(*count, 3);
+    EXPECT_EQ(count.use_count(), 3);
+
+    copy = moved;
+    EXPECT_EQ(count.use_count(), 3);
+    moved = nullptr;
+    copy = nullptr;
+    EXPECT_EQ(count.use_count(), 1);
+}
+
+TEST(InlineFunction, MutableLambdaKeepsItsState) {
+    InlineFunction<int()> counter = [n = 0]() mutable { return ++n; };
+    EXPECT_EQ(counter(), 1);
+    EXPECT_EQ(counter(), 2);
+}
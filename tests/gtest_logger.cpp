@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+
+using namespace bchtree;
+
+namespace {
+
+std::string TempLogPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+size_t CountLines(const std::string& path, const std::string& needle) {
+    std::ifstream in(path);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(in, line)) {
+        if (line.find(needle) != std::string::npos) ++count;
+    }
+    return count;
+}
+
+// Counts how often it is formatted
+struct Counted {
+    static inline int formatted = 0;
+};
+
+}  // namespace
+
+template <>
+struct fmt::formatter<Counted> : fmt::formatter<int> {
+    template <typename FormatContext>
+    auto format(const Counted&, FormatContext& ctx) const {
+        return fmt::formatter<int>::format(++Counted::formatted, ctx);
+    }
+};
+
+TEST(Logger, SyncWritesFile) {
+    const auto path = TempLogPath("bch_tree_sync.log");
+    {
+        Logger logger;
+        logger.setConsole(false);
+        logger.setFile(path);
+        logger.info("hello sync");
+        logger.debug("hidden");  // below the default level
+        logger.flush();
+    }
+    EXPECT_EQ(CountLines(path, "hello sync"), 1u);
+    EXPECT_EQ(CountLines(path, "hidden"), 0u);
+    std::remove(path.c_str());
+}
+
+TEST(Logger, FirstMessagesFromSeveralThreads) {
+    const auto path = TempLogPath("bch_tree_threads.log");
+    constexpr int kThreads = 8;
+    {
+        Logger logger;
+        logger.setConsole(false);
+        logger.setFile(path);
+        // Each thread may be the one creating the logger
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&logger] { logger.info("racing"); });
+        }
+        for (auto& t : threads) t.join();
+        logger.flush();
+    }
+    EXPECT_EQ(CountLines(path, "racing"), static_cast<size_t>(kThreads));
+    std::remove(path.c_str());
+}
+
+TEST(Logger, AsyncBlockKeepsEveryMessage) {
+    const auto path = TempLogPath("bch_tree_async.log");
+    constexpr size_t kMessages = 1000;
+    {
+        Logger logger;
+        logger.setConsole(false);
+        logger.setFile(path);
+        AsyncLogOptions options;
+        options.queue_size = 16;
+        logger.setAsync(options);
+        for (size_t i = 0; i < kMessages; ++i) {
+            logger.info("async " + std::to_string(i));
+        }
+        EXPECT_EQ(logger.droppedMessages(), 0u);
+    }  // the destructor drains the queue
+    EXPECT_EQ(CountLines(path, "async "), kMessages);
+    std::remove(path.c_str());
+}
+
+TEST(Logger, AsyncDropOldestCountsDrops) {
+    const auto path = TempLogPath("bch_tree_drop.log");
+    constexpr size_t kMessages = 10000;
+    size_t dropped = 0;
+    {
+        Logger logger;
+        logger.setConsole(false);
+        logger.setFile(path);
+        AsyncLogOptions options;
+        options.queue_size = 4;
+        options.overflow = LogOverflow::DropOldest;
+        logger.setAsync(options);
+        for (size_t i = 0; i < kMessages; ++i) {
+            logger.info("drop " + std::to_string(i));
+        }
+        dropped = logger.droppedMessages();
+    }
+    EXPECT_EQ(CountLines(path, "drop ") + dropped, kMessages);
+    std::remove(path.c_str());
+}
+
+TEST(Logger, FormatsOnlyEnabledLevels) {
+    const auto path = TempLogPath("bch_tree_fmt.log");
+    Counted::formatted = 0;
+    {
+        Logger logger;
+        logger.setConsole(false);
+        logger.setFile(path);
+        logger.setLevel("info");
+
+        logger.debug(FMT_STRING("skipped {}"), Counted{});
+        EXPECT_EQ(Counted::formatted, 0);
+        EXPECT_FALSE(logger.shouldLog(spdlog::level::debug));
+
+        logger.info(FMT_STRING("value {} {:.1f}"), Counted{}, 2.25);
+        EXPECT_EQ(Counted::formatted, 1);
+        logger.flush();
+    }
+    EXPECT_EQ(CountLines(path, "value 1 2.2"), 1u);
+    EXPECT_EQ(CountLines(path, "skipped"), 0u);
+    std::remove(path.c_str());
+}
+
+TEST(Logger, PreformattedMessageIsNotAFormat) {
+    const auto path = TempLogPath("bch_tree_plain.log");
+    {
+        Logger logger;
+        logger.setConsole(false);
+        logger.setFile(path);
+        logger.info(std::string("braces {} kept"));
+        logger.flush();
+    }
+    EXPECT_EQ(CountLines(path, "braces {} kept"), 1u);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "epics/loopback/loopback_transport.h"
+#include "epics/pv_manager.h"
+#include "metrics.h"
+
+using namespace std::chrono_literals;
+using namespace bchtree;
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::string HttpGet(uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return "";
+    }
+    const std::string request = "GET /metrics HTTP/1.1\r\n\r\n";
+    (void)!write(fd, request.data(), request.size());
+
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) response.append(buf, n);
+    close(fd);
+    return response;
+}
+
+}  // namespace
+
+TEST(LatencyHistogram, BucketsKeepAnEighthOfPrecision) {
+    for (uint64_t us = 0; us < 8; ++us) {
+        const size_t index = LatencyHistogram::BucketIndex(us);
+        EXPECT_EQ(LatencyHistogram::BucketMax(index), us);
+    }
+    for (uint64_t us : {8u, 100u, 1000u, 123456u, 10000000u}) {
+        const size_t index = LatencyHistogram::BucketIndex(us);
+        const uint64_t max = LatencyHistogram::BucketMax(index);
+        EXPECT_GE(max, us);
+        EXPECT_LE(max - us, us / 8);
+        if (index > 0) {
+            EXPECT_LT(LatencyHistogram::BucketMax(index - 1), us);
+        }
+    }
+}
+
+TEST(LatencyHistogram, Quantiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.Quantile(0.5), 0ns);
+
+    for (int i = 1; i <= 100; ++i) {
+        histogram.Record(std::chrono::microseconds(i));
+    }
+
+    EXPECT_EQ(histogram.Count(), 100u);
+    EXPECT_EQ(histogram.Sum(), 5050us);
+    EXPECT_EQ(histogram.Quantile(0.0), 1us);
+    const auto median = histogram.Quantile(0.5);
+    EXPECT_GE(median, 50us);
+    EXPECT_LE(median, 57us);
+    EXPECT_GE(histogram.Quantile(1.0), 100us);
+    EXPECT_EQ(histogram.CountAtOrBelow(7us), 7u);
+}
+
+TEST(MetricsRegistry, PrometheusText) {
+    MetricsRegistry registry;
+    auto node = registry.ForNode("main", "Seq/Get");
+    EXPECT_EQ(node, registry.ForNode("main", "Seq/Get"));
+    node->ticks = 3;
+    node->tick_time.Record(20us);
+    node->tick_time.Record(2ms);
+    registry.ForPV("TEST:\"AO\"")->get_errors = 2;
+
+    const std::string text = registry.Prometheus();
+    EXPECT_NE(text.find("# TYPE bchtree_node_ticks_total counter\n"),
+              std::string::npos);
+    EXPECT_NE(
+        text.find("bchtree_node_ticks_total{tree=\"main\",node=\"Seq/Get\"} 3"),
+        std::string::npos);
+    EXPECT_NE(text.find("bchtree_node_tick_seconds_bucket{tree=\"main\","
+                        "node=\"Seq/Get\",le=\"5e-05\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("bchtree_node_tick_seconds_bucket{tree=\"main\","
+                        "node=\"Seq/Get\",le=\"+Inf\"} 2\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("bchtree_node_tick_seconds_count{tree=\"main\","
+                        "node=\"Seq/Get\"} 2\n"),
+              std::string::npos);
+    EXPECT_NE(
+        text.find("bchtree_pv_get_errors_total{pv=\"TEST:\\\"AO\\\"\"} 2"),
+        std::string::npos);
+}
+
+TEST(MetricsExporter, WritesFileAndServesHttp) {
+    auto registry = std::make_shared<MetricsRegistry>();
+    registry->ForPV("TEST:AO")->connects = 1;
+    const std::string path = TempPath("bchtree_metrics_test.prom");
+    std::filesystem::remove(path);
+    {
+        MetricsExporter exporter(registry);
+        exporter.StartFileWriter(path, 10s);
+
+        const uint16_t port = exporter.Listen(0);
+        ASSERT_NE(port, 0);
+        const std::string response = HttpGet(port);
+        EXPECT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+        EXPECT_NE(response.find("bchtree_pv_connects_total{pv=\"TEST:AO\"} 1"),
+                  std::string::npos);
+
+        registry->ForPV("TEST:AO")->connects = 2;
+    }
+
+    // The last write happens when the exporter stops
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    EXPECT_NE(text.str().find("bchtree_pv_connects_total{pv=\"TEST:AO\"} 2"),
+              std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST(PVMetrics, CountsRequestsOfTheLoopbackTransport) {
+    auto transport = std::make_shared<epics::loopback::LoopbackTransport>();
+    auto registry = std::make_shared<MetricsRegistry>();
+    epics::PVManager manager(transport);
+    manager.SetMetrics(registry);
+
+    auto pv = manager.Get("LB:AO");
+    ASSERT_TRUE(manager.ConnectAll({pv}, 1s).empty());
+    auto metrics = registry->ForPV("LB:AO");
+    EXPECT_EQ(metrics->connects.load(), 1u);
+
+    std::promise<void> got;
+    ASSERT_TRUE(pv->GetCB([&](epics::PVData) { got.set_value(); }, 1s));
+    ASSERT_EQ(got.get_future().wait_for(2s), std::future_status::ready);
+
+    std::promise<void> put;
+    ASSERT_TRUE(pv->PutCB(epics::PVScalarValue{2.0},
+                          [&](bool) { put.set_value(); }));
+    ASSERT_EQ(put.get_future().wait_for(2s), std::future_status::ready);
+
+    EXPECT_EQ(metrics->get_time.Count(), 1u);
+    EXPECT_EQ(metrics->put_time.Count(), 1u);
+    EXPECT_EQ(metrics->get_errors.load(), 0u);
+    EXPECT_EQ(metrics->put_errors.load(), 0u);
+    EXPECT_EQ(metrics->outstanding.load(), 0);
+}
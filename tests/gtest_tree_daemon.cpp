@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "epics/loopback/loopback_transport.h"
+#include "tree_daemon.h"
+
+using namespace bchtree;
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Send one command line and return the reply without the newline
+std::string Command(const std::string& path, const std::string& line) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return "connect failed";
+    }
+    const std::string request = line + "\n";
+    EXPECT_EQ(write(fd, request.data(), request.size()),
+              static_cast<ssize_t>(request.size()));
+
+    std::string reply;
+    char c;
+    while (read(fd, &c, 1) == 1 && c != '\n') reply.push_back(c);
+    close(fd);
+    return reply;
+}
+
+}  // namespace
+
+class TreeDaemonTest : public ::testing::Test {
+   protected:
+    std::shared_ptr<epics::loopback::LoopbackTransport> transport =
+        std::make_shared<epics::loopback::LoopbackTransport>();
+    std::shared_ptr<epics::PVManager> pv_manager =
+        std::make_shared<epics::PVManager>(transport);
+    TreeScheduler scheduler{pv_manager, 1};
+    TreeDaemon daemon;
+    std::string tree_path = TempPath("bch-daemon-tree.xml");
+    std::thread server;
+
+    void SetUp() override {
+        std::ofstream(tree_path)
+            << R"(<root BTCPP_format="4"><BehaviorTree ID="MainTree">)"
+            << R"(<CAPutDouble pv="LB:OUT" value="1"/>)"
+            << "</BehaviorTree></root>";
+        auto runner = std::make_unique<BTRunner>(pv_manager);
+        runner->RegisterTreeFromFile(tree_path);
+        scheduler.Add("tree", std::move(runner));
+        server = std::thread([this] { daemon.Serve(scheduler); });
+    }
+
+    void TearDown() override {
+        daemon.Stop();
+        server.join();
+        std::filesystem::remove(tree_path);
+    }
+};
+
+TEST_F(TreeDaemonTest, RerunsTreeOnEachTrigger) {
+    for (uint64_t run = 1; run <= 3; ++run) {
+        EXPECT_EQ(daemon.Trigger("test"), run);
+        const auto report = daemon.WaitFor(run);
+        ASSERT_TRUE(report);
+        EXPECT_EQ(report->run, run);
+        EXPECT_EQ(report->trigger, "test");
+        EXPECT_TRUE(report->success);
+        EXPECT_GE(report->latency, report->duration);
+    }
+    EXPECT_EQ(scheduler.Reports()[0].stats.ticks, 3u);
+}
+
+TEST_F(TreeDaemonTest, TriggersOnPVChange) {
+    transport->SetValue("LB:TRIG", 0.0);
+    daemon.TriggerOnPV(pv_manager, "LB:TRIG");
+    // Let the first update set the reference value
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(daemon.LastRun());
+
+    transport->SetValue("LB:TRIG", 1.0);
+    const auto report = daemon.WaitFor(1);
+    ASSERT_TRUE(report);
+    EXPECT_EQ(report->trigger, "pv");
+}
+
+TEST_F(TreeDaemonTest, AnswersSocketCommands) {
+    const auto path = TempPath("bch-daemon-test.sock");
+    daemon.ListenOnSocket(path);
+
+    EXPECT_EQ(Command(path, "status"), "idle");
+    const auto reply = Command(path, "run");
+    EXPECT_EQ(reply.rfind("run 1 SUCCESS trigger=socket", 0), 0u) << reply;
+    EXPECT_EQ(Command(path, "status").rfind("run 1 SUCCESS", 0), 0u);
+    EXPECT_EQ(Command(path, "bogus").rfind("error", 0), 0u);
+    EXPECT_EQ(Command(path, "stop"), "stopping");
+}
+
+TEST_F(TreeDaemonTest, ClientsDoNotWaitForEachOther) {
+    const auto path = TempPath("bch-daemon-clients.sock");
+    daemon.ListenOnSocket(path);
+
+    // Connected but silent: holds its thread for the read timeout
+    const int silent = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(connect(silent, reinterpret_cast<sockaddr*>(&addr),
+                      sizeof(addr)),
+              0);
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(Command(path, "status"), "idle");
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(500));
+    close(silent);
+}
+
+TEST_F(TreeDaemonTest, WaitForReturnsNulloptWhenStopped) {
+    daemon.Stop();
+    EXPECT_FALSE(daemon.WaitFor(1));
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epics/loopback/loopback_transport.h"
+#include "tree_scheduler.h"
+
+using namespace bchtree;
+
+namespace {
+
+std::string WriteTree(const std::string& name, const std::string& body) {
+    const auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream out(path);
+    out << R"(<root BTCPP_format="4"><BehaviorTree ID="MainTree">)" << body
+        << "</BehaviorTree></root>";
+    return path;
+}
+
+}  // namespace
+
+TEST(TickSlots, RejectsZeroSlots) {
+    EXPECT_THROW(TickSlots(0), std::invalid_argument);
+}
+
+TEST(TickSlots, BoundsConcurrentHolders) {
+    TickSlots slots(2);
+    std::atomic<int> holders{0};
+    std::atomic<int> peak{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 6; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 50; ++i) {
+                slots.Acquire();
+                const int now = ++holders;
+                int seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+                }
+                std::this_thread::yield();
+                --holders;
+                slots.Release();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_LE(peak.load(), 2);
+    EXPECT_GE(peak.load(), 1);
+}
+
+class TreeSchedulerTest : public ::testing::Test {
+   protected:
+    std::shared_ptr<epics::loopback::LoopbackTransport> transport =
+        std::make_shared<epics::loopback::LoopbackTransport>();
+    std::shared_ptr<epics::PVManager> pv_manager =
+        std::make_shared<epics::PVManager>(transport);
+
+    std::unique_ptr<BTRunner> Runner(const std::string& path) {
+        auto runner = std::make_unique<BTRunner>(pv_manager);
+        runner->SetConnectTimeout(std::chrono::milliseconds(0));
+        runner->RegisterTreeFromFile(path);
+        return runner;
+    }
+};
+
+TEST_F(TreeSchedulerTest, RunsTreesOnSharedChannels) {
+    transport->SetValue("LB:SHARED", 3.0);
+    const auto waiter = WriteTree(
+        "bch-sched-waiter.xml",
+        R"(<CAWaitUntil pv="LB:SHARED" op="ge" value="10" timeout="2000"/>)");
+    const auto writer = WriteTree(
+        "bch-sched-writer.xml",
+        R"(<Sequence><CAGetDouble pv="LB:SHARED" result="{v}"/>)"
+        R"(<CAPutDouble pv="LB:SHARED" value="10"/></Sequence>)");
+
+    // One slot: the trees still interleave, as each waits off the slot
+    TreeScheduler scheduler(pv_manager, 1);
+    scheduler.Add("waiter", Runner(waiter));
+    scheduler.Add("writer", Runner(writer));
+    EXPECT_TRUE(scheduler.Run());
+
+    const auto reports = scheduler.Reports();
+    ASSERT_EQ(reports.size(), 2u);
+    for (const auto& report : reports) {
+        EXPECT_EQ(report.status, BT::NodeStatus::SUCCESS) << report.name;
+        EXPECT_TRUE(report.error.empty()) << report.error;
+        EXPECT_GE(report.stats.ticks, 1u);
+        EXPECT_GE(report.stats.max_tick_time.count(), 0);
+    }
+    EXPECT_EQ(reports[0].name, "waiter");
+
+    std::filesystem::remove(waiter);
+    std::filesystem::remove(writer);
+}
+
+TEST_F(TreeSchedulerTest, ReportsFailedTree) {
+    const auto failing = WriteTree(
+        "bch-sched-failing.xml",
+        R"(<CAWaitUntil pv="LB:NEVER" value="1" timeout="50"/>)");
+
+    TreeScheduler scheduler(pv_manager, 2);
+    scheduler.Add("failing", Runner(failing));
+    EXPECT_FALSE(scheduler.Run());
+    EXPECT_EQ(scheduler.Reports()[0].status, BT::NodeStatus::FAILURE);
+
+    std::filesystem::remove(failing);
+}
+
+TEST_F(TreeSchedulerTest, ClearsTheErrorOfAnEarlierRun) {
+    transport->SetValue("LB:CALC", std::string("text"));
+    const auto calc = WriteTree("bch-sched-calc.xml",
+                                R"(<CACalc expr="LB:CALC" timeout="1000"/>)");
+
+    TreeScheduler scheduler(pv_manager, 1);
+    scheduler.Add("calc", Runner(calc));
+    EXPECT_FALSE(scheduler.Run());
+    EXPECT_FALSE(scheduler.Reports()[0].error.empty());
+
+    transport->SetValue("LB:CALC", 1.0);
+    auto pv = pv_manager->Get("LB:CALC");
+    for (int i = 0; i < 200 && !pv->NumericValue(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(scheduler.Run());
+    EXPECT_EQ(scheduler.Reports()[0].status, BT::NodeStatus::SUCCESS);
+    EXPECT_TRUE(scheduler.Reports()[0].error.empty());
+
+    std::filesystem::remove(calc);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <behaviortree_cpp/bt_factory.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "epics/loopback/loopback_transport.h"
+#include "epics/pv_manager.h"
+
+// Node tests against the in-process loopback server, without an IOC. Test
+// classes register their nodes in factory_ and pass options to simulate a
+// slow or changing server.
+class LoopbackFixture : public ::testing::Test {
+   protected:
+    explicit LoopbackFixture(
+        bchtree::epics::loopback::LoopbackOptions options = {})
+        : transport_(
+              std::make_shared<bchtree::epics::loopback::LoopbackTransport>(
+                  options)),
+          pv_manager_(
+              std::make_shared<bchtree::epics::PVManager>(transport_)) {}
+
+    // Options of a server that answers every request after the latency
+    static bchtree::epics::loopback::LoopbackOptions Latency(
+        std::chrono::milliseconds latency) {
+        bchtree::epics::loopback::LoopbackOptions options;
+        options.latency = latency;
+        return options;
+    }
+
+    // A tree of the given nodes, e.g. TreeOf(R"(<CAGetDouble pv="LB:X"/>)")
+    BT::Tree TreeOf(const std::string& nodes) {
+        return factory_.createTreeFromText(
+            R"(<root BTCPP_format="4"><BehaviorTree ID="Main">)" + nodes +
+            "</BehaviorTree></root>");
+    }
+
+    std::shared_ptr<bchtree::epics::loopback::LoopbackTransport> transport_;
+    std::shared_ptr<bchtree::epics::PVManager> pv_manager_;
+    BT::BehaviorTreeFactory factory_;
+};
@@ -3,6 +3,7 @@
 #include <filesystem>
 
 #include "epics/ca/ca_context_manager.h"
+#include "epics/ca/ca_transport.h"
 #include "softioc_runner.h"
 
 class SoftIocFixture : public ::testing::Test {
@@ -10,6 +11,8 @@ class SoftIocFixture : public ::testing::Test {
     static inline SoftIocRunner runner_{};
     static inline std::shared_ptr<bchtree::epics::ca::CAContextManager> ctx_{
         std::make_shared<bchtree::epics::ca::CAContextManager>()};
+    static inline std::shared_ptr<bchtree::epics::ca::CATransport> transport_{
+        std::make_shared<bchtree::epics::ca::CATransport>(ctx_)};
     static inline std::string db_text_;
 
     static void SetUpTestSuite();
@@ -4,7 +4,9 @@
 
 class SoftIocRunner {
    public:
-    pid_t Start(const std::string& db_text);
+    // program is softIoc, or softIocPVA to serve pvAccess as well
+    pid_t Start(const std::string& db_text,
+                const std::string& program = "softIoc");
     void KillIfRunning();
     void WriteDBtoTemp(const std::string& db_text);
 
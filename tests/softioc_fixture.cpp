@@ -29,6 +29,24 @@ void SoftIocFixture::SetUpTestSuite() {
                 field(VAL,  "")
                 field(PINI, "YES")
             }
+            record(waveform, "TEST:WF") {
+                field(FTVL, "DOUBLE")
+                field(NELM, "16")
+            }
+            record(waveform, "TEST:WF1") {
+                field(FTVL, "DOUBLE")
+                field(NELM, "1")
+            }
+            record(waveform, "TEST:CHAR") {
+                field(FTVL, "UCHAR")
+                field(NELM, "1")
+            }
+            record(bo, "TEST:BO") {
+                field(ZNAM, "CLOSED")
+                field(ONAM, "OPEN")
+                field(VAL,  "1")
+                field(PINI, "YES")
+            }
         )DB";
 
     runner_.Start(db_text_);
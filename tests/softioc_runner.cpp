@@ -10,12 +10,14 @@
 #include <string>
 #include <thread>
 
-pid_t SoftIocRunner::Start(const std::string& db_text) {
+pid_t SoftIocRunner::Start(const std::string& db_text,
+                           const std::string& program) {
     WriteDBtoTemp(db_text);
 
     // Spawn a child process to run 'cmd' and return PID
     pid_ = fork();
-    const std::string cmd = "softIoc -d \"" + temp_db_path_.string() + "\"";
+    const std::string cmd =
+        program + " -d \"" + temp_db_path_.string() + "\"";
 
     if (pid_ == 0) {
         execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*)nullptr);
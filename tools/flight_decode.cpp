@@ -0,0 +1,42 @@
+#include <cxxopts.hpp>
+#include <iostream>
+
+#include "flight_recorder.h"
+
+// Render a flight recorder dump as text, oldest event first
+int main(int argc, char** argv) {
+    cxxopts::Options options("bch-tree-flight",
+                             "Decode a bch-tree flight recorder dump");
+
+    // clang-format off
+    options.add_options()
+      ("f,file", "dump file", cxxopts::value<std::string>())
+      ("n,last", "print only the last N events (0: all)", cxxopts::value<size_t>()->default_value("0"))
+      ("h,help", "print usage");
+    // clang-format on
+    options.parse_positional({"file"});
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("file")) {
+        std::cout << options.help() << std::endl;
+        return 2;
+    }
+
+    bchtree::FlightDump dump;
+    try {
+        dump = bchtree::LoadFlightDump(result["file"].as<std::string>());
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    const size_t last = result["last"].as<size_t>();
+    const size_t first = last > 0 && last < dump.records.size()
+                             ? dump.records.size() - last
+                             : 0;
+    for (size_t i = first; i < dump.records.size(); ++i) {
+        std::cout << bchtree::FormatFlightRecord(dump, dump.records[i])
+                  << "\n";
+    }
+    return 0;
+}